@@ -133,6 +133,13 @@
 #define GSTCURL_DEFAULT_CONNECTIONS_SERVER 5
 #define GSTCURL_DEFAULT_CONNECTIONS_PROXY 30
 #define GSTCURL_DEFAULT_CONNECTIONS_GLOBAL 255
+
+/* Size of the buffers the body is received in, how many of them can wait
+ * for ::create() before the transfer is paused, and how often (in ms) the
+ * curl loop checks whether paused transfers can go on */
+#define GSTCURL_BUFFER_SIZE (64 * 1024)
+#define GSTCURL_MAX_QUEUED_BUFFERS 16
+#define GSTCURL_PAUSED_POLL_INTERVAL 10
 #define GSTCURL_INFO_RESPONSE(x) ((x >= 100) && (x <= 199))
 #define GSTCURL_SUCCESS_RESPONSE(x) ((x >= 200) && (x <=299))
 #define GSTCURL_REDIRECT_RESPONSE(x) ((x >= 300) && (x <= 399))
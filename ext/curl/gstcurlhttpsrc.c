@@ -135,9 +135,19 @@ static CURL *gst_curl_http_src_create_easy_handle (GstCurlHttpSrc * s);
 static inline void gst_curl_http_src_destroy_easy_handle (GstCurlHttpSrc * src);
 static size_t gst_curl_http_src_get_header (void *header, size_t size,
     size_t nmemb, void *src);
+static gboolean gst_curl_http_src_resume_transfers
+    (GstCurlHttpSrcMultiTaskContext * context, GSList ** resume);
 static size_t gst_curl_http_src_get_chunks (void *chunk, size_t size,
     size_t nmemb, void *src);
 static void gst_curl_http_src_request_remove (GstCurlHttpSrc * src);
+static void gst_curl_http_src_share_lock (CURL * handle, curl_lock_data data,
+    curl_lock_access access, void *userptr);
+static void gst_curl_http_src_share_unlock (CURL * handle,
+    curl_lock_data data, void *userptr);
+static void gst_curl_http_src_update_connection_stats (GstCurlHttpSrc * src);
+static gboolean gst_curl_http_src_has_chunks (GstCurlHttpSrc * src);
+static GstBuffer *gst_curl_http_src_pop_chunk (GstCurlHttpSrc * src);
+static void gst_curl_http_src_flush_chunks (GstCurlHttpSrc * src);
 static char *gst_curl_http_src_strcasestr (const char *haystack,
     const char *needle);
 
@@ -179,6 +189,8 @@ gst_curl_http_src_class_init (GstCurlHttpSrcClass * klass)
   GstPushSrcClass *gstpushsrc_class;
   const gchar *http_env;
   GstCurlHttpVersion default_http_version;
+  CURLSH *share;
+  gint i;
 
   gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
@@ -382,6 +394,16 @@ gst_curl_http_src_class_init (GstCurlHttpSrcClass * klass)
           GST_TYPE_CURL_HTTP_VERSION, pref_http_ver,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_NEW_CONNECTIONS,
+      g_param_spec_uint ("new-connections", "New-Connections",
+          "Number of connections opened for the requests made so far",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REUSED_CONNECTIONS,
+      g_param_spec_uint ("reused-connections", "Reused-Connections",
+          "Number of requests made so far over an already open connection",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   /* Add a debugging task so it's easier to debug in the Multi worker thread */
   GST_DEBUG_CATEGORY_INIT (gst_curl_loop_debug, "curl_multi_loop", 0,
       "libcURL loop thread debugging");
@@ -394,6 +416,22 @@ gst_curl_http_src_class_init (GstCurlHttpSrcClass * klass)
   g_cond_init (&klass->multi_task_context.signal);
   g_rec_mutex_init (&klass->multi_task_context.task_rec_mutex);
 
+  /* The share handle lives as long as the class, so that DNS entries, TLS
+   * sessions and connections survive the multi loop being restarted */
+  for (i = 0; i < CURL_LOCK_DATA_LAST; i++)
+    g_mutex_init (&klass->multi_task_context.share_locks[i]);
+  share = curl_share_init ();
+  curl_share_setopt (share, CURLSHOPT_LOCKFUNC, gst_curl_http_src_share_lock);
+  curl_share_setopt (share, CURLSHOPT_UNLOCKFUNC,
+      gst_curl_http_src_share_unlock);
+  curl_share_setopt (share, CURLSHOPT_USERDATA, &klass->multi_task_context);
+  curl_share_setopt (share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt (share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+  curl_share_setopt (share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+  klass->multi_task_context.share_handle = share;
+
   gst_element_class_set_static_metadata (gstelement_class,
       "HTTP Client Source using libcURL",
       "Source/Network",
@@ -570,6 +608,12 @@ gst_curl_http_src_get_property (GObject * object, guint prop_id,
     case PROP_HTTPVERSION:
       g_value_set_enum (value, source->preferred_http_version);
       break;
+    case PROP_NEW_CONNECTIONS:
+      g_value_set_uint (value, source->new_connections);
+      break;
+    case PROP_REUSED_CONNECTIONS:
+      g_value_set_uint (value, source->reused_connections);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -580,6 +624,8 @@ gst_curl_http_src_get_property (GObject * object, guint prop_id,
 static void
 gst_curl_http_src_init (GstCurlHttpSrc * source)
 {
+  GstStructure *config;
+
   GSTCURL_FUNCTION_ENTRY (source);
 
   /* Assume everything is already free'd */
@@ -619,8 +665,17 @@ gst_curl_http_src_init (GstCurlHttpSrc * source)
   g_mutex_init (&source->buffer_mutex);
   g_cond_init (&source->signal);
 
-  source->buffer = NULL;
-  source->buffer_len = 0;
+  source->pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (source->pool);
+  gst_buffer_pool_config_set_params (config, NULL, GSTCURL_BUFFER_SIZE, 0, 0);
+  gst_buffer_pool_set_config (source->pool, config);
+  gst_buffer_pool_set_active (source->pool, TRUE);
+  g_queue_init (&source->chunks);
+  source->fill_buffer = NULL;
+  source->fill_len = 0;
+  source->paused = FALSE;
+  source->new_connections = 0;
+  source->reused_connections = 0;
   source->state = GSTCURL_NONE;
   source->pending_state = GSTCURL_NONE;
   source->status_code = 0;
@@ -658,8 +713,15 @@ gst_curl_http_src_ref_multi (GstCurlHttpSrc * src)
     /* set up curl */
     klass->multi_task_context.multi_handle = curl_multi_init ();
 
+    /* Multiplex concurrent requests to the same server over one HTTP/2
+     * connection when possible */
+#ifdef CURLPIPE_MULTIPLEX
+    curl_multi_setopt (klass->multi_task_context.multi_handle,
+        CURLMOPT_PIPELINING, CURLPIPE_HTTP1 | CURLPIPE_MULTIPLEX);
+#else
     curl_multi_setopt (klass->multi_task_context.multi_handle,
         CURLMOPT_PIPELINING, 1);
+#endif
 #ifdef CURLMOPT_MAX_HOST_CONNECTIONS
     curl_multi_setopt (klass->multi_task_context.multi_handle,
         CURLMOPT_MAX_HOST_CONNECTIONS, 1);
@@ -788,6 +850,7 @@ retry:
     src->state = GSTCURL_OK;
     src->transfer_begun = TRUE;
     src->data_received = FALSE;
+    src->paused = FALSE;
 
     GST_DEBUG_OBJECT (src, "Submitted request for URI %s to curl", src->uri);
 
@@ -801,16 +864,12 @@ retry:
   }
 
   /* Wait for data to become available, then punt it downstream */
-  while ((src->buffer_len == 0) && (src->state == GSTCURL_OK)) {
+  while (!gst_curl_http_src_has_chunks (src) && (src->state == GSTCURL_OK)) {
     g_cond_wait (&src->signal, &src->buffer_mutex);
   }
 
   if (src->state == GSTCURL_UNLOCK) {
-    if (src->buffer_len > 0) {
-      g_free (src->buffer);
-      src->buffer = NULL;
-      src->buffer_len = 0;
-    }
+    gst_curl_http_src_flush_chunks (src);
     ret = GST_FLOW_FLUSHING;
     goto escape;
   }
@@ -857,26 +916,24 @@ retry:
   }
 
   if (((src->state == GSTCURL_OK) || (src->state == GSTCURL_DONE)) &&
-      (src->buffer_len > 0)) {
-
-    GST_DEBUG_OBJECT (src, "Pushing %u bytes of transfer for URI %s to pad",
-        src->buffer_len, src->uri);
-    *outbuf = gst_buffer_new_allocate (NULL, src->buffer_len, NULL);
-    gst_buffer_fill (*outbuf, 0, src->buffer, src->buffer_len);
-
-    g_free (src->buffer);
-    src->buffer = NULL;
-    src->buffer_len = 0;
+      gst_curl_http_src_has_chunks (src)) {
+    /* The buffers are filled in place by the write callback, hand them
+     * over as they are */
+    *outbuf = gst_curl_http_src_pop_chunk (src);
+    GST_DEBUG_OBJECT (src, "Pushing %" G_GSIZE_FORMAT " bytes of transfer "
+        "for URI %s to pad", gst_buffer_get_size (*outbuf), src->uri);
     src->data_received = TRUE;
 
     /* ret should still be GST_FLOW_OK */
-  } else if ((src->state == GSTCURL_DONE) && (src->buffer_len == 0)) {
+  } else if ((src->state == GSTCURL_DONE) &&
+      !gst_curl_http_src_has_chunks (src)) {
     GST_INFO_OBJECT (src, "Full body received, signalling EOS for URI %s.",
         src->uri);
     src->state = GSTCURL_NONE;
     src->transfer_begun = FALSE;
     src->status_code = 0;
     src->hdrs_updated = FALSE;
+    gst_curl_http_src_update_connection_stats (src);
     gst_curl_http_src_destroy_easy_handle (src);
     ret = GST_FLOW_EOS;
   } else {
@@ -940,8 +997,12 @@ gst_curl_http_src_create_easy_handle (GstCurlHttpSrc * s)
 {
   CURL *handle;
   gint i;
+  GstCurlHttpSrcClass *klass;
   GSTCURL_FUNCTION_ENTRY (s);
 
+  klass = G_TYPE_INSTANCE_GET_CLASS (s, GST_TYPE_CURL_HTTP_SRC,
+      GstCurlHttpSrcClass);
+
   handle = curl_easy_init ();
   if (handle == NULL) {
     GST_ERROR_OBJECT (s, "Couldn't init a curl easy handle!");
@@ -964,6 +1025,16 @@ gst_curl_http_src_create_easy_handle (GstCurlHttpSrc * s)
   gst_curl_setopt_str (s, handle, CURLOPT_PROXYUSERNAME, s->proxy_user);
   gst_curl_setopt_str (s, handle, CURLOPT_PROXYPASSWORD, s->proxy_pass);
 
+  /* Reuse what earlier requests learnt about the server: DNS entries, TLS
+   * sessions, open connections */
+  gst_curl_setopt_generic (s, handle, CURLOPT_SHARE,
+      klass->multi_task_context.share_handle);
+#if LIBCURL_VERSION_NUM >= 0x072b00
+  /* Rather wait for a connection that can be multiplexed than open another
+   * one when requests for the same server run concurrently */
+  gst_curl_setopt_generic (s, handle, CURLOPT_PIPEWAIT, 1L);
+#endif
+
   for (i = 0; i < s->number_cookies; i++) {
     gst_curl_setopt_str (s, handle, CURLOPT_COOKIELIST, s->cookies[i]);
   }
@@ -1318,8 +1389,12 @@ gst_curl_http_src_cleanup_instance (GstCurlHttpSrc * src)
 
   g_cond_clear (&src->signal);
 
-  g_free (src->buffer);
-  src->buffer = NULL;
+  gst_curl_http_src_flush_chunks (src);
+  if (src->pool != NULL) {
+    gst_buffer_pool_set_active (src->pool, FALSE);
+    gst_object_unref (src->pool);
+    src->pool = NULL;
+  }
 
   if (src->http_headers != NULL) {
     gst_structure_free (src->http_headers);
@@ -1564,12 +1639,25 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
     fd_set fdread, fdwrite, fdexcep;
     int maxfd = -1;
     long curl_timeo = -1;
+    gboolean paused;
+    GSList *resume = NULL, *l;
+
+    paused = gst_curl_http_src_resume_transfers (context, &resume);
 
     /* Because curl can possibly take some time here, be nice and let go of the
      * mutex so other threads can perform state/queue operations as we don't
      * care about those until the end of this. */
     g_mutex_unlock (&context->mutex);
 
+    /* Unpausing can call the write callback straight away, which takes the
+     * buffer mutex of its source. ::create() takes the context mutex while
+     * holding that one, so this must not happen under the context mutex.
+     * Handles are only removed from the multi handle by this thread, so they
+     * are still valid here. */
+    for (l = resume; l != NULL; l = l->next)
+      curl_easy_pause (l->data, CURLPAUSE_CONT);
+    g_slist_free (resume);
+
     FD_ZERO (&fdread);
     FD_ZERO (&fdwrite);
     FD_ZERO (&fdexcep);
@@ -1587,6 +1675,14 @@ gst_curl_http_src_curl_multi_loop (gpointer thread_data)
       }
     }
 
+    /* Paused transfers have no socket to wait on, come back soon to check
+     * whether they can be resumed */
+    if (paused && (timeout.tv_sec > 0 ||
+            timeout.tv_usec > GSTCURL_PAUSED_POLL_INTERVAL * 1000)) {
+      timeout.tv_sec = 0;
+      timeout.tv_usec = GSTCURL_PAUSED_POLL_INTERVAL * 1000;
+    }
+
     /* get file descriptors from the transfers */
     curl_multi_fdset (context->multi_handle, &fdread, &fdwrite, &fdexcep,
         &maxfd);
@@ -1823,15 +1919,109 @@ gst_curl_http_src_strcasestr (const char *haystack, const char *needle)
   return location;
 }
 
+/*
+ * Queue the buffer the write callback was filling for ::create().
+ */
+static void
+gst_curl_http_src_queue_fill_buffer (GstCurlHttpSrc * s)
+{
+  gst_buffer_unmap (s->fill_buffer, &s->fill_map);
+  gst_buffer_set_size (s->fill_buffer, s->fill_len);
+  g_queue_push_tail (&s->chunks, s->fill_buffer);
+  s->fill_buffer = NULL;
+  s->fill_len = 0;
+}
+
+/*
+ * Whether there is any received data for ::create(). Call with the buffer
+ * mutex held, like the two functions below.
+ */
+static gboolean
+gst_curl_http_src_has_chunks (GstCurlHttpSrc * s)
+{
+  return !g_queue_is_empty (&s->chunks) || s->fill_len > 0;
+}
+
+/*
+ * Take the oldest received data. A partially filled buffer is handed over
+ * too rather than waiting for more of the body.
+ */
+static GstBuffer *
+gst_curl_http_src_pop_chunk (GstCurlHttpSrc * s)
+{
+  if (g_queue_is_empty (&s->chunks) && s->fill_len > 0)
+    gst_curl_http_src_queue_fill_buffer (s);
+
+  return g_queue_pop_head (&s->chunks);
+}
+
+/*
+ * Drop all the received data.
+ */
+static void
+gst_curl_http_src_flush_chunks (GstCurlHttpSrc * s)
+{
+  GstBuffer *buf;
+
+  if (s->fill_buffer != NULL) {
+    gst_buffer_unmap (s->fill_buffer, &s->fill_map);
+    gst_buffer_unref (s->fill_buffer);
+    s->fill_buffer = NULL;
+    s->fill_len = 0;
+  }
+
+  while ((buf = g_queue_pop_head (&s->chunks)) != NULL)
+    gst_buffer_unref (buf);
+}
+
+/*
+ * Find the transfers paused by the write callback that can be resumed, as
+ * ::create() has consumed half of the queued buffers or is not waiting for
+ * them any more. Called with the context mutex held; the curl handles to
+ * unpause are prepended to @resume. Returns TRUE if some transfers stay
+ * paused.
+ */
+static gboolean
+gst_curl_http_src_resume_transfers (GstCurlHttpSrcMultiTaskContext * context,
+    GSList ** resume)
+{
+  GstCurlHttpSrcQueueElement *qelement;
+  gboolean still_paused = FALSE;
+
+  for (qelement = context->queue; qelement != NULL; qelement = qelement->next) {
+    GstCurlHttpSrc *s = qelement->p;
+
+    g_mutex_lock (&s->buffer_mutex);
+    if (s->paused) {
+      if (s->state != GSTCURL_OK ||
+          g_queue_get_length (&s->chunks) <= GSTCURL_MAX_QUEUED_BUFFERS / 2) {
+        GSTCURL_DEBUG_PRINT ("Resuming transfer for URI %s", s->uri);
+        s->paused = FALSE;
+        *resume = g_slist_prepend (*resume, s->curl_handle);
+      } else {
+        still_paused = TRUE;
+      }
+    }
+    g_mutex_unlock (&s->buffer_mutex);
+  }
+
+  return still_paused;
+}
+
 /*
  * Receive chunks of the requested body and pass these back to the ::create()
- * loop
+ * loop. They are copied straight into pooled buffers which are pushed as they
+ * are; if too many of them are waiting, the transfer is paused and curl hands
+ * the chunk over again once it is resumed.
  */
 static size_t
 gst_curl_http_src_get_chunks (void *chunk, size_t size, size_t nmemb, void *src)
 {
   GstCurlHttpSrc *s = src;
   size_t chunk_len = size * nmemb;
+  const guint8 *data = chunk;
+  gsize remaining = chunk_len;
+
   GST_TRACE_OBJECT (s,
       "Received curl chunk for URI %s of size %d", s->uri, (int) chunk_len);
   g_mutex_lock (&s->buffer_mutex);
@@ -1839,19 +2029,89 @@ gst_curl_http_src_get_chunks (void *chunk, size_t size, size_t nmemb, void *src)
     g_mutex_unlock (&s->buffer_mutex);
     return chunk_len;
   }
-  s->buffer =
-      g_realloc (s->buffer, (s->buffer_len + chunk_len + 1) * sizeof (char));
-  if (s->buffer == NULL) {
-    GST_ERROR_OBJECT (s, "Realloc for cURL response message failed!\n");
-    return 0;
+
+  if (g_queue_get_length (&s->chunks) >= GSTCURL_MAX_QUEUED_BUFFERS) {
+    GST_LOG_OBJECT (s, "Too much data queued, pausing transfer for URI %s",
+        s->uri);
+    s->paused = TRUE;
+    g_mutex_unlock (&s->buffer_mutex);
+    return CURL_WRITEFUNC_PAUSE;
+  }
+
+  while (remaining > 0) {
+    gsize len;
+
+    if (s->fill_buffer == NULL) {
+      if (gst_buffer_pool_acquire_buffer (s->pool, &s->fill_buffer,
+              NULL) != GST_FLOW_OK) {
+        GST_ERROR_OBJECT (s, "Couldn't get a buffer for cURL response!");
+        s->fill_buffer = NULL;
+        g_mutex_unlock (&s->buffer_mutex);
+        return 0;
+      }
+      gst_buffer_map (s->fill_buffer, &s->fill_map, GST_MAP_WRITE);
+    }
+
+    len = MIN (remaining, s->fill_map.size - s->fill_len);
+    memcpy (s->fill_map.data + s->fill_len, data, len);
+    s->fill_len += len;
+    data += len;
+    remaining -= len;
+
+    if (s->fill_len == s->fill_map.size)
+      gst_curl_http_src_queue_fill_buffer (s);
   }
-  memcpy (s->buffer + s->buffer_len, chunk, chunk_len);
-  s->buffer_len += chunk_len;
+
   g_cond_signal (&s->signal);
   g_mutex_unlock (&s->buffer_mutex);
   return chunk_len;
 }
 
+/*
+ * Lock and unlock the data shared by all the easy handles, see
+ * CURLSHOPT_LOCKFUNC.
+ */
+static void
+gst_curl_http_src_share_lock (CURL * handle, curl_lock_data data,
+    curl_lock_access access, void *userptr)
+{
+  GstCurlHttpSrcMultiTaskContext *context = userptr;
+
+  g_mutex_lock (&context->share_locks[data]);
+}
+
+static void
+gst_curl_http_src_share_unlock (CURL * handle, curl_lock_data data,
+    void *userptr)
+{
+  GstCurlHttpSrcMultiTaskContext *context = userptr;
+
+  g_mutex_unlock (&context->share_locks[data]);
+}
+
+/*
+ * Count whether the finished transfer had to open a connection or could use
+ * one left open by an earlier request.
+ */
+static void
+gst_curl_http_src_update_connection_stats (GstCurlHttpSrc * src)
+{
+  long connects = 0;
+
+  if (curl_easy_getinfo (src->curl_handle, CURLINFO_NUM_CONNECTS,
+          &connects) != CURLE_OK)
+    return;
+
+  if (connects > 0) {
+    GST_DEBUG_OBJECT (src, "Opened %ld connection(s) for URI %s", connects,
+        src->uri);
+    src->new_connections += connects;
+  } else {
+    GST_DEBUG_OBJECT (src, "Reused a connection for URI %s", src->uri);
+    src->reused_connections++;
+  }
+}
+
 /*
  * Request a cancellation of a currently running curl handle.
  */
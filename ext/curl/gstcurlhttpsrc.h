@@ -126,6 +126,11 @@ struct _GstCurlHttpSrcMultiTaskContext
 
   /* < private > */
   CURLM *multi_handle;
+
+  /* DNS cache, TLS sessions and, where curl supports it, connections shared
+   * by all the easy handles, outliving the multi handle */
+  CURLSH *share_handle;
+  GMutex share_locks[CURL_LOCK_DATA_LAST];
 };
 
 struct _GstCurlHttpSrcClass
@@ -201,11 +206,24 @@ struct _GstCurlHttpSrc
   CURL *curl_handle;
   GMutex buffer_mutex;
   GCond signal;
-  gchar *buffer;
-  guint buffer_len;
+  /* Received body: full buffers waiting for ::create() and the one the
+   * write callback is filling, all from the pool */
+  GstBufferPool *pool;
+  GQueue chunks;
+  GstBuffer *fill_buffer;
+  GstMapInfo fill_map;
+  gsize fill_len;
+  /* TRUE if the write callback paused the transfer as ::create() is
+   * behind, the curl loop resumes it */
+  gboolean paused;
   gboolean transfer_begun;
   gboolean data_received;
 
+  /* Requests which had to open connections and how many, and requests
+   * served over a connection already open */
+  guint new_connections;
+  guint reused_connections;
+
   /*
    * Response Headers
    */
@@ -245,6 +263,8 @@ enum
   PROP_MAXCONCURRENT_PROXY,
   PROP_MAXCONCURRENT_GLOBAL,
   PROP_HTTPVERSION,
+  PROP_NEW_CONNECTIONS,
+  PROP_REUSED_CONNECTIONS,
   PROP_MAX
 };
 
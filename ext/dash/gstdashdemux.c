@@ -390,6 +390,9 @@ static gboolean
 gst_dash_demux_stream_advance_subfragment (GstAdaptiveDemuxStream * stream);
 static gboolean gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream *
     stream, guint64 bitrate);
+static gboolean
+gst_dash_demux_stream_get_fragment_ahead (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static gint64 gst_dash_demux_get_manifest_update_interval (GstAdaptiveDemux *
     demux);
 static GstFlowReturn gst_dash_demux_update_manifest_data (GstAdaptiveDemux *
@@ -637,6 +640,8 @@ gst_dash_demux_class_init (GstDashDemuxClass * klass)
       gst_dash_demux_stream_select_bitrate;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_dash_demux_stream_update_fragment_info;
+  gstadaptivedemux_class->stream_get_fragment_ahead =
+      gst_dash_demux_stream_get_fragment_ahead;
   gstadaptivedemux_class->stream_free = gst_dash_demux_stream_free;
   gstadaptivedemux_class->get_live_seek_range =
       gst_dash_demux_get_live_seek_range;
@@ -2159,6 +2164,51 @@ gst_dash_demux_stream_advance_fragment (GstAdaptiveDemuxStream * stream)
   return ret;
 }
 
+static gboolean
+gst_dash_demux_stream_get_fragment_ahead (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstDashDemuxStream *dashstream = (GstDashDemuxStream *) stream;
+  GstDashDemux *dashdemux = GST_DASH_DEMUX_CAST (stream->demux);
+  GstActiveStream *active_stream = dashstream->active_stream;
+  GstMediaFragmentInfo info;
+  gint segment_index, segment_repeat_index;
+  gboolean ret = TRUE;
+  guint i;
+
+  /* Subsegments are only known once the index is parsed, and live
+   * segments might not be available yet */
+  if (gst_mpd_client_has_isoff_ondemand_profile (dashdemux->client)
+      || GST_ADAPTIVE_DEMUX_IN_TRICKMODE_KEY_UNITS (dashdemux)
+      || gst_mpd_client_is_live (dashdemux->client))
+    return FALSE;
+
+  segment_index = active_stream->segment_index;
+  segment_repeat_index = active_stream->segment_repeat_index;
+
+  for (i = 0; i < n && ret; i++)
+    ret = gst_mpd_client_advance_segment (dashdemux->client, active_stream,
+        TRUE) == GST_FLOW_OK;
+  if (ret)
+    ret = gst_mpd_client_get_next_fragment (dashdemux->client,
+        dashstream->index, &info);
+
+  active_stream->segment_index = segment_index;
+  active_stream->segment_repeat_index = segment_repeat_index;
+
+  if (!ret)
+    return FALSE;
+
+  fragment->uri = info.uri;
+  fragment->range_start = MAX (info.range_start, dashstream->sidx_base_offset);
+  fragment->range_end = info.range_end;
+  fragment->timestamp = info.timestamp;
+  fragment->duration = info.duration;
+  g_free (info.index_uri);
+
+  return TRUE;
+}
+
 static gboolean
 gst_dash_demux_stream_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate)
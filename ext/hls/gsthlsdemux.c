@@ -109,6 +109,8 @@ static GstFlowReturn gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream
     * stream);
 static gboolean gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream,
     guint64 bitrate);
+static gboolean gst_hls_demux_stream_get_fragment_ahead (GstAdaptiveDemuxStream
+    * stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static void gst_hls_demux_reset (GstAdaptiveDemux * demux);
 static gboolean gst_hls_demux_get_live_seek_range (GstAdaptiveDemux * demux,
     gint64 * start, gint64 * stop);
@@ -175,6 +177,8 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   adaptivedemux_class->stream_update_fragment_info =
       gst_hls_demux_update_fragment_info;
   adaptivedemux_class->stream_select_bitrate = gst_hls_demux_select_bitrate;
+  adaptivedemux_class->stream_get_fragment_ahead =
+      gst_hls_demux_stream_get_fragment_ahead;
   adaptivedemux_class->stream_free = gst_hls_demux_stream_free;
 
   adaptivedemux_class->start_fragment = gst_hls_demux_start_fragment;
@@ -1124,6 +1128,31 @@ gst_hls_demux_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return GST_FLOW_OK;
 }
 
+static gboolean
+gst_hls_demux_stream_get_fragment_ahead (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstHLSDemuxStream *hlsdemux_stream = GST_HLS_DEMUX_STREAM_CAST (stream);
+  GstM3U8MediaFile *file;
+
+  file = gst_m3u8_peek_fragment (gst_hls_demux_stream_get_m3u8
+      (hlsdemux_stream), n);
+  if (file == NULL)
+    return FALSE;
+
+  fragment->uri = g_strdup (file->uri);
+  fragment->range_start = file->offset;
+  if (file->size != -1)
+    fragment->range_end = file->offset + file->size - 1;
+  else
+    fragment->range_end = -1;
+  fragment->duration = file->duration;
+
+  gst_m3u8_media_file_unref (file);
+
+  return TRUE;
+}
+
 static gboolean
 gst_hls_demux_select_bitrate (GstAdaptiveDemuxStream * stream, guint64 bitrate)
 {
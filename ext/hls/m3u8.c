@@ -902,6 +902,35 @@ gst_m3u8_has_next_fragment (GstM3U8 * m3u8, gboolean forward)
   return have_next;
 }
 
+/* Returns the fragment @n positions after the one gst_m3u8_get_next_fragment()
+ * returns in forward playback, without advancing */
+GstM3U8MediaFile *
+gst_m3u8_peek_fragment (GstM3U8 * m3u8, guint n)
+{
+  GstM3U8MediaFile *file = NULL;
+  GList *cur;
+
+  g_return_val_if_fail (m3u8 != NULL, NULL);
+
+  GST_M3U8_LOCK (m3u8);
+
+  if (m3u8->current_file) {
+    cur = m3u8->current_file;
+  } else {
+    cur = m3u8_find_next_fragment (m3u8, TRUE);
+  }
+
+  while (cur && n-- > 0)
+    cur = cur->next;
+
+  if (cur)
+    file = gst_m3u8_media_file_ref (cur->data);
+
+  GST_M3U8_UNLOCK (m3u8);
+
+  return file;
+}
+
 /* call with M3U8_LOCK held */
 static void
 m3u8_alternate_advance (GstM3U8 * m3u8, gboolean forward)
@@ -123,6 +123,9 @@ GstM3U8MediaFile * gst_m3u8_get_next_fragment    (GstM3U8      * m3u8,
 gboolean           gst_m3u8_has_next_fragment    (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
+GstM3U8MediaFile * gst_m3u8_peek_fragment        (GstM3U8 * m3u8,
+                                                  guint     n);
+
 void               gst_m3u8_advance_fragment     (GstM3U8 * m3u8,
                                                   gboolean  forward);
 
@@ -132,6 +132,9 @@ static gboolean gst_mss_demux_stream_select_bitrate (GstAdaptiveDemuxStream *
     stream, guint64 bitrate);
 static GstFlowReturn
 gst_mss_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream);
+static gboolean
+gst_mss_demux_stream_get_fragment_ahead (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment);
 static gboolean gst_mss_demux_seek (GstAdaptiveDemux * demux, GstEvent * seek);
 static gint64
 gst_mss_demux_get_manifest_update_interval (GstAdaptiveDemux * demux);
@@ -199,6 +202,8 @@ gst_mss_demux_class_init (GstMssDemuxClass * klass)
       gst_mss_demux_stream_select_bitrate;
   gstadaptivedemux_class->stream_update_fragment_info =
       gst_mss_demux_stream_update_fragment_info;
+  gstadaptivedemux_class->stream_get_fragment_ahead =
+      gst_mss_demux_stream_get_fragment_ahead;
   gstadaptivedemux_class->stream_get_fragment_waiting_time =
       gst_mss_demux_stream_get_fragment_waiting_time;
   gstadaptivedemux_class->update_manifest_data =
@@ -320,6 +325,24 @@ gst_mss_demux_stream_update_fragment_info (GstAdaptiveDemuxStream * stream)
   return ret;
 }
 
+static gboolean
+gst_mss_demux_stream_get_fragment_ahead (GstAdaptiveDemuxStream * stream,
+    guint n, GstAdaptiveDemuxStreamFragment * fragment)
+{
+  GstMssDemuxStream *mssstream = (GstMssDemuxStream *) stream;
+  GstMssDemux *mssdemux = GST_MSS_DEMUX_CAST (stream->demux);
+  gchar *path = NULL;
+
+  if (gst_mss_stream_get_fragment_url_ahead (mssstream->manifest_stream, n,
+          &path) != GST_FLOW_OK)
+    return FALSE;
+
+  fragment->uri = g_strdup_printf ("%s/%s", mssdemux->base_url, path);
+  g_free (path);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_mss_demux_stream_seek (GstAdaptiveDemuxStream * stream, gboolean forward,
     GstSeekFlags flags, GstClockTime ts, GstClockTime * final_ts)
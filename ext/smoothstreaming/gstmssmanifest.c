@@ -1034,14 +1034,32 @@ gst_mss_stream_get_caps (GstMssStream * stream)
   return caps;
 }
 
-GstFlowReturn
-gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+static gchar *
+gst_mss_stream_build_fragment_url (GstMssStream * stream, guint64 time)
 {
   gchar *tmp;
+  gchar *url;
   gchar *start_time_str;
+  GstMssStreamQuality *quality = stream->current_quality->data;
+
+  start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT, time);
+
+  tmp = g_regex_replace_literal (stream->regex_bitrate, stream->url,
+      strlen (stream->url), 0, quality->bitrate_str, 0, NULL);
+  url = g_regex_replace_literal (stream->regex_position, tmp,
+      strlen (tmp), 0, start_time_str, 0, NULL);
+
+  g_free (tmp);
+  g_free (start_time_str);
+
+  return url;
+}
+
+GstFlowReturn
+gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
+{
   guint64 time;
   GstMssStreamFragment *fragment;
-  GstMssStreamQuality *quality = stream->current_quality->data;
 
   g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
 
@@ -1052,15 +1070,47 @@ gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url)
 
   time =
       fragment->time + fragment->duration * stream->fragment_repetition_index;
-  start_time_str = g_strdup_printf ("%" G_GUINT64_FORMAT, time);
+  *url = gst_mss_stream_build_fragment_url (stream, time);
 
-  tmp = g_regex_replace_literal (stream->regex_bitrate, stream->url,
-      strlen (stream->url), 0, quality->bitrate_str, 0, NULL);
-  *url = g_regex_replace_literal (stream->regex_position, tmp,
-      strlen (tmp), 0, start_time_str, 0, NULL);
+  if (*url == NULL)
+    return GST_FLOW_ERROR;
 
-  g_free (tmp);
-  g_free (start_time_str);
+  return GST_FLOW_OK;
+}
+
+/* Same as gst_mss_stream_get_fragment_url() for the fragment @n positions
+ * after the current one, without advancing */
+GstFlowReturn
+gst_mss_stream_get_fragment_url_ahead (GstMssStream * stream, guint n,
+    gchar ** url)
+{
+  GstMssStreamFragment *fragment;
+  GList *iter;
+  guint repetition;
+
+  g_return_val_if_fail (stream->active, GST_FLOW_ERROR);
+
+  iter = stream->current_fragment;
+  if (iter == NULL)
+    return GST_FLOW_EOS;
+
+  fragment = iter->data;
+  repetition = stream->fragment_repetition_index;
+  while (n > 0) {
+    if (n < fragment->repetitions - repetition) {
+      repetition += n;
+      break;
+    }
+    n -= fragment->repetitions - repetition;
+    repetition = 0;
+    iter = g_list_next (iter);
+    if (iter == NULL)
+      return GST_FLOW_EOS;
+    fragment = iter->data;
+  }
+
+  *url = gst_mss_stream_build_fragment_url (stream,
+      fragment->time + fragment->duration * repetition);
 
   if (*url == NULL)
     return GST_FLOW_ERROR;
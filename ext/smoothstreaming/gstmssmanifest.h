@@ -64,6 +64,7 @@ guint64 gst_mss_stream_get_current_bitrate (GstMssStream * stream);
 void gst_mss_stream_set_active (GstMssStream * stream, gboolean active);
 guint64 gst_mss_stream_get_timescale (GstMssStream * stream);
 GstFlowReturn gst_mss_stream_get_fragment_url (GstMssStream * stream, gchar ** url);
+GstFlowReturn gst_mss_stream_get_fragment_url_ahead (GstMssStream * stream, guint n, gchar ** url);
 GstClockTime gst_mss_stream_get_fragment_gst_timestamp (GstMssStream * stream);
 GstClockTime gst_mss_stream_get_fragment_gst_duration (GstMssStream * stream);
 gboolean gst_mss_stream_has_next_fragment (GstMssStream * stream);
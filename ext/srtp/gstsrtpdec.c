@@ -81,7 +81,8 @@
  * Each packet received is first analysed (checked for valid SSRC) then
  * its buffer is unprotected with libsrtp, then pushed on the source pad.
  * If protection failed or the stream could not be created, the buffer
- * is dropped and a warning is emitted.
+ * is dropped and a warning is emitted. Buffer lists are unprotected as a
+ * whole and pushed on the source pad as lists.
  *
  * When the maximum usage of the master key is reached, a soft-limit
  * signal is sent to the user, and new parameters (master key) are needed
@@ -200,6 +201,10 @@ static GstFlowReturn gst_srtp_dec_chain_rtp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
 static GstFlowReturn gst_srtp_dec_chain_rtcp (GstPad * pad,
     GstObject * parent, GstBuffer * buf);
+static GstFlowReturn gst_srtp_dec_chain_list_rtp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
+static GstFlowReturn gst_srtp_dec_chain_list_rtcp (GstPad * pad,
+    GstObject * parent, GstBufferList * buf_list);
 
 static GstStateChangeReturn gst_srtp_dec_change_state (GstElement * element,
     GstStateChange transition);
@@ -225,6 +230,22 @@ struct _GstSrtpDecSsrcStream
       stream->rtp_auth != GST_SRTP_AUTH_NULL ||         \
       stream->rtcp_auth != GST_SRTP_AUTH_NULL)
 
+typedef struct ProcessBufferItData
+{
+  GstSrtpDec *filter;
+  GstPad *pad;
+  gboolean is_rtcp;
+  GstBufferList *rtp_list;
+  GstBufferList *rtcp_list;
+
+  /* Stream of the last SSRC seen, valid while the streams cookie is */
+  guint32 last_ssrc;
+  GstSrtpDecSsrcStream *last_stream;
+  guint last_cookie;
+
+  /* SSRCs that reached the soft limit */
+  GArray *soft_limit_ssrcs;
+} ProcessBufferItData;
 
 /* initialize the srtpdec's class */
 static void
@@ -363,6 +384,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtp));
   gst_pad_set_chain_function (filter->rtp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtp));
+  gst_pad_set_chain_list_function (filter->rtp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtp));
 
   filter->rtp_srcpad =
       gst_pad_new_from_static_template (&rtp_src_template, "rtp_src");
@@ -386,6 +409,8 @@ gst_srtp_dec_init (GstSrtpDec * filter)
       GST_DEBUG_FUNCPTR (gst_srtp_dec_iterate_internal_links_rtcp));
   gst_pad_set_chain_function (filter->rtcp_sinkpad,
       GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_rtcp));
+  gst_pad_set_chain_list_function (filter->rtcp_sinkpad,
+      GST_DEBUG_FUNCPTR (gst_srtp_dec_chain_list_rtcp));
 
   filter->rtcp_srcpad =
       gst_pad_new_from_static_template (&rtcp_src_template, "rtcp_src");
@@ -503,6 +528,7 @@ gst_srtp_dec_remove_stream (GstSrtpDec * filter, guint ssrc)
   if (stream) {
     srtp_remove_stream (filter->session, ssrc);
     g_hash_table_remove (filter->streams, GUINT_TO_POINTER (ssrc));
+    filter->streams_cookie++;
   }
 }
 
@@ -657,18 +683,18 @@ init_session_stream (GstSrtpDec * filter, guint32 ssrc,
     filter->first_session = FALSE;
     g_hash_table_insert (filter->streams, GUINT_TO_POINTER (stream->ssrc),
         stream);
+    filter->streams_cookie++;
   }
 
   return ret;
 }
 
-/* Return a stream structure for a given buffer
+/* Get the SSRC of a buffer, and whether it is RTP or RTCP
  */
-static GstSrtpDecSsrcStream *
-validate_buffer (GstSrtpDec * filter, GstBuffer * buf, guint32 * ssrc,
+static gboolean
+get_buffer_ssrc (GstSrtpDec * filter, GstBuffer * buf, guint32 * ssrc,
     gboolean * is_rtcp)
 {
-  GstSrtpDecSsrcStream *stream = NULL;
   GstRTPBuffer rtpbuf = GST_RTP_BUFFER_INIT;
 
   if (gst_rtp_buffer_map (buf,
@@ -679,19 +705,30 @@ validate_buffer (GstSrtpDec * filter, GstBuffer * buf, guint32 * ssrc,
 
       gst_rtp_buffer_unmap (&rtpbuf);
       *is_rtcp = FALSE;
-      goto have_ssrc;
+      return TRUE;
     }
     gst_rtp_buffer_unmap (&rtpbuf);
   }
 
   if (rtcp_buffer_get_ssrc (buf, ssrc)) {
     *is_rtcp = TRUE;
-  } else {
-    GST_WARNING_OBJECT (filter, "No SSRC found in buffer");
-    return NULL;
+    return TRUE;
   }
 
-have_ssrc:
+  GST_WARNING_OBJECT (filter, "No SSRC found in buffer");
+  return FALSE;
+}
+
+/* Return a stream structure for a given buffer
+ */
+static GstSrtpDecSsrcStream *
+validate_buffer (GstSrtpDec * filter, GstBuffer * buf, guint32 * ssrc,
+    gboolean * is_rtcp)
+{
+  GstSrtpDecSsrcStream *stream = NULL;
+
+  if (!get_buffer_ssrc (filter, buf, ssrc, is_rtcp))
+    return NULL;
 
   stream = find_stream_by_ssrc (filter, *ssrc);
 
@@ -788,6 +825,7 @@ gst_srtp_dec_clear_streams (GstSrtpDec * filter)
 
   if (filter->streams)
     nb = g_hash_table_foreach_remove (filter->streams, remove_yes, NULL);
+  filter->streams_cookie++;
 
   filter->first_session = TRUE;
 
@@ -1136,24 +1174,25 @@ gst_srtp_dec_push_early_events (GstSrtpDec * filter, GstPad * pad,
 }
 
 /*
- * This function should be called while holding the filter lock
+ * This function should be called while holding the filter lock, which is
+ * only released while asking for a new key when the hard limit is reached
  */
 static gboolean
-gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad, GstBuffer * buf,
-    gboolean is_rtcp, guint32 ssrc)
+gst_srtp_dec_decode_buffer (GstSrtpDec * filter, GstPad * pad,
+    GstBuffer ** buf, gboolean is_rtcp, guint32 ssrc)
 {
   GstMapInfo map;
   srtp_err_status_t err;
   gint size;
 
   GST_LOG_OBJECT (pad, "Received %s buffer of size %" G_GSIZE_FORMAT
-      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (buf),
+      " with SSRC = %u", is_rtcp ? "RTCP" : "RTP", gst_buffer_get_size (*buf),
       ssrc);
 
   /* Change buffer to remove protection */
-  buf = gst_buffer_make_writable (buf);
+  *buf = gst_buffer_make_writable (*buf);
 
-  gst_buffer_map (buf, &map, GST_MAP_READWRITE);
+  gst_buffer_map (*buf, &map, GST_MAP_READWRITE);
   size = map.size;
 
 unprotect:
@@ -1175,7 +1214,7 @@ unprotect:
         guint16 seqnum = 0;
         GstRTPBuffer rtpbuf = GST_RTP_BUFFER_INIT;
 
-        gst_rtp_buffer_map (buf,
+        gst_rtp_buffer_map (*buf,
             GST_MAP_READ | GST_RTP_BUFFER_MAP_FLAG_SKIP_PADDING, &rtpbuf);
         seqnum = gst_rtp_buffer_get_seq (&rtpbuf);
         gst_rtp_buffer_unmap (&rtpbuf);
@@ -1192,8 +1231,6 @@ unprotect:
     err = srtp_unprotect (filter->session, map.data, &size);
   }
 
-  GST_OBJECT_UNLOCK (filter);
-
   if (err != srtp_err_status_ok) {
     GST_WARNING_OBJECT (pad,
         "Unable to unprotect buffer (unprotect failed code %d)", err);
@@ -1201,13 +1238,15 @@ unprotect:
     /* Signal user depending on type of error */
     switch (err) {
       case srtp_err_status_key_expired:
-        GST_OBJECT_LOCK (filter);
-
         /* Update stream */
         if (find_stream_by_ssrc (filter, ssrc)) {
+          GstSrtpDecSsrcStream *stream;
+
           GST_OBJECT_UNLOCK (filter);
-          if (request_key_with_signal (filter, ssrc, SIGNAL_HARD_LIMIT)) {
-            GST_OBJECT_LOCK (filter);
+          stream = request_key_with_signal (filter, ssrc, SIGNAL_HARD_LIMIT);
+          GST_OBJECT_LOCK (filter);
+
+          if (stream) {
             goto unprotect;
           } else {
             GST_WARNING_OBJECT (filter, "Hard limit reached, no new key, "
@@ -1229,20 +1268,36 @@ unprotect:
         break;
     }
 
-    gst_buffer_unmap (buf, &map);
+    gst_buffer_unmap (*buf, &map);
 
-    GST_OBJECT_LOCK (filter);
     return FALSE;
   }
 
-  gst_buffer_unmap (buf, &map);
+  gst_buffer_unmap (*buf, &map);
 
-  gst_buffer_set_size (buf, size);
+  gst_buffer_set_size (*buf, size);
 
-  GST_OBJECT_LOCK (filter);
   return TRUE;
 }
 
+/* Get the source pad for RTP or RTCP, pushing the events it needs first
+ */
+static GstPad *
+gst_srtp_dec_get_src_pad (GstSrtpDec * filter, gboolean is_rtcp)
+{
+  if (is_rtcp) {
+    if (!filter->rtcp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
+          filter->rtp_srcpad, TRUE);
+    return filter->rtcp_srcpad;
+  } else {
+    if (!filter->rtp_has_segment)
+      gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
+          filter->rtcp_srcpad, FALSE);
+    return filter->rtp_srcpad;
+  }
+}
+
 static GstFlowReturn
 gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     gboolean is_rtcp)
@@ -1268,7 +1323,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     goto push_out;
   }
 
-  if (!gst_srtp_dec_decode_buffer (filter, pad, buf, is_rtcp, ssrc)) {
+  if (!gst_srtp_dec_decode_buffer (filter, pad, &buf, is_rtcp, ssrc)) {
     GST_OBJECT_UNLOCK (filter);
     goto drop_buffer;
   }
@@ -1281,17 +1336,7 @@ gst_srtp_dec_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
 push_out:
   /* Push buffer to source pad */
-  if (is_rtcp) {
-    otherpad = filter->rtcp_srcpad;
-    if (!filter->rtcp_has_segment)
-      gst_srtp_dec_push_early_events (filter, filter->rtcp_srcpad,
-          filter->rtp_srcpad, TRUE);
-  } else {
-    otherpad = filter->rtp_srcpad;
-    if (!filter->rtp_has_segment)
-      gst_srtp_dec_push_early_events (filter, filter->rtp_srcpad,
-          filter->rtcp_srcpad, FALSE);
-  }
+  otherpad = gst_srtp_dec_get_src_pad (filter, is_rtcp);
   ret = gst_pad_push (otherpad, buf);
 
   return ret;
@@ -1304,6 +1349,143 @@ drop_buffer:
   return ret;
 }
 
+static gboolean
+process_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+{
+  ProcessBufferItData *data = user_data;
+  GstSrtpDec *filter = data->filter;
+  GstSrtpDecSsrcStream *stream;
+  GstBuffer *buf = *buffer;
+  gboolean is_rtcp = data->is_rtcp;
+  guint32 ssrc = 0;
+  guint i;
+
+  /* Take the buffer out of the list, so that it can be decoded in place */
+  *buffer = NULL;
+
+  if (!get_buffer_ssrc (filter, buf, &ssrc, &is_rtcp))
+    goto drop_buffer;
+
+  /* Packets mostly come in runs of the same SSRC, only look up the stream
+   * again if the SSRC or the streams changed */
+  if (data->last_stream && data->last_ssrc == ssrc &&
+      data->last_cookie == filter->streams_cookie) {
+    stream = data->last_stream;
+  } else {
+    stream = find_stream_by_ssrc (filter, ssrc);
+    if (!stream)
+      stream = request_key_with_signal (filter, ssrc, SIGNAL_REQUEST_KEY);
+
+    data->last_ssrc = ssrc;
+    data->last_stream = stream;
+    data->last_cookie = filter->streams_cookie;
+  }
+
+  if (!stream) {
+    GST_WARNING_OBJECT (filter, "Invalid buffer, dropping");
+    goto drop_buffer;
+  }
+
+  if (STREAM_HAS_CRYPTO (stream)) {
+    if (!gst_srtp_dec_decode_buffer (filter, data->pad, &buf, is_rtcp, ssrc))
+      goto drop_buffer;
+
+    /* If all is well, we may have reached soft limit, the signal is sent
+     * once the whole list is done */
+    if (gst_srtp_get_soft_limit_reached ()) {
+      for (i = 0; i < data->soft_limit_ssrcs->len; i++)
+        if (g_array_index (data->soft_limit_ssrcs, guint32, i) == ssrc)
+          break;
+      if (i == data->soft_limit_ssrcs->len)
+        g_array_append_val (data->soft_limit_ssrcs, ssrc);
+    }
+  }
+
+  gst_buffer_list_add (is_rtcp ? data->rtcp_list : data->rtp_list, buf);
+
+  return TRUE;
+
+drop_buffer:
+  gst_buffer_unref (buf);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_srtp_dec_push_list (GstSrtpDec * filter, GstBufferList * list,
+    gboolean is_rtcp)
+{
+  GstPad *otherpad;
+
+  if (!gst_buffer_list_length (list)) {
+    gst_buffer_list_unref (list);
+    return GST_FLOW_OK;
+  }
+
+  otherpad = gst_srtp_dec_get_src_pad (filter, is_rtcp);
+  GST_LOG_OBJECT (otherpad, "Pushing buffer chain of %u",
+      gst_buffer_list_length (list));
+
+  return gst_pad_push_list (otherpad, list);
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list, gboolean is_rtcp)
+{
+  GstSrtpDec *filter = GST_SRTP_DEC (parent);
+  ProcessBufferItData process_data;
+  GstFlowReturn rtp_ret, rtcp_ret;
+  gboolean have_rtp, have_rtcp;
+  guint i, length;
+
+  length = gst_buffer_list_length (buf_list);
+
+  GST_LOG_OBJECT (pad, "Buffer chain with list of %u", length);
+
+  if (!length) {
+    gst_buffer_list_unref (buf_list);
+    return GST_FLOW_OK;
+  }
+
+  buf_list = gst_buffer_list_make_writable (buf_list);
+
+  process_data.filter = filter;
+  process_data.pad = pad;
+  process_data.is_rtcp = is_rtcp;
+  process_data.rtp_list = is_rtcp ? gst_buffer_list_new () :
+      gst_buffer_list_new_sized (length);
+  process_data.rtcp_list = is_rtcp ? gst_buffer_list_new_sized (length) :
+      gst_buffer_list_new ();
+  process_data.last_ssrc = 0;
+  process_data.last_stream = NULL;
+  process_data.last_cookie = 0;
+  process_data.soft_limit_ssrcs = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  GST_OBJECT_LOCK (filter);
+  gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data);
+  GST_OBJECT_UNLOCK (filter);
+
+  gst_buffer_list_unref (buf_list);
+
+  for (i = 0; i < process_data.soft_limit_ssrcs->len; i++)
+    request_key_with_signal (filter,
+        g_array_index (process_data.soft_limit_ssrcs, guint32, i),
+        SIGNAL_SOFT_LIMIT);
+  g_array_free (process_data.soft_limit_ssrcs, TRUE);
+
+  /* Push buffers to source pads, RTCP may be muxed with RTP */
+  have_rtp = gst_buffer_list_length (process_data.rtp_list) > 0;
+  have_rtcp = gst_buffer_list_length (process_data.rtcp_list) > 0;
+  rtp_ret = gst_srtp_dec_push_list (filter, process_data.rtp_list, FALSE);
+  rtcp_ret = gst_srtp_dec_push_list (filter, process_data.rtcp_list, TRUE);
+
+  if (is_rtcp)
+    return have_rtcp || !have_rtp ? rtcp_ret : rtp_ret;
+  else
+    return have_rtp || !have_rtcp ? rtp_ret : rtcp_ret;
+}
+
 static GstFlowReturn
 gst_srtp_dec_chain_rtp (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
@@ -1316,6 +1498,20 @@ gst_srtp_dec_chain_rtcp (GstPad * pad, GstObject * parent, GstBuffer * buf)
   return gst_srtp_dec_chain (pad, parent, buf, TRUE);
 }
 
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, FALSE);
+}
+
+static GstFlowReturn
+gst_srtp_dec_chain_list_rtcp (GstPad * pad, GstObject * parent,
+    GstBufferList * buf_list)
+{
+  return gst_srtp_dec_chain_list (pad, parent, buf_list, TRUE);
+}
+
 static GstStateChangeReturn
 gst_srtp_dec_change_state (GstElement * element, GstStateChange transition)
 {
@@ -79,6 +79,9 @@ struct _GstSrtpDec
   srtp_t session;
   gboolean first_session;
   GHashTable *streams;
+  /* Changed whenever streams are removed, so that a stream looked up in
+   * the table is known to still be valid as long as it is unchanged */
+  guint streams_cookie;
 
   gboolean rtp_has_segment;
   gboolean rtcp_has_segment;
@@ -128,6 +128,12 @@ GST_DEBUG_CATEGORY_STATIC (gst_srtp_enc_debug);
 #define DEFAULT_REPLAY_WINDOW_SIZE 128
 #define DEFAULT_ALLOW_REPEAT_TX FALSE
 
+/* Room left after a packet for the SRTP/SRTCP trailer */
+#define OUT_BUFFER_PADDING (SRTP_MAX_TRAILER_LEN + 10)
+
+/* Smallest buffers of the output pool, enough for a packet of the usual MTU */
+#define POOL_MIN_BUFFER_SIZE (1500 + OUT_BUFFER_PADDING)
+
 #define HAS_CRYPTO(filter) (filter->rtp_cipher != GST_SRTP_CIPHER_NULL || \
       filter->rtcp_cipher != GST_SRTP_CIPHER_NULL ||                      \
       filter->rtp_auth != GST_SRTP_AUTH_NULL ||                           \
@@ -155,13 +161,24 @@ enum
   PROP_STATS
 };
 
-typedef struct ProcessBufferItData
+/* A packet being protected: the output buffer, which is either the input
+ * buffer itself or a pool buffer the packet was copied into, mapped with
+ * room for the trailer */
+typedef struct GstSrtpEncPacket
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gint size;
+  srtp_err_status_t err;
+} GstSrtpEncPacket;
+
+typedef struct PrepareBufferItData
 {
   GstSrtpEnc *filter;
-  GstPad *pad;
-  GstBufferList *out_list;
-  gboolean is_rtcp;
-} ProcessBufferItData;
+  GstBufferPool *pool;
+  GstSrtpEncPacket *packets;
+  guint n_packets;
+} PrepareBufferItData;
 
 /* the capabilities of the inputs and outputs.
  *
@@ -450,11 +467,23 @@ gst_srtp_enc_reset_no_lock (GstSrtpEnc * filter)
   filter->key_changed = FALSE;
 }
 
+static void
+gst_srtp_enc_clear_pool (GstSrtpEnc * filter)
+{
+  if (filter->pool) {
+    gst_buffer_pool_set_active (filter->pool, FALSE);
+    gst_object_unref (filter->pool);
+    filter->pool = NULL;
+  }
+  filter->pool_size = 0;
+}
+
 static void
 gst_srtp_enc_reset (GstSrtpEnc * filter)
 {
   GST_OBJECT_LOCK (filter);
   gst_srtp_enc_reset_no_lock (filter);
+  gst_srtp_enc_clear_pool (filter);
   GST_OBJECT_UNLOCK (filter);
 }
 
@@ -602,6 +631,8 @@ gst_srtp_enc_dispose (GObject * object)
     g_hash_table_unref (filter->ssrcs_set);
   filter->ssrcs_set = NULL;
 
+  gst_srtp_enc_clear_pool (filter);
+
   G_OBJECT_CLASS (gst_srtp_enc_parent_class)->dispose (object);
 }
 
@@ -1029,46 +1060,123 @@ gst_srtp_enc_check_set_caps (GstSrtpEnc * filter, GstPad * pad,
   return GST_FLOW_OK;
 }
 
-static GstBuffer *
-gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
-    GstBuffer * buf, gboolean is_rtcp)
+/* Returns a pool of buffers of at least @size bytes, growing the current one
+ * if needed, or NULL if it could not be created
+ *
+ * Should be called with the filter locked
+ */
+static GstBufferPool *
+gst_srtp_enc_get_pool_unlocked (GstSrtpEnc * filter, guint size)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  if (filter->pool && filter->pool_size >= size)
+    return gst_object_ref (filter->pool);
+
+  gst_srtp_enc_clear_pool (filter);
+
+  size = MAX (size, POOL_MIN_BUFFER_SIZE);
+  GST_DEBUG_OBJECT (filter, "Creating pool of %u bytes buffers", size);
+
+  pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+  if (!gst_buffer_pool_set_config (pool, config) ||
+      !gst_buffer_pool_set_active (pool, TRUE)) {
+    GST_WARNING_OBJECT (filter, "Could not activate buffer pool");
+    gst_object_unref (pool);
+    return NULL;
+  }
+
+  filter->pool = pool;
+  filter->pool_size = size;
+
+  return gst_object_ref (pool);
+}
+
+/* Whether @buf is ours alone and its only memory has room for the trailer,
+ * so it can be protected without copying */
+static gboolean
+gst_srtp_enc_can_protect_in_place (GstBuffer * buf)
 {
-  gint size_max, size;
+  GstMemory *mem;
+  gsize size, offset, maxsize;
+
+  if (!gst_buffer_is_writable (buf) || gst_buffer_n_memory (buf) != 1)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (buf, 0);
+  if (GST_MEMORY_IS_READONLY (mem) ||
+      !gst_mini_object_is_writable (GST_MINI_OBJECT_CAST (mem)))
+    return FALSE;
+
+  size = gst_buffer_get_sizes (buf, &offset, &maxsize);
+
+  return maxsize - offset - size >= OUT_BUFFER_PADDING;
+}
+
+/* Sets up @packet to protect @buf, taking ownership of it */
+static void
+gst_srtp_enc_prepare_packet (GstSrtpEnc * filter, GstBufferPool * pool,
+    GstBuffer * buf, GstSrtpEncPacket * packet)
+{
+  gsize size = gst_buffer_get_size (buf);
   GstBuffer *bufout = NULL;
-  GstMapInfo mapout;
-  srtp_err_status_t err;
 
-  /* Create a bigger buffer to add protection */
-  size = gst_buffer_get_size (buf);
-  size_max = size + SRTP_MAX_TRAILER_LEN + 10;
-  bufout = gst_buffer_new_allocate (NULL, size_max, NULL);
+  packet->size = size;
+  packet->err = srtp_err_status_ok;
 
-  gst_buffer_map (bufout, &mapout, GST_MAP_READWRITE);
+  if (gst_srtp_enc_can_protect_in_place (buf)) {
+    gst_buffer_set_size (buf, size + OUT_BUFFER_PADDING);
+    packet->buf = buf;
+    gst_buffer_map (buf, &packet->map, GST_MAP_READWRITE);
+    return;
+  }
 
-  gst_buffer_extract (buf, 0, mapout.data, size);
+  /* Copy to a bigger buffer to add protection */
+  if (pool == NULL
+      || gst_buffer_pool_acquire_buffer (pool, &bufout, NULL) != GST_FLOW_OK)
+    bufout = gst_buffer_new_allocate (NULL, size + OUT_BUFFER_PADDING, NULL);
 
-  GST_OBJECT_LOCK (filter);
+  gst_buffer_map (bufout, &packet->map, GST_MAP_READWRITE);
+  gst_buffer_extract (buf, 0, packet->map.data, size);
+  gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_unref (buf);
 
-  gst_srtp_init_event_reporter ();
+  packet->buf = bufout;
+}
 
+/* Should be called with the filter locked */
+static void
+gst_srtp_enc_protect_packet (GstSrtpEnc * filter, GstSrtpEncPacket * packet,
+    gboolean is_rtcp)
+{
   if (is_rtcp)
-    err = srtp_protect_rtcp (filter->session, mapout.data, &size);
+    packet->err =
+        srtp_protect_rtcp (filter->session, packet->map.data, &packet->size);
   else
-    err = srtp_protect (filter->session, mapout.data, &size);
+    packet->err = srtp_protect (filter->session, packet->map.data,
+        &packet->size);
+}
 
-  GST_OBJECT_UNLOCK (filter);
+/* Returns the protected buffer of @packet, or NULL if it was dropped */
+static GstBuffer *
+gst_srtp_enc_finish_packet (GstSrtpEnc * filter, GstPad * pad,
+    GstSrtpEncPacket * packet, gboolean is_rtcp)
+{
+  GstBuffer *bufout = packet->buf;
 
-  gst_buffer_unmap (bufout, &mapout);
+  gst_buffer_unmap (bufout, &packet->map);
 
-  if (err == srtp_err_status_ok) {
+  if (packet->err == srtp_err_status_ok) {
     /* Buffer protected */
-    gst_buffer_set_size (bufout, size);
-    gst_buffer_copy_into (bufout, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+    gst_buffer_set_size (bufout, packet->size);
 
     GST_LOG_OBJECT (pad, "Encoding %s buffer of size %d",
-        is_rtcp ? "RTCP" : "RTP", size);
+        is_rtcp ? "RTCP" : "RTP", packet->size);
 
-  } else if (err == srtp_err_status_key_expired) {
+  } else if (packet->err == srtp_err_status_key_expired) {
 
     GST_ELEMENT_ERROR (GST_ELEMENT_CAST (filter), STREAM, ENCODE,
         ("Key usage limit has been reached"),
@@ -1078,7 +1186,7 @@ gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
   } else {
     /* srtp_protect failed */
     GST_ELEMENT_ERROR (filter, LIBRARY, FAILED, (NULL),
-        ("Unable to protect buffer (protect failed) code %d", err));
+        ("Unable to protect buffer (protect failed) code %d", packet->err));
     goto fail;
   }
 
@@ -1089,6 +1197,24 @@ fail:
   return NULL;
 }
 
+static GstBuffer *
+gst_srtp_enc_process_buffer (GstSrtpEnc * filter, GstPad * pad,
+    GstBufferPool * pool, GstBuffer * buf, gboolean is_rtcp)
+{
+  GstSrtpEncPacket packet;
+
+  gst_srtp_enc_prepare_packet (filter, pool, buf, &packet);
+
+  GST_OBJECT_LOCK (filter);
+
+  gst_srtp_init_event_reporter ();
+  gst_srtp_enc_protect_packet (filter, &packet, is_rtcp);
+
+  GST_OBJECT_UNLOCK (filter);
+
+  return gst_srtp_enc_finish_packet (filter, pad, &packet, is_rtcp);
+}
+
 static GstFlowReturn
 gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     gboolean is_rtcp)
@@ -1097,9 +1223,11 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
   GstBuffer *bufout = NULL;
+  GstBufferPool *pool;
 
   if ((ret = gst_srtp_enc_check_set_caps (filter, pad, is_rtcp)) != GST_FLOW_OK) {
-    goto out;
+    gst_buffer_unref (buf);
+    return ret;
   }
 
   GST_OBJECT_LOCK (filter);
@@ -1110,9 +1238,16 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
     return gst_pad_push (otherpad, buf);
   }
 
+  pool = gst_srtp_enc_get_pool_unlocked (filter,
+      gst_buffer_get_size (buf) + OUT_BUFFER_PADDING);
+
   GST_OBJECT_UNLOCK (filter);
 
-  if ((bufout = gst_srtp_enc_process_buffer (filter, pad, buf, is_rtcp))) {
+  bufout = gst_srtp_enc_process_buffer (filter, pad, pool, buf, is_rtcp);
+  if (pool)
+    gst_object_unref (pool);
+
+  if (bufout) {
     /* Push buffer to source pad */
     otherpad = get_rtp_other_pad (pad);
     ret = gst_pad_push (otherpad, bufout);
@@ -1138,8 +1273,6 @@ gst_srtp_enc_chain (GstPad * pad, GstObject * parent, GstBuffer * buf,
 
 out:
 
-  gst_buffer_unref (buf);
-
   return ret;
 
 fail:
@@ -1148,18 +1281,24 @@ fail:
 }
 
 static gboolean
-process_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+max_size_it (GstBuffer ** buffer, guint index, gpointer user_data)
 {
-  ProcessBufferItData *data = user_data;
-  GstBuffer *bufout;
+  gsize *max_size = user_data;
 
-  if ((bufout =
-          gst_srtp_enc_process_buffer (data->filter, data->pad, *buffer,
-              data->is_rtcp))) {
-    gst_buffer_list_add (data->out_list, bufout);
-  } else {
-    GST_WARNING_OBJECT (data->filter, "Error encoding buffer, dropping");
-  }
+  *max_size = MAX (*max_size, gst_buffer_get_size (*buffer));
+
+  return TRUE;
+}
+
+static gboolean
+prepare_buffer_it (GstBuffer ** buffer, guint index, gpointer user_data)
+{
+  PrepareBufferItData *data = user_data;
+
+  /* Take the buffer out of the list, so that it can be protected in place */
+  gst_srtp_enc_prepare_packet (data->filter, data->pool, *buffer,
+      &data->packets[data->n_packets++]);
+  *buffer = NULL;
 
   return TRUE;
 }
@@ -1172,17 +1311,22 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   GstFlowReturn ret = GST_FLOW_OK;
   GstPad *otherpad;
   GstBufferList *out_list = NULL;
-  ProcessBufferItData process_data;
+  PrepareBufferItData prepare_data;
+  gsize max_size = 0;
+  guint i, length;
+
+  length = gst_buffer_list_length (buf_list);
 
-  GST_LOG_OBJECT (pad, "Buffer chain with list of %d",
-      gst_buffer_list_length (buf_list));
+  GST_LOG_OBJECT (pad, "Buffer chain with list of %u", length);
 
-  if (!gst_buffer_list_length (buf_list))
+  if (!length)
     goto out;
 
   if ((ret = gst_srtp_enc_check_set_caps (filter, pad, is_rtcp)) != GST_FLOW_OK)
     goto out;
 
+  gst_buffer_list_foreach (buf_list, max_size_it, &max_size);
+
   GST_OBJECT_LOCK (filter);
 
   if (!HAS_CRYPTO (filter)) {
@@ -1191,16 +1335,44 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
     return gst_pad_push_list (otherpad, buf_list);
   }
 
+  prepare_data.pool = gst_srtp_enc_get_pool_unlocked (filter,
+      max_size + OUT_BUFFER_PADDING);
+
+  GST_OBJECT_UNLOCK (filter);
+
+  /* Copy or map all the packets first, then protect them all in one go */
+  buf_list = gst_buffer_list_make_writable (buf_list);
+
+  prepare_data.filter = filter;
+  prepare_data.packets = g_new (GstSrtpEncPacket, length);
+  prepare_data.n_packets = 0;
+
+  gst_buffer_list_foreach (buf_list, prepare_buffer_it, &prepare_data);
+
+  if (prepare_data.pool)
+    gst_object_unref (prepare_data.pool);
+
+  GST_OBJECT_LOCK (filter);
+
+  gst_srtp_init_event_reporter ();
+  for (i = 0; i < prepare_data.n_packets; i++)
+    gst_srtp_enc_protect_packet (filter, &prepare_data.packets[i], is_rtcp);
+
   GST_OBJECT_UNLOCK (filter);
 
-  out_list = gst_buffer_list_new ();
+  out_list = gst_buffer_list_new_sized (prepare_data.n_packets);
 
-  process_data.filter = filter;
-  process_data.pad = pad;
-  process_data.is_rtcp = is_rtcp;
-  process_data.out_list = out_list;
+  for (i = 0; i < prepare_data.n_packets; i++) {
+    GstBuffer *bufout = gst_srtp_enc_finish_packet (filter, pad,
+        &prepare_data.packets[i], is_rtcp);
+
+    if (bufout)
+      gst_buffer_list_add (out_list, bufout);
+    else
+      GST_WARNING_OBJECT (filter, "Error encoding buffer, dropping");
+  }
 
-  gst_buffer_list_foreach (buf_list, process_buffer_it, &process_data);
+  g_free (prepare_data.packets);
 
   if (!gst_buffer_list_length (out_list)) {
     gst_buffer_list_unref (out_list);
@@ -1211,7 +1383,7 @@ gst_srtp_enc_chain_list (GstPad * pad, GstObject * parent,
   /* Push buffer to source pad */
   otherpad = get_rtp_other_pad (pad);
   GST_LOG_OBJECT (pad, "Pushing buffer chain of %d",
-      gst_buffer_list_length (buf_list));
+      gst_buffer_list_length (out_list));
   ret = gst_pad_push_list (otherpad, out_list);
 
   if (ret != GST_FLOW_OK) {
@@ -85,6 +85,10 @@ struct _GstSrtpEnc
   gboolean allow_repeat_tx;
 
   GHashTable *ssrcs_set;
+
+  /* Output buffers for packets that can't be protected in place */
+  GstBufferPool *pool;
+  guint pool_size;
 };
 
 struct _GstSrtpEncClass
@@ -136,6 +136,9 @@ GST_DEBUG_CATEGORY (adaptivedemux_debug);
 #define DEFAULT_BITRATE_LIMIT 0.8f
 #define SRC_QUEUE_MAX_BYTES 20 * 1024 * 1024    /* For safety. Large enough to hold a segment. */
 #define NUM_LOOKBACK_FRAGMENTS 3
+#define DEFAULT_PREFETCH_FRAGMENTS 0
+#define DEFAULT_PREFETCH_MAX_BYTES (20 * 1024 * 1024)
+#define DEFAULT_PREFETCH_MAX_TIME (30 * GST_SECOND)
 
 #define GST_MANIFEST_GET_LOCK(d) (&(GST_ADAPTIVE_DEMUX_CAST(d)->priv->manifest_lock))
 #define GST_MANIFEST_LOCK(d) G_STMT_START { \
@@ -162,6 +165,9 @@ enum
   PROP_0,
   PROP_CONNECTION_SPEED,
   PROP_BITRATE_LIMIT,
+  PROP_PREFETCH_FRAGMENTS,
+  PROP_PREFETCH_MAX_BYTES,
+  PROP_PREFETCH_MAX_TIME,
   PROP_LAST
 };
 
@@ -210,6 +216,17 @@ struct _GstAdaptiveDemuxPrivate
    * without needing to stop tasks when they just want to
    * update the segment boundaries */
   GMutex segment_lock;
+
+  /* Fragment prefetching settings, protected by manifest_lock */
+  guint prefetch_fragments;
+  guint64 prefetch_max_bytes;
+  GstClockTime prefetch_max_time;
+  /* Threads downloading the prefetched fragments, at most
+   * prefetch_fragments per stream. MT safe */
+  GThreadPool *prefetch_pool;
+  /* GstAdaptiveDemuxStream -> GstAdaptiveDemuxPrefetchQueue, kept out of the
+   * public stream structure. Protected by manifest_lock */
+  GHashTable *prefetch_queues;
 };
 
 typedef struct _GstAdaptiveDemuxTimer
@@ -221,6 +238,48 @@ typedef struct _GstAdaptiveDemuxTimer
   gboolean fired;
 } GstAdaptiveDemuxTimer;
 
+/* A fragment downloaded ahead of time by one of the threads of the
+ * prefetch_pool. Only the download thread and the stream it was requested
+ * for hold references, it does not reference the stream. */
+typedef struct _GstAdaptiveDemuxPrefetch
+{
+  volatile gint ref_count;
+  GMutex lock;
+  GCond cond;
+
+  GstUriDownloader *downloader;
+  gchar *uri;
+  gint64 range_start;
+  gint64 range_end;
+  GstClockTime duration;
+
+  /* protected by lock */
+  gboolean cancelled;
+  gboolean done;
+  GstBuffer *buffer;
+  GstClockTime download_start;
+  GstClockTime download_stop;
+} GstAdaptiveDemuxPrefetch;
+
+/* A prefetched fragment that was used, for measuring the throughput */
+typedef struct _GstAdaptiveDemuxPrefetchDownload
+{
+  GstClockTime start;
+  GstClockTime stop;
+  gsize size;
+} GstAdaptiveDemuxPrefetchDownload;
+
+/* The fragments requested ahead for a stream */
+typedef struct _GstAdaptiveDemuxPrefetchQueue
+{
+  /* GstAdaptiveDemuxPrefetch, in the order of the fragments */
+  GQueue entries;
+  /* downloaders that finished a prefetch and can be reused */
+  GList *downloaders;
+  /* GstAdaptiveDemuxPrefetchDownload, the last used fragments */
+  GQueue downloads;
+} GstAdaptiveDemuxPrefetchQueue;
+
 static GstBinClass *parent_class = NULL;
 static void gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass);
 static void gst_adaptive_demux_init (GstAdaptiveDemux * dec,
@@ -307,6 +366,12 @@ static gboolean gst_adaptive_demux_clock_callback (GstClock * clock,
 static gboolean
 gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
     * demux);
+static void gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch *
+    prefetch, GstAdaptiveDemux * demux);
+static void gst_adaptive_demux_prefetch_queue_free (GstAdaptiveDemuxPrefetchQueue
+    * queue);
+static void gst_adaptive_demux_stream_cancel_prefetch (GstAdaptiveDemuxStream *
+    stream);
 
 /* we can't use G_DEFINE_ABSTRACT_TYPE because we need the klass in the _init
  * method to get to the padtemplates */
@@ -354,6 +419,15 @@ gst_adaptive_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      demux->priv->prefetch_fragments = g_value_get_uint (value);
+      break;
+    case PROP_PREFETCH_MAX_BYTES:
+      demux->priv->prefetch_max_bytes = g_value_get_uint64 (value);
+      break;
+    case PROP_PREFETCH_MAX_TIME:
+      demux->priv->prefetch_max_time = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -378,6 +452,15 @@ gst_adaptive_demux_get_property (GObject * object, guint prop_id,
     case PROP_BITRATE_LIMIT:
       g_value_set_float (value, demux->bitrate_limit);
       break;
+    case PROP_PREFETCH_FRAGMENTS:
+      g_value_set_uint (value, demux->priv->prefetch_fragments);
+      break;
+    case PROP_PREFETCH_MAX_BYTES:
+      g_value_set_uint64 (value, demux->priv->prefetch_max_bytes);
+      break;
+    case PROP_PREFETCH_MAX_TIME:
+      g_value_set_uint64 (value, demux->priv->prefetch_max_time);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -421,6 +504,51 @@ gst_adaptive_demux_class_init (GstAdaptiveDemuxClass * klass)
           0, 1, DEFAULT_BITRATE_LIMIT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAdaptiveDemux:prefetch-fragments:
+   *
+   * Number of fragments of each stream to request while the current one is
+   * being downloaded, so that the request latency of the next fragments is
+   * hidden. Only used in forward playback, and if the subclass can tell
+   * which fragments come next.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_FRAGMENTS,
+      g_param_spec_uint ("prefetch-fragments", "Prefetch fragments",
+          "Number of fragments to download ahead of the current one "
+          "(0 = disabled)", 0, 16, DEFAULT_PREFETCH_FRAGMENTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:prefetch-max-bytes:
+   *
+   * No more fragments are requested ahead once the fragments already
+   * prefetched for a stream amount to this size. Fragments that are still
+   * downloading count with the average size of the previous ones.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_MAX_BYTES,
+      g_param_spec_uint64 ("prefetch-max-bytes", "Prefetch max bytes",
+          "Maximum amount of prefetched data per stream (0 = unlimited)",
+          0, G_MAXUINT64, DEFAULT_PREFETCH_MAX_BYTES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstAdaptiveDemux:prefetch-max-time:
+   *
+   * No more fragments are requested ahead once the fragments already
+   * prefetched or downloading for a stream amount to this duration.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PREFETCH_MAX_TIME,
+      g_param_spec_uint64 ("prefetch-max-time", "Prefetch max time",
+          "Maximum duration of prefetched data per stream in nanoseconds "
+          "(0 = unlimited)", 0, G_MAXUINT64, DEFAULT_PREFETCH_MAX_TIME,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_adaptive_demux_change_state;
 
   gstbin_class->handle_message = gst_adaptive_demux_handle_message;
@@ -500,6 +628,12 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   g_cond_init (&demux->priv->preroll_cond);
   g_mutex_init (&demux->priv->preroll_lock);
 
+  demux->priv->prefetch_pool =
+      g_thread_pool_new ((GFunc) gst_adaptive_demux_prefetch_func, demux, 1,
+      FALSE, NULL);
+  demux->priv->prefetch_queues = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) gst_adaptive_demux_prefetch_queue_free);
+
   pad_template =
       gst_element_class_get_pad_template (GST_ELEMENT_CLASS (klass), "sink");
   g_return_if_fail (pad_template != NULL);
@@ -513,6 +647,9 @@ gst_adaptive_demux_init (GstAdaptiveDemux * demux,
   /* Properties */
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->priv->prefetch_fragments = DEFAULT_PREFETCH_FRAGMENTS;
+  demux->priv->prefetch_max_bytes = DEFAULT_PREFETCH_MAX_BYTES;
+  demux->priv->prefetch_max_time = DEFAULT_PREFETCH_MAX_TIME;
 
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 }
@@ -525,6 +662,11 @@ gst_adaptive_demux_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (object, "finalize");
 
+  /* All prefetches were cancelled when freeing the streams, this only waits
+   * for their threads to notice */
+  g_thread_pool_free (priv->prefetch_pool, FALSE, TRUE);
+  g_hash_table_unref (priv->prefetch_queues);
+
   g_object_unref (priv->input_adapter);
   g_object_unref (demux->downloader);
 
@@ -1388,6 +1530,9 @@ gst_adaptive_demux_stream_free (GstAdaptiveDemuxStream * stream)
     stream->download_task = NULL;
   }
 
+  /* cancels the fragments requested ahead */
+  g_hash_table_remove (demux->priv->prefetch_queues, stream);
+
   gst_adaptive_demux_stream_fragment_clear (&stream->fragment);
 
   if (stream->pending_segment) {
@@ -2090,6 +2235,9 @@ gst_adaptive_demux_stop_tasks (GstAdaptiveDemux * demux, gboolean stop_updates)
       gst_task_stop (stream->download_task);
       g_cond_signal (&stream->fragment_download_cond);
       g_mutex_unlock (&stream->fragment_download_lock);
+
+      /* the fragments to download after a seek are likely to be others */
+      gst_adaptive_demux_stream_cancel_prefetch (stream);
     }
     list_to_process = demux->prepared_streams;
   }
@@ -2521,27 +2669,23 @@ gst_adaptive_demux_requires_periodical_playlist_update_default (GstAdaptiveDemux
   return TRUE;
 }
 
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ */
 static GstFlowReturn
-_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+gst_adaptive_demux_stream_chain_buffer (GstAdaptiveDemuxStream * stream,
+    GstBuffer * buffer)
 {
-  GstAdaptiveDemuxStream *stream;
-  GstAdaptiveDemux *demux;
-  GstAdaptiveDemuxClass *klass;
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
   GstFlowReturn ret = GST_FLOW_OK;
 
-  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
-  stream = gst_pad_get_element_private (pad);
-  klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
-
-  GST_MANIFEST_LOCK (demux);
-
   /* do not make any changes if the stream is cancelled */
   g_mutex_lock (&stream->fragment_download_lock);
   if (G_UNLIKELY (stream->cancelled)) {
     g_mutex_unlock (&stream->fragment_download_lock);
     gst_buffer_unref (buffer);
     ret = stream->last_ret = GST_FLOW_FLUSHING;
-    GST_MANIFEST_UNLOCK (demux);
     return ret;
   }
   g_mutex_unlock (&stream->fragment_download_lock);
@@ -2607,7 +2751,7 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
        * and we don't have a birate from the sub-class, then see if we
        * can work it out from the fragment size and duration */
       if (stream->fragment.bitrate == 0 &&
-          stream->fragment.duration != 0 &&
+          stream->fragment.duration != 0 && stream->uri_handler &&
           gst_element_query_duration (stream->uri_handler, GST_FORMAT_BYTES,
               &chunk_size)) {
         guint bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (chunk_size,
@@ -2638,7 +2782,6 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
     g_mutex_lock (&stream->fragment_download_lock);
     if (G_UNLIKELY (stream->cancelled)) {
       g_mutex_unlock (&stream->fragment_download_lock);
-      GST_MANIFEST_UNLOCK (demux);
       return ret;
     }
     g_mutex_unlock (&stream->fragment_download_lock);
@@ -2677,7 +2820,21 @@ _src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   }
 
 error:
+  return ret;
+}
+
+static GstFlowReturn
+_src_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  GstAdaptiveDemuxStream *stream;
+  GstAdaptiveDemux *demux;
+  GstFlowReturn ret;
+
+  demux = GST_ADAPTIVE_DEMUX_CAST (parent);
+  stream = gst_pad_get_element_private (pad);
 
+  GST_MANIFEST_LOCK (demux);
+  ret = gst_adaptive_demux_stream_chain_buffer (stream, buffer);
   GST_MANIFEST_UNLOCK (demux);
 
   return ret;
@@ -3312,6 +3469,480 @@ gst_adaptive_demux_stream_download_header_fragment (GstAdaptiveDemuxStream *
   return ret;
 }
 
+static GstAdaptiveDemuxPrefetch *
+gst_adaptive_demux_prefetch_ref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_atomic_int_inc (&prefetch->ref_count);
+  return prefetch;
+}
+
+static void
+gst_adaptive_demux_prefetch_unref (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  if (g_atomic_int_dec_and_test (&prefetch->ref_count)) {
+    g_object_unref (prefetch->downloader);
+    g_free (prefetch->uri);
+    if (prefetch->buffer)
+      gst_buffer_unref (prefetch->buffer);
+    g_mutex_clear (&prefetch->lock);
+    g_cond_clear (&prefetch->cond);
+    g_slice_free (GstAdaptiveDemuxPrefetch, prefetch);
+  }
+}
+
+/* Runs in one of the threads of the prefetch_pool, without any of the demuxer
+ * locks. It only touches the prefetch entry, that owns its own downloader. */
+static void
+gst_adaptive_demux_prefetch_func (GstAdaptiveDemuxPrefetch * prefetch,
+    GstAdaptiveDemux * demux)
+{
+  GstFragment *download = NULL;
+  GError *err = NULL;
+
+  g_mutex_lock (&prefetch->lock);
+  if (prefetch->cancelled)
+    goto done;
+  prefetch->download_start = gst_adaptive_demux_get_monotonic_time (demux);
+  g_mutex_unlock (&prefetch->lock);
+
+  GST_DEBUG_OBJECT (demux, "Prefetching %s, range:%" G_GINT64_FORMAT " - %"
+      G_GINT64_FORMAT, prefetch->uri, prefetch->range_start,
+      prefetch->range_end);
+
+  /* HTTP ranges are inclusive, the downloader's stop position is not */
+  download = gst_uri_downloader_fetch_uri_with_range (prefetch->downloader,
+      prefetch->uri, NULL, FALSE, FALSE, TRUE, prefetch->range_start,
+      prefetch->range_end != -1 ? prefetch->range_end + 1 : -1, &err);
+
+  if (download == NULL) {
+    GST_DEBUG_OBJECT (demux, "Prefetch of %s failed: %s", prefetch->uri,
+        err ? err->message : "cancelled");
+    g_clear_error (&err);
+  }
+
+  g_mutex_lock (&prefetch->lock);
+  prefetch->download_stop = gst_adaptive_demux_get_monotonic_time (demux);
+  if (download) {
+    prefetch->buffer = gst_fragment_get_buffer (download);
+    g_object_unref (download);
+  }
+
+done:
+  prefetch->done = TRUE;
+  g_cond_broadcast (&prefetch->cond);
+  g_mutex_unlock (&prefetch->lock);
+
+  gst_adaptive_demux_prefetch_unref (prefetch);
+}
+
+static void
+gst_adaptive_demux_prefetch_cancel (GstAdaptiveDemuxPrefetch * prefetch)
+{
+  g_mutex_lock (&prefetch->lock);
+  prefetch->cancelled = TRUE;
+  g_cond_broadcast (&prefetch->cond);
+  g_mutex_unlock (&prefetch->lock);
+  /* the downloader goes away with the entry, a cancelled downloader is
+   * not reused */
+  gst_uri_downloader_cancel (prefetch->downloader);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+}
+
+static void
+gst_adaptive_demux_prefetch_queue_free (GstAdaptiveDemuxPrefetchQueue * queue)
+{
+  GstAdaptiveDemuxPrefetchDownload *download;
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  while ((prefetch = g_queue_pop_head (&queue->entries)))
+    gst_adaptive_demux_prefetch_cancel (prefetch);
+  g_list_free_full (queue->downloaders, g_object_unref);
+  while ((download = g_queue_pop_head (&queue->downloads)))
+    g_slice_free (GstAdaptiveDemuxPrefetchDownload, download);
+  g_slice_free (GstAdaptiveDemuxPrefetchQueue, queue);
+}
+
+static gint
+gst_adaptive_demux_prefetch_download_compare (gconstpointer a,
+    gconstpointer b)
+{
+  const GstAdaptiveDemuxPrefetchDownload *da = a, *db = b;
+
+  return da->start < db->start ? -1 : (da->start > db->start ? 1 : 0);
+}
+
+/* must be called with manifest_lock taken.
+ *
+ * Adds a used prefetched fragment to the last @max_downloads ones and
+ * returns the throughput of the connection over them: their total size
+ * over the time during which at least one of them was downloading. The
+ * requests overlap, so the throughput of each request alone would only
+ * be a fraction of the one of the connection. */
+static guint64
+gst_adaptive_demux_prefetch_queue_add_download (GstAdaptiveDemuxPrefetchQueue *
+    queue, GstClockTime start, GstClockTime stop, gsize size,
+    guint max_downloads)
+{
+  GstAdaptiveDemuxPrefetchDownload *download;
+  GstClockTime busy_time = 0, busy_stop = 0;
+  guint64 total_size = 0;
+  GList *sorted, *iter;
+
+  download = g_slice_new (GstAdaptiveDemuxPrefetchDownload);
+  download->start = start;
+  download->stop = MAX (start, stop);
+  download->size = size;
+  g_queue_push_tail (&queue->downloads, download);
+  while (g_queue_get_length (&queue->downloads) > MAX (max_downloads, 1))
+    g_slice_free (GstAdaptiveDemuxPrefetchDownload,
+        g_queue_pop_head (&queue->downloads));
+
+  /* length of the union of the download intervals */
+  sorted = g_list_sort (g_list_copy (queue->downloads.head),
+      gst_adaptive_demux_prefetch_download_compare);
+  for (iter = sorted; iter; iter = iter->next) {
+    download = iter->data;
+
+    total_size += download->size;
+    if (download->stop <= busy_stop)
+      continue;
+    busy_time += download->stop - MAX (download->start, busy_stop);
+    busy_stop = download->stop;
+  }
+  g_list_free (sorted);
+
+  return gst_util_uint64_scale (total_size, 8 * GST_SECOND, MAX (busy_time,
+          1));
+}
+
+/* must be called with manifest_lock taken */
+static GstAdaptiveDemuxPrefetchQueue *
+gst_adaptive_demux_stream_get_prefetch_queue (GstAdaptiveDemuxStream * stream,
+    gboolean create)
+{
+  GHashTable *queues = stream->demux->priv->prefetch_queues;
+  GstAdaptiveDemuxPrefetchQueue *queue;
+
+  queue = g_hash_table_lookup (queues, stream);
+  if (queue == NULL && create) {
+    queue = g_slice_new0 (GstAdaptiveDemuxPrefetchQueue);
+    g_queue_init (&queue->entries);
+    g_queue_init (&queue->downloads);
+    g_hash_table_insert (queues, stream, queue);
+  }
+
+  return queue;
+}
+
+/* must be called with manifest_lock taken */
+static void
+gst_adaptive_demux_stream_cancel_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemuxPrefetchQueue *queue;
+  GstAdaptiveDemuxPrefetch *prefetch;
+
+  queue = gst_adaptive_demux_stream_get_prefetch_queue (stream, FALSE);
+  if (queue == NULL)
+    return;
+
+  while ((prefetch = g_queue_pop_head (&queue->entries)))
+    gst_adaptive_demux_prefetch_cancel (prefetch);
+}
+
+static gboolean
+gst_adaptive_demux_prefetch_matches (GstAdaptiveDemuxPrefetch * prefetch,
+    const gchar * uri, gint64 range_start, gint64 range_end)
+{
+  return prefetch->range_start == range_start &&
+      prefetch->range_end == range_end && g_str_equal (prefetch->uri, uri);
+}
+
+/* must be called with manifest_lock taken.
+ *
+ * Returns the expected size of the next fragments of @stream, 0 if
+ * unknown */
+static guint64
+gst_adaptive_demux_stream_estimate_fragment_size (GstAdaptiveDemuxStream *
+    stream, GstAdaptiveDemuxPrefetchQueue * queue)
+{
+  guint n_downloads = g_queue_get_length (&queue->downloads);
+  guint64 total_size = 0;
+  GList *iter;
+
+  if (n_downloads > 0) {
+    for (iter = queue->downloads.head; iter; iter = iter->next)
+      total_size += ((GstAdaptiveDemuxPrefetchDownload *) iter->data)->size;
+    return total_size / n_downloads;
+  }
+
+  if (stream->fragment_bytes_downloaded)
+    return stream->fragment_bytes_downloaded;
+
+  if (stream->fragment.bitrate && GST_CLOCK_TIME_IS_VALID
+      (stream->fragment.duration))
+    return gst_util_uint64_scale (stream->fragment.bitrate,
+        stream->fragment.duration, 8 * GST_SECOND);
+
+  return 0;
+}
+
+/* must be called with manifest_lock taken */
+static void
+gst_adaptive_demux_stream_schedule_prefetch (GstAdaptiveDemuxStream * stream)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxClass *klass = GST_ADAPTIVE_DEMUX_GET_CLASS (demux);
+  GstAdaptiveDemuxPrefetchQueue *queue;
+  guint prefetch_fragments;
+  guint64 max_bytes;
+  GstClockTime max_time;
+  guint64 queued_bytes = 0, fragment_size;
+  GstClockTime queued_time = 0, fragment_duration;
+  gint max_threads;
+  GList *iter;
+  guint n;
+
+  /* the settings are protected by the manifest_lock we hold */
+  prefetch_fragments = demux->priv->prefetch_fragments;
+  max_bytes = demux->priv->prefetch_max_bytes;
+  max_time = demux->priv->prefetch_max_time;
+
+  if (prefetch_fragments == 0 || !klass->stream_get_fragment_ahead
+      || demux->segment.rate < 0)
+    return;
+
+  /* enough threads for every stream to have all its fragments requested
+   * ahead downloading at once, and no more */
+  max_threads = prefetch_fragments * MAX (g_list_length (demux->streams), 1);
+  if (g_thread_pool_get_max_threads (demux->priv->prefetch_pool) !=
+      max_threads)
+    g_thread_pool_set_max_threads (demux->priv->prefetch_pool, max_threads,
+        NULL);
+
+  queue = gst_adaptive_demux_stream_get_prefetch_queue (stream, TRUE);
+
+  /* fragments that are still downloading count with the expected size */
+  fragment_size = gst_adaptive_demux_stream_estimate_fragment_size (stream,
+      queue);
+  for (iter = queue->entries.head; iter; iter = iter->next) {
+    GstAdaptiveDemuxPrefetch *prefetch = iter->data;
+
+    g_mutex_lock (&prefetch->lock);
+    if (prefetch->buffer)
+      queued_bytes += gst_buffer_get_size (prefetch->buffer);
+    else if (!prefetch->done && !prefetch->cancelled)
+      queued_bytes += fragment_size;
+    g_mutex_unlock (&prefetch->lock);
+
+    if (GST_CLOCK_TIME_IS_VALID (prefetch->duration))
+      queued_time += prefetch->duration;
+  }
+
+  for (n = 1; n <= prefetch_fragments; n++) {
+    GstAdaptiveDemuxStreamFragment fragment = { 0, };
+    GstAdaptiveDemuxPrefetch *prefetch = NULL;
+
+    gst_adaptive_demux_stream_fragment_clear (&fragment);
+    if (!klass->stream_get_fragment_ahead (stream, n, &fragment)) {
+      gst_adaptive_demux_stream_fragment_clear (&fragment);
+      break;
+    }
+
+    for (iter = queue->entries.head; iter; iter = iter->next) {
+      if (gst_adaptive_demux_prefetch_matches (iter->data, fragment.uri,
+              fragment.range_start, fragment.range_end)) {
+        prefetch = iter->data;
+        break;
+      }
+    }
+
+    if (prefetch != NULL) {
+      /* already counted */
+      gst_adaptive_demux_stream_fragment_clear (&fragment);
+      continue;
+    }
+
+    /* not all subclasses know the duration of the fragments ahead */
+    fragment_duration = fragment.duration;
+    if (!GST_CLOCK_TIME_IS_VALID (fragment_duration) || fragment_duration == 0)
+      fragment_duration = stream->fragment.duration;
+
+    if (max_bytes && queued_bytes + fragment_size > max_bytes) {
+      GST_LOG_OBJECT (stream->pad, "%" G_GUINT64_FORMAT " bytes prefetched "
+          "or downloading already, not requesting more", queued_bytes);
+      gst_adaptive_demux_stream_fragment_clear (&fragment);
+      break;
+    }
+    if (max_time && GST_CLOCK_TIME_IS_VALID (fragment_duration) &&
+        queued_time + fragment_duration > max_time) {
+      GST_LOG_OBJECT (stream->pad, "%" GST_TIME_FORMAT " prefetched or "
+          "downloading already, not requesting more",
+          GST_TIME_ARGS (queued_time));
+      gst_adaptive_demux_stream_fragment_clear (&fragment);
+      break;
+    }
+
+    prefetch = g_slice_new0 (GstAdaptiveDemuxPrefetch);
+    prefetch->ref_count = 1;
+    g_mutex_init (&prefetch->lock);
+    g_cond_init (&prefetch->cond);
+    prefetch->uri = fragment.uri;
+    fragment.uri = NULL;
+    prefetch->range_start = fragment.range_start;
+    prefetch->range_end = fragment.range_end;
+    prefetch->duration = fragment_duration;
+    prefetch->download_start = prefetch->download_stop = GST_CLOCK_TIME_NONE;
+
+    if (queue->downloaders) {
+      prefetch->downloader = queue->downloaders->data;
+      queue->downloaders =
+          g_list_delete_link (queue->downloaders, queue->downloaders);
+    } else {
+      prefetch->downloader = gst_uri_downloader_new ();
+      gst_uri_downloader_set_parent (prefetch->downloader,
+          GST_ELEMENT_CAST (demux));
+    }
+
+    GST_DEBUG_OBJECT (stream->pad, "Requesting fragment %u ahead: %s", n,
+        prefetch->uri);
+
+    queued_bytes += fragment_size;
+    if (GST_CLOCK_TIME_IS_VALID (fragment_duration))
+      queued_time += fragment_duration;
+
+    g_queue_push_tail (&queue->entries, prefetch);
+    g_thread_pool_push (demux->priv->prefetch_pool,
+        gst_adaptive_demux_prefetch_ref (prefetch), NULL);
+
+    gst_adaptive_demux_stream_fragment_clear (&fragment);
+  }
+}
+
+/* must be called with manifest_lock taken.
+ * Can temporarily release manifest_lock
+ *
+ * Feeds the current fragment from the prefetch queue if it was requested
+ * ahead of time. Returns FALSE if it has to be downloaded the usual way.
+ */
+static gboolean
+gst_adaptive_demux_stream_use_prefetched (GstAdaptiveDemuxStream * stream,
+    GstFlowReturn * ret)
+{
+  GstAdaptiveDemux *demux = stream->demux;
+  GstAdaptiveDemuxPrefetchQueue *queue;
+  GstAdaptiveDemuxPrefetch *prefetch = NULL;
+  GstClockTime download_time;
+  GstBuffer *buffer;
+  GList *iter;
+  gsize size;
+
+  queue = gst_adaptive_demux_stream_get_prefetch_queue (stream, FALSE);
+  if (queue == NULL)
+    return FALSE;
+
+  for (iter = queue->entries.head; iter; iter = iter->next) {
+    if (gst_adaptive_demux_prefetch_matches (iter->data, stream->fragment.uri,
+            stream->fragment.range_start, stream->fragment.range_end)) {
+      prefetch = iter->data;
+      break;
+    }
+  }
+
+  /* Not requested ahead, the queued fragments come after this one */
+  if (prefetch == NULL)
+    return FALSE;
+
+  /* Anything queued before the current fragment was skipped and will not be
+   * used anymore */
+  while (g_queue_peek_head (&queue->entries) != prefetch)
+    gst_adaptive_demux_prefetch_cancel (g_queue_pop_head (&queue->entries));
+
+  GST_DEBUG_OBJECT (stream->pad, "Waiting for prefetched fragment %s",
+      prefetch->uri);
+
+  /* Keep it queued while waiting, so that stopping the tasks can cancel it */
+  gst_adaptive_demux_prefetch_ref (prefetch);
+  GST_MANIFEST_UNLOCK (demux);
+  g_mutex_lock (&prefetch->lock);
+  while (!prefetch->done && !prefetch->cancelled)
+    g_cond_wait (&prefetch->cond, &prefetch->lock);
+  buffer = prefetch->buffer;
+  prefetch->buffer = NULL;
+  g_mutex_unlock (&prefetch->lock);
+  GST_MANIFEST_LOCK (demux);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    if (buffer)
+      gst_buffer_unref (buffer);
+    gst_adaptive_demux_prefetch_unref (prefetch);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  /* drop the reference of the queue, looked up again as the manifest_lock
+   * was released */
+  queue = gst_adaptive_demux_stream_get_prefetch_queue (stream, TRUE);
+  if (g_queue_remove (&queue->entries, prefetch))
+    gst_adaptive_demux_prefetch_unref (prefetch);
+
+  if (buffer == NULL) {
+    GST_INFO_OBJECT (stream->pad, "Prefetching %s failed, downloading it again",
+        prefetch->uri);
+    gst_adaptive_demux_prefetch_unref (prefetch);
+    return FALSE;
+  }
+
+  /* The downloader has finished, it can serve the next prefetch */
+  queue->downloaders = g_list_prepend (queue->downloaders,
+      g_object_ref (prefetch->downloader));
+
+  size = gst_buffer_get_size (buffer);
+  download_time = prefetch->download_stop - prefetch->download_start;
+
+  /* Up to prefetch-fragments requests are running next to the one of the
+   * current fragment */
+  stream->download_start_time = GST_TIME_AS_USECONDS (prefetch->download_start);
+  stream->last_latency = 0;
+  stream->fragment_bytes_downloaded = size;
+  stream->last_download_time = MAX (download_time, 1);
+  stream->last_bitrate = gst_adaptive_demux_prefetch_queue_add_download (queue,
+      prefetch->download_start, prefetch->download_stop, size,
+      demux->priv->prefetch_fragments + 1);
+  gst_adaptive_demux_prefetch_unref (prefetch);
+
+  if (stream->fragment.bitrate == 0 && stream->fragment.duration != 0)
+    stream->fragment.bitrate = MIN (G_MAXUINT, gst_util_uint64_scale (size,
+            8 * GST_SECOND, stream->fragment.duration));
+
+  GST_DEBUG_OBJECT (stream->pad, "Using prefetched fragment of size %"
+      G_GSIZE_FORMAT " downloaded in %" GST_TIME_FORMAT ", bitrate %"
+      G_GUINT64_FORMAT " bps", size, GST_TIME_ARGS (stream->last_download_time),
+      stream->last_bitrate);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  stream->download_finished = FALSE;
+  stream->downloading_first_buffer = TRUE;
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  *ret = gst_adaptive_demux_stream_chain_buffer (stream, buffer);
+  if (*ret == GST_FLOW_OK)
+    gst_adaptive_demux_eos_handling (stream);
+
+  g_mutex_lock (&stream->fragment_download_lock);
+  if (G_UNLIKELY (stream->cancelled)) {
+    g_mutex_unlock (&stream->fragment_download_lock);
+    *ret = stream->last_ret = GST_FLOW_FLUSHING;
+    return TRUE;
+  }
+  g_mutex_unlock (&stream->fragment_download_lock);
+
+  *ret = stream->last_ret;
+  return TRUE;
+}
+
 /* must be called with manifest_lock taken.
  * Can temporarily release manifest_lock
  */
@@ -3430,9 +4061,14 @@ again:
         chunk_end = MIN (chunk_end, range_end);
     }
   } else {
-    ret =
-        gst_adaptive_demux_stream_download_uri (demux, stream, url,
-        stream->fragment.range_start, stream->fragment.range_end, &http_status);
+    gst_adaptive_demux_stream_schedule_prefetch (stream);
+
+    if (!gst_adaptive_demux_stream_use_prefetched (stream, &ret)) {
+      ret =
+          gst_adaptive_demux_stream_download_uri (demux, stream, url,
+          stream->fragment.range_start, stream->fragment.range_end,
+          &http_status);
+    }
     GST_DEBUG_OBJECT (stream->pad, "Fragment download result: %d (%d) %s",
         stream->last_ret, http_status, gst_flow_get_name (stream->last_ret));
   }
@@ -4216,6 +4852,8 @@ gst_adaptive_demux_stream_advance_fragment_unlocked (GstAdaptiveDemux * demux,
   if (ret == GST_FLOW_OK) {
     if (gst_adaptive_demux_stream_select_bitrate (demux, stream,
             gst_adaptive_demux_stream_update_current_bitrate (demux, stream))) {
+      /* the fragments requested ahead belong to the previous bitrate */
+      gst_adaptive_demux_stream_cancel_prefetch (stream);
       stream->need_header = TRUE;
       ret = (GstFlowReturn) GST_ADAPTIVE_DEMUX_FLOW_SWITCH;
     }
@@ -481,6 +481,26 @@ struct _GstAdaptiveDemuxClass
    * Return: %TRUE if the playlist needs to be refreshed periodically by the demuxer.
    */
   gboolean (*requires_periodical_playlist_update) (GstAdaptiveDemux * demux);
+
+  /**
+   * stream_get_fragment_ahead:
+   * @stream: #GstAdaptiveDemuxStream
+   * @n: the position of the fragment after the current one, starting at 1
+   * @fragment: #GstAdaptiveDemuxStreamFragment to fill
+   *
+   * Optional. Sets the uri and range of the fragment @n positions after the
+   * current one in forward playback, without changing the state of @stream,
+   * so that it can be requested before it is needed. Only fragments that
+   * can already be downloaded should be returned.
+   *
+   * Returns: %TRUE if @fragment was set
+   *
+   * Since: 1.14
+   */
+  gboolean (*stream_get_fragment_ahead) (GstAdaptiveDemuxStream * stream, guint n, GstAdaptiveDemuxStreamFragment * fragment);
+
+  /*< private >*/
+  gpointer _gst_reserved[GST_PADDING_LARGE];
 };
 
 GST_EXPORT
@@ -297,13 +297,32 @@ nal_reader_has_more_data (NalReader * nr)
 
 /***********  end of nal parser ***************/
 
+/* Start codes are located from their 0x01 byte, which is rare in coded
+ * data, so that most of the data is skipped by memchr(), which the C
+ * library implements with vector instructions wherever available, instead
+ * of being walked a few bytes at a time. */
 gint
 scan_for_start_codes (const guint8 * data, guint size)
 {
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
+  const guint8 *p, *end;
 
   /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
+  if (size < 4)
+    return -1;
+
+  p = data + 2;
+  end = data + size - 1;
+
+  while (p < end) {
+    p = memchr (p, 0x01, end - p);
+    if (p == NULL)
+      break;
+
+    if (p[-1] == 0x00 && p[-2] == 0x00)
+      return p - 2 - data;
+
+    p++;
+  }
+
+  return -1;
 }
@@ -1336,6 +1336,75 @@ clean_pad (GstElement * agg, GstPad * pad, gpointer user_data)
   return TRUE;
 }
 
+/* Whether a buffer with @pad's format can be used as is as output buffer */
+static gboolean
+gst_video_aggregator_pad_layout_matches (GstVideoAggregator * vagg,
+    GstVideoAggregatorPad * pad)
+{
+  GstVideoInfo *in_info = &pad->info;
+  GstVideoInfo *out_info = &vagg->info;
+  GstVideoMeta *meta;
+  guint i;
+
+  if (GST_VIDEO_INFO_FORMAT (in_info) != GST_VIDEO_INFO_FORMAT (out_info) ||
+      GST_VIDEO_INFO_WIDTH (in_info) != GST_VIDEO_INFO_WIDTH (out_info) ||
+      GST_VIDEO_INFO_HEIGHT (in_info) != GST_VIDEO_INFO_HEIGHT (out_info) ||
+      GST_VIDEO_INFO_INTERLACE_MODE (in_info) !=
+      GST_VIDEO_INFO_INTERLACE_MODE (out_info) ||
+      in_info->chroma_site != out_info->chroma_site ||
+      !gst_video_colorimetry_is_equal (&in_info->colorimetry,
+          &out_info->colorimetry))
+    return FALSE;
+
+  /* Downstream might not support non-default strides or offsets */
+  meta = gst_buffer_get_video_meta (pad->buffer);
+  if (meta) {
+    for (i = 0; i < meta->n_planes; i++) {
+      if (meta->offset[i] != GST_VIDEO_INFO_PLANE_OFFSET (out_info, i) ||
+          meta->stride[i] != GST_VIDEO_INFO_PLANE_STRIDE (out_info, i))
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Returns: a new reference to the buffer of the topmost pad if it covers the
+ * whole output and can be pushed as is, %NULL otherwise */
+static GstBuffer *
+gst_video_aggregator_get_passthrough_buffer (GstVideoAggregator * vagg)
+{
+  GstVideoAggregatorPad *top_pad = NULL;
+  GstVideoAggregatorPadClass *vaggpad_class;
+  GstBuffer *buffer = NULL;
+  GList *l;
+
+  GST_OBJECT_LOCK (vagg);
+  for (l = g_list_last (GST_ELEMENT (vagg)->sinkpads); l; l = l->prev) {
+    GstVideoAggregatorPad *pad = l->data;
+
+    if (pad->buffer != NULL) {
+      top_pad = pad;
+      break;
+    }
+  }
+
+  if (top_pad) {
+    vaggpad_class = GST_VIDEO_AGGREGATOR_PAD_GET_CLASS (top_pad);
+
+    if (vaggpad_class->covers_output &&
+        vaggpad_class->covers_output (top_pad, vagg) &&
+        gst_video_aggregator_pad_layout_matches (vagg, top_pad))
+      buffer = gst_buffer_ref (top_pad->buffer);
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (buffer)
+    GST_LOG_OBJECT (top_pad, "Covers the whole output, forwarding buffer");
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
     GstClockTime output_start_time, GstClockTime output_end_time,
@@ -1348,6 +1417,24 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   g_assert (vagg_klass->aggregate_frames != NULL);
   g_assert (vagg_klass->get_output_buffer != NULL);
 
+  /* Sync pad properties to the stream time */
+  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
+
+  /* If a single pad hides everything else, there's nothing to aggregate and
+   * its buffer can be pushed without copying any pixel */
+  *outbuf = gst_video_aggregator_get_passthrough_buffer (vagg);
+  if (*outbuf) {
+    *outbuf = gst_buffer_make_writable (*outbuf);
+    GST_BUFFER_TIMESTAMP (*outbuf) = output_start_time;
+    GST_BUFFER_DURATION (*outbuf) = output_end_time - output_start_time;
+    GST_BUFFER_DTS (*outbuf) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_OFFSET (*outbuf) = GST_BUFFER_OFFSET_NONE;
+    GST_BUFFER_OFFSET_END (*outbuf) = GST_BUFFER_OFFSET_NONE;
+    GST_BUFFER_FLAG_UNSET (*outbuf, GST_BUFFER_FLAG_DISCONT);
+
+    return GST_FLOW_OK;
+  }
+
   if ((ret = vagg_klass->get_output_buffer (vagg, outbuf)) != GST_FLOW_OK) {
     GST_WARNING_OBJECT (vagg, "Could not get an output buffer, reason: %s",
         gst_flow_get_name (ret));
@@ -1361,9 +1448,6 @@ gst_video_aggregator_do_aggregate (GstVideoAggregator * vagg,
   GST_BUFFER_TIMESTAMP (*outbuf) = output_start_time;
   GST_BUFFER_DURATION (*outbuf) = output_end_time - output_start_time;
 
-  /* Sync pad properties to the stream time */
-  gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), sync_pad_values, NULL);
-
   /* Convert all the frames the subclass has before aggregating */
   gst_element_foreach_sink_pad (GST_ELEMENT_CAST (vagg), prepare_frames, NULL);
 
@@ -87,6 +87,11 @@ struct _GstVideoAggregatorPad
  * @prepare_frame: Prepare the frame from the pad buffer (if any)
  *                 and sets it to @aggregated_frame
  * @clean_frame:   clean the frame previously prepared in prepare_frame
+ * @covers_output: Optional. Called with the OBJECT_LOCK of the aggregator
+ *                 held on the topmost pad that has a buffer. Returns %TRUE if
+ *                 aggregating would only copy that buffer unmodified into the
+ *                 output, hiding all other pads, in which case the buffer is
+ *                 forwarded downstream without copying it. Since: 1.14
  */
 struct _GstVideoAggregatorPadClass
 {
@@ -102,7 +107,10 @@ struct _GstVideoAggregatorPadClass
   void               (*clean_frame)           (GstVideoAggregatorPad * pad,
                                                GstVideoAggregator    * videoaggregator);
 
-  gpointer          _gst_reserved[GST_PADDING_LARGE];
+  gboolean           (*covers_output)         (GstVideoAggregatorPad * pad,
+                                               GstVideoAggregator    * videoaggregator);
+
+  gpointer          _gst_reserved[GST_PADDING_LARGE - 1];
 };
 
 GST_EXPORT
@@ -0,0 +1,232 @@
+/* GStreamer
+ *
+ * gstvideostripepool.c: worker pool for processing frames in stripes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:gstvideostripepool
+ * @title: GstVideoStripePool
+ * @short_description: Worker pool for processing frames in stripes
+ *
+ * #GstVideoStripePool lets a video filter split each frame into horizontal
+ * stripes and process them in parallel. The caller decides what a stripe
+ * is, gst_video_stripe_pool_prepare() tells it how many to use and
+ * gst_video_stripe_pool_run() processes the first one on the calling thread
+ * and all others on worker threads, and only returns once all of them are
+ * done.
+ *
+ * The worker threads are only started when more than one stripe is used.
+ * A pool must only be used from one thread at a time.
+ *
+ * Since: 1.14
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstvideostripepool.h"
+
+#ifndef GST_DISABLE_GST_DEBUG
+#define GST_CAT_DEFAULT ensure_debug_category ()
+static GstDebugCategory *
+ensure_debug_category (void)
+{
+  static gsize cat_gonce = 0;
+
+  if (g_once_init_enter (&cat_gonce)) {
+    gsize cat_done;
+
+    cat_done = (gsize) _gst_debug_category_new ("videostripepool", 0,
+        "video stripe pool");
+
+    g_once_init_leave (&cat_gonce, cat_done);
+  }
+
+  return (GstDebugCategory *) cat_gonce;
+}
+#else
+#define ensure_debug_category() /* NOOP */
+#endif /* GST_DISABLE_GST_DEBUG */
+
+struct _GstVideoStripePool
+{
+  GThreadPool *pool;
+
+  GMutex lock;
+  GCond cond;
+  guint pending;
+
+  /* the stripes being run */
+  GstVideoStripeFunc func;
+  gpointer user_data;
+};
+
+static void
+gst_video_stripe_pool_worker (gpointer data, gpointer user_data)
+{
+  GstVideoStripePool *pool = user_data;
+
+  pool->func (data, pool->user_data);
+
+  g_mutex_lock (&pool->lock);
+  pool->pending--;
+  if (pool->pending == 0)
+    g_cond_signal (&pool->cond);
+  g_mutex_unlock (&pool->lock);
+}
+
+/**
+ * gst_video_stripe_pool_new:
+ *
+ * Creates a new stripe pool. No threads are started until
+ * gst_video_stripe_pool_prepare() asks for more than one stripe.
+ *
+ * Returns: (transfer full): a new #GstVideoStripePool, free with
+ *     gst_video_stripe_pool_free()
+ *
+ * Since: 1.14
+ */
+GstVideoStripePool *
+gst_video_stripe_pool_new (void)
+{
+  GstVideoStripePool *pool = g_slice_new0 (GstVideoStripePool);
+
+  g_mutex_init (&pool->lock);
+  g_cond_init (&pool->cond);
+
+  return pool;
+}
+
+/**
+ * gst_video_stripe_pool_free:
+ * @pool: a #GstVideoStripePool
+ *
+ * Stops the worker threads of @pool and frees it.
+ *
+ * Since: 1.14
+ */
+void
+gst_video_stripe_pool_free (GstVideoStripePool * pool)
+{
+  g_return_if_fail (pool != NULL);
+
+  if (pool->pool)
+    g_thread_pool_free (pool->pool, TRUE, TRUE);
+  g_mutex_clear (&pool->lock);
+  g_cond_clear (&pool->cond);
+
+  g_slice_free (GstVideoStripePool, pool);
+}
+
+/**
+ * gst_video_stripe_pool_prepare:
+ * @pool: a #GstVideoStripePool
+ * @n_threads: the number of threads to use, or 0 for the number of
+ *     processors
+ * @max_stripes: the largest number of stripes the frame can be split into
+ *
+ * Works out how many stripes to split the next frame into and makes sure
+ * there are enough worker threads for them.
+ *
+ * Returns: the number of stripes to use, at least 1 and otherwise at most
+ *     @max_stripes
+ *
+ * Since: 1.14
+ */
+guint
+gst_video_stripe_pool_prepare (GstVideoStripePool * pool, guint n_threads,
+    guint max_stripes)
+{
+  g_return_val_if_fail (pool != NULL, 1);
+
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  n_threads = MIN (n_threads, max_stripes);
+  if (n_threads <= 1)
+    return 1;
+
+  if (!pool->pool) {
+    GError *err = NULL;
+
+    pool->pool = g_thread_pool_new (gst_video_stripe_pool_worker, pool,
+        n_threads - 1, FALSE, &err);
+    if (!pool->pool) {
+      GST_WARNING ("Could not create worker pool: %s", err->message);
+      g_clear_error (&err);
+      return 1;
+    }
+  } else if (g_thread_pool_get_max_threads (pool->pool) !=
+      (gint) n_threads - 1) {
+    g_thread_pool_set_max_threads (pool->pool, n_threads - 1, NULL);
+  }
+
+  return n_threads;
+}
+
+/**
+ * gst_video_stripe_pool_run:
+ * @pool: a #GstVideoStripePool
+ * @func: the function processing a stripe
+ * @user_data: user data passed to @func
+ * @stripes: an array of @n_stripes stripes
+ * @stripe_size: the size of each stripe in @stripes
+ * @n_stripes: the number of stripes, as returned by
+ *     gst_video_stripe_pool_prepare() or less
+ *
+ * Calls @func on all @stripes, the first one on the calling thread and all
+ * others on the worker threads, and waits until all of them are done.
+ *
+ * Since: 1.14
+ */
+void
+gst_video_stripe_pool_run (GstVideoStripePool * pool, GstVideoStripeFunc func,
+    gpointer user_data, gpointer stripes, gsize stripe_size, guint n_stripes)
+{
+  guint8 *stripe = stripes;
+  guint i;
+
+  g_return_if_fail (pool != NULL);
+  g_return_if_fail (func != NULL);
+  g_return_if_fail (n_stripes <= 1 || pool->pool != NULL);
+
+  if (n_stripes == 0)
+    return;
+
+  if (n_stripes == 1) {
+    func (stripe, user_data);
+    return;
+  }
+
+  g_mutex_lock (&pool->lock);
+  pool->func = func;
+  pool->user_data = user_data;
+  pool->pending = n_stripes - 1;
+  g_mutex_unlock (&pool->lock);
+
+  for (i = 1; i < n_stripes; i++)
+    g_thread_pool_push (pool->pool, stripe + i * stripe_size, NULL);
+
+  func (stripe, user_data);
+
+  g_mutex_lock (&pool->lock);
+  while (pool->pending > 0)
+    g_cond_wait (&pool->cond, &pool->lock);
+  g_mutex_unlock (&pool->lock);
+}
@@ -0,0 +1,73 @@
+/* GStreamer
+ *
+ * gstvideostripepool.h: worker pool for processing frames in stripes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_VIDEO_STRIPE_POOL_H__
+#define __GST_VIDEO_STRIPE_POOL_H__
+
+#ifndef GST_USE_UNSTABLE_API
+#warning "The Video library from gst-plugins-bad is unstable API and may change in future."
+#warning "You can define GST_USE_UNSTABLE_API to avoid this warning."
+#endif
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/**
+ * GstVideoStripePool:
+ *
+ * An opaque worker pool processing the stripes of a frame.
+ *
+ * Since: 1.14
+ */
+typedef struct _GstVideoStripePool GstVideoStripePool;
+
+/**
+ * GstVideoStripeFunc:
+ * @stripe: the stripe to process
+ * @user_data: the data passed to gst_video_stripe_pool_run()
+ *
+ * Processes one stripe of a frame.
+ *
+ * Since: 1.14
+ */
+typedef void (*GstVideoStripeFunc) (gpointer stripe, gpointer user_data);
+
+GST_EXPORT
+GstVideoStripePool * gst_video_stripe_pool_new      (void);
+
+GST_EXPORT
+void                 gst_video_stripe_pool_free     (GstVideoStripePool * pool);
+
+GST_EXPORT
+guint                gst_video_stripe_pool_prepare  (GstVideoStripePool * pool,
+                                                     guint                n_threads,
+                                                     guint                max_stripes);
+
+GST_EXPORT
+void                 gst_video_stripe_pool_run      (GstVideoStripePool * pool,
+                                                     GstVideoStripeFunc   func,
+                                                     gpointer             user_data,
+                                                     gpointer             stripes,
+                                                     gsize                stripe_size,
+                                                     guint                n_stripes);
+
+G_END_DECLS
+#endif /* __GST_VIDEO_STRIPE_POOL_H__ */
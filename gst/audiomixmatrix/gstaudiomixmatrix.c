@@ -228,6 +228,75 @@ gst_audio_mix_matrix_init (GstAudioMixMatrix * self)
   self->s16_conv_matrix = NULL;
   self->s32_conv_matrix = NULL;
   self->mode = GST_AUDIO_MIX_MATRIX_MODE_MANUAL;
+  self->kernel = GST_AUDIO_MIX_MATRIX_KERNEL_DENSE;
+  self->nonzero_rows = NULL;
+  self->nonzero_in = NULL;
+  self->copy_map = NULL;
+}
+
+static void
+gst_audio_mix_matrix_clear_plan (GstAudioMixMatrix * self)
+{
+  g_free (self->nonzero_rows);
+  self->nonzero_rows = NULL;
+  g_free (self->nonzero_in);
+  self->nonzero_in = NULL;
+  g_free (self->copy_map);
+  self->copy_map = NULL;
+  self->kernel = GST_AUDIO_MIX_MATRIX_KERNEL_DENSE;
+}
+
+/* Routing matrices are mostly zeros, often with a single unity coefficient
+ * per output channel. Look at the structure of the matrix once, so that
+ * transform() only visits the non-zero coefficients, or does not multiply
+ * at all when every output channel is a plain copy of an input channel (or
+ * silence). */
+static void
+gst_audio_mix_matrix_plan (GstAudioMixMatrix * self)
+{
+  guint in, out, n_nonzero = 0;
+  gboolean copy = TRUE;
+
+  gst_audio_mix_matrix_clear_plan (self);
+
+  if (self->matrix == NULL || self->in_channels == 0
+      || self->out_channels == 0)
+    return;
+
+  self->nonzero_rows = g_new (guint, self->out_channels + 1);
+  self->nonzero_in = g_new (guint, self->in_channels * self->out_channels);
+  self->copy_map = g_new (gint, self->out_channels);
+
+  for (out = 0; out < self->out_channels; out++) {
+    self->nonzero_rows[out] = n_nonzero;
+    self->copy_map[out] = -1;
+    for (in = 0; in < self->in_channels; in++) {
+      gdouble coefficient = self->matrix[out * self->in_channels + in];
+
+      if (coefficient == 0.0)
+        continue;
+
+      if (coefficient == 1.0 && self->copy_map[out] == -1)
+        self->copy_map[out] = in;
+      else
+        copy = FALSE;
+      self->nonzero_in[n_nonzero++] = in;
+    }
+  }
+  self->nonzero_rows[self->out_channels] = n_nonzero;
+
+  /* Indexed access only pays off if it skips most of the multiplications */
+  if (copy)
+    self->kernel = GST_AUDIO_MIX_MATRIX_KERNEL_COPY;
+  else if (n_nonzero * 2 <= self->in_channels * self->out_channels)
+    self->kernel = GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE;
+  else
+    self->kernel = GST_AUDIO_MIX_MATRIX_KERNEL_DENSE;
+
+  GST_DEBUG_OBJECT (self, "%u of %u coefficients are non-zero, using %s "
+      "kernel", n_nonzero, self->in_channels * self->out_channels,
+      self->kernel == GST_AUDIO_MIX_MATRIX_KERNEL_COPY ? "copy" :
+      self->kernel == GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE ? "sparse" : "dense");
 }
 
 static void
@@ -240,6 +309,8 @@ gst_audio_mix_matrix_dispose (GObject * object)
     self->matrix = NULL;
   }
 
+  gst_audio_mix_matrix_clear_plan (self);
+
   G_OBJECT_CLASS (gst_audio_mix_matrix_parent_class)->dispose (object);
 }
 
@@ -275,7 +346,7 @@ gst_audio_mix_matrix_convert_s32_matrix (GstAudioMixMatrix * self)
       g_new (gint64, self->in_channels * self->out_channels);
   for (i = 0; i < self->in_channels * self->out_channels; i++) {
     self->s32_conv_matrix[i] =
-        (gint64) ((self->matrix[i]) * (1 << self->shift_bytes));
+        (gint64) ((self->matrix[i]) * ((gint64) 1 << self->shift_bytes));
   }
 }
 
@@ -293,6 +364,8 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
       }
+      /* The matrix no longer matches, planned again at set_caps time */
+      gst_audio_mix_matrix_clear_plan (self);
       break;
     case PROP_OUT_CHANNELS:
       self->out_channels = g_value_get_uint (value);
@@ -300,6 +373,8 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
         gst_audio_mix_matrix_convert_s16_matrix (self);
         gst_audio_mix_matrix_convert_s32_matrix (self);
       }
+      /* The matrix no longer matches, planned again at set_caps time */
+      gst_audio_mix_matrix_clear_plan (self);
       break;
     case PROP_MATRIX:{
       gint in, out;
@@ -324,6 +399,7 @@ gst_audio_mix_matrix_set_property (GObject * object, guint prop_id,
       }
       gst_audio_mix_matrix_convert_s16_matrix (self);
       gst_audio_mix_matrix_convert_s32_matrix (self);
+      gst_audio_mix_matrix_plan (self);
       break;
     }
     case PROP_CHANNEL_MASK:
@@ -404,11 +480,50 @@ gst_audio_mix_matrix_change_state (GstElement * element,
       g_free (self->s32_conv_matrix);
       self->s32_conv_matrix = NULL;
     }
+
+    gst_audio_mix_matrix_clear_plan (self);
   }
 
   return s;
 }
 
+#define NO_SHIFT(v) (v)
+#define SHIFT(v) ((v) >> n)
+
+/* Same arithmetic as the dense loops below, only visiting the non-zero
+ * coefficients of each row */
+#define MIX_SPARSE(type, acctype, coefftype, coeffs, scale)                 \
+  G_STMT_START {                                                            \
+    const guint *rows = self->nonzero_rows;                                 \
+    const guint *nonzero_in = self->nonzero_in;                             \
+    guint i;                                                                \
+                                                                            \
+    for (sample = 0; sample < n_samples; sample++) {                        \
+      const type *insample = inarray + sample * inchannels;                 \
+      for (out = 0; out < outchannels; out++) {                             \
+        const coefftype *row = coeffs + out * inchannels;                   \
+        acctype outval = 0;                                                 \
+        for (i = rows[out]; i < rows[out + 1]; i++)                         \
+          outval += insample[nonzero_in[i]] * row[nonzero_in[i]];           \
+        outarray[sample * outchannels + out] = (type) scale (outval);       \
+      }                                                                     \
+    }                                                                       \
+  } G_STMT_END
+
+#define COPY_CHANNELS(type)                                                 \
+  G_STMT_START {                                                            \
+    const type *inarray = (const type *) inmap.data;                        \
+    type *outarray = (type *) outmap.data;                                  \
+    guint n_samples = outmap.size / (sizeof (type) * outchannels);          \
+    const gint *copy_map = self->copy_map;                                  \
+                                                                            \
+    for (sample = 0; sample < n_samples; sample++) {                        \
+      const type *insample = inarray + sample * inchannels;                 \
+      type *outsample = outarray + sample * outchannels;                    \
+      for (out = 0; out < outchannels; out++)                               \
+        outsample[out] = copy_map[out] < 0 ? 0 : insample[copy_map[out]];   \
+    }                                                                       \
+  } G_STMT_END
 
 static GstFlowReturn
 gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
@@ -429,6 +544,26 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
     return GST_FLOW_ERROR;
   }
 
+  if (self->kernel == GST_AUDIO_MIX_MATRIX_KERNEL_COPY) {
+    /* Unity gains: moving the samples is enough, whatever their type */
+    switch (GST_AUDIO_FORMAT_INFO_WIDTH (gst_audio_format_get_info
+            (self->format))) {
+      case 16:
+        COPY_CHANNELS (guint16);
+        break;
+      case 32:
+        COPY_CHANNELS (guint32);
+        break;
+      case 64:
+        COPY_CHANNELS (guint64);
+        break;
+      default:
+        g_assert_not_reached ();
+        break;
+    }
+    goto done;
+  }
+
   switch (self->format) {
     case GST_AUDIO_FORMAT_F32LE:
     case GST_AUDIO_FORMAT_F32BE:{
@@ -439,6 +574,11 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gfloat *) inmap.data;
       outarray = (gfloat *) outmap.data;
 
+      if (self->kernel == GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE) {
+        MIX_SPARSE (gfloat, gfloat, gdouble, matrix, NO_SHIFT);
+        break;
+      }
+
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gfloat outval = 0;
@@ -461,6 +601,11 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gdouble *) inmap.data;
       outarray = (gdouble *) outmap.data;
 
+      if (self->kernel == GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE) {
+        MIX_SPARSE (gdouble, gdouble, gdouble, matrix, NO_SHIFT);
+        break;
+      }
+
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gdouble outval = 0;
@@ -485,6 +630,11 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gint16 *) inmap.data;
       outarray = (gint16 *) outmap.data;
 
+      if (self->kernel == GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE) {
+        MIX_SPARSE (gint16, gint32, gint32, conv_matrix, SHIFT);
+        break;
+      }
+
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gint32 outval = 0;
@@ -508,6 +658,11 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
       inarray = (gint32 *) inmap.data;
       outarray = (gint32 *) outmap.data;
 
+      if (self->kernel == GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE) {
+        MIX_SPARSE (gint32, gint64, gint64, conv_matrix, SHIFT);
+        break;
+      }
+
       for (sample = 0; sample < n_samples; sample++) {
         for (out = 0; out < outchannels; out++) {
           gint64 outval = 0;
@@ -527,6 +682,7 @@ gst_audio_mix_matrix_transform (GstBaseTransform * vfilter,
 
   }
 
+done:
   gst_buffer_unmap (inbuf, &inmap);
   gst_buffer_unmap (outbuf, &outmap);
   return GST_FLOW_OK;
@@ -567,6 +723,7 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     self->in_channels = info.channels;
     self->out_channels = out_info.channels;
 
+    g_free (self->matrix);
     self->matrix = g_new (gdouble, self->in_channels * self->out_channels);
 
     for (out = 0; out < self->out_channels; out++) {
@@ -596,6 +753,9 @@ gst_audio_mix_matrix_set_caps (GstBaseTransform * trans, GstCaps * incaps,
     default:
       break;
   }
+
+  gst_audio_mix_matrix_plan (self);
+
   return TRUE;
 }
 
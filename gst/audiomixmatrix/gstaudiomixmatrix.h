@@ -43,6 +43,13 @@ typedef enum _GstAudioMixMatrixMode
   GST_AUDIO_MIX_MATRIX_MODE_FIRST_CHANNELS = 1
 } GstAudioMixMatrixMode;
 
+typedef enum _GstAudioMixMatrixKernel
+{
+  GST_AUDIO_MIX_MATRIX_KERNEL_DENSE = 0,
+  GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE,
+  GST_AUDIO_MIX_MATRIX_KERNEL_COPY
+} GstAudioMixMatrixKernel;
+
 /**
  * GstAudioMixMatrix:
  *
@@ -62,6 +69,12 @@ struct _GstAudioMixMatrix
   gint64 *s32_conv_matrix;
   gint shift_bytes;
 
+  /* Matrix structure, computed from the matrix at set_caps time */
+  GstAudioMixMatrixKernel kernel;
+  guint *nonzero_rows;
+  guint *nonzero_in;
+  gint *copy_map;
+
   GstAudioFormat format;
 };
 
@@ -148,12 +148,13 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
   gint i, j; \
   gint val; \
   static const gint tab[] = { 80, 160, 80, 160 }; \
-  gint width, height; \
+  gint width, height, dest_add; \
   guint8 *dest; \
   \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
   width = GST_VIDEO_FRAME_COMP_WIDTH (frame, 0); \
   height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, 0); \
+  dest_add = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0) - width * 4; \
   \
   if (!RGB) { \
     for (i = 0; i < height; i++) { \
@@ -164,6 +165,7 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
         dest[C3] = 128; \
         dest += 4; \
       } \
+      dest += dest_add; \
     } \
   } else { \
     for (i = 0; i < height; i++) { \
@@ -175,6 +177,7 @@ fill_checker_##name##_c (GstVideoFrame * frame) \
         dest[C3] = val; \
         dest += 4; \
       } \
+      dest += dest_add; \
     } \
   } \
 }
@@ -193,7 +196,7 @@ fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
 { \
   gint c1, c2, c3; \
   guint32 val; \
-  gint width, height; \
+  gint i, width, height, stride; \
   guint8 *dest; \
   \
   dest = GST_VIDEO_FRAME_PLANE_DATA (frame, 0); \
@@ -211,7 +214,15 @@ fill_color_##name (GstVideoFrame * frame, gint Y, gint U, gint V) \
   } \
   val = GUINT32_FROM_BE ((0xff << A) | (c1 << C1) | (c2 << C2) | (c3 << C3)); \
   \
-  compositor_orc_splat_u32 ((guint32 *) dest, val, height * width); \
+  stride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0); \
+  if (stride == width * 4) { \
+    compositor_orc_splat_u32 ((guint32 *) dest, val, height * width); \
+  } else { \
+    for (i = 0; i < height; i++) { \
+      compositor_orc_splat_u32 ((guint32 *) dest, val, width); \
+      dest += stride; \
+    } \
+  } \
 }
 
 A32_COLOR (argb, TRUE, 24, 16, 8, 0);
@@ -42,6 +42,10 @@
  *   is a simple copy when fully-transparent (0.0) and fully-opaque (1.0). (#gdouble)
  * * "zorder": The z-order position of the picture in the composition (#guint)
  *
+ * Setting the #GstCompositor:n-threads property to a value other than 1 splits
+ * the output frame into horizontal stripes that are filled and blended in
+ * parallel by a pool of worker threads.
+ *
  * ## Sample pipelines
  * |[
  * gst-launch-1.0 \
@@ -612,6 +616,34 @@ gst_compositor_pad_finalize (GObject * object)
   G_OBJECT_CLASS (gst_compositor_pad_parent_class)->finalize (object);
 }
 
+static gboolean
+gst_compositor_pad_covers_output (GstVideoAggregatorPad * pad,
+    GstVideoAggregator * vagg)
+{
+  GstCompositorPad *cpad = GST_COMPOSITOR_PAD (pad);
+  gint width, height;
+  GList *l;
+
+  /* Blending an opaque frame without alpha at the origin just copies it */
+  if (cpad->alpha != 1.0 || cpad->xpos != 0 || cpad->ypos != 0 ||
+      cpad->crossfade >= 0.0 || GST_VIDEO_INFO_HAS_ALPHA (&pad->info))
+    return FALSE;
+
+  l = g_list_find (GST_ELEMENT (vagg)->sinkpads, pad);
+  if (l && l->prev && GST_COMPOSITOR_PAD (l->prev->data)->crossfade >= 0.0)
+    return FALSE;
+
+  /* and so does "scaling" it to its own size when it fills the output */
+  _mixer_pad_get_output_size (GST_COMPOSITOR (vagg), cpad,
+      GST_VIDEO_INFO_PAR_N (&vagg->info), GST_VIDEO_INFO_PAR_D (&vagg->info),
+      &width, &height);
+
+  return width == GST_VIDEO_INFO_WIDTH (&pad->info) &&
+      height == GST_VIDEO_INFO_HEIGHT (&pad->info) &&
+      width == GST_VIDEO_INFO_WIDTH (&vagg->info) &&
+      height == GST_VIDEO_INFO_HEIGHT (&vagg->info);
+}
+
 static void
 gst_compositor_pad_class_init (GstCompositorPadClass * klass)
 {
@@ -655,6 +687,8 @@ gst_compositor_pad_class_init (GstCompositorPadClass * klass)
       GST_DEBUG_FUNCPTR (gst_compositor_pad_prepare_frame);
   vaggpadclass->clean_frame =
       GST_DEBUG_FUNCPTR (gst_compositor_pad_clean_frame);
+  vaggpadclass->covers_output =
+      GST_DEBUG_FUNCPTR (gst_compositor_pad_covers_output);
 }
 
 static void
@@ -669,12 +703,26 @@ gst_compositor_pad_init (GstCompositorPad * compo_pad)
 
 /* GstCompositor */
 #define DEFAULT_BACKGROUND COMPOSITOR_BACKGROUND_CHECKER
+#define DEFAULT_N_THREADS 1
 enum
 {
   PROP_0,
   PROP_BACKGROUND,
+  PROP_N_THREADS,
 };
 
+/* Stripes and all rectangles of the visibility pass are aligned on a grid of
+ * this many pixels, which keeps them aligned with the chroma subsampling of
+ * all formats and with the checker pattern (which repeats every 32 pixels
+ * for packed 4:2:2 formats) */
+#define BLOCK_ALIGN 32
+#define ROUND_DOWN_BLOCK(x) ((x) & ~(BLOCK_ALIGN - 1))
+#define ROUND_UP_BLOCK(x) ROUND_DOWN_BLOCK ((x) + BLOCK_ALIGN - 1)
+
+/* Maximum number of rectangles a visible region is split into. Once reached,
+ * further occluders are ignored, which only costs some redundant blending */
+#define MAX_REGION_RECTS 64
+
 #define GST_TYPE_COMPOSITOR_BACKGROUND (gst_compositor_background_get_type())
 static GType
 gst_compositor_background_get_type (void)
@@ -708,6 +756,11 @@ gst_compositor_get_property (GObject * object,
     case PROP_BACKGROUND:
       g_value_set_enum (value, self->background);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->n_threads);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -724,6 +777,11 @@ gst_compositor_set_property (GObject * object,
     case PROP_BACKGROUND:
       self->background = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (self);
+      self->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -733,6 +791,8 @@ gst_compositor_set_property (GObject * object,
 #define gst_compositor_parent_class parent_class
 G_DEFINE_TYPE (GstCompositor, gst_compositor, GST_TYPE_VIDEO_AGGREGATOR);
 
+static void gst_compositor_finalize (GObject * object);
+
 static gboolean
 set_functions (GstCompositor * self, GstVideoInfo * info)
 {
@@ -1110,6 +1170,311 @@ gst_compositor_crossfade_frames (GstCompositor * self, GstVideoFrame * outframe)
   return all_crossfading;
 }
 
+static void
+gst_compositor_fill_background (GstCompositor * self, GstVideoFrame * frame)
+{
+  switch (self->background) {
+    case COMPOSITOR_BACKGROUND_CHECKER:
+      self->fill_checker (frame);
+      break;
+    case COMPOSITOR_BACKGROUND_BLACK:
+      self->fill_color (frame, 16, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_WHITE:
+      self->fill_color (frame, 240, 128, 128);
+      break;
+    case COMPOSITOR_BACKGROUND_TRANSPARENT:
+      gst_compositor_fill_transparent (self, frame, NULL);
+      break;
+  }
+}
+
+/* A pad frame to blend, collected with the object lock held so that the
+ * worker threads never have to look at the pads themselves */
+typedef struct
+{
+  GstVideoFrame *frame;
+  gint xpos, ypos;
+  gdouble alpha;
+
+  /* GstVideoRectangle: the parts of the output the frame is visible in */
+  GArray *visible;
+} CompositorBlendItem;
+
+typedef struct
+{
+  GstCompositor *self;
+  GstVideoFrame *outframe;
+  gint y_start, y_end;
+
+  /* GstVideoRectangle: the parts of the background to fill, or NULL */
+  GArray *background;
+  BlendFunction composite;
+  const CompositorBlendItem *items;
+  guint n_items;
+} CompositorStripe;
+
+static gboolean
+intersect_rectangles (const GstVideoRectangle * rect1,
+    const GstVideoRectangle * rect2, GstVideoRectangle * result)
+{
+  gint x1 = MAX (rect1->x, rect2->x);
+  gint y1 = MAX (rect1->y, rect2->y);
+  gint x2 = MIN (rect1->x + rect1->w, rect2->x + rect2->w);
+  gint y2 = MIN (rect1->y + rect1->h, rect2->y + rect2->h);
+
+  if (x1 >= x2 || y1 >= y2)
+    return FALSE;
+
+  result->x = x1;
+  result->y = y1;
+  result->w = x2 - x1;
+  result->h = y2 - y1;
+
+  return TRUE;
+}
+
+/* Removes @rect from the region made of the rectangles in @region */
+static void
+subtract_rectangle (GArray * region, const GstVideoRectangle * rect)
+{
+  GArray *result;
+  guint i;
+
+  if (region->len >= MAX_REGION_RECTS)
+    return;
+
+  result = g_array_sized_new (FALSE, FALSE, sizeof (GstVideoRectangle),
+      region->len + 4);
+
+  for (i = 0; i < region->len; i++) {
+    GstVideoRectangle *r = &g_array_index (region, GstVideoRectangle, i);
+    GstVideoRectangle c, piece;
+
+    if (!intersect_rectangles (r, rect, &c)) {
+      g_array_append_val (result, *r);
+      continue;
+    }
+
+    /* Keep what is above, below, left and right of the intersection */
+    if (c.y > r->y) {
+      piece.x = r->x;
+      piece.y = r->y;
+      piece.w = r->w;
+      piece.h = c.y - r->y;
+      g_array_append_val (result, piece);
+    }
+    if (c.y + c.h < r->y + r->h) {
+      piece.x = r->x;
+      piece.y = c.y + c.h;
+      piece.w = r->w;
+      piece.h = r->y + r->h - piece.y;
+      g_array_append_val (result, piece);
+    }
+    if (c.x > r->x) {
+      piece.x = r->x;
+      piece.y = c.y;
+      piece.w = c.x - r->x;
+      piece.h = c.h;
+      g_array_append_val (result, piece);
+    }
+    if (c.x + c.w < r->x + r->w) {
+      piece.x = c.x + c.w;
+      piece.y = c.y;
+      piece.w = r->x + r->w - piece.x;
+      piece.h = c.h;
+      g_array_append_val (result, piece);
+    }
+  }
+
+  g_array_set_size (region, 0);
+  g_array_append_vals (region, result->data, result->len);
+  g_array_free (result, TRUE);
+}
+
+/* Makes @view a view on the area @rect of @frame. The position of @rect must
+ * be a multiple of BLOCK_ALIGN */
+static void
+gst_compositor_sub_frame (GstVideoFrame * frame,
+    const GstVideoRectangle * rect, GstVideoFrame * view)
+{
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
+  guint plane, comp;
+
+  *view = *frame;
+  GST_VIDEO_INFO_WIDTH (&view->info) = rect->w;
+  GST_VIDEO_INFO_HEIGHT (&view->info) = rect->h;
+
+  for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++) {
+    for (comp = 0; comp < GST_VIDEO_FRAME_N_COMPONENTS (frame); comp++) {
+      if (GST_VIDEO_FRAME_COMP_PLANE (frame, comp) == plane)
+        break;
+    }
+
+    view->data[plane] = (guint8 *) frame->data[plane] +
+        GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, comp, rect->y) *
+        GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane) +
+        GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, comp, rect->x) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (frame, comp);
+  }
+}
+
+static void
+gst_compositor_process_stripe (gpointer data, gpointer user_data)
+{
+  CompositorStripe *stripe = data;
+  GstVideoRectangle stripe_rect, rect;
+  GstVideoFrame view;
+  guint i, j;
+
+  stripe_rect.x = 0;
+  stripe_rect.y = stripe->y_start;
+  stripe_rect.w = GST_VIDEO_FRAME_WIDTH (stripe->outframe);
+  stripe_rect.h = stripe->y_end - stripe->y_start;
+
+  if (stripe->background) {
+    for (i = 0; i < stripe->background->len; i++) {
+      if (!intersect_rectangles (&g_array_index (stripe->background,
+                  GstVideoRectangle, i), &stripe_rect, &rect))
+        continue;
+
+      gst_compositor_sub_frame (stripe->outframe, &rect, &view);
+      gst_compositor_fill_background (stripe->self, &view);
+    }
+  }
+
+  /* Items are in z-order, and each stripe blends them in that same order */
+  for (i = 0; i < stripe->n_items; i++) {
+    const CompositorBlendItem *item = &stripe->items[i];
+
+    for (j = 0; j < item->visible->len; j++) {
+      if (!intersect_rectangles (&g_array_index (item->visible,
+                  GstVideoRectangle, j), &stripe_rect, &rect))
+        continue;
+
+      gst_compositor_sub_frame (stripe->outframe, &rect, &view);
+      stripe->composite (item->frame, item->xpos - rect.x,
+          item->ypos - rect.y, item->alpha, &view,
+          COMPOSITOR_BLEND_MODE_NORMAL);
+    }
+  }
+}
+
+/* WITH GST_OBJECT_LOCK !!
+ * Returns: the number of stripes to split a frame of @height rows into,
+ * making sure the worker pool is ready if more than one */
+static guint
+gst_compositor_get_n_stripes (GstCompositor * self, gint height,
+    gint * stripe_height)
+{
+  guint n_threads;
+
+  *stripe_height = height;
+
+  n_threads = gst_video_stripe_pool_prepare (self->stripe_pool,
+      self->n_threads, (height + BLOCK_ALIGN - 1) / BLOCK_ALIGN);
+  if (n_threads <= 1)
+    return 1;
+
+  *stripe_height = ROUND_UP_BLOCK ((height + n_threads - 1) / n_threads);
+
+  return (height + *stripe_height - 1) / *stripe_height;
+}
+
+/* Returns the part of the output that is guaranteed to be completely
+ * covered by @item, shrunk to the block grid so that the rounding of
+ * positions done by the blend functions can't uncover anything */
+static gboolean
+gst_compositor_get_opaque_rectangle (const CompositorBlendItem * item,
+    gint out_width, gint out_height, GstVideoRectangle * rect)
+{
+  gint x1, y1, x2, y2;
+
+  x1 = ROUND_UP_BLOCK (MAX (item->xpos, 0));
+  y1 = ROUND_UP_BLOCK (MAX (item->ypos, 0));
+  x2 = item->xpos + GST_VIDEO_FRAME_WIDTH (item->frame);
+  y2 = item->ypos + GST_VIDEO_FRAME_HEIGHT (item->frame);
+  x2 = x2 >= out_width ? out_width : ROUND_DOWN_BLOCK (x2);
+  y2 = y2 >= out_height ? out_height : ROUND_DOWN_BLOCK (y2);
+
+  if (x1 >= x2 || y1 >= y2)
+    return FALSE;
+
+  rect->x = x1;
+  rect->y = y1;
+  rect->w = x2 - x1;
+  rect->h = y2 - y1;
+
+  return TRUE;
+}
+
+/* Computes which parts of each item are not covered by an opaque item with a
+ * higher z-order, and which parts of the background are not covered by any
+ * opaque item. Rectangles are grown to the block grid, which is safe as
+ * anything blended too much is overwritten by the opaque item on top.
+ *
+ * Returns: the background region to fill */
+static GArray *
+gst_compositor_compute_visibility (GstCompositor * self,
+    CompositorBlendItem * items, guint n_items, const gboolean * opaque,
+    gint out_width, gint out_height)
+{
+  GstVideoRectangle *opaque_rects;
+  gboolean *has_opaque_rect;
+  GstVideoRectangle rect;
+  GArray *background;
+  guint i, j;
+
+  opaque_rects = g_newa (GstVideoRectangle, n_items);
+  has_opaque_rect = g_newa (gboolean, n_items);
+  for (i = 0; i < n_items; i++) {
+    has_opaque_rect[i] = opaque[i] &&
+        gst_compositor_get_opaque_rectangle (&items[i], out_width, out_height,
+        &opaque_rects[i]);
+  }
+
+  for (i = 0; i < n_items; i++) {
+    CompositorBlendItem *item = &items[i];
+    gint x1, y1, x2, y2;
+
+    item->visible = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+
+    x1 = ROUND_DOWN_BLOCK (CLAMP (item->xpos, 0, out_width));
+    y1 = ROUND_DOWN_BLOCK (CLAMP (item->ypos, 0, out_height));
+    x2 = ROUND_UP_BLOCK (CLAMP (item->xpos + GST_VIDEO_FRAME_WIDTH
+            (item->frame), 0, out_width));
+    y2 = ROUND_UP_BLOCK (CLAMP (item->ypos + GST_VIDEO_FRAME_HEIGHT
+            (item->frame), 0, out_height));
+    rect.x = x1;
+    rect.y = y1;
+    rect.w = MIN (x2, out_width) - x1;
+    rect.h = MIN (y2, out_height) - y1;
+    if (rect.w <= 0 || rect.h <= 0)
+      continue;
+
+    g_array_append_val (item->visible, rect);
+    for (j = i + 1; j < n_items && item->visible->len > 0; j++) {
+      if (has_opaque_rect[j])
+        subtract_rectangle (item->visible, &opaque_rects[j]);
+    }
+
+    GST_LOG_OBJECT (self, "item %u at %ix%i visible in %u rectangles", i,
+        item->xpos, item->ypos, item->visible->len);
+  }
+
+  background = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+  rect.x = rect.y = 0;
+  rect.w = out_width;
+  rect.h = out_height;
+  g_array_append_val (background, rect);
+  for (i = 0; i < n_items && background->len > 0; i++) {
+    if (has_opaque_rect[i])
+      subtract_rectangle (background, &opaque_rects[i]);
+  }
+
+  return background;
+}
+
 static GstFlowReturn
 gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
 {
@@ -1117,6 +1482,13 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   GstCompositor *self = GST_COMPOSITOR (vagg);
   BlendFunction composite;
   GstVideoFrame out_frame, *outframe;
+  CompositorStripe *stripes;
+  CompositorBlendItem *items;
+  gboolean *opaque;
+  GArray *background;
+  gboolean crossfading = FALSE;
+  guint i, n_stripes, n_items = 0;
+  gint out_width, out_height, stripe_height;
 
   if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE)) {
     GST_WARNING_OBJECT (vagg, "Could not map output buffer");
@@ -1124,43 +1496,100 @@ gst_compositor_aggregate_frames (GstVideoAggregator * vagg, GstBuffer * outbuf)
   }
 
   outframe = &out_frame;
-  /* default to blending */
-  composite = self->blend;
-  /* TODO: If the frames to be composited completely obscure the background,
-   * don't bother drawing the background at all. */
-  switch (self->background) {
-    case COMPOSITOR_BACKGROUND_CHECKER:
-      self->fill_checker (outframe);
-      break;
-    case COMPOSITOR_BACKGROUND_BLACK:
-      self->fill_color (outframe, 16, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_WHITE:
-      self->fill_color (outframe, 240, 128, 128);
-      break;
-    case COMPOSITOR_BACKGROUND_TRANSPARENT:
-      gst_compositor_fill_transparent (self, outframe, NULL);
-      /* use overlay to keep background transparent */
-      composite = self->overlay;
+  out_width = GST_VIDEO_FRAME_WIDTH (outframe);
+  out_height = GST_VIDEO_FRAME_HEIGHT (outframe);
+
+  /* default to blending, use overlay to keep a transparent background
+   * transparent */
+  if (self->background == COMPOSITOR_BACKGROUND_TRANSPARENT)
+    composite = self->overlay;
+  else
+    composite = self->blend;
+
+  /* The object lock is kept while the workers run, which guarantees that
+   * the pad frames stay valid */
+  GST_OBJECT_LOCK (vagg);
+  n_stripes = gst_compositor_get_n_stripes (self, out_height, &stripe_height);
+
+  stripes = g_newa (CompositorStripe, n_stripes);
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].self = self;
+    stripes[i].outframe = outframe;
+    stripes[i].y_start = i * stripe_height;
+    stripes[i].y_end = MIN ((i + 1) * stripe_height, out_height);
+    stripes[i].background = NULL;
+    stripes[i].composite = composite;
+    stripes[i].items = NULL;
+    stripes[i].n_items = 0;
+  }
+
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    if (GST_COMPOSITOR_PAD (l->data)->crossfade >= 0.0) {
+      crossfading = TRUE;
       break;
+    }
   }
 
-  GST_OBJECT_LOCK (vagg);
-  /* First mix the crossfade frames as required */
-  if (!gst_compositor_crossfade_frames (self, outframe)) {
-    for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
-      GstVideoAggregatorPad *pad = l->data;
-      GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
-
-      if (pad->aggregated_frame != NULL) {
-        composite (pad->aggregated_frame,
-            compo_pad->crossfaded ? 0 : compo_pad->xpos,
-            compo_pad->crossfaded ? 0 : compo_pad->ypos, compo_pad->alpha,
-            outframe, COMPOSITOR_BLEND_MODE_NORMAL);
-        compo_pad->crossfaded = FALSE;
-      }
+  /* Crossfading replaces the pads' frames, so it has to happen on the
+   * complete background before everything else is blended */
+  if (crossfading) {
+    GstVideoRectangle rect = { 0, 0, out_width, out_height };
+
+    background = g_array_new (FALSE, FALSE, sizeof (GstVideoRectangle));
+    g_array_append_val (background, rect);
+    for (i = 0; i < n_stripes; i++)
+      stripes[i].background = background;
+    gst_video_stripe_pool_run (self->stripe_pool,
+        gst_compositor_process_stripe, NULL, stripes,
+        sizeof (CompositorStripe), n_stripes);
+    g_array_free (background, TRUE);
+
+    for (i = 0; i < n_stripes; i++)
+      stripes[i].background = NULL;
+
+    if (gst_compositor_crossfade_frames (self, outframe))
+      goto done;
+  }
+
+  n_items = g_list_length (GST_ELEMENT (vagg)->sinkpads);
+  items = g_newa (CompositorBlendItem, n_items);
+  opaque = g_newa (gboolean, n_items);
+  n_items = 0;
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *pad = l->data;
+    GstCompositorPad *compo_pad = GST_COMPOSITOR_PAD (pad);
+
+    if (pad->aggregated_frame != NULL) {
+      items[n_items].frame = pad->aggregated_frame;
+      items[n_items].xpos = compo_pad->crossfaded ? 0 : compo_pad->xpos;
+      items[n_items].ypos = compo_pad->crossfaded ? 0 : compo_pad->ypos;
+      items[n_items].alpha = compo_pad->alpha;
+      /* Same criteria as for skipping obscured pads in prepare_frame() */
+      opaque[n_items] = !compo_pad->crossfaded && compo_pad->crossfade < 0.0
+          && compo_pad->alpha == 1.0 && !GST_VIDEO_INFO_HAS_ALPHA (&pad->info);
+      n_items++;
+      compo_pad->crossfaded = FALSE;
     }
   }
+
+  background = gst_compositor_compute_visibility (self, items, n_items, opaque,
+      out_width, out_height);
+
+  for (i = 0; i < n_stripes; i++) {
+    /* The background was already filled for crossfading */
+    stripes[i].background = crossfading ? NULL : background;
+    stripes[i].items = items;
+    stripes[i].n_items = n_items;
+  }
+
+  gst_video_stripe_pool_run (self->stripe_pool, gst_compositor_process_stripe,
+      NULL, stripes, sizeof (CompositorStripe), n_stripes);
+
+  g_array_free (background, TRUE);
+  for (i = 0; i < n_items; i++)
+    g_array_free (items[i].visible, TRUE);
+
+done:
   GST_OBJECT_UNLOCK (vagg);
 
   gst_video_frame_unmap (outframe);
@@ -1222,6 +1651,7 @@ gst_compositor_class_init (GstCompositorClass * klass)
 
   gobject_class->get_property = gst_compositor_get_property;
   gobject_class->set_property = gst_compositor_set_property;
+  gobject_class->finalize = gst_compositor_finalize;
 
   agg_class->sink_query = _sink_query;
   agg_class->fixate_src_caps = _fixate_caps;
@@ -1233,6 +1663,21 @@ gst_compositor_class_init (GstCompositorClass * klass)
           GST_TYPE_COMPOSITOR_BACKGROUND,
           DEFAULT_BACKGROUND, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstCompositor:n-threads:
+   *
+   * Number of threads used to fill and blend horizontal stripes of the
+   * output frame in parallel. 0 uses one thread per CPU core, 1 blends
+   * everything on the streaming thread.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Maximum number of blending threads (0 = number of CPU cores)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_factory);
   gst_element_class_add_static_pad_template_with_gtype (gstelement_class,
       &sink_factory, GST_TYPE_COMPOSITOR_PAD);
@@ -1248,6 +1693,20 @@ gst_compositor_init (GstCompositor * self)
 {
   /* initialize variables */
   self->background = DEFAULT_BACKGROUND;
+  self->n_threads = DEFAULT_N_THREADS;
+
+  self->stripe_pool = gst_video_stripe_pool_new ();
+}
+
+static void
+gst_compositor_finalize (GObject * object)
+{
+  GstCompositor *self = GST_COMPOSITOR (object);
+
+  gst_video_stripe_pool_free (self->stripe_pool);
+  self->stripe_pool = NULL;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 /* Element registration */
@@ -24,6 +24,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideoaggregator.h>
+#include <gst/video/gstvideostripepool.h>
 
 #include "blend.h"
 
@@ -72,6 +73,10 @@ struct _GstCompositor
   BlendFunction blend, overlay;
   FillCheckerFunction fill_checker;
   FillColorFunction fill_color;
+
+  /* stripe-parallel blending */
+  guint n_threads;
+  GstVideoStripePool *stripe_pool;
 };
 
 struct _GstCompositorClass
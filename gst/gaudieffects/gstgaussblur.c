@@ -60,9 +60,9 @@
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
-#include <string.h>
 #endif
 
+#include <string.h>
 #include <math.h>
 #include <gst/gst.h>
 
@@ -111,17 +111,24 @@ GST_STATIC_PAD_TEMPLATE ("src",
 enum
 {
   PROP_0,
-  PROP_SIGMA
+  PROP_SIGMA,
+  PROP_N_THREADS
 };
 
 static gboolean make_gaussian_kernel (GstGaussianBlur * gb, float sigma);
-static void gaussian_smooth (GstGaussianBlur * gb, guint8 * image,
-    guint8 * out_image);
+static void gaussian_smooth (GstGaussianBlur * gb, const guint8 * image,
+    gint in_stride, guint8 * out_image, gint out_stride, guint n_threads);
 
 #define gst_gaussianblur_parent_class parent_class
 G_DEFINE_TYPE (GstGaussianBlur, gst_gaussianblur, GST_TYPE_VIDEO_FILTER);
 
 #define DEFAULT_SIGMA 1.2
+#define DEFAULT_N_THREADS 1
+
+/* The kernel is applied in fixed point: coefficients have KERNEL_SHIFT
+ * fractional bits, and the horizontally blurred samples INTER_SHIFT */
+#define KERNEL_SHIFT 12
+#define INTER_SHIFT 4
 
 /* Initalize the gaussianblur's class. */
 static void
@@ -152,6 +159,12 @@ gst_gaussianblur_class_init (GstGaussianBlurClass * klass)
           -20.0, 20.0, DEFAULT_SIGMA,
           G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to use for blurring (0 = number of CPU cores)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   vfilter_class->transform_frame =
       GST_DEBUG_FUNCPTR (gst_gaussianblur_transform_frame);
   vfilter_class->set_info = GST_DEBUG_FUNCPTR (gst_gaussianblur_set_info);
@@ -162,15 +175,15 @@ gst_gaussianblur_set_info (GstVideoFilter * filter, GstCaps * incaps,
     GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
 {
   GstGaussianBlur *gb = GST_GAUSSIANBLUR (filter);
-  guint32 n_elems;
 
   gb->width = GST_VIDEO_INFO_WIDTH (in_info);
   gb->height = GST_VIDEO_INFO_HEIGHT (in_info);
 
   /* get stride */
   gb->stride = GST_VIDEO_INFO_COMP_STRIDE (in_info, 0);
-  n_elems = gb->stride * gb->height;
-  gb->tempim = g_malloc (sizeof (gfloat) * n_elems);
+
+  g_free (gb->smoothedim);
+  gb->smoothedim = g_new (gint16, gb->width * 4 * gb->height);
 
   return TRUE;
 }
@@ -180,6 +193,8 @@ gst_gaussianblur_init (GstGaussianBlur * gb)
 {
   gb->sigma = (gfloat) DEFAULT_SIGMA;
   gb->cur_sigma = -1.0;
+  gb->n_threads = DEFAULT_N_THREADS;
+  gb->stripe_pool = gst_video_stripe_pool_new ();
 }
 
 static void
@@ -187,8 +202,8 @@ gst_gaussianblur_finalize (GObject * object)
 {
   GstGaussianBlur *gb = GST_GAUSSIANBLUR (object);
 
-  g_free (gb->tempim);
-  gb->tempim = NULL;
+  gst_video_stripe_pool_free (gb->stripe_pool);
+  gb->stripe_pool = NULL;
 
   g_free (gb->smoothedim);
   gb->smoothedim = NULL;
@@ -197,6 +212,10 @@ gst_gaussianblur_finalize (GObject * object)
   gb->kernel = NULL;
   g_free (gb->kernel_sum);
   gb->kernel_sum = NULL;
+  g_free (gb->kernel_int);
+  gb->kernel_int = NULL;
+  g_free (gb->kernel_sum_int);
+  gb->kernel_sum_int = NULL;
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -209,6 +228,7 @@ gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
   GstClockTime timestamp;
   gint64 stream_time;
   gfloat sigma;
+  guint n_threads;
   guint8 *src, *dest;
 
   /* GstController: update the properties */
@@ -225,6 +245,7 @@ gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
 
   GST_OBJECT_LOCK (filter);
   sigma = filter->sigma;
+  n_threads = filter->n_threads;
   GST_OBJECT_UNLOCK (filter);
 
   if (filter->cur_sigma != sigma) {
@@ -232,6 +253,10 @@ gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
     filter->kernel = NULL;
     g_free (filter->kernel_sum);
     filter->kernel_sum = NULL;
+    g_free (filter->kernel_int);
+    filter->kernel_int = NULL;
+    g_free (filter->kernel_sum_int);
+    filter->kernel_sum_int = NULL;
     filter->cur_sigma = sigma;
   }
   if (filter->kernel == NULL &&
@@ -247,19 +272,35 @@ gst_gaussianblur_transform_frame (GstVideoFilter * vfilter,
    */
   src = GST_VIDEO_FRAME_COMP_DATA (in_frame, 0);
   dest = GST_VIDEO_FRAME_COMP_DATA (out_frame, 0);
-  gst_video_frame_copy (out_frame, in_frame);
-  if (filter->sigma != 0.0)
-    gaussian_smooth (filter, src, dest);
+  /* every output pixel is written by the blur, only copy when it's a
+   * no-op */
+  if (sigma == 0.0)
+    gst_video_frame_copy (out_frame, in_frame);
+  else
+    gaussian_smooth (filter, src, GST_VIDEO_FRAME_COMP_STRIDE (in_frame, 0),
+        dest, GST_VIDEO_FRAME_COMP_STRIDE (out_frame, 0), n_threads);
 
   return GST_FLOW_OK;
 }
 
+typedef struct
+{
+  GstGaussianBlur *gb;
+  const guint8 *in_image;
+  gint in_stride;
+  guint8 *out_image;
+  gint out_stride;
+  gint y_start, y_end;
+  gboolean vertical;
+} GstGaussianBlurStripe;
+
 static void
-blur_row_x (GstGaussianBlur * gb, guint8 * in_row, gfloat * out_row)
+blur_row_x (GstGaussianBlur * gb, const guint8 * in_row, gint16 * out_row)
 {
-  int c, cc, center;
-  float dot[4], sum;
+  int c, cc, i, center;
+  gint32 dot[4], sum;
   int k, kmin, kmax;
+  const guint8 *in;
 
   center = gb->windowsize / 2;
 
@@ -270,45 +311,50 @@ blur_row_x (GstGaussianBlur * gb, guint8 * in_row, gfloat * out_row)
     cc = kmin - cc;
     /* Calc max */
     kmax = MIN (gb->windowsize, gb->width - cc);
-    cc *= 4;
-
-    dot[0] = dot[1] = dot[2] = dot[3] = 0.0;
-    /* Calculate sum for range */
-    sum = gb->kernel_sum[kmax - 1];
-    sum -= kmin ? gb->kernel_sum[kmin - 1] : 0.0;
-
-    for (k = kmin; k < kmax; k++) {
-      float coeff = gb->kernel[k];
-      dot[0] += (float) in_row[cc++] * coeff;
-      dot[1] += (float) in_row[cc++] * coeff;
-      dot[2] += (float) in_row[cc++] * coeff;
-      dot[3] += (float) in_row[cc++] * coeff;
+    in = in_row + cc * 4;
+
+    dot[0] = dot[1] = dot[2] = dot[3] = 0;
+    for (k = kmin; k < kmax; k++, in += 4) {
+      gint32 coeff = gb->kernel_int[k];
+      dot[0] += in[0] * coeff;
+      dot[1] += in[1] * coeff;
+      dot[2] += in[2] * coeff;
+      dot[3] += in[3] * coeff;
     }
 
-    out_row[c * 4] = dot[0] / sum;
-    out_row[c * 4 + 1] = dot[1] / sum;
-    out_row[c * 4 + 2] = dot[2] / sum;
-    out_row[c * 4 + 3] = dot[3] / sum;
+    if (kmin == 0 && kmax == gb->windowsize) {
+      /* The full kernel sums to 1 */
+      for (i = 0; i < 4; i++)
+        out_row[c * 4 + i] = (dot[i] + (1 << (KERNEL_SHIFT - INTER_SHIFT - 1)))
+            >> (KERNEL_SHIFT - INTER_SHIFT);
+    } else {
+      /* Near the edges, normalise by the sum of the part of the kernel
+       * that's used */
+      sum = gb->kernel_sum_int[kmax - 1];
+      sum -= kmin ? gb->kernel_sum_int[kmin - 1] : 0;
+
+      for (i = 0; i < 4; i++)
+        out_row[c * 4 + i] = CLAMP (((gint64) dot[i] << INTER_SHIFT) / sum,
+            G_MININT16, G_MAXINT16);
+    }
   }
 }
 
 static void
-gaussian_smooth (GstGaussianBlur * gb, guint8 * image, guint8 * out_image)
+blur_rows_y (GstGaussianBlur * gb, guint8 * out_image, gint out_stride,
+    gint y_start, gint y_end)
 {
-  int r, c, rr, center;
-  float dot[4], sum;
+  int r, rr, i, center, row_len;
+  gint32 *acc, sum;
   int k, kmin, kmax;
-  guint8 *in_row = image;
-  float *tmp_out_row = gb->tempim;
-  float *tmp_in_pos;
-  gint y_avail = 0;
+  const gint16 *tmp;
   guint8 *out_row;
 
-  /* Apply the gaussian kernel */
   center = gb->windowsize / 2;
+  row_len = gb->width * 4;
+  acc = g_new (gint32, row_len);
 
-  /* Blur in the y - direction. */
-  for (r = 0; r < gb->height; r++) {
+  for (r = y_start; r < y_end; r++) {
     /* Calculate input row range */
     rr = center - r;
     kmin = MAX (0, rr);
@@ -316,41 +362,124 @@ gaussian_smooth (GstGaussianBlur * gb, guint8 * image, guint8 * out_image)
     /* Calc max */
     kmax = MIN (gb->windowsize, gb->height - rr);
 
-    /* Precalculate sum for range */
-    sum = gb->kernel_sum[kmax - 1];
-    sum -= kmin ? gb->kernel_sum[kmin - 1] : 0.0;
+    /* Accumulate whole rows at a time, so that the inner loop runs over
+     * contiguous samples */
+    memset (acc, 0, row_len * sizeof (gint32));
+    tmp = gb->smoothedim + rr * row_len;
+    for (k = kmin; k < kmax; k++, tmp += row_len) {
+      gint32 coeff = gb->kernel_int[k];
 
-    /* Blur more input rows (x direction blur) */
-    while (y_avail <= (r + center) && y_avail < gb->height) {
-      blur_row_x (gb, in_row, tmp_out_row);
-      in_row += gb->stride;
-      tmp_out_row += gb->stride;
-      y_avail++;
+      for (i = 0; i < row_len; i++)
+        acc[i] += tmp[i] * coeff;
     }
 
-    tmp_in_pos = gb->tempim + (rr * gb->stride);
-    out_row = out_image + r * gb->stride;
+    out_row = out_image + r * out_stride;
+    if (kmin == 0 && kmax == gb->windowsize) {
+      for (i = 0; i < row_len; i++) {
+        gint32 v = (acc[i] + (1 << (KERNEL_SHIFT + INTER_SHIFT - 1)))
+            >> (KERNEL_SHIFT + INTER_SHIFT);
+        out_row[i] = CLAMP (v, 0, 255);
+      }
+    } else {
+      gint64 div;
 
-    for (c = 0; c < gb->width; c++) {
-      float *tmp = tmp_in_pos;
+      sum = gb->kernel_sum_int[kmax - 1];
+      sum -= kmin ? gb->kernel_sum_int[kmin - 1] : 0;
+      div = (gint64) sum << INTER_SHIFT;
 
-      dot[0] = dot[1] = dot[2] = dot[3] = 0.0;
-      for (k = kmin; k < kmax; k++, tmp += gb->stride) {
-        float kern = gb->kernel[k];
-        dot[0] += tmp[0] * kern;
-        dot[1] += tmp[1] * kern;
-        dot[2] += tmp[2] * kern;
-        dot[3] += tmp[3] * kern;
+      for (i = 0; i < row_len; i++) {
+        gint64 v = (acc[i] + div / 2) / div;
+        out_row[i] = CLAMP (v, 0, 255);
       }
+    }
+  }
 
-      *out_row++ = (guint8) CLAMP ((dot[0] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[1] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[2] / sum + 0.5), 0, 255);
-      *out_row++ = (guint8) CLAMP ((dot[3] / sum + 0.5), 0, 255);
+  g_free (acc);
+}
 
-      tmp_in_pos += 4;
-    }
+static void
+gaussian_process_stripe (gpointer data, gpointer user_data)
+{
+  GstGaussianBlurStripe *stripe = data;
+  GstGaussianBlur *gb = stripe->gb;
+  gint y;
+
+  if (stripe->vertical) {
+    blur_rows_y (gb, stripe->out_image, stripe->out_stride, stripe->y_start,
+        stripe->y_end);
+  } else {
+    for (y = stripe->y_start; y < stripe->y_end; y++)
+      blur_row_x (gb, stripe->in_image + y * stripe->in_stride,
+          gb->smoothedim + y * gb->width * 4);
+  }
+}
+
+static void
+gaussian_smooth (GstGaussianBlur * gb, const guint8 * image, gint in_stride,
+    guint8 * out_image, gint out_stride, guint n_threads)
+{
+  GstGaussianBlurStripe *stripes;
+  guint n_stripes, i;
+  gint stripe_height;
+
+  n_stripes = gst_video_stripe_pool_prepare (gb->stripe_pool, n_threads,
+      gb->height);
+  stripe_height = (gb->height + n_stripes - 1) / n_stripes;
+  stripes = g_newa (GstGaussianBlurStripe, n_stripes);
+
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].gb = gb;
+    stripes[i].in_image = image;
+    stripes[i].in_stride = in_stride;
+    stripes[i].out_image = out_image;
+    stripes[i].out_stride = out_stride;
+    stripes[i].y_start = MIN (i * stripe_height, gb->height);
+    stripes[i].y_end = MIN ((i + 1) * stripe_height, gb->height);
+    stripes[i].vertical = FALSE;
   }
+
+  /* Blur in the x - direction, all rows have to be done before the
+   * y - direction as each output row needs its neighbours */
+  gst_video_stripe_pool_run (gb->stripe_pool, gaussian_process_stripe, NULL,
+      stripes, sizeof (GstGaussianBlurStripe), n_stripes);
+
+  /* Blur in the y - direction. */
+  for (i = 0; i < n_stripes; i++)
+    stripes[i].vertical = TRUE;
+  gst_video_stripe_pool_run (gb->stripe_pool, gaussian_process_stripe, NULL,
+      stripes, sizeof (GstGaussianBlurStripe), n_stripes);
+}
+
+/*
+ * Convert the kernel to fixed point, with the rounding error put on the
+ * center coefficient so that the full kernel sums to exactly 1.
+ */
+static gboolean
+make_fixed_point_kernel (GstGaussianBlur * gb)
+{
+  int i, center;
+  gint32 sum;
+
+  center = gb->windowsize / 2;
+
+  gb->kernel_int = g_new (gint32, gb->windowsize);
+  gb->kernel_sum_int = g_new (gint32, gb->windowsize);
+
+  sum = 0;
+  for (i = 0; i < gb->windowsize; i++) {
+    gb->kernel_int[i] = (gint32) floor (gb->kernel[i] * (1 << KERNEL_SHIFT)
+        + 0.5);
+    sum += gb->kernel_int[i];
+  }
+  gb->kernel_int[center] += (1 << KERNEL_SHIFT) - sum;
+
+  sum = 0;
+  for (i = 0; i < gb->windowsize; i++) {
+    sum += gb->kernel_int[i];
+    gb->kernel_sum_int[i] = sum;
+  }
+
+  return TRUE;
 }
 
 /*
@@ -375,7 +504,7 @@ make_gaussian_kernel (GstGaussianBlur * gb, float sigma)
   if (gb->windowsize == 1) {
     gb->kernel[0] = 1.0;
     gb->kernel_sum[0] = 1.0;
-    return TRUE;
+    return make_fixed_point_kernel (gb);
   }
 
   /* Center co-efficient */
@@ -416,7 +545,7 @@ make_gaussian_kernel (GstGaussianBlur * gb, float sigma)
   g_print ("sum %f sum2 %f\n", sum, sum2);
 #endif
 
-  return TRUE;
+  return make_fixed_point_kernel (gb);
 }
 
 static void
@@ -430,6 +559,11 @@ gst_gaussianblur_set_property (GObject * object,
       gb->sigma = g_value_get_double (value);
       GST_OBJECT_UNLOCK (object);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (object);
+      gb->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -447,6 +581,11 @@ gst_gaussianblur_get_property (GObject * object,
       g_value_set_double (value, gb->sigma);
       GST_OBJECT_UNLOCK (gb);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (gb);
+      g_value_set_uint (value, gb->n_threads);
+      GST_OBJECT_UNLOCK (gb);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -51,6 +51,7 @@
 #include <gst/gst.h>
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
+#include <gst/video/gstvideostripepool.h>
 
 G_BEGIN_DECLS
 
@@ -68,11 +69,19 @@ struct _GstGaussianBlur
 
   float cur_sigma, sigma;
   int windowsize;
+  guint n_threads;
 
   float *kernel;
   float *kernel_sum;
-  float *tempim;
+
+  /* the kernel in fixed point, and its running sums */
+  gint32 *kernel_int;
+  gint32 *kernel_sum_int;
+
+  /* horizontally blurred frame, in fixed point */
   gint16 *smoothedim;
+
+  GstVideoStripePool *stripe_pool;
 };
 
 struct _GstGaussianBlurClass
@@ -133,15 +133,13 @@ G_STMT_START {							\
 #define CRC_INIT   0xFFFF
 
 static guint16 gst_dp_crc (const guint8 * buffer, guint length);
-static guint16 gst_dp_crc_from_memory_maps (const GstMapInfo * maps,
-    guint n_maps);
+static guint16 gst_dp_crc_from_buffer (GstBuffer * buffer);
 
 /* payloading functions */
 
-GstBuffer *
-gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
+static GstMemory *
+gst_dp_payload_buffer_header (GstBuffer * buffer, GstDPHeaderFlag flags)
 {
-  GstBuffer *ret_buf;
   GstMapInfo map;
   GstMemory *mem;
   guint8 *h;
@@ -156,32 +154,9 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   /* version, flags, type */
   GST_DP_INIT_HEADER (h, GST_DP_VERSION_1_0, flags, GST_DP_PAYLOAD_BUFFER);
 
-  if ((flags & GST_DP_HEADER_FLAG_CRC_PAYLOAD)) {
-    GstMapInfo *maps;
-    guint n_maps, i;
-
-    buffer_size = 0;
-
-    n_maps = gst_buffer_n_memory (buffer);
-    if (n_maps > 0) {
-      maps = g_newa (GstMapInfo, n_maps);
-
-      for (i = 0; i < n_maps; ++i) {
-        GstMemory *mem;
-
-        mem = gst_buffer_peek_memory (buffer, i);
-        gst_memory_map (mem, &maps[i], GST_MAP_READ);
-        buffer_size += maps[i].size;
-      }
-
-      crc = gst_dp_crc_from_memory_maps (maps, n_maps);
-
-      for (i = 0; i < n_maps; ++i)
-        gst_memory_unmap (maps[i].memory, &maps[i]);
-    }
-  } else {
-    buffer_size = gst_buffer_get_size (buffer);
-  }
+  buffer_size = gst_buffer_get_size (buffer);
+  if ((flags & GST_DP_HEADER_FLAG_CRC_PAYLOAD))
+    crc = gst_dp_crc_from_buffer (buffer);
 
   /* buffer properties */
   GST_WRITE_UINT32_BE (h + 6, buffer_size);
@@ -215,15 +190,58 @@ gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
   GST_MEMDUMP ("payload header for buffer", h, GST_DP_HEADER_LENGTH);
   gst_memory_unmap (mem, &map);
 
+  return mem;
+}
+
+GstBuffer *
+gst_dp_payload_buffer (GstBuffer * buffer, GstDPHeaderFlag flags)
+{
+  GstBuffer *ret_buf;
+
   ret_buf = gst_buffer_new ();
 
   /* header */
-  gst_buffer_append_memory (ret_buf, mem);
+  gst_buffer_append_memory (ret_buf, gst_dp_payload_buffer_header (buffer,
+          flags));
 
   /* buffer data */
   return gst_buffer_append (ret_buf, gst_buffer_ref (buffer));
 }
 
+/**
+ * gst_dp_payload_buffer_list:
+ * @buffer: the buffer to payload
+ * @flags: the #GstDPHeaderFlag to use
+ *
+ * Like gst_dp_payload_buffer(), but returns the packet header and the
+ * memories of @buffer as two buffers of a list, so that they are never
+ * merged, even if @buffer has as many memories as a buffer can hold.
+ *
+ * The second buffer is flagged %GST_BUFFER_FLAG_DELTA_UNIT, as a packet
+ * can't start there.
+ *
+ * Returns: a #GstBufferList of the header and the data of @buffer.
+ */
+GstBufferList *
+gst_dp_payload_buffer_list (GstBuffer * buffer, GstDPHeaderFlag flags)
+{
+  GstBufferList *list;
+  GstBuffer *header_buf, *data_buf;
+
+  header_buf = gst_buffer_new ();
+  gst_buffer_append_memory (header_buf, gst_dp_payload_buffer_header (buffer,
+          flags));
+
+  data_buf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_MEMORY, 0, -1);
+  GST_BUFFER_FLAG_SET (data_buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  list = gst_buffer_list_new_sized (2);
+  gst_buffer_list_add (list, header_buf);
+  gst_buffer_list_add (list, data_buf);
+
+  return list;
+}
+
 GstBuffer *
 gst_dp_payload_caps (const GstCaps * caps, GstDPHeaderFlag flags)
 {
@@ -364,6 +382,58 @@ static const guint16 gst_dp_crc_table[256] = {
   0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
 };
 
+/* gst_dp_crc_slice_tables[k - 1][i] is the CRC register after byte i
+ * followed by k zero bytes, which allows processing 8 bytes at a time */
+static guint16 gst_dp_crc_slice_tables[7][256];
+
+static void
+gst_dp_crc_init_slice_tables (void)
+{
+  static volatile gsize inited = 0;
+  const guint16 *prev;
+  guint i, k;
+
+  if (!g_once_init_enter (&inited))
+    return;
+
+  prev = gst_dp_crc_table;
+  for (k = 0; k < 7; k++) {
+    for (i = 0; i < 256; i++)
+      gst_dp_crc_slice_tables[k][i] = (guint16) ((prev[i] << 8) ^
+          gst_dp_crc_table[prev[i] >> 8]);
+    prev = gst_dp_crc_slice_tables[k];
+  }
+
+  g_once_init_leave (&inited, 1);
+}
+
+static guint16
+gst_dp_crc_update (guint16 crc_register, const guint8 * buffer, gsize length)
+{
+  const guint16 *t1 = gst_dp_crc_slice_tables[0];
+  const guint16 *t2 = gst_dp_crc_slice_tables[1];
+  const guint16 *t3 = gst_dp_crc_slice_tables[2];
+  const guint16 *t4 = gst_dp_crc_slice_tables[3];
+  const guint16 *t5 = gst_dp_crc_slice_tables[4];
+  const guint16 *t6 = gst_dp_crc_slice_tables[5];
+  const guint16 *t7 = gst_dp_crc_slice_tables[6];
+
+  gst_dp_crc_init_slice_tables ();
+
+  for (; length >= 8; length -= 8, buffer += 8) {
+    crc_register = t7[buffer[0] ^ (crc_register >> 8)] ^
+        t6[buffer[1] ^ (crc_register & 0x00ff)] ^ t5[buffer[2]] ^
+        t4[buffer[3]] ^ t3[buffer[4]] ^ t2[buffer[5]] ^ t1[buffer[6]] ^
+        gst_dp_crc_table[buffer[7]];
+  }
+
+  for (; length--;) {
+    crc_register = (guint16) ((crc_register << 8) ^
+        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+  }
+  return crc_register;
+}
+
 /**
  * gst_dp_crc:
  * @buffer: array of bytes
@@ -378,45 +448,34 @@ static const guint16 gst_dp_crc_table[256] = {
 static guint16
 gst_dp_crc (const guint8 * buffer, guint length)
 {
-  guint16 crc_register = CRC_INIT;
-
   if (length == 0)
     return 0;
 
   g_assert (buffer != NULL);
 
-  /* calc CRC */
-  for (; length--;) {
-    crc_register = (guint16) ((crc_register << 8) ^
-        gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
-  }
-  return (0xffff ^ crc_register);
+  return (0xffff ^ gst_dp_crc_update (CRC_INIT, buffer, length));
 }
 
+/* CRC over all the memories of the buffer, mapping them one at a time */
 static guint16
-gst_dp_crc_from_memory_maps (const GstMapInfo * maps, guint n_maps)
+gst_dp_crc_from_buffer (GstBuffer * buffer)
 {
   guint16 crc_register = CRC_INIT;
   gsize total_length = 0;
+  guint i, n_mem;
 
-  if (n_maps == 0)
-    return 0;
-
-  g_assert (maps != NULL);
-
-  /* calc CRC */
-  while (n_maps > 0) {
-    guint8 *buffer = maps->data;
-    gsize length = maps->size;
-
-    total_length += length;
+  n_mem = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n_mem; ++i) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, i);
+    GstMapInfo map;
 
-    while (length-- > 0) {
-      crc_register = (guint16) ((crc_register << 8) ^
-          gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *buffer++]);
+    if (!gst_memory_map (mem, &map, GST_MAP_READ)) {
+      GST_WARNING ("failed to map memory %u for CRC", i);
+      continue;
     }
-    --n_maps;
-    ++maps;
+    crc_register = gst_dp_crc_update (crc_register, map.data, map.size);
+    total_length += map.size;
+    gst_memory_unmap (mem, &map);
   }
 
   if (G_UNLIKELY (total_length == 0))
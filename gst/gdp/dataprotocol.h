@@ -92,6 +92,9 @@ GstEvent *      gst_dp_event_from_packet        (guint header_length,
 GstBuffer *     gst_dp_payload_buffer           (GstBuffer      * buffer,
                                                  GstDPHeaderFlag  flags);
 
+GstBufferList * gst_dp_payload_buffer_list      (GstBuffer      * buffer,
+                                                 GstDPHeaderFlag  flags);
+
 GstBuffer *     gst_dp_payload_caps             (const GstCaps  * caps,
                                                  GstDPHeaderFlag  flags);
 
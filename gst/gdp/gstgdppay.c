@@ -420,6 +420,29 @@ gst_gdp_queue_buffer (GstGDPPay * this, GstBuffer * buffer)
   return GST_FLOW_OK;
 }
 
+static GstFlowReturn
+gst_gdp_pay_push_buffer_list (GstGDPPay * this, GstBuffer * buffer)
+{
+  GstBufferList *list;
+  guint i;
+
+  list = gst_dp_payload_buffer_list (buffer, this->header_flag);
+  for (i = 0; i < gst_buffer_list_length (list); i++) {
+    GstBuffer *outbuffer = gst_buffer_list_get (list, i);
+
+    if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_HEADER))
+      GST_BUFFER_FLAG_SET (outbuffer, GST_BUFFER_FLAG_HEADER);
+    gst_gdp_stamp_buffer (this, outbuffer);
+    GST_BUFFER_TIMESTAMP (outbuffer) = GST_BUFFER_TIMESTAMP (buffer);
+  }
+  GST_BUFFER_DURATION (gst_buffer_list_get (list, 0)) =
+      GST_BUFFER_DURATION (buffer);
+
+  GST_LOG_OBJECT (this, "Pushing GDP buffer list %p, caps %" GST_PTR_FORMAT,
+      list, this->caps);
+  return gst_pad_push_list (this->srcpad, list);
+}
+
 static GstFlowReturn
 gst_gdp_pay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 {
@@ -459,6 +482,15 @@ gst_gdp_pay_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   if (!this->caps)
     goto no_caps;
 
+  /* appending the header to a buffer that already has as many memories as
+   * a buffer can hold would merge them all, so push the header and the
+   * data as a list instead */
+  if (gst_buffer_n_memory (buffer) >= gst_buffer_get_max_memory ()
+      && this->sent_streamheader && !this->reset_streamheader) {
+    ret = gst_gdp_pay_push_buffer_list (this, buffer);
+    goto done;
+  }
+
   /* create a GDP header packet,
    * then create a GST buffer of the header packet and the buffer contents */
   outbuffer = gst_gdp_pay_buffer_from_buffer (this, buffer);
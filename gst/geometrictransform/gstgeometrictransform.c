@@ -49,7 +49,9 @@ static GstVideoFilterClass *parent_class = NULL;
 enum
 {
   PROP_0,
-  PROP_OFF_EDGE_PIXELS
+  PROP_OFF_EDGE_PIXELS,
+  PROP_INTERPOLATION,
+  PROP_N_THREADS
 };
 
 #define GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE ( \
@@ -75,6 +77,77 @@ gst_geometric_transform_off_edges_pixels_method_get_type (void)
 }
 
 #define DEFAULT_OFF_EDGE_PIXELS GST_GT_OFF_EDGES_PIXELS_IGNORE
+#define DEFAULT_INTERPOLATION GST_GT_INTERPOLATION_NEAREST
+#define DEFAULT_N_THREADS 1
+
+/* Bilinear positions are stored in 16.16 fixed point, which limits the
+ * frame size it can be used with */
+#define FIXED_SHIFT 16
+#define FIXED_MAX_SIZE G_MAXINT16
+
+#define GST_GT_INTERPOLATION_TYPE ( \
+    gst_geometric_transform_interpolation_get_type())
+static GType
+gst_geometric_transform_interpolation_get_type (void)
+{
+  static GType interpolation_type = 0;
+
+  static const GEnumValue interpolation_types[] = {
+    {GST_GT_INTERPOLATION_NEAREST, "Nearest neighbour", "nearest"},
+    {GST_GT_INTERPOLATION_BILINEAR, "Bilinear", "bilinear"},
+    {0, NULL, NULL}
+  };
+
+  if (!interpolation_type) {
+    interpolation_type =
+        g_enum_register_static ("GstGeometricTransformInterpolation",
+        interpolation_types);
+  }
+  return interpolation_type;
+}
+
+typedef struct
+{
+  GstGeometricTransform *gt;
+  const guint8 *in_data;
+  guint8 *out_data;
+  gint out_stride;
+  gint y_start, y_end;
+} GstGeometricTransformStripe;
+
+/* Applies the off edge pixels method to the input position of an output
+ * pixel. Returns FALSE if there is no input pixel for it */
+static gboolean
+gst_geometric_transform_fix_edges (GstGeometricTransform * gt,
+    gdouble * in_x, gdouble * in_y)
+{
+  gint trunc_x, trunc_y;
+
+  switch (gt->off_edge_pixels) {
+    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
+      *in_x = CLAMP (*in_x, 0, gt->width - 1);
+      *in_y = CLAMP (*in_y, 0, gt->height - 1);
+      break;
+
+    case GST_GT_OFF_EDGES_PIXELS_WRAP:
+      *in_x = gst_gm_mod_float (*in_x, gt->width);
+      *in_y = gst_gm_mod_float (*in_y, gt->height);
+      if (*in_x < 0)
+        *in_x += gt->width;
+      if (*in_y < 0)
+        *in_y += gt->height;
+      break;
+
+    default:
+      break;
+  }
+
+  trunc_x = (gint) * in_x;
+  trunc_y = (gint) * in_y;
+
+  return trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
+      trunc_y < gt->height;
+}
 
 /* must be called with the object lock */
 static gboolean
@@ -83,45 +156,78 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   gint x, y;
   gdouble in_x, in_y;
   gboolean ret = TRUE;
+  gboolean bilinear;
   GstGeometricTransformClass *klass;
-  gdouble *ptr;
-
-  GST_INFO_OBJECT (gt, "Generating new transform map");
+  gsize map_size;
+  gint32 *ptr;
 
-  /* cleanup old map */
-  g_free (gt->map);
-  gt->map = NULL;
+  /* subclasses without precalculated map get here for every frame */
+  if (gt->precalc_map)
+    GST_DEBUG_OBJECT (gt, "Generating new transform map");
+  else
+    GST_LOG_OBJECT (gt, "Generating transform map for this frame");
 
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
   /* subclass must have defined the map_func */
   g_return_val_if_fail (klass->map_func, FALSE);
 
+  bilinear = gt->interpolation == GST_GT_INTERPOLATION_BILINEAR;
+  if (bilinear && (gt->width > FIXED_MAX_SIZE || gt->height > FIXED_MAX_SIZE)) {
+    GST_WARNING_OBJECT (gt, "Frame too large for bilinear interpolation");
+    bilinear = FALSE;
+  }
+
   /*
-   * (x,y) pairs of the inverse mapping
+   * Input offsets or (x,y) pairs of the inverse mapping, with the off edge
+   * pixels method already applied
    */
-  gt->map = g_malloc0 (sizeof (gdouble) * gt->width * gt->height * 2);
+  map_size = (gsize) gt->width * gt->height * (bilinear ? 2 : 1);
+  if (gt->map == NULL || gt->map_size != map_size) {
+    g_free (gt->map);
+    gt->map = g_new (gint32, map_size);
+    gt->map_size = map_size;
+  }
   ptr = gt->map;
 
   for (y = 0; y < gt->height; y++) {
     for (x = 0; x < gt->width; x++) {
+      gboolean valid;
+
       if (!klass->map_func (gt, x, y, &in_x, &in_y)) {
         /* child should have warned */
         ret = FALSE;
         goto end;
       }
 
-      ptr[0] = in_x;
-      ptr[1] = in_y;
-      ptr += 2;
+      valid = gst_geometric_transform_fix_edges (gt, &in_x, &in_y);
+
+      if (bilinear) {
+        if (valid) {
+          ptr[0] = (gint32) (CLAMP (in_x, 0, gt->width - 1) *
+              (1 << FIXED_SHIFT));
+          ptr[1] = (gint32) (CLAMP (in_y, 0, gt->height - 1) *
+              (1 << FIXED_SHIFT));
+        } else {
+          ptr[0] = G_MININT32;
+          ptr[1] = 0;
+        }
+        ptr += 2;
+      } else {
+        ptr[0] = valid ? (gint) in_y * gt->row_stride +
+            (gint) in_x * gt->pixel_stride : -1;
+        ptr++;
+      }
     }
   }
+  gt->map_bilinear = bilinear;
 
 end:
   if (!ret) {
     GST_WARNING_OBJECT (gt, "Generating transform map failed");
     g_free (gt->map);
     gt->map = NULL;
+    gt->map_size = 0;
   } else
     gt->needs_remap = FALSE;
   return ret;
@@ -135,6 +241,7 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   gboolean ret = TRUE;
   gint old_width;
   gint old_height;
+  gint old_row_stride;
   GstGeometricTransformClass *klass;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
@@ -142,16 +249,28 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
 
   old_width = gt->width;
   old_height = gt->height;
+  old_row_stride = gt->row_stride;
 
   gt->width = in_info->width;
   gt->height = in_info->height;
   gt->row_stride = in_info->stride[0];
   gt->pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE (in_info, 0);
+  gt->format = GST_VIDEO_INFO_FORMAT (in_info);
+
+  if (gt->format == GST_VIDEO_FORMAT_AYUV) {
+    /* in AYUV black is not just all zeros:
+     * 0x10 is black for Y,
+     * 0x80 is black for Cr and Cb */
+    GST_WRITE_UINT32_BE (gt->background, 0xff108080);
+  } else {
+    memset (gt->background, 0, sizeof (gt->background));
+  }
 
-  /* regenerate the map */
+  /* regenerate the map, the offsets in it depend on the stride */
   GST_OBJECT_LOCK (gt);
   if (gt->map == NULL || old_width == 0 || old_height == 0
-      || gt->width != old_width || gt->height != old_height) {
+      || gt->width != old_width || gt->height != old_height
+      || gt->row_stride != old_row_stride) {
     if (klass->prepare_func)
       if (!klass->prepare_func (gt)) {
         GST_OBJECT_UNLOCK (gt);
@@ -164,48 +283,145 @@ gst_geometric_transform_set_info (GstVideoFilter * vfilter, GstCaps * incaps,
   return ret;
 }
 
+#define MAP_ROW_NEAREST(bpp) \
+  for (x = 0; x < width; x++) { \
+    if (map[x] >= 0) \
+      memcpy (out + x * bpp, in + map[x], bpp); \
+    else \
+      memcpy (out + x * bpp, background, bpp); \
+  }
+
+/* The pixel size is a constant in each loop, so that the copies are
+ * plain loads and stores */
 static void
-gst_geometric_transform_do_map (GstGeometricTransform * gt, guint8 * in_data,
-    guint8 * out_data, gint x, gint y, gdouble in_x, gdouble in_y)
+gst_geometric_transform_map_row_nearest (const gint32 * map,
+    const guint8 * in, guint8 * out, gint width, gint pixel_stride,
+    const guint8 * background)
 {
-  gint in_offset;
-  gint out_offset;
+  gint x;
 
-  out_offset = y * gt->row_stride + x * gt->pixel_stride;
-
-  /* operate on out of edge pixels */
-  switch (gt->off_edge_pixels) {
-    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
-      in_x = CLAMP (in_x, 0, gt->width - 1);
-      in_y = CLAMP (in_y, 0, gt->height - 1);
+  switch (pixel_stride) {
+    case 1:
+      MAP_ROW_NEAREST (1);
       break;
-
-    case GST_GT_OFF_EDGES_PIXELS_WRAP:
-      in_x = gst_gm_mod_float (in_x, gt->width);
-      in_y = gst_gm_mod_float (in_y, gt->height);
-      if (in_x < 0)
-        in_x += gt->width;
-      if (in_y < 0)
-        in_y += gt->height;
+    case 2:
+      MAP_ROW_NEAREST (2);
       break;
-
-    default:
+    case 3:
+      MAP_ROW_NEAREST (3);
+      break;
+    case 4:
+      MAP_ROW_NEAREST (4);
       break;
+    default:
+      g_assert_not_reached ();
   }
+}
 
-  {
-    gint trunc_x = (gint) in_x;
-    gint trunc_y = (gint) in_y;
-    /* only set the values if the values are valid */
-    if (trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
-        trunc_y < gt->height) {
-      in_offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+#undef MAP_ROW_NEAREST
+
+static void
+gst_geometric_transform_map_row_bilinear (GstGeometricTransform * gt,
+    const gint32 * map, const guint8 * in, guint8 * out)
+{
+  gint x, c;
+  gint row_stride = gt->row_stride;
+  gint pixel_stride = gt->pixel_stride;
+  gboolean wrap = gt->off_edge_pixels == GST_GT_OFF_EDGES_PIXELS_WRAP;
+
+  for (x = 0; x < gt->width; x++, map += 2, out += pixel_stride) {
+    gint x0, y0, x1, y1;
+    guint fx, fy;
+    const guint8 *p00, *p01, *p10, *p11;
+
+    if (map[0] == G_MININT32) {
+      memcpy (out, gt->background, pixel_stride);
+      continue;
+    }
 
-      memcpy (out_data + out_offset, in_data + in_offset, gt->pixel_stride);
+    /* the 4 surrounding pixels, and 8 bit weights */
+    x0 = map[0] >> FIXED_SHIFT;
+    y0 = map[1] >> FIXED_SHIFT;
+    fx = (map[0] >> (FIXED_SHIFT - 8)) & 0xff;
+    fy = (map[1] >> (FIXED_SHIFT - 8)) & 0xff;
+    x1 = x0 + 1 < gt->width ? x0 + 1 : (wrap ? 0 : x0);
+    y1 = y0 + 1 < gt->height ? y0 + 1 : (wrap ? 0 : y0);
+
+    p00 = in + y0 * row_stride + x0 * pixel_stride;
+    p01 = in + y0 * row_stride + x1 * pixel_stride;
+    p10 = in + y1 * row_stride + x0 * pixel_stride;
+    p11 = in + y1 * row_stride + x1 * pixel_stride;
+
+#define BILINEAR(v00,v01,v10,v11) \
+    ((((v00) * (256 - fx) + (v01) * fx) * (256 - fy) + \
+        ((v10) * (256 - fx) + (v11) * fx) * fy + (1 << 15)) >> 16)
+
+    if (gt->format == GST_VIDEO_FORMAT_GRAY16_LE) {
+      GST_WRITE_UINT16_LE (out, BILINEAR (GST_READ_UINT16_LE (p00),
+              GST_READ_UINT16_LE (p01), GST_READ_UINT16_LE (p10),
+              GST_READ_UINT16_LE (p11)));
+    } else if (gt->format == GST_VIDEO_FORMAT_GRAY16_BE) {
+      GST_WRITE_UINT16_BE (out, BILINEAR (GST_READ_UINT16_BE (p00),
+              GST_READ_UINT16_BE (p01), GST_READ_UINT16_BE (p10),
+              GST_READ_UINT16_BE (p11)));
+    } else {
+      for (c = 0; c < pixel_stride; c++)
+        out[c] = BILINEAR (p00[c], p01[c], p10[c], p11[c]);
     }
+
+#undef BILINEAR
+  }
+}
+
+static void
+gst_geometric_transform_process_stripe (gpointer data, gpointer user_data)
+{
+  GstGeometricTransformStripe *stripe = data;
+  GstGeometricTransform *gt = stripe->gt;
+  gint y;
+
+  for (y = stripe->y_start; y < stripe->y_end; y++) {
+    guint8 *out = stripe->out_data + y * stripe->out_stride;
+
+    if (gt->map_bilinear)
+      gst_geometric_transform_map_row_bilinear (gt,
+          gt->map + 2 * y * gt->width, stripe->in_data, out);
+    else
+      gst_geometric_transform_map_row_nearest (gt->map + y * gt->width,
+          stripe->in_data, out, gt->width, gt->pixel_stride, gt->background);
   }
 }
 
+/* WITH GST_OBJECT_LOCK !!
+ * Maps all rows, the first stripe on the calling thread and all others on
+ * the worker pool, and waits until all of them are done */
+static void
+gst_geometric_transform_run_stripes (GstGeometricTransform * gt,
+    const guint8 * in_data, guint8 * out_data, gint out_stride)
+{
+  GstGeometricTransformStripe *stripes;
+  guint n_stripes, i;
+  gint stripe_height;
+
+  n_stripes = gst_video_stripe_pool_prepare (gt->stripe_pool, gt->n_threads,
+      gt->height);
+  stripe_height = (gt->height + n_stripes - 1) / n_stripes;
+  stripes = g_newa (GstGeometricTransformStripe, n_stripes);
+
+  for (i = 0; i < n_stripes; i++) {
+    stripes[i].gt = gt;
+    stripes[i].in_data = in_data;
+    stripes[i].out_data = out_data;
+    stripes[i].out_stride = out_stride;
+    stripes[i].y_start = MIN (i * stripe_height, gt->height);
+    stripes[i].y_end = MIN ((i + 1) * stripe_height, gt->height);
+  }
+
+  gst_video_stripe_pool_run (gt->stripe_pool,
+      gst_geometric_transform_process_stripe, NULL, stripes,
+      sizeof (GstGeometricTransformStripe), n_stripes);
+}
+
 static void
 gst_geometric_transform_before_transform (GstBaseTransform * trans,
     GstBuffer * outbuf)
@@ -229,64 +445,33 @@ gst_geometric_transform_transform_frame (GstVideoFilter * vfilter,
 {
   GstGeometricTransform *gt;
   GstGeometricTransformClass *klass;
-  gint x, y, i;
   GstFlowReturn ret = GST_FLOW_OK;
-  gdouble *ptr;
-  guint8 *in_data;
-  guint8 *out_data;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (vfilter);
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
-  in_data = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
-  out_data = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
-
-  if (GST_VIDEO_FRAME_FORMAT (out_frame) == GST_VIDEO_FORMAT_AYUV) {
-    /* in AYUV black is not just all zeros:
-     * 0x10 is black for Y,
-     * 0x80 is black for Cr and Cb */
-    for (i = 0; i < out_frame->map[0].size; i += 4)
-      GST_WRITE_UINT32_BE (out_data + i, 0xff108080);
-  } else {
-    memset (out_data, 0, out_frame->map[0].size);
-  }
-
   GST_OBJECT_LOCK (gt);
-  if (gt->precalc_map) {
-    if (gt->needs_remap) {
-      if (klass->prepare_func)
-        if (!klass->prepare_func (gt)) {
-          ret = FALSE;
-          goto end;
-        }
-      gst_geometric_transform_generate_map (gt);
-    }
-    g_return_val_if_fail (gt->map, GST_FLOW_ERROR);
-    ptr = gt->map;
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        /* do the mapping */
-        gst_geometric_transform_do_map (gt, in_data, out_data, x, y, ptr[0],
-            ptr[1]);
-        ptr += 2;
+  /* Subclasses without a fixed mapping get a new map for each frame */
+  if (gt->needs_remap || !gt->precalc_map) {
+    if (gt->precalc_map && klass->prepare_func) {
+      if (!klass->prepare_func (gt)) {
+        ret = GST_FLOW_ERROR;
+        goto end;
       }
     }
-  } else {
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        gdouble in_x, in_y;
-
-        if (klass->map_func (gt, x, y, &in_x, &in_y)) {
-          gst_geometric_transform_do_map (gt, in_data, out_data, x, y, in_x,
-              in_y);
-        } else {
-          GST_WARNING_OBJECT (gt, "Failed to do mapping for %d %d", x, y);
-          ret = GST_FLOW_ERROR;
-          goto end;
-        }
-      }
+    if (!gst_geometric_transform_generate_map (gt)) {
+      ret = GST_FLOW_ERROR;
+      goto end;
     }
   }
+
+  /* Every output pixel is written, either from the input or with the
+   * background */
+  gst_geometric_transform_run_stripes (gt,
+      GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0),
+      GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0),
+      GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0));
+
 end:
   GST_OBJECT_UNLOCK (gt);
   return ret;
@@ -301,9 +486,32 @@ gst_geometric_transform_set_property (GObject * object, guint prop_id,
   gt = GST_GEOMETRIC_TRANSFORM_CAST (object);
 
   switch (prop_id) {
-    case PROP_OFF_EDGE_PIXELS:
+    case PROP_OFF_EDGE_PIXELS:{
+      gint off_edge_pixels = g_value_get_enum (value);
+
+      GST_OBJECT_LOCK (gt);
+      /* the edge handling is part of the map */
+      if (off_edge_pixels != gt->off_edge_pixels) {
+        gt->off_edge_pixels = off_edge_pixels;
+        gst_geometric_transform_set_need_remap (gt);
+      }
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    }
+    case PROP_INTERPOLATION:{
+      gint interpolation = g_value_get_enum (value);
+
+      GST_OBJECT_LOCK (gt);
+      if (interpolation != gt->interpolation) {
+        gt->interpolation = interpolation;
+        gst_geometric_transform_set_need_remap (gt);
+      }
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    }
+    case PROP_N_THREADS:
       GST_OBJECT_LOCK (gt);
-      gt->off_edge_pixels = g_value_get_enum (value);
+      gt->n_threads = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (gt);
       break;
     default:
@@ -324,6 +532,12 @@ gst_geometric_transform_get_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       g_value_set_enum (value, gt->off_edge_pixels);
       break;
+    case PROP_INTERPOLATION:
+      g_value_set_enum (value, gt->interpolation);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, gt->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -343,10 +557,25 @@ gst_geometric_transform_stop (GstBaseTransform * trans)
 
   g_free (gt->map);
   gt->map = NULL;
+  gt->map_size = 0;
 
   return TRUE;
 }
 
+static void
+gst_geometric_transform_finalize (GObject * object)
+{
+  GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (object);
+
+  gst_video_stripe_pool_free (gt->stripe_pool);
+  gt->stripe_pool = NULL;
+
+  g_free (gt->map);
+  gt->map = NULL;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_geometric_transform_base_init (gpointer g_class)
 {
@@ -373,6 +602,7 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
 
   obj_class->set_property = gst_geometric_transform_set_property;
   obj_class->get_property = gst_geometric_transform_get_property;
+  obj_class->finalize = gst_geometric_transform_finalize;
 
   trans_class->stop = GST_DEBUG_FUNCPTR (gst_geometric_transform_stop);
   trans_class->before_transform =
@@ -388,6 +618,34 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
           "What to do with off edge pixels",
           GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE, DEFAULT_OFF_EDGE_PIXELS,
           GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstGeometricTransform:interpolation:
+   *
+   * How output pixels are computed from the input pixels around their
+   * mapped position. Bilinear interpolation is only used for frames up to
+   * 32767 pixels wide and high.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (obj_class, PROP_INTERPOLATION,
+      g_param_spec_enum ("interpolation", "Interpolation",
+          "Interpolation method", GST_GT_INTERPOLATION_TYPE,
+          DEFAULT_INTERPOLATION,
+          GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstGeometricTransform:n-threads:
+   *
+   * Number of threads the rows of each frame are mapped on.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (obj_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to use for mapping (0 = number of CPU cores)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -396,6 +654,9 @@ gst_geometric_transform_init (GTypeInstance * instance, gpointer g_class)
   GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (instance);
 
   gt->off_edge_pixels = DEFAULT_OFF_EDGE_PIXELS;
+  gt->interpolation = DEFAULT_INTERPOLATION;
+  gt->n_threads = DEFAULT_N_THREADS;
+  gt->stripe_pool = gst_video_stripe_pool_new ();
   gt->precalc_map = TRUE;
   gt->needs_remap = TRUE;
 }
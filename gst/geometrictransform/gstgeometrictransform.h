@@ -22,6 +22,7 @@
 
 #include <gst/video/gstvideofilter.h>
 #include <gst/video/video.h>
+#include <gst/video/gstvideostripepool.h>
 
 G_BEGIN_DECLS
 
@@ -46,6 +47,12 @@ enum
   GST_GT_OFF_EDGES_PIXELS_WRAP
 };
 
+enum
+{
+  GST_GT_INTERPOLATION_NEAREST = 0,
+  GST_GT_INTERPOLATION_BILINEAR
+};
+
 typedef struct _GstGeometricTransform GstGeometricTransform;
 typedef struct _GstGeometricTransformClass GstGeometricTransformClass;
 
@@ -99,8 +106,22 @@ struct _GstGeometricTransform {
 
   /* properties */
   gint off_edge_pixels;
-
-  gdouble *map;
+  gint interpolation;
+  guint n_threads;
+
+  /* Inverse mapping of each output pixel: the offset of its input pixel
+   * (-1 for none), or with bilinear interpolation the 16.16 fixed point
+   * (x,y) position in the input (x = G_MININT32 for none) */
+  gint32 *map;
+  /* number of entries allocated in map, kept across regenerations */
+  gsize map_size;
+  gboolean map_bilinear;
+
+  /* Value of the output pixels without input pixel */
+  guint8 background[4];
+
+  /* stripe-parallel mapping */
+  GstVideoStripePool *stripe_pool;
 };
 
 struct _GstGeometricTransformClass {
@@ -226,7 +226,7 @@ gst_inter_audio_sink_stop (GstBaseSink * sink)
   GST_DEBUG_OBJECT (interaudiosink, "stop");
 
   g_mutex_lock (&interaudiosink->surface->mutex);
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
+  gst_inter_queue_clear (&interaudiosink->surface->audio_queue);
   memset (&interaudiosink->surface->audio_info, 0, sizeof (GstAudioInfo));
   g_mutex_unlock (&interaudiosink->surface->mutex);
 
@@ -253,7 +253,7 @@ gst_inter_audio_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
   interaudiosink->surface->audio_info = info;
   interaudiosink->info = info;
   /* TODO: Ideally we would drain the source here */
-  gst_adapter_clear (interaudiosink->surface->audio_adapter);
+  gst_inter_queue_clear (&interaudiosink->surface->audio_queue);
   g_mutex_unlock (&interaudiosink->surface->mutex);
 
   return TRUE;
@@ -270,10 +270,11 @@ gst_inter_audio_sink_event (GstBaseSink * sink, GstEvent * event)
       guint n;
 
       if ((n = gst_adapter_available (interaudiosink->input_adapter)) > 0) {
+        tmp = gst_adapter_take_buffer_fast (interaudiosink->input_adapter, n);
         g_mutex_lock (&interaudiosink->surface->mutex);
-        tmp = gst_adapter_take_buffer (interaudiosink->input_adapter, n);
-        gst_adapter_push (interaudiosink->surface->audio_adapter, tmp);
+        gst_inter_queue_push (&interaudiosink->surface->audio_queue, tmp);
         g_mutex_unlock (&interaudiosink->surface->mutex);
+        gst_buffer_unref (tmp);
       }
       break;
     }
@@ -288,9 +289,10 @@ static GstFlowReturn
 gst_inter_audio_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
   GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (sink);
+  GstBuffer *chunk;
   guint n, bpf;
   guint64 period_time, buffer_time;
-  guint64 period_samples, buffer_samples;
+  guint64 period_samples;
 
   GST_DEBUG_OBJECT (interaudiosink, "render %" G_GSIZE_FORMAT,
       gst_buffer_get_size (buffer));
@@ -310,36 +312,27 @@ gst_inter_audio_sink_render (GstBaseSink * sink, GstBuffer * buffer)
     return GST_FLOW_ERROR;
   }
 
-  buffer_samples =
-      gst_util_uint64_scale (buffer_time, interaudiosink->info.rate,
-      GST_SECOND);
+  /* Enough chunks for each interaudiosrc to be buffer-time late, they drop
+   * what is later than that themselves */
+  gst_inter_queue_set_size (&interaudiosink->surface->audio_queue,
+      gst_inter_surface_get_audio_queue_size (buffer_time, period_time));
+  g_mutex_unlock (&interaudiosink->surface->mutex);
+
   period_samples =
       gst_util_uint64_scale (period_time, interaudiosink->info.rate,
       GST_SECOND);
 
-  n = gst_adapter_available (interaudiosink->surface->audio_adapter) / bpf;
-  while (n > buffer_samples) {
-    GST_DEBUG_OBJECT (interaudiosink, "flushing %" GST_TIME_FORMAT,
-        GST_TIME_ARGS (period_time));
-    gst_adapter_flush (interaudiosink->surface->audio_adapter,
-        period_samples * bpf);
-    n -= period_samples;
-  }
-
+  /* Queue chunks of at least a period */
+  gst_adapter_push (interaudiosink->input_adapter, gst_buffer_ref (buffer));
   n = gst_adapter_available (interaudiosink->input_adapter);
-  if (period_samples * bpf > gst_buffer_get_size (buffer) + n) {
-    gst_adapter_push (interaudiosink->input_adapter, gst_buffer_ref (buffer));
-  } else {
-    GstBuffer *tmp;
-
-    if (n > 0) {
-      tmp = gst_adapter_take_buffer (interaudiosink->input_adapter, n);
-      gst_adapter_push (interaudiosink->surface->audio_adapter, tmp);
-    }
-    gst_adapter_push (interaudiosink->surface->audio_adapter,
-        gst_buffer_ref (buffer));
-  }
+  if (n < period_samples * bpf)
+    return GST_FLOW_OK;
+
+  chunk = gst_adapter_take_buffer_fast (interaudiosink->input_adapter, n);
+  g_mutex_lock (&interaudiosink->surface->mutex);
+  gst_inter_queue_push (&interaudiosink->surface->audio_queue, chunk);
   g_mutex_unlock (&interaudiosink->surface->mutex);
+  gst_buffer_unref (chunk);
 
   return GST_FLOW_OK;
 }
@@ -161,6 +161,7 @@ gst_inter_audio_src_init (GstInterAudioSrc * interaudiosrc)
   interaudiosrc->buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   interaudiosrc->latency_time = DEFAULT_AUDIO_LATENCY_TIME;
   interaudiosrc->period_time = DEFAULT_AUDIO_PERIOD_TIME;
+  interaudiosrc->adapter = gst_adapter_new ();
 }
 
 void
@@ -221,6 +222,7 @@ gst_inter_audio_src_finalize (GObject * object)
 
   /* clean up object here */
   g_free (interaudiosrc->channel);
+  gst_object_unref (interaudiosrc->adapter);
 
   G_OBJECT_CLASS (gst_inter_audio_src_parent_class)->finalize (object);
 }
@@ -287,6 +289,8 @@ gst_inter_audio_src_start (GstBaseSrc * src)
   interaudiosrc->surface->audio_buffer_time = interaudiosrc->buffer_time;
   interaudiosrc->surface->audio_latency_time = interaudiosrc->latency_time;
   interaudiosrc->surface->audio_period_time = interaudiosrc->period_time;
+  /* Start from the next chunk */
+  interaudiosrc->read_count = interaudiosrc->surface->audio_queue.write_count;
   g_mutex_unlock (&interaudiosrc->surface->mutex);
 
   return TRUE;
@@ -301,6 +305,7 @@ gst_inter_audio_src_stop (GstBaseSrc * src)
 
   gst_inter_surface_unref (interaudiosrc->surface);
   interaudiosrc->surface = NULL;
+  gst_adapter_clear (interaudiosrc->adapter);
 
   return TRUE;
 }
@@ -336,10 +341,10 @@ gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
 {
   GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (src);
   GstCaps *caps;
-  GstBuffer *buffer;
+  GstBuffer *buffer, *chunk;
   guint n, bpf;
   guint64 period_time;
-  guint64 period_samples;
+  guint64 period_samples, buffer_samples;
 
   GST_DEBUG_OBJECT (interaudiosrc, "create");
 
@@ -355,29 +360,46 @@ gst_inter_audio_src_create (GstBaseSrc * src, guint64 offset, guint size,
           gst_util_uint64_scale (interaudiosrc->n_samples, GST_SECOND,
           interaudiosrc->info.rate);
       interaudiosrc->n_samples = 0;
+      /* samples in the previous format */
+      gst_adapter_clear (interaudiosrc->adapter);
     }
   }
 
   bpf = interaudiosrc->surface->audio_info.bpf;
   period_time = interaudiosrc->surface->audio_period_time;
+
+  while ((chunk = gst_inter_queue_read (&interaudiosrc->surface->audio_queue,
+              &interaudiosrc->read_count)))
+    gst_adapter_push (interaudiosrc->adapter, chunk);
+  g_mutex_unlock (&interaudiosrc->surface->mutex);
+
   period_samples =
       gst_util_uint64_scale (period_time, interaudiosrc->info.rate, GST_SECOND);
+  buffer_samples =
+      gst_util_uint64_scale (interaudiosrc->buffer_time,
+      interaudiosrc->info.rate, GST_SECOND);
 
   if (bpf > 0)
-    n = gst_adapter_available (interaudiosrc->surface->audio_adapter) / bpf;
+    n = gst_adapter_available (interaudiosrc->adapter) / bpf;
   else
     n = 0;
 
+  /* Don't fall more than buffer-time behind */
+  while (period_samples > 0 && n > MAX (buffer_samples, period_samples)) {
+    GST_DEBUG_OBJECT (interaudiosrc, "flushing %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (period_time));
+    gst_adapter_flush (interaudiosrc->adapter, period_samples * bpf);
+    n -= period_samples;
+  }
+
   if (n > period_samples)
     n = period_samples;
   if (n > 0) {
-    buffer = gst_adapter_take_buffer (interaudiosrc->surface->audio_adapter,
-        n * bpf);
+    buffer = gst_adapter_take_buffer (interaudiosrc->adapter, n * bpf);
   } else {
     buffer = gst_buffer_new ();
     GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_GAP);
   }
-  g_mutex_unlock (&interaudiosrc->surface->mutex);
 
   if (caps) {
     gboolean ret = gst_base_src_set_caps (src, caps);
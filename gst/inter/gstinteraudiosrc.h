@@ -21,6 +21,7 @@
 #define _GST_INTER_AUDIO_SRC_H_
 
 #include <gst/base/gstbasesrc.h>
+#include <gst/base/gstadapter.h>
 #include <gst/audio/audio.h>
 #include "gstintersurface.h"
 
@@ -42,6 +43,11 @@ struct _GstInterAudioSrc
   GstInterSurface *surface;
   char *channel;
 
+  /* Position in the surface queue, and the samples read from it that
+   * weren't output yet */
+  guint64 read_count;
+  GstAdapter *adapter;
+
   guint64 n_samples;
   GstClockTime timestamp_offset;
   GstAudioInfo info;
@@ -48,10 +48,13 @@ gst_inter_surface_get (const char *name)
   surface->ref_count = 1;
   surface->name = g_strdup (name);
   g_mutex_init (&surface->mutex);
-  surface->audio_adapter = gst_adapter_new ();
   surface->audio_buffer_time = DEFAULT_AUDIO_BUFFER_TIME;
   surface->audio_latency_time = DEFAULT_AUDIO_LATENCY_TIME;
   surface->audio_period_time = DEFAULT_AUDIO_PERIOD_TIME;
+  gst_inter_queue_set_size (&surface->audio_queue,
+      gst_inter_surface_get_audio_queue_size (surface->audio_buffer_time,
+          surface->audio_period_time));
+  gst_inter_queue_set_size (&surface->video_queue, DEFAULT_VIDEO_QUEUE_SIZE);
 
   list = g_list_append (list, surface);
   g_mutex_unlock (&mutex);
@@ -78,11 +81,80 @@ gst_inter_surface_unref (GstInterSurface * surface)
     }
 
     g_mutex_clear (&surface->mutex);
-    gst_buffer_replace (&surface->video_buffer, NULL);
+    gst_inter_queue_clear (&surface->video_queue);
+    g_free (surface->video_queue.buffers);
+    gst_inter_queue_clear (&surface->audio_queue);
+    g_free (surface->audio_queue.buffers);
     gst_buffer_replace (&surface->sub_buffer, NULL);
-    gst_object_unref (surface->audio_adapter);
     g_free (surface->name);
     g_free (surface);
   }
   g_mutex_unlock (&mutex);
 }
+
+/* Number of audio chunks to keep so that each consumer can be up to
+ * @buffer_time late. Chunks hold at least @period_time, one more is kept
+ * for the one being read */
+guint
+gst_inter_surface_get_audio_queue_size (guint64 buffer_time,
+    guint64 period_time)
+{
+  if (period_time == 0)
+    return 1;
+
+  return MIN ((buffer_time + period_time - 1) / period_time, G_MAXUINT16) + 1;
+}
+
+void
+gst_inter_queue_clear (GstInterQueue * queue)
+{
+  guint i;
+
+  for (i = 0; i < queue->size; i++)
+    gst_buffer_replace (&queue->buffers[i], NULL);
+}
+
+void
+gst_inter_queue_set_size (GstInterQueue * queue, guint size)
+{
+  g_return_if_fail (size > 0);
+
+  if (size == queue->size)
+    return;
+
+  gst_inter_queue_clear (queue);
+  g_free (queue->buffers);
+  queue->buffers = g_new0 (GstBuffer *, size);
+  queue->size = size;
+}
+
+void
+gst_inter_queue_push (GstInterQueue * queue, GstBuffer * buffer)
+{
+  guint index = queue->write_count % queue->size;
+
+  gst_buffer_replace (&queue->buffers[index], buffer);
+  queue->write_count++;
+}
+
+/* Returns a new reference to the next buffer after @read_count, skipping
+ * the ones that were overwritten already, or NULL if there is none */
+GstBuffer *
+gst_inter_queue_read (GstInterQueue * queue, guint64 * read_count)
+{
+  GstBuffer *buffer;
+
+  if (queue->write_count - *read_count > queue->size)
+    *read_count = queue->write_count - queue->size;
+
+  while (*read_count < queue->write_count) {
+    buffer = queue->buffers[*read_count % queue->size];
+    (*read_count)++;
+
+    /* NULL if the queue was cleared since */
+    if (buffer)
+      return gst_buffer_ref (buffer);
+  }
+
+  return NULL;
+}
@@ -20,14 +20,23 @@
 #ifndef _GST_INTER_SURFACE_H_
 #define _GST_INTER_SURFACE_H_
 
-#include <gst/base/gstadapter.h>
 #include <gst/audio/audio.h>
 #include <gst/video/video.h>
 
 G_BEGIN_DECLS
 
+typedef struct _GstInterQueue GstInterQueue;
 typedef struct _GstInterSurface GstInterSurface;
 
+/* The last size buffers written, write_count is the number of buffers
+ * written so far and each consumer keeps its own read count */
+struct _GstInterQueue
+{
+  GstBuffer **buffers;
+  guint size;
+  guint64 write_count;
+};
+
 struct _GstInterSurface
 {
   GMutex mutex;
@@ -37,27 +46,37 @@ struct _GstInterSurface
 
   /* video */
   GstVideoInfo video_info;
-  int video_buffer_count;
+  GstInterQueue video_queue;
 
   /* audio */
   GstAudioInfo audio_info;
   guint64 audio_buffer_time;
   guint64 audio_latency_time;
   guint64 audio_period_time;
+  /* chunks of at least audio_period_time */
+  GstInterQueue audio_queue;
 
-  GstBuffer *video_buffer;
   GstBuffer *sub_buffer;
-  GstAdapter *audio_adapter;
 };
 
 #define DEFAULT_AUDIO_BUFFER_TIME  (GST_SECOND)
 #define DEFAULT_AUDIO_LATENCY_TIME (100 * GST_MSECOND)
 #define DEFAULT_AUDIO_PERIOD_TIME  (25 * GST_MSECOND)
+#define DEFAULT_VIDEO_QUEUE_SIZE   (1)
 
 
 GstInterSurface * gst_inter_surface_get (const char *name);
 void gst_inter_surface_unref (GstInterSurface *surface);
 
+guint gst_inter_surface_get_audio_queue_size (guint64 buffer_time,
+    guint64 period_time);
+
+/* Must be called with the surface mutex held */
+void gst_inter_queue_set_size (GstInterQueue *queue, guint size);
+void gst_inter_queue_clear (GstInterQueue *queue);
+void gst_inter_queue_push (GstInterQueue *queue, GstBuffer *buffer);
+GstBuffer * gst_inter_queue_read (GstInterQueue *queue, guint64 *read_count);
+
 
 G_END_DECLS
 
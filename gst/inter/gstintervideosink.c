@@ -66,10 +66,12 @@ static GstFlowReturn gst_inter_video_sink_show_frame (GstVideoSink * sink,
 enum
 {
   PROP_0,
-  PROP_CHANNEL
+  PROP_CHANNEL,
+  PROP_QUEUE_SIZE
 };
 
 #define DEFAULT_CHANNEL ("default")
+#define DEFAULT_QUEUE_SIZE (DEFAULT_VIDEO_QUEUE_SIZE)
 
 /* pad templates */
 static GstStaticPadTemplate gst_inter_video_sink_sink_template =
@@ -118,12 +120,29 @@ gst_inter_video_sink_class_init (GstInterVideoSinkClass * klass)
       g_param_spec_string ("channel", "Channel",
           "Channel name to match inter src and sink elements",
           DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstInterVideoSink:queue-size:
+   *
+   * Number of frames kept for the intervideosrc elements on the channel.
+   * Each of them reads the frames at its own pace, and only misses some if
+   * it falls behind by more than this many frames. 1 only keeps the latest
+   * frame. Changing it while running drops the frames kept so far.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_QUEUE_SIZE,
+      g_param_spec_uint ("queue-size", "Queue size",
+          "Number of frames kept for each consumer of the channel",
+          1, G_MAXUINT16, DEFAULT_QUEUE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_inter_video_sink_init (GstInterVideoSink * intervideosink)
 {
   intervideosink->channel = g_strdup (DEFAULT_CHANNEL);
+  intervideosink->queue_size = DEFAULT_QUEUE_SIZE;
 }
 
 void
@@ -137,6 +156,18 @@ gst_inter_video_sink_set_property (GObject * object, guint property_id,
       g_free (intervideosink->channel);
       intervideosink->channel = g_value_dup_string (value);
       break;
+    case PROP_QUEUE_SIZE:
+      GST_OBJECT_LOCK (intervideosink);
+      intervideosink->queue_size = g_value_get_uint (value);
+      /* takes effect right away when running */
+      if (intervideosink->surface) {
+        g_mutex_lock (&intervideosink->surface->mutex);
+        gst_inter_queue_set_size (&intervideosink->surface->video_queue,
+            intervideosink->queue_size);
+        g_mutex_unlock (&intervideosink->surface->mutex);
+      }
+      GST_OBJECT_UNLOCK (intervideosink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -153,6 +184,11 @@ gst_inter_video_sink_get_property (GObject * object, guint property_id,
     case PROP_CHANNEL:
       g_value_set_string (value, intervideosink->channel);
       break;
+    case PROP_QUEUE_SIZE:
+      GST_OBJECT_LOCK (intervideosink);
+      g_value_set_uint (value, intervideosink->queue_size);
+      GST_OBJECT_UNLOCK (intervideosink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -196,10 +232,14 @@ gst_inter_video_sink_start (GstBaseSink * sink)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
 
+  GST_OBJECT_LOCK (intervideosink);
   intervideosink->surface = gst_inter_surface_get (intervideosink->channel);
   g_mutex_lock (&intervideosink->surface->mutex);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
+  gst_inter_queue_set_size (&intervideosink->surface->video_queue,
+      intervideosink->queue_size);
   g_mutex_unlock (&intervideosink->surface->mutex);
+  GST_OBJECT_UNLOCK (intervideosink);
 
   return TRUE;
 }
@@ -209,16 +249,15 @@ gst_inter_video_sink_stop (GstBaseSink * sink)
 {
   GstInterVideoSink *intervideosink = GST_INTER_VIDEO_SINK (sink);
 
+  GST_OBJECT_LOCK (intervideosink);
   g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
-  }
-  intervideosink->surface->video_buffer = NULL;
+  gst_inter_queue_clear (&intervideosink->surface->video_queue);
   memset (&intervideosink->surface->video_info, 0, sizeof (GstVideoInfo));
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   gst_inter_surface_unref (intervideosink->surface);
   intervideosink->surface = NULL;
+  GST_OBJECT_UNLOCK (intervideosink);
 
   return TRUE;
 }
@@ -251,11 +290,7 @@ gst_inter_video_sink_show_frame (GstVideoSink * sink, GstBuffer * buffer)
       GST_TIME_ARGS (GST_BUFFER_PTS (buffer)));
 
   g_mutex_lock (&intervideosink->surface->mutex);
-  if (intervideosink->surface->video_buffer) {
-    gst_buffer_unref (intervideosink->surface->video_buffer);
-  }
-  intervideosink->surface->video_buffer = gst_buffer_ref (buffer);
-  intervideosink->surface->video_buffer_count = 0;
+  gst_inter_queue_push (&intervideosink->surface->video_queue, buffer);
   g_mutex_unlock (&intervideosink->surface->mutex);
 
   return GST_FLOW_OK;
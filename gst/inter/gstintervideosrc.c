@@ -276,6 +276,14 @@ gst_inter_video_src_start (GstBaseSrc * src)
   intervideosrc->surface = gst_inter_surface_get (intervideosrc->channel);
   intervideosrc->timestamp_offset = 0;
   intervideosrc->n_frames = 0;
+  intervideosrc->video_buffer_count = 0;
+
+  /* Start from the latest frame */
+  g_mutex_lock (&intervideosrc->surface->mutex);
+  intervideosrc->read_count = intervideosrc->surface->video_queue.write_count;
+  if (intervideosrc->read_count > 0)
+    intervideosrc->read_count--;
+  g_mutex_unlock (&intervideosrc->surface->mutex);
 
   return TRUE;
 }
@@ -290,6 +298,7 @@ gst_inter_video_src_stop (GstBaseSrc * src)
   gst_inter_surface_unref (intervideosrc->surface);
   intervideosrc->surface = NULL;
   gst_buffer_replace (&intervideosrc->black_frame, NULL);
+  gst_buffer_replace (&intervideosrc->video_buffer, NULL);
 
   return TRUE;
 }
@@ -326,6 +335,7 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
   GstCaps *caps;
   GstBuffer *buffer;
+  GstBuffer *new_buffer;
   guint64 frames;
   gboolean is_gap = FALSE;
 
@@ -360,25 +370,32 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
     }
   }
 
-  if (intervideosrc->surface->video_buffer) {
+  new_buffer = gst_inter_queue_read (&intervideosrc->surface->video_queue,
+      &intervideosrc->read_count);
+  g_mutex_unlock (&intervideosrc->surface->mutex);
+
+  if (new_buffer) {
+    gst_buffer_replace (&intervideosrc->video_buffer, NULL);
+    intervideosrc->video_buffer = new_buffer;
+    intervideosrc->video_buffer_count = 0;
+  }
+
+  if (intervideosrc->video_buffer) {
     /* We have a buffer to push */
-    buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
+    buffer = gst_buffer_ref (intervideosrc->video_buffer);
 
     /* Can only be true if timeout > 0 */
-    if (intervideosrc->surface->video_buffer_count == frames) {
-      gst_buffer_unref (intervideosrc->surface->video_buffer);
-      intervideosrc->surface->video_buffer = NULL;
-    }
+    if (intervideosrc->video_buffer_count == frames)
+      gst_buffer_replace (&intervideosrc->video_buffer, NULL);
   }
 
-  if (intervideosrc->surface->video_buffer_count != 0 &&
-      intervideosrc->surface->video_buffer_count != (frames + 1)) {
+  if (intervideosrc->video_buffer_count != 0 &&
+      intervideosrc->video_buffer_count != (frames + 1)) {
     /* This is a repeat of the stored buffer or of a black frame */
     is_gap = TRUE;
   }
 
-  intervideosrc->surface->video_buffer_count++;
-  g_mutex_unlock (&intervideosrc->surface->mutex);
+  intervideosrc->video_buffer_count++;
 
   if (caps) {
     gboolean ret;
@@ -47,6 +47,13 @@ struct _GstInterVideoSrc
   GstVideoInfo info;
   GstBuffer *black_frame;
   int n_frames;
+
+  /* Position in the surface queue, last frame read and how many times it
+   * was output */
+  guint64 read_count;
+  GstBuffer *video_buffer;
+  int video_buffer_count;
+
   GstClockTime timestamp_offset;
 };
 
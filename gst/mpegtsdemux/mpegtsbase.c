@@ -1392,7 +1392,13 @@ mpegts_base_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
   mpegts_packetizer_push (base->packetizer, buf);
 
   while (res == GST_FLOW_OK) {
-    pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
+    /* Subclasses inspecting all packets need to see every PID, others only
+     * care about the PES and PSI PIDs we know about */
+    if (klass->inspect_packet)
+      pret = mpegts_packetizer_next_packet (base->packetizer, &packet);
+    else
+      pret = mpegts_packetizer_next_packet_filtered (base->packetizer,
+          &packet, base->is_pes, base->known_psi);
 
     /* If we don't have enough data, return */
     if (G_UNLIKELY (pret == PACKET_NEED_MORE))
@@ -1585,6 +1591,13 @@ mpegts_base_loop (MpegTSBase * base)
 
       ret = gst_pad_pull_range (base->sinkpad, base->seek_offset,
           100 * base->packetsize, &buf);
+      if (G_UNLIKELY (ret == GST_FLOW_EOS)) {
+        /* Output the pending data now, the subclass may want to go back to
+         * some data it skipped */
+        mpegts_base_drain (base);
+        if (base->mode == BASE_MODE_SEEKING)
+          return;
+      }
       if (G_UNLIKELY (ret != GST_FLOW_OK))
         goto error;
       base->seek_offset += gst_buffer_get_size (buf);
@@ -1682,11 +1695,6 @@ mpegts_base_handle_seek_event (MpegTSBase * base, GstPad * pad,
     return FALSE;
   }
 
-  if (rate <= 0.0) {
-    GST_WARNING ("Negative rate not supported");
-    return FALSE;
-  }
-
   GST_DEBUG ("seek event, rate: %f start: %" GST_TIME_FORMAT
       " stop: %" GST_TIME_FORMAT, rate, GST_TIME_ARGS (start),
       GST_TIME_ARGS (stop));
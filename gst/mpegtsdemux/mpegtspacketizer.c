@@ -797,8 +797,18 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
     sync_offset = 0;
 
   for (i = sync_offset; i + 2 * packet_size < size; i++) {
-    if (data[i] == PACKET_SYNC_BYTE &&
-        data[i + packet_size] == PACKET_SYNC_BYTE &&
+    guint8 *candidate;
+
+    /* memchr() is vectorized in most libc implementations, and is much
+     * faster than checking each byte ourselves on garbage data */
+    candidate = memchr (data + i, PACKET_SYNC_BYTE, size - 2 * packet_size - i);
+    if (candidate == NULL) {
+      i = size - 2 * packet_size;
+      break;
+    }
+    i = candidate - data;
+
+    if (data[i + packet_size] == PACKET_SYNC_BYTE &&
         data[i + 2 * packet_size] == PACKET_SYNC_BYTE) {
       found = TRUE;
       break;
@@ -813,9 +823,27 @@ mpegts_packetizer_sync (MpegTSPacketizer2 * packetizer)
   return found;
 }
 
-MpegTSPacketizerPacketReturn
-mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
-    MpegTSPacketizerPacket * packet)
+/* Returns TRUE if the packet starting at @data (sync byte) is on one of the
+ * PIDs set in @pes_pids or @psi_pids, or carries a PCR. Packets carrying a
+ * PCR are always wanted so that skew and offset observations are not
+ * affected by filtering */
+static inline gboolean
+mpegts_packetizer_packet_is_wanted (const guint8 * data,
+    const guint8 * pes_pids, const guint8 * psi_pids)
+{
+  guint16 pid = GST_READ_UINT16_BE (data + 1) & 0x1FFF;
+
+  if (MPEGTS_BIT_IS_SET (pes_pids, pid) || MPEGTS_BIT_IS_SET (psi_pids, pid))
+    return TRUE;
+
+  return FLAGS_HAS_AFC (data[3]) && data[4] > 0
+      && (data[5] & MPEGTS_AFC_PCR_FLAG);
+}
+
+static inline MpegTSPacketizerPacketReturn
+mpegts_packetizer_next_packet_internal (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacket * packet, const guint8 * pes_pids,
+    const guint8 * psi_pids)
 {
   guint8 *packet_data;
   guint packet_size;
@@ -846,6 +874,24 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
 
     packet_data = &packetizer->map_data[packetizer->map_offset + sync_offset];
 
+    /* Skip over all unwanted packets of the mapped area in one go, without
+     * doing any per-packet parsing or bookkeeping */
+    if (pes_pids) {
+      gsize remaining = packetizer->map_size - packetizer->map_offset;
+
+      while (remaining >= packet_size && *packet_data == PACKET_SYNC_BYTE &&
+          !mpegts_packetizer_packet_is_wanted (packet_data, pes_pids,
+              psi_pids)) {
+        packetizer->map_offset += packet_size;
+        packetizer->offset += packet_size;
+        packet_data += packet_size;
+        remaining -= packet_size;
+      }
+
+      if (remaining < packet_size)
+        continue;
+    }
+
     /* Check sync byte */
     if (G_UNLIKELY (*packet_data != PACKET_SYNC_BYTE)) {
       GST_DEBUG ("lost sync");
@@ -866,6 +912,28 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
   }
 }
 
+MpegTSPacketizerPacketReturn
+mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacket * packet)
+{
+  return mpegts_packetizer_next_packet_internal (packetizer, packet, NULL,
+      NULL);
+}
+
+/* Same as mpegts_packetizer_next_packet() but silently skips all packets
+ * whose PID is set in neither @pes_pids nor @psi_pids (bit arrays of 8192
+ * entries, see MPEGTS_BIT_IS_SET), unless they carry a PCR */
+MpegTSPacketizerPacketReturn
+mpegts_packetizer_next_packet_filtered (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacket * packet, const guint8 * pes_pids,
+    const guint8 * psi_pids)
+{
+  g_return_val_if_fail (pes_pids != NULL && psi_pids != NULL, PACKET_BAD);
+
+  return mpegts_packetizer_next_packet_internal (packetizer, packet, pes_pids,
+      psi_pids);
+}
+
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet (MpegTSPacketizer2 * packetizer)
 {
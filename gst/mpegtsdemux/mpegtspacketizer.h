@@ -345,6 +345,9 @@ G_GNUC_INTERNAL gboolean mpegts_packetizer_has_packets (MpegTSPacketizer2 *packe
 G_GNUC_INTERNAL MpegTSPacketizerPacketReturn mpegts_packetizer_next_packet (MpegTSPacketizer2 *packetizer,
   MpegTSPacketizerPacket *packet);
 G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
+mpegts_packetizer_next_packet_filtered (MpegTSPacketizer2 *packetizer,
+  MpegTSPacketizerPacket *packet, const guint8 *pes_pids, const guint8 *psi_pids);
+G_GNUC_INTERNAL MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
 G_GNUC_INTERNAL void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
 				     MpegTSPacketizerPacket *packet);
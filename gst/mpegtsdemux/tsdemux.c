@@ -70,8 +70,18 @@
  */
 #define SEEK_TIMESTAMP_OFFSET (2500 * GST_MSECOND)
 
+/* Minimum distance, at rate 1.0, between two keyframes output in
+ * key unit trick mode. Scaled by the absolute rate */
+#define TRICK_MODE_INTERVAL (100 * GST_MSECOND)
+
 #define GST_FLOW_REWINDING GST_FLOW_CUSTOM_ERROR
 
+/* PES buffers are pooled in power of two size classes, from 8 kB to 16 MB.
+ * Larger PES use plain memory */
+#define PES_POOL_MIN_SHIFT 13
+#define PES_POOL_MAX_SHIFT 24
+#define PES_POOL_N_CLASSES (PES_POOL_MAX_SHIFT - PES_POOL_MIN_SHIFT + 1)
+
 /* latency in nsecs */
 #define TS_LATENCY (700 * GST_MSECOND)
 
@@ -160,12 +170,22 @@ struct _TSDemuxStream
 
   /* Data being reconstructed (allocated) */
   guint8 *data;
+  /* Pooled buffer mapped at ->data, or NULL if ->data was g_malloc()'d */
+  GstBuffer *data_buffer;
+  GstMapInfo data_map;
+
+  /* Pools of PES buffers, one per size class, created on demand */
+  GstBufferPool *pools[PES_POOL_N_CLASSES];
 
   /* Size of data being reconstructed (if known, else 0) */
   guint expected_size;
 
   /* Amount of bytes in current ->data */
   guint current_size;
+  /* Offset of the packet which started the current PES */
+  guint64 pes_offset;
+  /* Whether that packet had the random access indicator set */
+  gboolean pes_rai;
   /* Size of ->data */
   guint allocated_size;
 
@@ -282,6 +302,7 @@ enum
   PROP_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_INDEX_LOCATION,
   /* FILL ME */
 };
 
@@ -324,6 +345,8 @@ static void gst_ts_demux_stream_flush (TSDemuxStream * stream,
 static gboolean push_event (MpegTSBase * base, GstEvent * event);
 static void gst_ts_demux_check_and_sync_streams (GstTSDemux * demux,
     GstClockTime time);
+static void calculate_and_push_newsegment (GstTSDemux * demux,
+    TSDemuxStream * stream, MpegTSBaseProgram * target_program);
 
 static void
 _extra_init (void)
@@ -348,6 +371,13 @@ gst_ts_demux_dispose (GObject * object)
 
   gst_flow_combiner_free (demux->flowcombiner);
 
+  if (demux->index) {
+    ts_demux_index_free (demux->index);
+    demux->index = NULL;
+  }
+  g_free (demux->index_location);
+  demux->index_location = NULL;
+
   GST_CALL_PARENT (G_OBJECT_CLASS, dispose, (object));
 }
 
@@ -373,6 +403,23 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstTSDemux:index-location:
+   *
+   * Sidecar file holding the keyframe index of the stream. It is read
+   * before the first seek and updated when going back to READY, so that
+   * seeks are fast from the start the next time the stream is played.
+   * The file records the size of the stream and a hash of its first and
+   * last packets, and is ignored if either changed; it is not used at all
+   * if upstream doesn't know the size or tsdemux isn't in pull mode.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index location",
+          "File to load the keyframe index from and save it to (NULL = none)",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   element_class = GST_ELEMENT_CLASS (klass);
   gst_element_class_add_pad_template (element_class,
       gst_static_pad_template_get (&video_template));
@@ -432,6 +479,31 @@ gst_ts_demux_reset (MpegTSBase * base)
 
   demux->last_seek_offset = -1;
   demux->program_generation = 0;
+
+  if (demux->index) {
+    gchar *location;
+
+    GST_OBJECT_LOCK (demux);
+    location = g_strdup (demux->index_location);
+    GST_OBJECT_UNLOCK (demux);
+
+    if (location && ts_demux_index_is_dirty (demux->index)
+        && ts_demux_index_has_stream (demux->index)) {
+      GError *err = NULL;
+
+      if (!ts_demux_index_save (demux->index, location, &err)) {
+        GST_WARNING_OBJECT (demux, "Failed to save index: %s", err->message);
+        g_clear_error (&err);
+      }
+    }
+    g_free (location);
+
+    ts_demux_index_clear (demux->index);
+  }
+  demux->index_pid = -1;
+  demux->index_loaded = FALSE;
+
+  demux->trick_pid = -1;
 }
 
 static void
@@ -447,6 +519,7 @@ gst_ts_demux_init (GstTSDemux * demux)
   demux->flowcombiner = gst_flow_combiner_new ();
   demux->requested_program_number = -1;
   demux->program_number = -1;
+  demux->index = ts_demux_index_new ();
   gst_ts_demux_reset (base);
 }
 
@@ -466,6 +539,12 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->index_location);
+      demux->index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -484,6 +563,11 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->index_location);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -624,6 +708,131 @@ clear_simple_buffer (SimpleBuffer * sbuf)
   sbuf->data = NULL;
 }
 
+/* PES payloads are reassembled in buffers from per-stream pools, one for
+ * each power of two size class, so a PES never takes more than twice its
+ * size whatever the largest PES on the stream was. Every PES of a known
+ * size is copied exactly once, without any reallocation, and its memory is
+ * recycled when downstream is done with it. Plain memory is used for PES
+ * above the largest class or if a pool can't provide a buffer. */
+static void
+gst_ts_demux_stream_free_data (TSDemuxStream * stream)
+{
+  if (stream->data_buffer) {
+    gst_buffer_unmap (stream->data_buffer, &stream->data_map);
+    gst_buffer_unref (stream->data_buffer);
+    stream->data_buffer = NULL;
+  } else {
+    g_free (stream->data);
+  }
+  stream->data = NULL;
+}
+
+static void
+gst_ts_demux_stream_clear_pools (TSDemuxStream * stream)
+{
+  guint i;
+
+  /* Outstanding buffers are freed once released */
+  for (i = 0; i < PES_POOL_N_CLASSES; i++) {
+    if (stream->pools[i]) {
+      gst_buffer_pool_set_active (stream->pools[i], FALSE);
+      gst_object_unref (stream->pools[i]);
+      stream->pools[i] = NULL;
+    }
+  }
+}
+
+static GstBuffer *
+gst_ts_demux_stream_acquire_buffer (TSDemuxStream * stream, guint size)
+{
+  GstBuffer *buffer = NULL;
+  GstBufferPool *pool;
+  guint shift;
+
+  shift = MAX (g_bit_storage (MAX (size, 1) - 1), PES_POOL_MIN_SHIFT);
+  if (shift > PES_POOL_MAX_SHIFT)
+    return NULL;
+
+  pool = stream->pools[shift - PES_POOL_MIN_SHIFT];
+  if (pool == NULL) {
+    GstStructure *config;
+    guint pool_size = 1 << shift;
+
+    pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, NULL, pool_size, 0, 0);
+    if (!gst_buffer_pool_set_config (pool, config) ||
+        !gst_buffer_pool_set_active (pool, TRUE)) {
+      GST_WARNING ("Failed to set up PES buffer pool of %u bytes", pool_size);
+      gst_object_unref (pool);
+      return NULL;
+    }
+    GST_DEBUG ("PES buffer pool of %u bytes for pid 0x%04x", pool_size,
+        ((MpegTSBaseStream *) stream)->pid);
+    stream->pools[shift - PES_POOL_MIN_SHIFT] = pool;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (pool, &buffer, NULL) != GST_FLOW_OK)
+    return NULL;
+
+  return buffer;
+}
+
+/* Make ->data point to at least @size bytes, keeping the first
+ * ->current_size bytes of the current data */
+static void
+gst_ts_demux_stream_alloc_data (TSDemuxStream * stream, guint size)
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint8 *data;
+
+  buffer = gst_ts_demux_stream_acquire_buffer (stream, size);
+  if (buffer && !gst_buffer_map (buffer, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref (buffer);
+    buffer = NULL;
+  }
+
+  if (buffer) {
+    data = map.data;
+    stream->allocated_size = map.size;
+  } else {
+    data = g_malloc (size);
+    stream->allocated_size = size;
+  }
+
+  if (stream->data) {
+    memcpy (data, stream->data, stream->current_size);
+    gst_ts_demux_stream_free_data (stream);
+  }
+
+  if (buffer)
+    stream->data_map = map;
+  stream->data_buffer = buffer;
+  stream->data = data;
+}
+
+/* Hand out the data between @offset and @offset + @size as a buffer */
+static GstBuffer *
+gst_ts_demux_stream_take_buffer (TSDemuxStream * stream, guint offset,
+    guint size)
+{
+  GstBuffer *buffer;
+
+  if (stream->data_buffer) {
+    buffer = stream->data_buffer;
+    gst_buffer_unmap (buffer, &stream->data_map);
+    gst_buffer_resize (buffer, offset, size);
+    stream->data_buffer = NULL;
+  } else {
+    buffer = gst_buffer_new_wrapped_full (0, stream->data,
+        stream->current_size, offset, size, stream->data, g_free);
+  }
+  stream->data = NULL;
+
+  return buffer;
+}
+
 static gboolean
 scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
     const gsize data_size, const gsize max_frame_offset)
@@ -765,7 +974,7 @@ scan_keyframe_h264 (TSDemuxStream * stream, const guint8 * data,
       clear_simple_buffer (&h264infos->framedata);
     }
 
-    g_free (stream->data);
+    gst_ts_demux_stream_free_data (stream);
     stream->current_size = gst_byte_writer_get_size (h264infos->sps);
     stream->data = gst_byte_writer_reset_and_get_data (h264infos->sps);
     gst_byte_writer_init (h264infos->sps);
@@ -815,6 +1024,320 @@ gst_ts_demux_adjust_seek_offset_for_keyframe (TSDemuxStream * stream,
   return TRUE;
 }
 
+static gboolean
+scan_keyframe_index (TSDemuxStream * stream, const guint8 * data,
+    const gsize data_size, const gsize max_frame_offset)
+{
+  return ts_demux_index_is_keyframe (((MpegTSBaseStream *) stream)->stream_type,
+      data, data_size);
+}
+
+/* Pull @size bytes at @offset and add them to the fingerprint */
+static gboolean
+gst_ts_demux_pull_fingerprint (GstTSDemux * demux, guint64 offset, guint size,
+    GstBuffer ** buffer, GstMapInfo * map)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+
+  *buffer = NULL;
+  if (gst_pad_pull_range (base->sinkpad, offset, size, buffer) != GST_FLOW_OK)
+    return FALSE;
+
+  if (!gst_buffer_map (*buffer, map, GST_MAP_READ)) {
+    gst_buffer_replace (buffer, NULL);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Identify the stream by its first and last bytes, which can only be read
+ * when driving the pipeline. In push mode no sidecar file is used */
+static void
+gst_ts_demux_set_index_fingerprint (GstTSDemux * demux, guint64 size)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  guint len = MIN (size, TS_DEMUX_INDEX_FINGERPRINT_SIZE);
+  GstBuffer *head, *tail;
+  GstMapInfo head_map, tail_map;
+
+  if (GST_PAD_MODE (base->sinkpad) != GST_PAD_MODE_PULL) {
+    GST_DEBUG_OBJECT (demux, "Not in pull mode, can't fingerprint the stream");
+    return;
+  }
+
+  if (!gst_ts_demux_pull_fingerprint (demux, 0, len, &head, &head_map))
+    goto failed;
+  if (!gst_ts_demux_pull_fingerprint (demux, size - len, len, &tail,
+          &tail_map)) {
+    gst_buffer_unmap (head, &head_map);
+    gst_buffer_unref (head);
+    goto failed;
+  }
+
+  ts_demux_index_set_stream_fingerprint (demux->index, head_map.data,
+      head_map.size, tail_map.data, tail_map.size);
+
+  gst_buffer_unmap (head, &head_map);
+  gst_buffer_unref (head);
+  gst_buffer_unmap (tail, &tail_map);
+  gst_buffer_unref (tail);
+  return;
+
+failed:
+  GST_WARNING_OBJECT (demux, "Could not read the stream to fingerprint it");
+}
+
+/* Read the sidecar index, the first time it is needed */
+static void
+gst_ts_demux_load_index (GstTSDemux * demux)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  gchar *location;
+  GError *err = NULL;
+  gint64 size;
+
+  if (demux->index_loaded)
+    return;
+  demux->index_loaded = TRUE;
+
+  /* The sidecar file is tied to the size and the fingerprint of the
+   * stream */
+  if (!gst_pad_peer_query_duration (base->sinkpad, GST_FORMAT_BYTES, &size)
+      || size <= 0)
+    size = 0;
+  ts_demux_index_set_stream_size (demux->index, size);
+  if (size > 0)
+    gst_ts_demux_set_index_fingerprint (demux, size);
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->index_location);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (location && !ts_demux_index_load (demux->index, location, &err)) {
+    /* Not an error, the file is created when going back to READY */
+    GST_INFO_OBJECT (demux, "No index loaded: %s", err->message);
+    g_clear_error (&err);
+  }
+  g_free (location);
+}
+
+/* Record the PES about to be pushed if it is a keyframe of the indexed
+ * stream, the first video stream the index supports */
+static void
+gst_ts_demux_index_pes (GstTSDemux * demux, TSDemuxStream * stream)
+{
+  MpegTSBaseStream *bs = (MpegTSBaseStream *) stream;
+
+  if (demux->index_pid == -1) {
+    if (!ts_demux_index_stream_is_supported (bs->stream_type))
+      return;
+    GST_DEBUG_OBJECT (demux, "Indexing keyframes of pid 0x%04x", bs->pid);
+    demux->index_pid = bs->pid;
+  } else if (demux->index_pid != bs->pid) {
+    return;
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID (stream->pts))
+    return;
+
+  if (ts_demux_index_is_keyframe (bs->stream_type, stream->data,
+          stream->current_size)) {
+    gst_ts_demux_load_index (demux);
+    ts_demux_index_add_entry (demux->index, stream->pes_offset, stream->pts);
+  }
+}
+
+/* The stream whose keyframes are output in trick mode: the indexed one,
+ * or else the first video stream whose keyframes we can detect */
+static TSDemuxStream *
+gst_ts_demux_find_trick_stream (GstTSDemux * demux)
+{
+  GList *tmp;
+
+  for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
+    MpegTSBaseStream *bs = (MpegTSBaseStream *) tmp->data;
+
+    if (demux->index_pid != -1 ? bs->pid == demux->index_pid :
+        ts_demux_index_stream_is_supported (bs->stream_type))
+      return (TSDemuxStream *) bs;
+  }
+
+  return NULL;
+}
+
+/* Jump to @offset to look for the next keyframe to output. If @exact,
+ * @offset is where the keyframe at the target starts */
+static GstFlowReturn
+gst_ts_demux_trick_mode_jump (GstTSDemux * demux, TSDemuxStream * stream,
+    guint64 offset, gboolean exact)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+
+  GST_DEBUG_OBJECT (demux, "Jumping to offset %" G_GUINT64_FORMAT
+      " for a keyframe %s %" GST_TIME_FORMAT, offset, exact ? "at" : "around",
+      GST_TIME_ARGS (demux->trick_target));
+
+  base->seek_offset = offset;
+  demux->trick_offset = offset;
+  demux->trick_exact = exact;
+  demux->trick_candidate_offset = -1;
+  mpegts_packetizer_flush (base->packetizer, FALSE);
+  base->mode = BASE_MODE_SEEKING;
+
+  stream->continuity_counter = CONTINUITY_UNSET;
+  return GST_FLOW_REWINDING;
+}
+
+/* Offset of the data @before ahead of @ts, estimated from the PCRs */
+static guint64
+gst_ts_demux_trick_mode_estimate (GstTSDemux * demux, GstClockTime ts,
+    GstClockTime before)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+
+  return mpegts_packetizer_ts_to_offset (base->packetizer,
+      ts > before ? ts - before : 0, demux->program->pcr_pid);
+}
+
+/* In reverse, we went past the target without finding a keyframe: jump
+ * back twice as far ahead of it */
+static GstFlowReturn
+gst_ts_demux_trick_mode_backoff (GstTSDemux * demux, TSDemuxStream * stream)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  guint64 offset;
+
+  if (demux->trick_offset == 0) {
+    GST_DEBUG_OBJECT (demux, "No keyframe before %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (demux->trick_target));
+    return GST_FLOW_EOS;
+  }
+
+  demux->trick_backoff *= 2;
+  offset = gst_ts_demux_trick_mode_estimate (demux, demux->trick_target,
+      demux->trick_backoff);
+  if (offset == -1 || offset >= demux->trick_offset) {
+    if (demux->trick_offset < 200 * base->packetsize)
+      offset = 0;
+    else
+      offset = demux->trick_offset - 200 * base->packetsize;
+  }
+
+  return gst_ts_demux_trick_mode_jump (demux, stream, offset, FALSE);
+}
+
+/* Whether the PES about to be pushed is the next keyframe to output in
+ * trick mode. If not, @res may be set to jump somewhere else.
+ *
+ * In reverse, the keyframe to output is the last one at or before the
+ * target. Unless the jump went straight to it, the keyframes are scanned
+ * until one goes past the target, and then the last one before is jumped
+ * back to */
+static gboolean
+gst_ts_demux_trick_mode_filter (GstTSDemux * demux, TSDemuxStream * stream,
+    GstFlowReturn * res)
+{
+  MpegTSBaseStream *bs = (MpegTSBaseStream *) stream;
+  gboolean keyframe;
+
+  if (!GST_CLOCK_TIME_IS_VALID (stream->pts))
+    return FALSE;
+
+  if (demux->rate < 0.0 && stream->pts > demux->trick_target) {
+    if (demux->trick_candidate_offset != -1) {
+      demux->trick_target = demux->trick_candidate_ts;
+      *res = gst_ts_demux_trick_mode_jump (demux, stream,
+          demux->trick_candidate_offset, TRUE);
+    } else {
+      *res = gst_ts_demux_trick_mode_backoff (demux, stream);
+    }
+    return FALSE;
+  }
+
+  keyframe = stream->pes_rai || ts_demux_index_is_keyframe (bs->stream_type,
+      stream->data, stream->current_size);
+  if (!keyframe)
+    return FALSE;
+
+  if (demux->rate > 0.0)
+    return stream->pts >= demux->trick_target;
+
+  if (demux->trick_exact && stream->pts == demux->trick_target)
+    return TRUE;
+
+  demux->trick_candidate_offset = stream->pes_offset;
+  demux->trick_candidate_ts = stream->pts;
+  return FALSE;
+}
+
+/* Called once the keyframe at @ts was pushed: keep the other streams
+ * going and go to the next keyframe to output */
+static GstFlowReturn
+gst_ts_demux_trick_mode_step (GstTSDemux * demux, TSDemuxStream * stream,
+    GstClockTime ts)
+{
+  MpegTSBase *base = (MpegTSBase *) demux;
+  GstClockTime interval = ABS (demux->rate) * TRICK_MODE_INTERVAL;
+  TSDemuxIndexEntry entry;
+  guint64 offset;
+  GList *tmp;
+
+  demux->trick_last_ts = ts;
+  stream->discont = TRUE;
+
+  for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
+    TSDemuxStream *ps = (TSDemuxStream *) tmp->data;
+
+    if (ps == stream || ps->pad == NULL)
+      continue;
+    if (G_UNLIKELY (ps->need_newsegment))
+      calculate_and_push_newsegment (demux, ps, NULL);
+    gst_pad_push_event (ps->pad, gst_event_new_gap (ts, 0));
+  }
+
+  if (demux->rate > 0.0) {
+    demux->trick_target = ts + interval;
+
+    if (ts_demux_index_lookup (demux->index, demux->trick_target, &entry)
+        && entry.ts > ts) {
+      demux->trick_target = entry.ts;
+      return gst_ts_demux_trick_mode_jump (demux, stream, entry.offset,
+          FALSE);
+    }
+
+    /* Skip the data in between if it is worth it, else read on. Without an
+     * index the target is located from the PCRs; landing a little ahead of
+     * it is enough since a later keyframe will do too, so the margin is a
+     * quarter of the interval rather than SEEK_TIMESTAMP_OFFSET, which
+     * would only let rates above 25x skip anything */
+    offset = gst_ts_demux_trick_mode_estimate (demux, demux->trick_target,
+        MIN (interval / 4, SEEK_TIMESTAMP_OFFSET));
+    if (offset != -1 && offset > base->seek_offset)
+      return gst_ts_demux_trick_mode_jump (demux, stream, offset, FALSE);
+    return GST_FLOW_OK;
+  }
+
+  if (ts <= demux->segment.start)
+    return GST_FLOW_EOS;
+
+  demux->trick_target = ts > demux->segment.start + interval ?
+      ts - interval : demux->segment.start;
+  demux->trick_backoff = SEEK_TIMESTAMP_OFFSET;
+
+  if (ts_demux_index_lookup (demux->index, demux->trick_target, &entry)
+      && entry.ts < ts) {
+    demux->trick_target = entry.ts;
+    return gst_ts_demux_trick_mode_jump (demux, stream, entry.offset, TRUE);
+  }
+
+  offset = gst_ts_demux_trick_mode_estimate (demux, demux->trick_target,
+      demux->trick_backoff);
+  if (offset == -1)
+    return GST_FLOW_EOS;
+  return gst_ts_demux_trick_mode_jump (demux, stream, offset, FALSE);
+}
+
 static GstFlowReturn
 gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
 {
@@ -826,8 +1349,12 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   GstFormat format;
   GstSeekFlags flags;
   GstSeekType start_type, stop_type;
-  gint64 start, stop;
+  gint64 start, stop, position;
   guint64 start_offset;
+  TSDemuxIndexEntry entry;
+  TSDemuxStream *trick_stream = NULL;
+  GstClockTime trick_target = GST_CLOCK_TIME_NONE;
+  gboolean trick_exact = FALSE;
 
   gst_event_parse_seek (event, &rate, &format, &flags, &start_type, &start,
       &stop_type, &stop);
@@ -836,8 +1363,8 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
       " stop: %" GST_TIME_FORMAT, rate, GST_TIME_ARGS (start),
       GST_TIME_ARGS (stop));
 
-  if (rate <= 0.0) {
-    GST_WARNING ("Negative rate not supported");
+  if (rate < 0.0 && base->mode == BASE_MODE_PUSHING) {
+    GST_WARNING ("Negative rate not supported in push mode");
     goto done;
   }
 
@@ -846,13 +1373,54 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
     goto done;
   }
 
+  /* Reverse playback and key unit trick mode only output the keyframes of
+   * a video stream, jumping from one to the next */
+  if (base->mode != BASE_MODE_PUSHING && (rate < 0.0
+          || (flags & GST_SEEK_FLAG_TRICKMODE_KEY_UNITS))) {
+    trick_stream = gst_ts_demux_find_trick_stream (demux);
+    if (trick_stream == NULL) {
+      GST_WARNING ("No video stream to do trick modes with");
+      goto done;
+    }
+  }
+
+  /* Reverse playback starts from the end of the segment */
+  if (rate < 0.0) {
+    if (stop_type == GST_SEEK_TYPE_NONE || stop == -1) {
+      GstClockTime duration;
+
+      if (!gst_ts_demux_get_duration (demux, &duration)) {
+        GST_WARNING ("Unknown duration, can't play backwards");
+        goto done;
+      }
+      stop_type = GST_SEEK_TYPE_SET;
+      stop = duration;
+    }
+    position = stop;
+  } else {
+    position = start_type != GST_SEEK_TYPE_NONE ? start : -1;
+  }
+
   /* configure the segment with the seek variables */
   GST_DEBUG_OBJECT (demux, "configuring seek");
 
-  if (start_type != GST_SEEK_TYPE_NONE) {
-    start_offset =
-        mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
-            start - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
+  if (position != -1) {
+    gst_ts_demux_load_index (demux);
+
+    /* Go straight to the keyframe if it is known, otherwise seek ahead of
+     * the position using the PCRs and look for a keyframe from there */
+    if (ts_demux_index_lookup (demux->index, MAX (0, position), &entry)) {
+      GST_DEBUG_OBJECT (demux, "Seeking to indexed keyframe at %"
+          GST_TIME_FORMAT, GST_TIME_ARGS (entry.ts));
+      start_offset = entry.offset;
+      trick_target = entry.ts;
+      trick_exact = TRUE;
+    } else {
+      start_offset =
+          mpegts_packetizer_ts_to_offset (base->packetizer, MAX (0,
+              position - SEEK_TIMESTAMP_OFFSET), demux->program->pcr_pid);
+      trick_target = MAX (0, position);
+    }
 
     if (G_UNLIKELY (start_offset == -1)) {
       GST_WARNING ("Couldn't convert start position to an offset");
@@ -870,6 +1438,7 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
       demux->segment_event = NULL;
     }
     demux->rate = rate;
+    demux->trick_pid = -1;
     res = GST_FLOW_OK;
     goto done;
   }
@@ -882,8 +1451,25 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
 
   gst_segment_do_seek (&demux->segment, rate, format, flags, start_type,
       start, stop_type, stop, NULL);
-  /* Reset segment if we're not doing an accurate seek */
-  demux->reset_segment = (!(flags & GST_SEEK_FLAG_ACCURATE));
+  /* Reset segment if we're not doing an accurate seek, the trick modes
+   * need the configured one (rate, stop and flags) */
+  demux->reset_segment = (!(flags & GST_SEEK_FLAG_ACCURATE))
+      && trick_stream == NULL;
+
+  if (trick_stream) {
+    GST_DEBUG_OBJECT (demux, "Trick mode on pid 0x%04x from %"
+        GST_TIME_FORMAT, ((MpegTSBaseStream *) trick_stream)->pid,
+        GST_TIME_ARGS (trick_target));
+    demux->trick_pid = ((MpegTSBaseStream *) trick_stream)->pid;
+    demux->trick_target = trick_target;
+    demux->trick_last_ts = GST_CLOCK_TIME_NONE;
+    demux->trick_backoff = SEEK_TIMESTAMP_OFFSET;
+    demux->trick_offset = start_offset;
+    demux->trick_exact = trick_exact;
+    demux->trick_candidate_offset = -1;
+  } else {
+    demux->trick_pid = -1;
+  }
 
   if (demux->segment_event) {
     gst_event_unref (demux->segment_event);
@@ -893,7 +1479,7 @@ gst_ts_demux_do_seek (MpegTSBase * base, GstEvent * event)
   for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
     TSDemuxStream *stream = tmp->data;
 
-    if (flags & GST_SEEK_FLAG_ACCURATE)
+    if ((flags & GST_SEEK_FLAG_ACCURATE) && trick_stream == NULL)
       stream->needs_keyframe = TRUE;
 
     stream->seeked_pts = GST_CLOCK_TIME_NONE;
@@ -1745,6 +2331,10 @@ gst_ts_demux_stream_added (MpegTSBase * base, MpegTSBaseStream * bstream,
         && bstream->stream_type == GST_MPEGTS_STREAM_TYPE_VIDEO_H264) {
       stream->scan_function =
           (GstTsDemuxKeyFrameScanFunction) scan_keyframe_h264;
+    } else if (base->mode != BASE_MODE_PUSHING
+        && ts_demux_index_stream_is_supported (bstream->stream_type)) {
+      stream->scan_function =
+          (GstTsDemuxKeyFrameScanFunction) scan_keyframe_index;
     } else {
       stream->scan_function = NULL;
     }
@@ -1816,6 +2406,7 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
   }
 
   gst_ts_demux_stream_flush (stream, GST_TS_DEMUX_CAST (base), TRUE);
+  gst_ts_demux_stream_clear_pools (stream);
 
   if (stream->taglist != NULL) {
     gst_tag_list_unref (stream->taglist);
@@ -1848,8 +2439,7 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream, GstTSDemux * tsdemux,
 {
   GST_DEBUG ("flushing stream %p", stream);
 
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_free_data (stream);
   stream->state = PENDING_PACKET_EMPTY;
   stream->expected_size = 0;
   stream->allocated_size = 0;
@@ -2260,6 +2850,7 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
     goto discont;
   }
 
+  stream->pes_offset = bufferoffset;
   gst_ts_demux_record_dts (demux, stream, header.DTS, bufferoffset);
   gst_ts_demux_record_pts (demux, stream, header.PTS, bufferoffset);
   if (G_UNLIKELY (stream->pending_ts &&
@@ -2295,13 +2886,13 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   length -= header.header_size;
 
   /* Create the output buffer */
+  g_assert (stream->data == NULL);
+  stream->current_size = 0;
   if (stream->expected_size)
-    stream->allocated_size = MAX (stream->expected_size, length);
+    gst_ts_demux_stream_alloc_data (stream, MAX (stream->expected_size,
+            length));
   else
-    stream->allocated_size = MAX (8192, length);
-
-  g_assert (stream->data == NULL);
-  stream->data = g_malloc (stream->allocated_size);
+    gst_ts_demux_stream_alloc_data (stream, MAX (8192, length));
   memcpy (stream->data, data, length);
   stream->current_size = length;
 
@@ -2351,6 +2942,8 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     } else {
       GST_LOG ("EMPTY=>HEADER");
       stream->state = PENDING_PACKET_HEADER;
+      stream->pes_rai =
+          (packet->afc_flags & MPEGTS_AFC_RANDOM_ACCES_FLAGS) != 0;
     }
   }
 
@@ -2367,11 +2960,13 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     {
       GST_LOG ("BUFFER: appending data");
       if (G_UNLIKELY (stream->current_size + size > stream->allocated_size)) {
+        guint allocated_size = stream->allocated_size;
+
         GST_LOG ("resizing buffer");
         do {
-          stream->allocated_size *= 2;
-        } while (stream->current_size + size > stream->allocated_size);
-        stream->data = g_realloc (stream->data, stream->allocated_size);
+          allocated_size *= 2;
+        } while (stream->current_size + size > allocated_size);
+        gst_ts_demux_stream_alloc_data (stream, allocated_size);
       }
       memcpy (stream->data + stream->current_size, data, size);
       stream->current_size += size;
@@ -2380,10 +2975,8 @@ gst_ts_demux_queue_data (GstTSDemux * demux, TSDemuxStream * stream,
     case PENDING_PACKET_DISCONT:
     {
       GST_LOG ("DISCONT: not storing/pushing");
-      if (G_UNLIKELY (stream->data)) {
-        g_free (stream->data);
-        stream->data = NULL;
-      }
+      if (G_UNLIKELY (stream->data))
+        gst_ts_demux_stream_free_data (stream);
       stream->continuity_counter = CONTINUITY_UNSET;
       break;
     }
@@ -2627,8 +3220,7 @@ parse_opus_access_unit (TSDemuxStream * stream)
     gst_buffer_list_add (buffer_list, buffer);
   } while (gst_byte_reader_get_remaining (&reader) > 0);
 
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_free_data (stream);
   stream->current_size = 0;
 
   return buffer_list;
@@ -2636,8 +3228,7 @@ parse_opus_access_unit (TSDemuxStream * stream)
 error:
   {
     GST_ERROR ("Failed to parse Opus access unit");
-    g_free (stream->data);
-    stream->data = NULL;
+    gst_ts_demux_stream_free_data (stream);
     stream->current_size = 0;
     if (buffer_list)
       gst_buffer_list_unref (buffer_list);
@@ -2776,17 +3367,14 @@ parse_jp2k_access_unit (TSDemuxStream * stream)
     goto error;
   }
 
-  retbuf = gst_buffer_new_wrapped_full (0, stream->data, stream->current_size,
-      data_location, stream->current_size - data_location,
-      stream->data, g_free);
-  stream->data = NULL;
+  retbuf = gst_ts_demux_stream_take_buffer (stream, data_location,
+      stream->current_size - data_location);
   stream->current_size = 0;
   return retbuf;
 
 error:
   GST_ERROR ("Failed to parse JP2K access unit");
-  g_free (stream->data);
-  stream->data = NULL;
+  gst_ts_demux_stream_free_data (stream);
   stream->current_size = 0;
   return NULL;
 }
@@ -2799,6 +3387,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
   MpegTSBaseStream *bs = (MpegTSBaseStream *) stream;
   GstBuffer *buffer = NULL;
   GstBufferList *buffer_list = NULL;
+  gboolean trick_keyframe = FALSE;
 
 
   GST_DEBUG_OBJECT (stream->pad,
@@ -2822,10 +3411,17 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
   if (G_UNLIKELY (demux->program == NULL)) {
     GST_LOG_OBJECT (demux, "No program");
-    g_free (stream->data);
     goto beach;
   }
 
+  gst_ts_demux_index_pes (demux, stream);
+
+  if (G_UNLIKELY (demux->trick_pid == bs->pid)) {
+    if (!gst_ts_demux_trick_mode_filter (demux, stream, &res))
+      goto beach;
+    trick_keyframe = TRUE;
+  }
+
   if (stream->needs_keyframe) {
     MpegTSBase *base = (MpegTSBase *) demux;
 
@@ -2855,7 +3451,8 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
           goto beach;
         }
       } else {
-        buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+        buffer = gst_ts_demux_stream_take_buffer (stream, 0,
+            stream->current_size);
       }
 
       stream->seeked_pts = stream->pts;
@@ -2871,7 +3468,6 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
 
       stream->continuity_counter = CONTINUITY_UNSET;
       res = GST_FLOW_REWINDING;
-      g_free (stream->data);
       goto beach;
     }
   } else {
@@ -2895,7 +3491,8 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
         goto beach;
       }
     } else {
-      buffer = gst_buffer_new_wrapped (stream->data, stream->current_size);
+      buffer = gst_ts_demux_stream_take_buffer (stream, 0,
+          stream->current_size);
     }
 
     if (G_UNLIKELY (stream->pending_ts && !check_pending_buffers (demux))) {
@@ -3011,6 +3608,11 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream,
   res = gst_flow_combiner_update_flow (demux->flowcombiner, res);
   GST_DEBUG_OBJECT (stream->pad, "combined %s", gst_flow_get_name (res));
 
+  /* The other streams are not read in trick mode, they get gaps from
+   * gst_ts_demux_trick_mode_step() */
+  if (G_UNLIKELY (demux->trick_pid != -1))
+    goto beach;
+
   /* GAP / sparse stream tracking */
   if (G_UNLIKELY (stream->gap_ref_pts == GST_CLOCK_TIME_NONE))
     stream->gap_ref_pts = stream->pts;
@@ -3040,10 +3642,14 @@ beach:
   /* Reset everything */
   GST_LOG ("Resetting to EMPTY, returning %s", gst_flow_get_name (res));
   stream->state = PENDING_PACKET_EMPTY;
-  stream->data = NULL;
+  if (stream->data)
+    gst_ts_demux_stream_free_data (stream);
   stream->expected_size = 0;
   stream->current_size = 0;
 
+  if (G_UNLIKELY (trick_keyframe) && res == GST_FLOW_OK)
+    res = gst_ts_demux_trick_mode_step (demux, stream, stream->pts);
+
   return res;
 }
 
@@ -3057,6 +3663,11 @@ gst_ts_demux_handle_packet (GstTSDemux * demux, TSDemuxStream * stream,
       packet->payload_unit_start_indicator, packet->scram_afc_cc & 0x30,
       FLAGS_CONTINUITY_COUNTER (packet->scram_afc_cc), packet->payload);
 
+  /* Only the keyframes of one stream are read in trick mode */
+  if (G_UNLIKELY (demux->trick_pid != -1 &&
+          stream->stream.pid != demux->trick_pid))
+    return res;
+
   if (G_UNLIKELY (packet->payload_unit_start_indicator) &&
       FLAGS_HAS_PAYLOAD (packet->scram_afc_cc))
     /* Flush previous data */
@@ -3124,6 +3735,22 @@ gst_ts_demux_drain (MpegTSBase * base)
     }
   }
 
+  /* In reverse trick mode, the data ran out before going past the target:
+   * the last keyframe seen is the one to output */
+  if (res == GST_FLOW_OK && demux->trick_pid != -1 && demux->rate < 0.0 &&
+      demux->trick_candidate_offset != -1) {
+    TSDemuxStream *stream =
+        (TSDemuxStream *) demux->program->streams[demux->trick_pid];
+
+    demux->trick_target = demux->trick_candidate_ts;
+    res = gst_ts_demux_trick_mode_jump (demux, stream,
+        demux->trick_candidate_offset, TRUE);
+  }
+
+  /* Jumps only need the reading to go on */
+  if (res == GST_FLOW_REWINDING)
+    res = GST_FLOW_OK;
+
   return res;
 }
 
@@ -3151,6 +3778,7 @@ gst_ts_demux_plugin_init (GstPlugin * plugin)
   GST_DEBUG_CATEGORY_INIT (ts_demux_debug, "tsdemux", 0,
       "MPEG transport stream demuxer");
   init_pes_parser ();
+  init_ts_demux_index ();
 
   return gst_element_register (plugin, "tsdemux",
       GST_RANK_PRIMARY, GST_TYPE_TS_DEMUX);
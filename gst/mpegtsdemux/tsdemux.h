@@ -32,6 +32,7 @@
 #include <gst/base/gstflowcombiner.h>
 #include "mpegtsbase.h"
 #include "mpegtspacketizer.h"
+#include "tsdemuxindex.h"
 
 /* color specifications for JPEG 2000 stream over MPEG TS */
 typedef enum
@@ -76,6 +77,7 @@ struct _GstTSDemux
   gint requested_program_number; /* Required program number (ignore:-1) */
   guint program_number;
   gboolean emit_statistics;
+  gchar *index_location;
 
   /*< private >*/
   gint program_generation; /* Incremented each time we switch program 0..15 */
@@ -101,6 +103,28 @@ struct _GstTSDemux
 
   /* Used when seeking for a keyframe to go backward in the stream */
   guint64 last_seek_offset;
+
+  /* Keyframes of the first video stream, and whether the sidecar file
+   * was read into it */
+  TSDemuxIndex *index;
+  gint index_pid;
+  gboolean index_loaded;
+
+  /* Key unit trick mode: pid of the only stream read (-1 if disabled),
+   * timestamp the next keyframe should be at or after (at or before in
+   * reverse), last keyframe pushed, how far ahead of the target the last
+   * reverse jump went, and the offset it went to */
+  gint trick_pid;
+  GstClockTime trick_target;
+  GstClockTime trick_last_ts;
+  GstClockTime trick_backoff;
+  guint64 trick_offset;
+  /* In reverse: whether the jump went straight to the keyframe at the
+   * target, else the offset and timestamp of the last keyframe at or
+   * before the target seen since (-1 if none) */
+  gboolean trick_exact;
+  guint64 trick_candidate_offset;
+  GstClockTime trick_candidate_ts;
 };
 
 struct _GstTSDemuxClass
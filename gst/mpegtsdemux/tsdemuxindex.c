@@ -0,0 +1,504 @@
+/*
+ * tsdemuxindex.c : keyframe index for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gst/mpegts/mpegts.h>
+
+#include "tsdemuxindex.h"
+
+GST_DEBUG_CATEGORY_STATIC (ts_demux_index_debug);
+#define GST_CAT_DEFAULT ts_demux_index_debug
+
+/* Sidecar file layout, all values big endian:
+ *   "TSDI"                  4 bytes
+ *   version                 32 bits
+ *   size of the stream      64 bits
+ *   fingerprint             20 bytes, SHA-1 of the start and end of the stream
+ *   number of entries       32 bits
+ *   entries                 n * (offset 64 bits, PTS in ns 64 bits)
+ */
+#define TS_DEMUX_INDEX_MAGIC "TSDI"
+#define TS_DEMUX_INDEX_VERSION 3
+#define TS_DEMUX_INDEX_DIGEST_SIZE 20
+#define TS_DEMUX_INDEX_HEADER_SIZE (20 + TS_DEMUX_INDEX_DIGEST_SIZE)
+#define TS_DEMUX_INDEX_ENTRY_SIZE 16
+
+/* Keyframes are recognised from the headers at the start of the PES, no need
+ * to look through the whole picture */
+#define TS_DEMUX_INDEX_SCAN_SIZE 4096
+
+struct _TSDemuxIndex
+{
+  /* TSDemuxIndexEntry, ordered by both offset and timestamp */
+  GArray *entries;
+  /* entries were added since the index was loaded or saved */
+  gboolean dirty;
+  /* size in bytes of the indexed stream, 0 if unknown */
+  guint64 stream_size;
+  /* SHA-1 of the first and last bytes of the stream, if known */
+  gboolean have_fingerprint;
+  guint8 fingerprint[TS_DEMUX_INDEX_DIGEST_SIZE];
+};
+
+TSDemuxIndex *
+ts_demux_index_new (void)
+{
+  TSDemuxIndex *index = g_slice_new0 (TSDemuxIndex);
+
+  index->entries = g_array_new (FALSE, FALSE, sizeof (TSDemuxIndexEntry));
+
+  return index;
+}
+
+void
+ts_demux_index_free (TSDemuxIndex * index)
+{
+  g_array_free (index->entries, TRUE);
+  g_slice_free (TSDemuxIndex, index);
+}
+
+void
+ts_demux_index_clear (TSDemuxIndex * index)
+{
+  g_array_set_size (index->entries, 0);
+  index->dirty = FALSE;
+  index->stream_size = 0;
+  index->have_fingerprint = FALSE;
+}
+
+/**
+ * ts_demux_index_set_stream_size:
+ * @index: a #TSDemuxIndex
+ * @size: size in bytes of the indexed stream, or 0 if unknown
+ *
+ * The size is stored in the sidecar file, and a sidecar file made for a
+ * stream of another size is not loaded: the offsets it holds would point
+ * anywhere. Without a size, the sidecar file is neither loaded nor saved.
+ */
+void
+ts_demux_index_set_stream_size (TSDemuxIndex * index, guint64 size)
+{
+  index->stream_size = size;
+}
+
+guint64
+ts_demux_index_get_stream_size (TSDemuxIndex * index)
+{
+  return index->stream_size;
+}
+
+/**
+ * ts_demux_index_set_stream_fingerprint:
+ * @index: a #TSDemuxIndex
+ * @head: the first bytes of the stream
+ * @head_size: the size of @head
+ * @tail: the last bytes of the stream
+ * @tail_size: the size of @tail
+ *
+ * Identify the indexed stream by its first and last bytes, usually
+ * %TS_DEMUX_INDEX_FINGERPRINT_SIZE of each, on top of its size. A stream
+ * rewritten in place, or remuxed to the same size, is then told apart
+ * from the one the sidecar file was made for. Like the size, the
+ * fingerprint is needed for the sidecar file to be loaded or saved.
+ */
+void
+ts_demux_index_set_stream_fingerprint (TSDemuxIndex * index,
+    const guint8 * head, gsize head_size, const guint8 * tail, gsize tail_size)
+{
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  gsize digest_size = TS_DEMUX_INDEX_DIGEST_SIZE;
+
+  g_checksum_update (checksum, head, head_size);
+  g_checksum_update (checksum, tail, tail_size);
+  g_checksum_get_digest (checksum, index->fingerprint, &digest_size);
+  g_checksum_free (checksum);
+
+  index->have_fingerprint = TRUE;
+}
+
+/* Whether the stream is known well enough to load or save the sidecar
+ * file */
+gboolean
+ts_demux_index_has_stream (TSDemuxIndex * index)
+{
+  return index->stream_size > 0 && index->have_fingerprint;
+}
+
+guint
+ts_demux_index_get_n_entries (TSDemuxIndex * index)
+{
+  return index->entries->len;
+}
+
+gboolean
+ts_demux_index_is_dirty (TSDemuxIndex * index)
+{
+  return index->dirty;
+}
+
+/* Returns the position of the first entry at or after @offset */
+static guint
+ts_demux_index_find_offset (TSDemuxIndex * index, guint64 offset)
+{
+  TSDemuxIndexEntry *entries = (TSDemuxIndexEntry *) index->entries->data;
+  guint low = 0, high = index->entries->len;
+
+  while (low < high) {
+    guint mid = low + (high - low) / 2;
+
+    if (entries[mid].offset < offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  return low;
+}
+
+/**
+ * ts_demux_index_add_entry:
+ * @index: a #TSDemuxIndex
+ * @offset: offset of the first packet of a keyframe PES
+ * @ts: PTS of that keyframe, in stream time
+ *
+ * Record a keyframe. Keyframes are usually added in playback order, but
+ * after a seek they may land anywhere in the index. An entry whose
+ * timestamp doesn't fit between its neighbours (a PCR discontinuity)
+ * is dropped, so that the index can be searched by offset and by
+ * timestamp.
+ */
+void
+ts_demux_index_add_entry (TSDemuxIndex * index, guint64 offset,
+    GstClockTime ts)
+{
+  TSDemuxIndexEntry *entries = (TSDemuxIndexEntry *) index->entries->data;
+  TSDemuxIndexEntry entry = { offset, ts };
+  guint len = index->entries->len;
+  guint pos;
+
+  g_return_if_fail (GST_CLOCK_TIME_IS_VALID (ts));
+
+  /* Fast path, playing forward */
+  if (len == 0 || entries[len - 1].offset < offset) {
+    pos = len;
+  } else {
+    pos = ts_demux_index_find_offset (index, offset);
+    if (entries[pos].offset == offset)
+      return;
+  }
+
+  if ((pos > 0 && entries[pos - 1].ts >= ts) ||
+      (pos < len && entries[pos].ts <= ts)) {
+    GST_DEBUG ("Keyframe at offset %" G_GUINT64_FORMAT " ts %" GST_TIME_FORMAT
+        " is out of order, not indexing it", offset, GST_TIME_ARGS (ts));
+    return;
+  }
+
+  GST_LOG ("Keyframe at offset %" G_GUINT64_FORMAT " ts %" GST_TIME_FORMAT,
+      offset, GST_TIME_ARGS (ts));
+  g_array_insert_val (index->entries, pos, entry);
+  index->dirty = TRUE;
+}
+
+/**
+ * ts_demux_index_lookup:
+ * @index: a #TSDemuxIndex
+ * @ts: a timestamp, in stream time
+ * @entry: (out): the keyframe to start from
+ *
+ * Find the last keyframe at or before @ts. This only succeeds if the
+ * index also knows the keyframe following it, less than
+ * %TS_DEMUX_INDEX_MAX_GAP later, so that no closer keyframe can have been
+ * missed.
+ *
+ * Returns: %TRUE if @entry was filled
+ */
+gboolean
+ts_demux_index_lookup (TSDemuxIndex * index, GstClockTime ts,
+    TSDemuxIndexEntry * entry)
+{
+  TSDemuxIndexEntry *entries = (TSDemuxIndexEntry *) index->entries->data;
+  guint low = 0, high = index->entries->len;
+
+  /* first entry after ts */
+  while (low < high) {
+    guint mid = low + (high - low) / 2;
+
+    if (entries[mid].ts <= ts)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  if (low == 0 || low == index->entries->len)
+    return FALSE;
+
+  if (entries[low].ts - entries[low - 1].ts > TS_DEMUX_INDEX_MAX_GAP)
+    return FALSE;
+
+  *entry = entries[low - 1];
+
+  GST_DEBUG ("ts %" GST_TIME_FORMAT " => keyframe at offset %" G_GUINT64_FORMAT
+      " ts %" GST_TIME_FORMAT, GST_TIME_ARGS (ts), entry->offset,
+      GST_TIME_ARGS (entry->ts));
+
+  return TRUE;
+}
+
+/**
+ * ts_demux_index_load:
+ * @index: a #TSDemuxIndex
+ * @location: the sidecar file to read
+ * @error: return location for a #GError
+ *
+ * Merge the entries of a sidecar file previously written by
+ * ts_demux_index_save() into @index. The file is rejected if it was
+ * written for a stream of another size or fingerprint.
+ *
+ * Returns: %TRUE if the file could be read
+ */
+gboolean
+ts_demux_index_load (TSDemuxIndex * index, const gchar * location,
+    GError ** error)
+{
+  gboolean was_dirty = index->dirty;
+  gchar *contents;
+  gsize size;
+  const guint8 *data;
+  guint32 i, n_entries;
+  guint64 stream_size;
+
+  if (!ts_demux_index_has_stream (index)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "size or fingerprint of the stream is unknown");
+    return FALSE;
+  }
+
+  if (!g_file_get_contents (location, &contents, &size, error))
+    return FALSE;
+
+  data = (const guint8 *) contents;
+  if (size < TS_DEMUX_INDEX_HEADER_SIZE ||
+      memcmp (data, TS_DEMUX_INDEX_MAGIC, 4) != 0 ||
+      GST_READ_UINT32_BE (data + 4) != TS_DEMUX_INDEX_VERSION)
+    goto invalid;
+
+  stream_size = GST_READ_UINT64_BE (data + 8);
+  if (stream_size != index->stream_size) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "%s was made for a stream of %" G_GUINT64_FORMAT " bytes, not %"
+        G_GUINT64_FORMAT, location, stream_size, index->stream_size);
+    g_free (contents);
+    return FALSE;
+  }
+
+  if (memcmp (data + 16, index->fingerprint, TS_DEMUX_INDEX_DIGEST_SIZE)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "%s was made for another stream of the same size", location);
+    g_free (contents);
+    return FALSE;
+  }
+
+  n_entries = GST_READ_UINT32_BE (data + 16 + TS_DEMUX_INDEX_DIGEST_SIZE);
+  if ((size - TS_DEMUX_INDEX_HEADER_SIZE) / TS_DEMUX_INDEX_ENTRY_SIZE <
+      n_entries)
+    goto invalid;
+
+  data += TS_DEMUX_INDEX_HEADER_SIZE;
+  for (i = 0; i < n_entries; i++) {
+    guint64 offset = GST_READ_UINT64_BE (data);
+    GstClockTime ts = GST_READ_UINT64_BE (data + 8);
+
+    if (GST_CLOCK_TIME_IS_VALID (ts))
+      ts_demux_index_add_entry (index, offset, ts);
+    data += TS_DEMUX_INDEX_ENTRY_SIZE;
+  }
+  g_free (contents);
+
+  /* Only entries that aren't in the file make it dirty */
+  index->dirty = was_dirty;
+
+  GST_DEBUG ("Loaded %u keyframes from %s", n_entries, location);
+
+  return TRUE;
+
+invalid:
+  g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+      "%s is not a transport stream index", location);
+  g_free (contents);
+  return FALSE;
+}
+
+/**
+ * ts_demux_index_save:
+ * @index: a #TSDemuxIndex
+ * @location: the sidecar file to write
+ * @error: return location for a #GError
+ *
+ * Atomically replace @location with the contents of @index.
+ *
+ * Returns: %TRUE if the file could be written
+ */
+gboolean
+ts_demux_index_save (TSDemuxIndex * index, const gchar * location,
+    GError ** error)
+{
+  TSDemuxIndexEntry *entries = (TSDemuxIndexEntry *) index->entries->data;
+  guint len = index->entries->len;
+  gsize size = TS_DEMUX_INDEX_HEADER_SIZE + len * TS_DEMUX_INDEX_ENTRY_SIZE;
+  guint8 *contents, *data;
+  gboolean ret;
+  guint i;
+
+  if (!ts_demux_index_has_stream (index)) {
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+        "size or fingerprint of the stream is unknown");
+    return FALSE;
+  }
+
+  data = contents = g_malloc (size);
+  memcpy (data, TS_DEMUX_INDEX_MAGIC, 4);
+  GST_WRITE_UINT32_BE (data + 4, TS_DEMUX_INDEX_VERSION);
+  GST_WRITE_UINT64_BE (data + 8, index->stream_size);
+  memcpy (data + 16, index->fingerprint, TS_DEMUX_INDEX_DIGEST_SIZE);
+  GST_WRITE_UINT32_BE (data + 16 + TS_DEMUX_INDEX_DIGEST_SIZE, len);
+  data += TS_DEMUX_INDEX_HEADER_SIZE;
+
+  for (i = 0; i < len; i++) {
+    GST_WRITE_UINT64_BE (data, entries[i].offset);
+    GST_WRITE_UINT64_BE (data + 8, entries[i].ts);
+    data += TS_DEMUX_INDEX_ENTRY_SIZE;
+  }
+
+  ret = g_file_set_contents (location, (const gchar *) contents, size, error);
+  g_free (contents);
+
+  if (ret) {
+    GST_DEBUG ("Saved %u keyframes to %s", len, location);
+    index->dirty = FALSE;
+  }
+
+  return ret;
+}
+
+gboolean
+ts_demux_index_stream_is_supported (guint8 stream_type)
+{
+  switch (stream_type) {
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_H264:
+    case GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+/* Returns a pointer to the byte following the next 0x000001 start code at or
+ * after @data, or NULL */
+static const guint8 *
+ts_demux_index_next_start_code (const guint8 * data, const guint8 * end)
+{
+  const guint8 *p = data + 2;
+
+  while (p < end) {
+    p = memchr (p, 0x01, end - p);
+    if (p == NULL)
+      return NULL;
+    if (p[-1] == 0x00 && p[-2] == 0x00)
+      return p + 1;
+    p++;
+  }
+
+  return NULL;
+}
+
+/**
+ * ts_demux_index_is_keyframe:
+ * @stream_type: the stream type of the PES
+ * @data: the payload of the PES
+ * @size: the size of @data
+ *
+ * Check whether a video PES starts a picture decoding can start from: an
+ * IDR picture in H.264, an IRAP picture in H.265, and an I picture or a
+ * sequence header in MPEG-1/2 video.
+ *
+ * Returns: %TRUE if the PES holds a keyframe
+ */
+gboolean
+ts_demux_index_is_keyframe (guint8 stream_type, const guint8 * data,
+    gsize size)
+{
+  const guint8 *end = data + MIN (size, TS_DEMUX_INDEX_SCAN_SIZE);
+  const guint8 *p = data;
+
+  /* one byte of header after the start code, two for MPEG pictures */
+  while ((p = ts_demux_index_next_start_code (p, end)) && end - p >= 2) {
+    guint type;
+
+    switch (stream_type) {
+      case GST_MPEGTS_STREAM_TYPE_VIDEO_H264:
+        type = p[0] & 0x1f;
+        if (type == 5)
+          return TRUE;
+        /* non-IDR slice */
+        if (type == 1)
+          return FALSE;
+        break;
+      case GST_MPEGTS_STREAM_TYPE_VIDEO_HEVC:
+        type = (p[0] >> 1) & 0x3f;
+        /* BLA, IDR and CRA */
+        if (type >= 16 && type <= 21)
+          return TRUE;
+        /* other slices */
+        if (type < 16)
+          return FALSE;
+        break;
+      case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG1:
+      case GST_MPEGTS_STREAM_TYPE_VIDEO_MPEG2:
+        /* sequence header or GOP header */
+        if (p[0] == 0xb3 || p[0] == 0xb8)
+          return TRUE;
+        /* picture header: 10 bits temporal_reference, 3 bits type */
+        if (p[0] == 0x00) {
+          if (end - p < 3)
+            return FALSE;
+          return ((p[2] >> 3) & 0x07) == 1;
+        }
+        break;
+      default:
+        return FALSE;
+    }
+  }
+
+  return FALSE;
+}
+
+void
+init_ts_demux_index (void)
+{
+  GST_DEBUG_CATEGORY_INIT (ts_demux_index_debug, "tsdemuxindex", 0,
+      "MPEG transport stream demuxer keyframe index");
+}
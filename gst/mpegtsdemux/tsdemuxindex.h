@@ -0,0 +1,82 @@
+/*
+ * tsdemuxindex.h : keyframe index for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __TS_DEMUX_INDEX_H__
+#define __TS_DEMUX_INDEX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Maximum distance between two keyframes of the index for the index to be
+ * trusted in between them. Larger gaps are regions which weren't indexed */
+#define TS_DEMUX_INDEX_MAX_GAP (10 * GST_SECOND)
+
+/* Number of bytes at the start and at the end of the stream its
+ * fingerprint is computed from */
+#define TS_DEMUX_INDEX_FINGERPRINT_SIZE (188 * 32)
+
+typedef struct _TSDemuxIndex TSDemuxIndex;
+
+typedef struct _TSDemuxIndexEntry
+{
+  /* offset of the first packet of the keyframe PES */
+  guint64 offset;
+  /* PTS of the keyframe, in stream time */
+  GstClockTime ts;
+} TSDemuxIndexEntry;
+
+G_GNUC_INTERNAL TSDemuxIndex *ts_demux_index_new (void);
+G_GNUC_INTERNAL void ts_demux_index_free (TSDemuxIndex * index);
+G_GNUC_INTERNAL void ts_demux_index_clear (TSDemuxIndex * index);
+G_GNUC_INTERNAL guint ts_demux_index_get_n_entries (TSDemuxIndex * index);
+G_GNUC_INTERNAL gboolean ts_demux_index_is_dirty (TSDemuxIndex * index);
+G_GNUC_INTERNAL void ts_demux_index_set_stream_size (TSDemuxIndex * index,
+						     guint64 size);
+G_GNUC_INTERNAL guint64 ts_demux_index_get_stream_size (TSDemuxIndex * index);
+G_GNUC_INTERNAL void ts_demux_index_set_stream_fingerprint (TSDemuxIndex * index,
+							    const guint8 * head,
+							    gsize head_size,
+							    const guint8 * tail,
+							    gsize tail_size);
+G_GNUC_INTERNAL gboolean ts_demux_index_has_stream (TSDemuxIndex * index);
+
+G_GNUC_INTERNAL void ts_demux_index_add_entry (TSDemuxIndex * index,
+					       guint64 offset,
+					       GstClockTime ts);
+G_GNUC_INTERNAL gboolean ts_demux_index_lookup (TSDemuxIndex * index,
+						GstClockTime ts,
+						TSDemuxIndexEntry * entry);
+
+G_GNUC_INTERNAL gboolean ts_demux_index_load (TSDemuxIndex * index,
+					      const gchar * location,
+					      GError ** error);
+G_GNUC_INTERNAL gboolean ts_demux_index_save (TSDemuxIndex * index,
+					      const gchar * location,
+					      GError ** error);
+
+G_GNUC_INTERNAL gboolean ts_demux_index_stream_is_supported (guint8 stream_type);
+G_GNUC_INTERNAL gboolean ts_demux_index_is_keyframe (guint8 stream_type,
+						     const guint8 * data,
+						     gsize size);
+
+G_GNUC_INTERNAL void init_ts_demux_index (void);
+
+G_END_DECLS
+#endif /* __TS_DEMUX_INDEX_H__ */
@@ -113,11 +113,18 @@ enum
   PROP_PAT_INTERVAL,
   PROP_PMT_INTERVAL,
   PROP_ALIGNMENT,
-  PROP_SI_INTERVAL
+  PROP_SI_INTERVAL,
+  PROP_BITRATE,
+  PROP_PCR_INTERVAL
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
+#define MPEGTSMUX_DEFAULT_BITRATE      0
+
+/* Room for the PAT/PMT/SI tables and the PES header when sizing the output
+ * buffer of an input buffer */
+#define MPEGTSMUX_SLAB_EXTRA_PACKETS   8
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
     GST_STATIC_PAD_TEMPLATE ("sink_%d",
@@ -171,14 +178,13 @@ static void gst_mpegtsmux_get_property (GObject * object, guint prop_id,
 
 static void mpegtsmux_reset (MpegTsMux * mux, gboolean alloc);
 static void mpegtsmux_dispose (GObject * object);
-static void alloc_packet_cb (GstBuffer ** _buf, void *user_data);
-static gboolean new_packet_cb (GstBuffer * buf, void *user_data,
+static gboolean alloc_packet_cb (guint8 ** packet, void *user_data);
+static gboolean new_packet_cb (guint8 * packet, void *user_data,
     gint64 new_pcr);
 static void release_buffer_cb (guint8 * data, void *user_data);
-static GstFlowReturn mpegtsmux_collect_packet (MpegTsMux * mux,
-    GstBuffer * buf);
+static void mpegtsmux_clear_slabs (MpegTsMux * mux);
 static GstFlowReturn mpegtsmux_push_packets (MpegTsMux * mux, gboolean force);
-static gboolean new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf,
+static gboolean new_packet_m2ts (MpegTsMux * mux, guint8 * packet,
     gint64 new_pcr);
 
 static void mpegtsmux_prepare_srcpad (MpegTsMux * mux);
@@ -303,6 +309,34 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "Set the interval (in ticks of the 90kHz clock) for writing out the Service"
           "Information tables", 1, G_MAXUINT, TSMUX_DEFAULT_SI_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MpegTsMux:bitrate:
+   *
+   * Constant output bitrate in bits per second. The output is padded with
+   * null packets and the PCR is derived from the position in the output.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_BITRATE,
+      g_param_spec_uint64 ("bitrate", "Bitrate (in bits per second)",
+          "Set the target bitrate, will insert null packets as padding "
+          "to achieve multiplex-wide constant bitrate (0 = no padding)",
+          0, G_MAXUINT64, MPEGTSMUX_DEFAULT_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * MpegTsMux:pcr-interval:
+   *
+   * Maximum interval between two PCRs of a program.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_PCR_INTERVAL,
+      g_param_spec_uint ("pcr-interval", "PCR interval",
+          "Set the interval (in ticks of the 90kHz clock) for writing PCR",
+          1, G_MAXUINT, TSMUX_DEFAULT_PCR_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -326,8 +360,8 @@ mpegtsmux_init (MpegTsMux * mux)
   gst_collect_pads_set_clip_function (mux->collect, (GstCollectPadsClipFunction)
       GST_DEBUG_FUNCPTR (mpegtsmux_clip_inc_running_time), mux);
 
-  mux->adapter = gst_adapter_new ();
-  mux->out_adapter = gst_adapter_new ();
+  mux->m2ts_pending = g_ptr_array_new ();
+  g_queue_init (&mux->out_slabs);
 
   /* properties */
   mux->m2ts_mode = MPEGTSMUX_DEFAULT_M2TS;
@@ -336,6 +370,8 @@ mpegtsmux_init (MpegTsMux * mux)
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
+  mux->bitrate = MPEGTSMUX_DEFAULT_BITRATE;
+  mux->pcr_interval = TSMUX_DEFAULT_PCR_INTERVAL;
 
   /* initial state */
   mpegtsmux_reset (mux, TRUE);
@@ -394,10 +430,10 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->element_index = NULL;
   }
 #endif
-  if (mux->adapter)
-    gst_adapter_clear (mux->adapter);
-  if (mux->out_adapter)
-    gst_adapter_clear (mux->out_adapter);
+  if (mux->m2ts_pending)
+    g_ptr_array_set_size (mux->m2ts_pending, 0);
+  mpegtsmux_clear_slabs (mux);
+  mux->out_slab_packets = MPEGTSMUX_SLAB_EXTRA_PACKETS;
 
   if (mux->tsmux) {
     tsmux_free (mux->tsmux);
@@ -413,7 +449,6 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     gst_buffer_unref (buf);
 
   gst_event_replace (&mux->force_key_unit_event, NULL);
-  gst_buffer_replace (&mux->out_buffer, NULL);
 
   if (mux->collect) {
     GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
@@ -426,6 +461,8 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
     tsmux_set_alloc_func (mux->tsmux, alloc_packet_cb, mux);
+    tsmux_set_bitrate (mux->tsmux, mux->bitrate);
+    tsmux_set_pcr_interval (mux->tsmux, mux->pcr_interval);
   }
 }
 
@@ -436,13 +473,9 @@ mpegtsmux_dispose (GObject * object)
 
   mpegtsmux_reset (mux, FALSE);
 
-  if (mux->adapter) {
-    g_object_unref (mux->adapter);
-    mux->adapter = NULL;
-  }
-  if (mux->out_adapter) {
-    g_object_unref (mux->out_adapter);
-    mux->out_adapter = NULL;
+  if (mux->m2ts_pending) {
+    g_ptr_array_free (mux->m2ts_pending, TRUE);
+    mux->m2ts_pending = NULL;
   }
   if (mux->collect) {
     gst_object_unref (mux->collect);
@@ -506,6 +539,19 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
       mux->si_interval = g_value_get_uint (value);
       tsmux_set_si_interval (mux->tsmux, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      mux->bitrate = g_value_get_uint64 (value);
+      /* the output clock is re-anchored between two packets */
+      GST_COLLECT_PADS_STREAM_LOCK (mux->collect);
+      if (mux->tsmux)
+        tsmux_set_bitrate (mux->tsmux, mux->bitrate);
+      GST_COLLECT_PADS_STREAM_UNLOCK (mux->collect);
+      break;
+    case PROP_PCR_INTERVAL:
+      mux->pcr_interval = g_value_get_uint (value);
+      if (mux->tsmux)
+        tsmux_set_pcr_interval (mux->tsmux, mux->pcr_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -537,6 +583,12 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case PROP_SI_INTERVAL:
       g_value_set_uint (value, mux->si_interval);
       break;
+    case PROP_BITRATE:
+      g_value_set_uint64 (value, mux->bitrate);
+      break;
+    case PROP_PCR_INTERVAL:
+      g_value_set_uint (value, mux->pcr_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1451,6 +1503,9 @@ mpegtsmux_collected_buffer (GstCollectPads * pads, GstCollectData * data,
 
   mux->is_delta = delta;
   mux->is_header = header;
+  mux->out_slab_packets =
+      (tsmux_stream_bytes_in_buffer (best->stream) + TSMUX_PAYLOAD_LENGTH -
+      1) / TSMUX_PAYLOAD_LENGTH + MPEGTSMUX_SLAB_EXTRA_PACKETS;
   while (tsmux_stream_bytes_in_buffer (best->stream) > 0) {
     if (!tsmux_write_stream_packet (mux->tsmux, best->stream)) {
       /* Failed writing data for some reason. Set appropriate error */
@@ -1560,20 +1615,17 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
     guint len)
 {
   /* Packets should be at least 188 bytes, but check anyway */
-  g_assert (len >= 2 || !data);
+  g_assert (len >= NORMAL_TS_PACKET_LENGTH);
 
-  if (!mux->streamheader_sent && data) {
-    guint pid = ((data[1] & 0x1f) << 8) | data[2];
+  if (!mux->streamheader_sent) {
+    guint8 *ts = data + len - NORMAL_TS_PACKET_LENGTH;
+    guint pid = ((ts[1] & 0x1f) << 8) | ts[2];
     /* if it's a PAT or a PMT */
     if (pid == 0x00 || (pid >= TSMUX_START_PMT_PID && pid < TSMUX_START_ES_PID)) {
       GstBuffer *hbuf;
 
-      if (!buf) {
-        hbuf = gst_buffer_new_and_alloc (len);
-        gst_buffer_fill (hbuf, 0, data, len);
-      } else {
-        hbuf = gst_buffer_copy (buf);
-      }
+      hbuf = gst_buffer_new_and_alloc (len);
+      gst_buffer_fill (hbuf, 0, data, len);
       GST_LOG_OBJECT (mux,
           "Collecting packet with pid 0x%04x into streamheaders", pid);
 
@@ -1584,6 +1636,7 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
     }
   }
 
+  /* An output buffer gets the flags of its first packet */
   if (buf) {
     if (mux->is_header) {
       GST_LOG_OBJECT (mux, "marking as header buffer");
@@ -1594,144 +1647,182 @@ new_packet_common_init (MpegTsMux * mux, GstBuffer * buf, guint8 * data,
       GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
     } else {
       GST_DEBUG_OBJECT (mux, "marking as non-delta unit");
-      mux->is_delta = TRUE;
     }
   }
+  mux->is_delta = TRUE;
 }
 
-static GstFlowReturn
-mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+static gint
+mpegtsmux_get_alignment (MpegTsMux * mux)
 {
-  GstBufferList *buffer_list;
-  gint align = mux->alignment;
-  gint av, packet_size;
-
-  if (mux->m2ts_mode) {
-    packet_size = M2TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 32;
-  } else {
-    packet_size = NORMAL_TS_PACKET_LENGTH;
-    if (align < 0)
-      align = 0;
-  }
+  if (mux->alignment >= 0)
+    return mux->alignment;
 
-  av = gst_adapter_available (mux->out_adapter);
-  GST_LOG_OBJECT (mux, "align %d, av %d", align, av);
+  return mux->m2ts_mode ? 32 : 0;
+}
 
-  if (av == 0)
-    return GST_FLOW_OK;
+static MpegTsMuxSlab *
+mpegtsmux_slab_new (MpegTsMux * mux, guint max_packets)
+{
+  MpegTsMuxSlab *slab = g_slice_new0 (MpegTsMuxSlab);
 
-  /* no alignment, just push all available data */
-  if (align == 0) {
-    buffer_list = gst_adapter_take_buffer_list (mux->out_adapter, av);
-    return gst_pad_push_list (mux->srcpad, buffer_list);
-  }
+  slab->packet_size =
+      mux->m2ts_mode ? M2TS_PACKET_LENGTH : NORMAL_TS_PACKET_LENGTH;
+  slab->max_packets = max_packets;
+  slab->buffer =
+      gst_buffer_new_allocate (NULL, max_packets * slab->packet_size, NULL);
+  gst_buffer_map (slab->buffer, &slab->map, GST_MAP_WRITE);
 
-  align *= packet_size;
+  GST_LOG_OBJECT (mux, "new output buffer for %u packets", max_packets);
 
-  if (!force && align > av)
-    return GST_FLOW_OK;
+  return slab;
+}
 
-  buffer_list = gst_buffer_list_new_sized ((av / align) + 1);
+/* Frees @slab, returning its buffer trimmed to the packets written */
+static GstBuffer *
+mpegtsmux_slab_finish (MpegTsMuxSlab * slab)
+{
+  GstBuffer *buf = slab->buffer;
 
-  GST_LOG_OBJECT (mux, "aligning to %d bytes", align);
-  while (align <= av) {
-    GstBuffer *buf;
-    GstClockTime pts;
+  gst_buffer_unmap (buf, &slab->map);
+  gst_buffer_set_size (buf, slab->n_packets * slab->packet_size);
+  g_slice_free (MpegTsMuxSlab, slab);
 
-    pts = gst_adapter_prev_pts (mux->out_adapter, NULL);
-    buf = gst_adapter_take_buffer (mux->out_adapter, align);
+  return buf;
+}
 
-    GST_BUFFER_PTS (buf) = pts;
+static void
+mpegtsmux_clear_slabs (MpegTsMux * mux)
+{
+  MpegTsMuxSlab *slab;
 
-    gst_buffer_list_add (buffer_list, buf);
-    av -= align;
+  while ((slab = g_queue_pop_head (&mux->out_slabs)))
+    gst_buffer_unref (mpegtsmux_slab_finish (slab));
+}
+
+/* Fills the free space of @slab with null packets */
+static void
+mpegtsmux_slab_add_null_packets (MpegTsMux * mux, MpegTsMuxSlab * slab)
+{
+  guint8 *data;
+  guint32 header;
+  gint dummy;
+
+  g_assert (slab->n_packets > 0);
+
+  data = slab->map.data + slab->n_packets * slab->packet_size;
+  header = GST_READ_UINT32_BE (data - slab->packet_size);
+
+  dummy = slab->max_packets - slab->n_packets;
+  GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
+
+  for (; dummy > 0; dummy--) {
+    gint offset;
+
+    if (slab->packet_size > NORMAL_TS_PACKET_LENGTH) {
+      GST_WRITE_UINT32_BE (data, header);
+      /* simply increase header a bit and never mind too much */
+      header++;
+      offset = 4;
+    } else {
+      offset = 0;
+    }
+    GST_WRITE_UINT8 (data + offset, TSMUX_SYNC_BYTE);
+    /* null packet PID */
+    GST_WRITE_UINT16_BE (data + offset + 1, 0x1FFF);
+    /* no adaptation field exists | continuity counter undefined */
+    GST_WRITE_UINT8 (data + offset + 3, 0x10);
+    /* payload */
+    memset (data + offset + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
+    data += slab->packet_size;
   }
 
-  if (av > 0 && force) {
-    GstBuffer *buf;
-    GstClockTime pts;
-    guint8 *data;
-    guint32 header;
-    gint dummy;
-    GstMapInfo map;
+  slab->n_packets = slab->max_packets;
+}
 
-    GST_LOG_OBJECT (mux, "handling %d leftover bytes", av);
+static gboolean
+mpegtsmux_slab_has_pending_packets (MpegTsMux * mux, MpegTsMuxSlab * slab)
+{
+  guint8 *first_pending;
 
-    pts = gst_adapter_prev_pts (mux->out_adapter, NULL);
-    buf = gst_buffer_new_and_alloc (align);
+  if (mux->m2ts_pending->len == 0)
+    return FALSE;
 
-    GST_BUFFER_PTS (buf) = pts;
+  /* the pending packets are the last ones written, so it is enough to check
+   * the first one */
+  first_pending = g_ptr_array_index (mux->m2ts_pending, 0);
 
-    gst_buffer_map (buf, &map, GST_MAP_READ);
-    data = map.data;
+  return first_pending >= slab->map.data &&
+      first_pending < slab->map.data + slab->map.size;
+}
 
-    gst_adapter_copy (mux->out_adapter, data, 0, av);
-    gst_adapter_clear (mux->out_adapter);
+static GstFlowReturn
+mpegtsmux_push_packets (MpegTsMux * mux, gboolean force)
+{
+  GstBufferList *buffer_list = NULL;
+  MpegTsMuxSlab *slab;
+  gint align = mpegtsmux_get_alignment (mux);
+
+  GST_LOG_OBJECT (mux, "align %d, %u output buffers", align,
+      g_queue_get_length (&mux->out_slabs));
+
+  /* no alignment, all the packets written so far can go */
+  slab = g_queue_peek_tail (&mux->out_slabs);
+  if (slab && (align == 0 || force) && slab->n_packets < slab->max_packets) {
+    if (align > 0 && slab->n_packets > 0)
+      mpegtsmux_slab_add_null_packets (mux, slab);
+    else
+      slab->max_packets = slab->n_packets;
+  }
 
-    data += av;
-    header = GST_READ_UINT32_BE (data - packet_size);
+  while ((slab = g_queue_peek_head (&mux->out_slabs))) {
+    if (slab->n_packets < slab->max_packets)
+      break;
 
-    dummy = (map.size - av) / packet_size;
-    GST_LOG_OBJECT (mux, "adding %d null packets", dummy);
+    /* m2ts packets have to wait for their timestamp */
+    if (!force && mpegtsmux_slab_has_pending_packets (mux, slab))
+      break;
 
-    for (; dummy > 0; dummy--) {
-      gint offset;
+    g_queue_pop_head (&mux->out_slabs);
 
-      if (packet_size > NORMAL_TS_PACKET_LENGTH) {
-        GST_WRITE_UINT32_BE (data, header);
-        /* simply increase header a bit and never mind too much */
-        header++;
-        offset = 4;
-      } else {
-        offset = 0;
-      }
-      GST_WRITE_UINT8 (data + offset, TSMUX_SYNC_BYTE);
-      /* null packet PID */
-      GST_WRITE_UINT16_BE (data + offset + 1, 0x1FFF);
-      /* no adaptation field exists | continuity counter undefined */
-      GST_WRITE_UINT8 (data + offset + 3, 0x10);
-      /* payload */
-      memset (data + offset + 4, 0, NORMAL_TS_PACKET_LENGTH - 4);
-      data += packet_size;
+    if (slab->n_packets == 0) {
+      gst_buffer_unref (mpegtsmux_slab_finish (slab));
+      continue;
     }
 
-    gst_buffer_unmap (buf, &map);
-    gst_buffer_list_add (buffer_list, buf);
+    if (buffer_list == NULL)
+      buffer_list = gst_buffer_list_new ();
+    gst_buffer_list_add (buffer_list, mpegtsmux_slab_finish (slab));
   }
 
-  return gst_pad_push_list (mux->srcpad, buffer_list);
-}
+  if (force)
+    g_ptr_array_set_size (mux->m2ts_pending, 0);
 
-static GstFlowReturn
-mpegtsmux_collect_packet (MpegTsMux * mux, GstBuffer * buf)
-{
-  GST_LOG_OBJECT (mux, "collecting packet size %" G_GSIZE_FORMAT,
-      gst_buffer_get_size (buf));
-  gst_adapter_push (mux->out_adapter, buf);
+  if (buffer_list == NULL)
+    return GST_FLOW_OK;
 
-  return GST_FLOW_OK;
+  GST_LOG_OBJECT (mux, "pushing %u buffers",
+      gst_buffer_list_length (buffer_list));
+
+  return gst_pad_push_list (mux->srcpad, buffer_list);
 }
 
 static gboolean
-new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
+new_packet_m2ts (MpegTsMux * mux, guint8 * packet, gint64 new_pcr)
 {
-  GstBuffer *out_buf;
-  int chunk_bytes;
-  GstMapInfo map;
+  gint64 chunk_bytes;
 
-  GST_LOG_OBJECT (mux, "Have buffer %p with new_pcr=%" G_GINT64_FORMAT,
-      buf, new_pcr);
+  GST_LOG_OBJECT (mux, "Have packet %p with new_pcr=%" G_GINT64_FORMAT,
+      packet, new_pcr);
 
-  chunk_bytes = gst_adapter_available (mux->adapter);
+  chunk_bytes = (gint64) mux->m2ts_pending->len * M2TS_PACKET_LENGTH;
 
-  if (G_LIKELY (buf)) {
+  if (G_LIKELY (packet)) {
     if (new_pcr < 0) {
-      /* If there is no pcr in current ts packet then just add the packet
-         to the adapter for later output when we see a PCR */
+      /* If there is no pcr in current ts packet then just keep the packet
+         pending until we see a PCR */
       GST_LOG_OBJECT (mux, "Accumulating non-PCR packet");
-      gst_adapter_push (mux->adapter, buf);
+      g_ptr_array_add (mux->m2ts_pending, packet);
       goto exit;
     }
 
@@ -1741,7 +1832,7 @@ new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
       mux->previous_pcr = new_pcr;
       mux->previous_offset = chunk_bytes;
       GST_LOG_OBJECT (mux, "Accumulating non-PCR packet");
-      gst_adapter_push (mux->adapter, buf);
+      g_ptr_array_add (mux->m2ts_pending, packet);
       goto exit;
     }
   } else {
@@ -1751,6 +1842,7 @@ new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
   /* interpolate if needed, and 2 points available */
   if (chunk_bytes && (new_pcr != mux->previous_pcr)) {
     gint64 offset = 0;
+    guint i;
 
     GST_LOG_OBJECT (mux, "Processing pending packets; "
         "previous pcr %" G_GINT64_FORMAT ", previous offset %d, "
@@ -1765,11 +1857,8 @@ new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
       mux->pcr_rate_den = chunk_bytes - mux->previous_offset;
     }
 
-    while (offset < chunk_bytes) {
-      guint64 cur_pcr, ts;
-
-      /* Loop, pulling packets of the adapter, updating their 4 byte
-       * timestamp header and pushing */
+    for (i = 0; i < mux->m2ts_pending->len; i++) {
+      guint64 cur_pcr;
 
       /* interpolate PCR */
       if (G_LIKELY (offset >= mux->previous_offset))
@@ -1781,41 +1870,27 @@ new_packet_m2ts (MpegTsMux * mux, GstBuffer * buf, gint64 new_pcr)
             gst_util_uint64_scale (mux->previous_offset - offset,
             mux->pcr_rate_num, mux->pcr_rate_den);
 
-      /* FIXME: what about DTS here? */
-      ts = gst_adapter_prev_pts (mux->adapter, NULL);
-      out_buf = gst_adapter_take_buffer (mux->adapter, M2TS_PACKET_LENGTH);
-      g_assert (out_buf);
-      offset += M2TS_PACKET_LENGTH;
-
-      GST_BUFFER_PTS (out_buf) = ts;
-
-      gst_buffer_map (out_buf, &map, GST_MAP_WRITE);
-
       /* The header is the bottom 30 bits of the PCR, apparently not
        * encoded into base + ext as in the packets themselves */
-      GST_WRITE_UINT32_BE (map.data, cur_pcr & 0x3FFFFFFF);
-      gst_buffer_unmap (out_buf, &map);
+      GST_WRITE_UINT32_BE (g_ptr_array_index (mux->m2ts_pending, i),
+          cur_pcr & 0x3FFFFFFF);
+      offset += M2TS_PACKET_LENGTH;
 
       GST_LOG_OBJECT (mux, "Outputting a packet of length %d PCR %"
           G_GUINT64_FORMAT, M2TS_PACKET_LENGTH, cur_pcr);
-      mpegtsmux_collect_packet (mux, out_buf);
     }
+    g_ptr_array_set_size (mux->m2ts_pending, 0);
   }
 
-  if (G_UNLIKELY (!buf))
+  if (G_UNLIKELY (!packet))
     goto exit;
 
-  gst_buffer_map (buf, &map, GST_MAP_WRITE);
-
   /* Finally, output the passed in packet */
   /* Only write the bottom 30 bits of the PCR */
-  GST_WRITE_UINT32_BE (map.data, new_pcr & 0x3FFFFFFF);
-
-  gst_buffer_unmap (buf, &map);
+  GST_WRITE_UINT32_BE (packet, new_pcr & 0x3FFFFFFF);
 
   GST_LOG_OBJECT (mux, "Outputting a packet of length %d PCR %"
       G_GUINT64_FORMAT, M2TS_PACKET_LENGTH, new_pcr);
-  mpegtsmux_collect_packet (mux, buf);
 
   if (new_pcr != mux->previous_pcr) {
     mux->previous_pcr = new_pcr;
@@ -1826,62 +1901,67 @@ exit:
   return TRUE;
 }
 
-/* Called when the TsMux has prepared a packet for output. Return FALSE
- * on error */
+/* Called when the TsMux has written a packet into the memory returned by
+ * alloc_packet_cb(). Return FALSE on error */
 static gboolean
-new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
+new_packet_cb (guint8 * packet, void *user_data, gint64 new_pcr)
 {
   MpegTsMux *mux = (MpegTsMux *) user_data;
-  gint offset = 0;
-  GstMapInfo map;
+  MpegTsMuxSlab *slab = g_queue_peek_tail (&mux->out_slabs);
+  GstBuffer *first = NULL;
+  guint8 *data;
 
-#if 0
-  GST_LOG_OBJECT (mux, "handling packet %d", mux->spn_count);
-  mux->spn_count++;
-#endif
-
-  if (mux->m2ts_mode) {
-    offset = 4;
-    gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH + offset);
-  }
+  g_assert (slab != NULL && slab->n_packets < slab->max_packets);
 
-  gst_buffer_map (buf, &map, GST_MAP_READWRITE);
+  /* start of the packet, including any prefix */
+  data = slab->map.data + slab->n_packets * slab->packet_size;
+  g_assert (packet == data + slab->packet_size - NORMAL_TS_PACKET_LENGTH);
 
-  if (offset) {
-    /* there should be a better way to do this */
-    memmove (map.data + offset, map.data, map.size - offset);
+  if (slab->n_packets == 0) {
+    GST_BUFFER_PTS (slab->buffer) = mux->last_ts;
+    first = slab->buffer;
   }
-
-  GST_BUFFER_PTS (buf) = mux->last_ts;
   /* do common init (flags and streamheaders) */
-  new_packet_common_init (mux, buf, map.data + offset, map.size);
+  new_packet_common_init (mux, first, data, slab->packet_size);
 
-  gst_buffer_unmap (buf, &map);
+  slab->n_packets++;
 
   /* all is meant for downstream, including any prefix */
-  if (offset)
-    return new_packet_m2ts (mux, buf, new_pcr);
-  else
-    mpegtsmux_collect_packet (mux, buf);
+  if (slab->packet_size > NORMAL_TS_PACKET_LENGTH)
+    return new_packet_m2ts (mux, data, new_pcr);
 
   return TRUE;
 }
 
-/* called when TsMux needs new packet to write into */
-static void
-alloc_packet_cb (GstBuffer ** _buf, void *user_data)
+/* called when TsMux needs the memory to write the next packet into. Packets
+ * are written directly into the output buffers, there is no per packet
+ * allocation */
+static gboolean
+alloc_packet_cb (guint8 ** packet, void *user_data)
 {
   MpegTsMux *mux = (MpegTsMux *) user_data;
-  GstBuffer *buf;
-  gint offset = 0;
+  MpegTsMuxSlab *slab = g_queue_peek_tail (&mux->out_slabs);
+  guint8 *data;
 
-  if (mux->m2ts_mode == TRUE)
-    offset = 4;
+  if (slab == NULL || slab->n_packets == slab->max_packets) {
+    gint align = mpegtsmux_get_alignment (mux);
 
-  buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH + offset);
-  gst_buffer_set_size (buf, NORMAL_TS_PACKET_LENGTH);
+    /* either one aligned chunk, or room for the whole input buffer */
+    slab = mpegtsmux_slab_new (mux,
+        align > 0 ? align : MAX (mux->out_slab_packets, 1));
+    g_queue_push_tail (&mux->out_slabs, slab);
+  }
+
+  data = slab->map.data + slab->n_packets * slab->packet_size;
+  if (slab->packet_size > NORMAL_TS_PACKET_LENGTH) {
+    /* the timestamp is only known once the next PCR is written */
+    GST_WRITE_UINT32_BE (data, 0);
+    data += slab->packet_size - NORMAL_TS_PACKET_LENGTH;
+  }
 
-  *_buf = buf;
+  *packet = data;
+
+  return TRUE;
 }
 
 static void
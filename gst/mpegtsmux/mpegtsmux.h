@@ -85,7 +85,6 @@
 
 #include <gst/gst.h>
 #include <gst/base/gstcollectpads.h>
-#include <gst/base/gstadapter.h>
 
 G_BEGIN_DECLS
 
@@ -116,6 +115,7 @@ G_BEGIN_DECLS
 typedef struct MpegTsMux MpegTsMux;
 typedef struct MpegTsMuxClass MpegTsMuxClass;
 typedef struct MpegTsPadData MpegTsPadData;
+typedef struct MpegTsMuxSlab MpegTsMuxSlab;
 
 typedef GstBuffer * (*MpegTsPadDataPrepareFunction) (GstBuffer * buf,
     MpegTsPadData * data, MpegTsMux * mux);
@@ -139,6 +139,8 @@ struct MpegTsMux {
   guint pmt_interval;
   gint alignment;
   guint si_interval;
+  guint64 bitrate;
+  guint pcr_interval;
 
   /* state */
   gboolean first;
@@ -158,11 +160,13 @@ struct MpegTsMux {
   gint64 previous_offset;
   gint64 pcr_rate_num;
   gint64 pcr_rate_den;
-  GstAdapter *adapter;
+  /* packets waiting for the next PCR to get their timestamp */
+  GPtrArray *m2ts_pending;
 
-  /* output buffer aggregation */
-  GstAdapter *out_adapter;
-  GstBuffer *out_buffer;
+  /* output buffers the packets are written into, oldest first */
+  GQueue out_slabs;
+  /* size in packets of the next slab when not aligning */
+  guint out_slab_packets;
 
 #if 0
   /* SPN/PTS index handling */
@@ -171,6 +175,15 @@ struct MpegTsMux {
 #endif
 };
 
+/* An output buffer that is kept mapped while packets are written into it */
+struct MpegTsMuxSlab {
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint packet_size;
+  guint n_packets;
+  guint max_packets;
+};
+
 struct MpegTsMuxClass {
   GstElementClass parent_class;
 };
@@ -106,8 +106,10 @@
  * 1/8 second atm */
 #define TSMUX_PCR_OFFSET (TSMUX_CLOCK_FREQ / 8)
 
-/* Times per second to write PCR */
-#define TSMUX_DEFAULT_PCR_FREQ (25)
+/* ISO/IEC 13818-1 2.4.2.2: the PCR is the time the byte containing the last
+ * bit of program_clock_reference_base arrives. After the 4 byte header, the
+ * adaptation field length and flags, that is byte 10 of the packet */
+#define TSMUX_PCR_BYTE_OFFSET 10
 
 /* Base for all written PCR and DTS/PTS,
  * so we have some slack to go backwards */
@@ -115,6 +117,7 @@
 
 static gboolean tsmux_write_pat (TsMux * mux);
 static gboolean tsmux_write_pmt (TsMux * mux, TsMuxProgram * program);
+static gint64 tsmux_get_current_pcr (TsMux * mux);
 static void
 tsmux_section_free (TsMuxSection * section)
 {
@@ -150,6 +153,9 @@ tsmux_new (void)
   mux->last_si_ts = G_MININT64;
   mux->si_interval = TSMUX_DEFAULT_SI_INTERVAL;
 
+  mux->pcr_interval = TSMUX_DEFAULT_PCR_INTERVAL;
+  mux->first_pcr = -1;
+
   mux->si_sections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, (GDestroyNotify) tsmux_section_free);
 
@@ -163,7 +169,9 @@ tsmux_new (void)
  * @user_data: user data passed to @func
  *
  * Set the callback function and user data to be called when @mux has output to
- * produce. @user_data will be passed as user data in @func.
+ * produce. @func is passed the packet previously obtained from the alloc
+ * function, once it is complete. @user_data will be passed as user data in
+ * @func.
  */
 void
 tsmux_set_write_func (TsMux * mux, TsMuxWriteFunc func, void *user_data)
@@ -181,7 +189,9 @@ tsmux_set_write_func (TsMux * mux, TsMuxWriteFunc func, void *user_data)
  * @user_data: user data passed to @func
  *
  * Set the callback function and user data to be called when @mux needs
- * a new buffer to write a packet into.
+ * %TSMUX_PACKET_LENGTH bytes to write a packet into. The memory has to stay
+ * valid until the packet is handed to the write function. If the packet is
+ * not written out, the next call should return the same memory again.
  * @user_data will be passed as user data in @func.
  */
 void
@@ -228,6 +238,94 @@ tsmux_get_pat_interval (TsMux * mux)
   return mux->pat_interval;
 }
 
+/**
+ * tsmux_set_pcr_interval:
+ * @mux: a #TsMux
+ * @interval: a new PCR interval
+ *
+ * Set the maximum interval (in cycles of the 90kHz clock) between two PCRs
+ * of a program. The MPEG-TS specification requires at most 0.1 seconds.
+ */
+void
+tsmux_set_pcr_interval (TsMux * mux, guint interval)
+{
+  g_return_if_fail (mux != NULL);
+  g_return_if_fail (interval > 0);
+
+  mux->pcr_interval = interval;
+}
+
+/**
+ * tsmux_get_pcr_interval:
+ * @mux: a #TsMux
+ *
+ * Get the configured PCR interval. See also tsmux_set_pcr_interval().
+ *
+ * Returns: the configured PCR interval
+ */
+guint
+tsmux_get_pcr_interval (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->pcr_interval;
+}
+
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the output bitrate in bits per second, or 0
+ *
+ * Set a constant output bitrate. When non-zero, @mux schedules every packet
+ * against a virtual output clock running at @bitrate, pads the output with
+ * null packets while no data is due, and derives the PCR values from the
+ * position of the packet in the output. Data is never sent more than the PCR
+ * offset ahead of its decoding time, which bounds the fill level of the
+ * decoder buffers.
+ *
+ * With a @bitrate of 0, the output has a variable bitrate and the PCR is
+ * derived from the timestamps of the PCR stream.
+ *
+ * The bitrate can be changed while muxing. The output clock then continues
+ * from the PCR of the next packet at the new rate.
+ */
+void
+tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
+{
+  g_return_if_fail (mux != NULL);
+
+  if (bitrate == mux->bitrate)
+    return;
+
+  /* Re-anchor the output clock on the next packet, so that the PCRs already
+   * written aren't scaled again by the new rate. Coming from a variable
+   * bitrate, the clock is anchored on the next data again. */
+  if (mux->bitrate && bitrate && mux->first_pcr != -1)
+    mux->first_pcr = tsmux_get_current_pcr (mux);
+  else
+    mux->first_pcr = -1;
+  mux->n_bytes = 0;
+  mux->late_warned = FALSE;
+
+  mux->bitrate = bitrate;
+}
+
+/**
+ * tsmux_get_bitrate:
+ * @mux: a #TsMux
+ *
+ * Get the configured output bitrate. See also tsmux_set_bitrate().
+ *
+ * Returns: the configured bitrate, or 0 for variable bitrate
+ */
+guint64
+tsmux_get_bitrate (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->bitrate;
+}
+
 /**
  * tsmux_set_si_interval:
  * @mux: a #TsMux
@@ -566,32 +664,54 @@ tsmux_find_stream (TsMux * mux, guint16 pid)
 }
 
 static gboolean
-tsmux_get_buffer (TsMux * mux, GstBuffer ** buf)
+tsmux_get_packet (TsMux * mux, guint8 ** packet)
 {
-  g_return_val_if_fail (buf, FALSE);
+  g_return_val_if_fail (packet, FALSE);
 
   if (G_UNLIKELY (!mux->alloc_func))
     return FALSE;
 
-  mux->alloc_func (buf, mux->alloc_func_data);
-
-  if (!*buf)
+  *packet = NULL;
+  if (!mux->alloc_func (packet, mux->alloc_func_data))
     return FALSE;
 
-  g_assert (gst_buffer_get_size (*buf) == TSMUX_PACKET_LENGTH);
-  return TRUE;
+  return *packet != NULL;
 }
 
 static gboolean
-tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
+tsmux_packet_out (TsMux * mux, guint8 * packet, gint64 pcr)
 {
-  if (G_UNLIKELY (mux->write_func == NULL)) {
-    if (buf)
-      gst_buffer_unref (buf);
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
+  if (G_UNLIKELY (mux->write_func == NULL))
     return TRUE;
-  }
 
-  return mux->write_func (buf, mux->write_func_data, pcr);
+  return mux->write_func (packet, mux->write_func_data, pcr);
+}
+
+/* The PCR for the start of the next packet, from the position of that packet
+ * in the constant bitrate output */
+static gint64
+tsmux_get_current_pcr (TsMux * mux)
+{
+  if (mux->first_pcr == -1)
+    mux->first_pcr = (CLOCK_BASE - TSMUX_PCR_OFFSET) *
+        (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+
+  return mux->first_pcr + gst_util_uint64_scale (mux->n_bytes * 8,
+      TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+}
+
+/* The value of the PCR field of the next packet in the constant bitrate
+ * output, which is TSMUX_PCR_BYTE_OFFSET bytes later than its start. Only
+ * valid once tsmux_get_current_pcr() anchored the output */
+static gint64
+tsmux_get_pcr_field (TsMux * mux)
+{
+  g_assert (mux->first_pcr != -1);
+
+  return mux->first_pcr + gst_util_uint64_scale ((mux->n_bytes +
+          TSMUX_PCR_BYTE_OFFSET) * 8, TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
 }
 
 /*
@@ -845,15 +965,11 @@ static gboolean
 tsmux_section_write_packet (GstMpegtsSectionType * type,
     TsMuxSection * section, TsMux * mux)
 {
-  GstBuffer *section_buffer;
-  GstBuffer *packet_buffer = NULL;
-  GstMemory *mem;
   guint8 *packet;
   guint8 *data;
   gsize data_size = 0;
   gsize payload_written;
   guint len = 0, offset = 0, payload_len = 0;
-  guint extra_alloc_bytes = 0;
 
   g_return_val_if_fail (section != NULL, FALSE);
   g_return_val_if_fail (mux != NULL, FALSE);
@@ -861,6 +977,7 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
   /* Mark the start of new PES unit */
   section->pi.packet_start_unit_indicator = TRUE;
 
+  /* The data will be freed when the GstMpegtsSection is destroyed */
   data = gst_mpegts_section_packetize (section->section, &data_size);
 
   if (!data) {
@@ -872,24 +989,18 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
   section->pi.stream_avail = data_size;
   payload_written = 0;
 
-  /* Wrap section data in a buffer without free function.
-     The data will be freed when the GstMpegtsSection is destroyed. */
-  section_buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
-      data, data_size, 0, data_size, NULL, NULL);
-
-  TS_DEBUG ("Section buffer with size %" G_GSIZE_FORMAT " created",
-      gst_buffer_get_size (section_buffer));
+  TS_DEBUG ("Section of size %" G_GSIZE_FORMAT, data_size);
 
   while (section->pi.stream_avail > 0) {
-
-    packet = g_malloc (TSMUX_PACKET_LENGTH);
+    if (!tsmux_get_packet (mux, &packet))
+      return FALSE;
 
     if (section->pi.packet_start_unit_indicator) {
       /* Wee need room for a pointer byte */
       section->pi.stream_avail++;
 
       if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
+        return FALSE;
 
       /* Write the pointer byte */
       packet[offset++] = 0x00;
@@ -897,71 +1008,28 @@ tsmux_section_write_packet (GstMpegtsSectionType * type,
 
     } else {
       if (!tsmux_write_ts_header (packet, &section->pi, &len, &offset))
-        goto fail;
+        return FALSE;
       payload_len = len;
     }
 
-    /* Wrap the TS header and adaption field in a GstMemory */
-    mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
-        packet, TSMUX_PACKET_LENGTH, 0, offset, packet, g_free);
-
-    TS_DEBUG ("Creating packet buffer at offset "
+    TS_DEBUG ("Copying section data at offset "
         "%" G_GSIZE_FORMAT " with length %u", payload_written, payload_len);
 
-    /* If in M2TS mode, we will need to resize to 4 bytes after the end
-       of the buffer. For performance reasons, we will now try to include
-       4 extra bytes from the source buffer, then resize down, to avoid
-       having an extra 4 byte GstMemory appended. If the source buffer
-       does not have enough data for this, a new GstMemory will be used */
-    if (gst_buffer_get_size (section_buffer) - (payload_written +
-            payload_len) >= 4) {
-      /* enough space */
-      extra_alloc_bytes = 4;
-    }
-    packet_buffer = gst_buffer_copy_region (section_buffer, GST_BUFFER_COPY_ALL,
-        payload_written, payload_len + extra_alloc_bytes);
-
-    /* Prepend the header to the section data */
-    gst_buffer_prepend_memory (packet_buffer, mem);
-
-    /* add an extra 4 bytes if it could not be reserved already */
-    if (extra_alloc_bytes == 4) {
-      /* we allocated those already, resize */
-      gst_buffer_set_size (packet_buffer,
-          gst_buffer_get_size (packet_buffer) - extra_alloc_bytes);
-    } else {
-      void *ptr = g_malloc (4);
-      GstMemory *extra =
-          gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, ptr, 4, 0, 0, ptr,
-          g_free);
-      gst_buffer_append_memory (packet_buffer, extra);
-    }
+    memcpy (packet + offset, data + payload_written, payload_len);
 
     TS_DEBUG ("Writing %d bytes to section. %d bytes remaining",
         len, section->pi.stream_avail - len);
 
     /* Push the packet without PCR */
-    if (G_UNLIKELY (!tsmux_packet_out (mux, packet_buffer, -1))) {
-      /* Buffer given away */
-      packet_buffer = NULL;
-      goto fail;
-    }
+    if (G_UNLIKELY (!tsmux_packet_out (mux, packet, -1)))
+      return FALSE;
 
-    packet_buffer = NULL;
     section->pi.stream_avail -= len;
     payload_written += payload_len;
     section->pi.packet_start_unit_indicator = FALSE;
   }
 
-  gst_buffer_unref (section_buffer);
-
   return TRUE;
-
-fail:
-  g_free (packet);
-  if (section_buffer)
-    gst_buffer_unref (section_buffer);
-  return FALSE;
 }
 
 static gboolean
@@ -976,6 +1044,126 @@ tsmux_write_si (TsMux * mux)
 
 }
 
+static gboolean
+tsmux_write_null_packet (TsMux * mux)
+{
+  guint8 *packet;
+
+  if (!tsmux_get_packet (mux, &packet))
+    return FALSE;
+
+  /* PID 0x1fff, payload only, no continuity counter */
+  packet[0] = TSMUX_SYNC_BYTE;
+  packet[1] = 0x1f;
+  packet[2] = 0xff;
+  packet[3] = 0x10;
+  memset (packet + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+
+  return tsmux_packet_out (mux, packet, -1);
+}
+
+/* Write a packet on the PID of @stream that only carries an adaptation field
+ * with the PCR. It has no payload, so the continuity counter stays as is */
+static gboolean
+tsmux_write_pcr_packet (TsMux * mux, TsMuxStream * stream, gint64 pcr)
+{
+  TsMuxPacketInfo pi = stream->pi;
+  guint payload_len, payload_offs;
+  guint8 *packet;
+
+  pi.flags = TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+  pi.pcr = tsmux_get_pcr_field (mux);
+  pi.packet_start_unit_indicator = FALSE;
+  pi.stream_avail = 0;
+
+  if (!tsmux_get_packet (mux, &packet))
+    return FALSE;
+
+  if (!tsmux_write_ts_header (packet, &pi, &payload_len, &payload_offs))
+    return FALSE;
+
+  TS_DEBUG ("Writing PCR-only packet for PID 0x%04x", pi.pid);
+  stream->last_pcr = pcr;
+
+  return tsmux_packet_out (mux, packet, pcr);
+}
+
+static gboolean
+tsmux_pcr_is_due (TsMux * mux, TsMuxStream * stream, gint64 pcr)
+{
+  return stream->last_pcr == -1 || (pcr - stream->last_pcr >
+      mux->pcr_interval * (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ));
+}
+
+/* In constant bitrate mode, give every program whose PCR interval elapsed a
+ * PCR, except the one carried by @stream which is about to write its own */
+static gboolean
+tsmux_write_due_pcrs (TsMux * mux, TsMuxStream * stream)
+{
+  GList *cur;
+
+  for (cur = mux->programs; cur; cur = cur->next) {
+    TsMuxProgram *program = (TsMuxProgram *) cur->data;
+    TsMuxStream *pcr_stream = program->pcr_stream;
+    gint64 pcr;
+
+    /* programs only start getting PCRs once their PCR stream started */
+    if (pcr_stream == NULL || pcr_stream == stream ||
+        pcr_stream->last_pcr == -1)
+      continue;
+
+    pcr = tsmux_get_current_pcr (mux);
+    if (tsmux_pcr_is_due (mux, pcr_stream, pcr) &&
+        !tsmux_write_pcr_packet (mux, pcr_stream, pcr))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* In constant bitrate mode, hold back the next packet of @stream until the
+ * output clock reaches the decoding time of its data minus the PCR offset,
+ * so the decoder buffers never fill more than that offset in advance. The
+ * time in between is filled with PCR and null packets */
+static gboolean
+tsmux_write_padding (TsMux * mux, TsMuxStream * stream)
+{
+  gint64 dts = tsmux_stream_get_next_dts (stream);
+
+  if (dts != G_MININT64) {
+    gint64 start, cur_pcr;
+
+    /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
+    start = (dts + CLOCK_BASE - TSMUX_PCR_OFFSET) *
+        (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+    if (mux->first_pcr == -1)
+      mux->first_pcr = start - gst_util_uint64_scale (mux->n_bytes * 8,
+          TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+
+    cur_pcr = tsmux_get_current_pcr (mux);
+    if (cur_pcr > start + TSMUX_PCR_OFFSET *
+        (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ) && !mux->late_warned) {
+      GST_WARNING ("Bitrate %" G_GUINT64_FORMAT " too low, data for PID "
+          "0x%04x arrives after its decoding time", mux->bitrate,
+          tsmux_stream_get_pid (stream));
+      mux->late_warned = TRUE;
+    }
+
+    while (cur_pcr < start) {
+      guint64 n_bytes = mux->n_bytes;
+
+      if (!tsmux_write_due_pcrs (mux, NULL))
+        return FALSE;
+      if (mux->n_bytes == n_bytes && !tsmux_write_null_packet (mux))
+        return FALSE;
+
+      cur_pcr = tsmux_get_current_pcr (mux);
+    }
+  }
+
+  return tsmux_write_due_pcrs (mux, stream);
+}
+
 /**
  * tsmux_write_stream_packet:
  * @mux: a #TsMux
@@ -992,45 +1180,24 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   TsMuxPacketInfo *pi = &stream->pi;
   gboolean res;
   gint64 cur_pcr = -1;
-  GstBuffer *buf = NULL;
-  GstMapInfo map;
+  guint8 *packet;
 
   g_return_val_if_fail (mux != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
+  if (mux->bitrate && !tsmux_write_padding (mux, stream))
+    return FALSE;
+
   if (tsmux_stream_is_pcr (stream)) {
     gint64 cur_pts = tsmux_stream_get_pts (stream);
     gboolean write_pat;
     gboolean write_si;
     GList *cur;
 
-    cur_pcr = 0;
     if (cur_pts != G_MININT64) {
       TS_DEBUG ("TS for PCR stream is %" G_GINT64_FORMAT, cur_pts);
     }
 
-    /* FIXME: The current PCR needs more careful calculation than just
-     * writing a fixed offset */
-    if (cur_pts != G_MININT64) {
-      /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
-      cur_pts += CLOCK_BASE;
-      cur_pcr = (cur_pts - TSMUX_PCR_OFFSET) *
-          (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
-    }
-
-    /* Need to decide whether to write a new PCR in this packet */
-    if (stream->last_pcr == -1 ||
-        (cur_pcr - stream->last_pcr >
-            (TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ))) {
-
-      stream->pi.flags |=
-          TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
-      stream->pi.pcr = cur_pcr;
-      stream->last_pcr = cur_pcr;
-    } else {
-      cur_pcr = -1;
-    }
-
     /* check if we need to rewrite pat */
     if (mux->last_pat_ts == G_MININT64 || mux->pat_changed)
       write_pat = TRUE;
@@ -1077,6 +1244,31 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
           return FALSE;
       }
     }
+
+    if (mux->bitrate) {
+      /* The exact time this packet leaves the muxer, now that the tables
+       * written before it are accounted for */
+      cur_pcr = tsmux_get_current_pcr (mux);
+    } else if (cur_pts != G_MININT64) {
+      /* FIXME: The current PCR needs more careful calculation than just
+       * writing a fixed offset */
+      /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
+      cur_pts += CLOCK_BASE;
+      cur_pcr = (cur_pts - TSMUX_PCR_OFFSET) *
+          (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+    } else {
+      cur_pcr = 0;
+    }
+
+    /* Need to decide whether to write a new PCR in this packet */
+    if (tsmux_pcr_is_due (mux, stream, cur_pcr)) {
+      stream->pi.flags |=
+          TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+      stream->pi.pcr = mux->bitrate ? tsmux_get_pcr_field (mux) : cur_pcr;
+      stream->last_pcr = cur_pcr;
+    } else {
+      cur_pcr = -1;
+    }
   }
 
   pi->packet_start_unit_indicator = tsmux_stream_at_pes_start (stream);
@@ -1089,38 +1281,23 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   }
   pi->stream_avail = tsmux_stream_bytes_avail (stream);
 
-  /* obtain buffer */
-  if (!tsmux_get_buffer (mux, &buf))
+  /* obtain the memory to write the packet into */
+  if (!tsmux_get_packet (mux, &packet))
     return FALSE;
 
-  gst_buffer_map (buf, &map, GST_MAP_READ);
-
-  if (!tsmux_write_ts_header (map.data, pi, &payload_len, &payload_offs))
-    goto fail;
-
-
-  if (!tsmux_stream_get_data (stream, map.data + payload_offs, payload_len))
-    goto fail;
+  if (!tsmux_write_ts_header (packet, pi, &payload_len, &payload_offs))
+    return FALSE;
 
-  gst_buffer_unmap (buf, &map);
+  if (!tsmux_stream_get_data (stream, packet + payload_offs, payload_len))
+    return FALSE;
 
-  GST_DEBUG_OBJECT (mux, "Writing PES of size %d",
-      (int) gst_buffer_get_size (buf));
-  res = tsmux_packet_out (mux, buf, cur_pcr);
+  TS_DEBUG ("Writing PES packet with %u bytes of payload", payload_len);
+  res = tsmux_packet_out (mux, packet, cur_pcr);
 
   /* Reset all dynamic flags */
   stream->pi.flags &= TSMUX_PACKET_FLAG_PES_FULL_HEADER;
 
   return res;
-
-  /* ERRORS */
-fail:
-  {
-    gst_buffer_unmap (buf, &map);
-    if (buf)
-      gst_buffer_unref (buf);
-    return FALSE;
-  }
 }
 
 /**
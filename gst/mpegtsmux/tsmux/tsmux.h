@@ -100,8 +100,8 @@ G_BEGIN_DECLS
 typedef struct TsMuxSection TsMuxSection;
 typedef struct TsMux TsMux;
 
-typedef gboolean (*TsMuxWriteFunc) (GstBuffer * buf, void *user_data, gint64 new_pcr);
-typedef void (*TsMuxAllocFunc) (GstBuffer ** buf, void *user_data);
+typedef gboolean (*TsMuxWriteFunc) (guint8 * packet, void *user_data, gint64 new_pcr);
+typedef gboolean (*TsMuxAllocFunc) (guint8 ** packet, void *user_data);
 
 struct TsMuxSection {
   TsMuxPacketInfo pi;
@@ -169,10 +169,22 @@ struct TsMux {
   /* last time SIT written in MPEG PTS clock time */
   gint64   last_si_ts;
 
+  /* interval between PCR in MPEG PTS clock time */
+  guint    pcr_interval;
+
+  /* output bitrate in bits per second, 0 for variable bitrate */
+  guint64  bitrate;
+  /* number of bytes output since the one first_pcr refers to */
+  guint64  n_bytes;
+  /* PCR the output clock is anchored on in constant bitrate mode */
+  gint64   first_pcr;
+  /* already warned about the bitrate being too low */
+  gboolean late_warned;
+
   /* callback to write finished packet */
   TsMuxWriteFunc write_func;
   void *write_func_data;
-  /* callback to alloc new packet buffer */
+  /* callback to get the memory to write the next packet into */
   TsMuxAllocFunc alloc_func;
   void *alloc_func_data;
 
@@ -189,6 +201,10 @@ void 		tsmux_set_write_func 		(TsMux *mux, TsMuxWriteFunc func, void *user_data)
 void 		tsmux_set_alloc_func 		(TsMux *mux, TsMuxAllocFunc func, void *user_data);
 void 		tsmux_set_pat_interval          (TsMux *mux, guint interval);
 guint 		tsmux_get_pat_interval          (TsMux *mux);
+void 		tsmux_set_pcr_interval          (TsMux *mux, guint interval);
+guint 		tsmux_get_pcr_interval          (TsMux *mux);
+void 		tsmux_set_bitrate               (TsMux *mux, guint64 bitrate);
+guint64 	tsmux_get_bitrate               (TsMux *mux);
 guint16		tsmux_get_new_pid 		(TsMux *mux);
 
 /* pid/program management */
@@ -1090,3 +1090,32 @@ tsmux_stream_get_pts (TsMuxStream * stream)
 
   return stream->last_pts;
 }
+
+/**
+ * tsmux_stream_get_next_dts:
+ * @stream: a #TsMuxStream
+ *
+ * Return the DTS of the buffer the next bytes written from @stream belong
+ * to, or its PTS if it has no DTS.
+ *
+ * Returns: the DTS of the next buffer in @stream, or %G_MININT64 if no
+ * timestamp is known.
+ */
+gint64
+tsmux_stream_get_next_dts (TsMuxStream * stream)
+{
+  TsMuxStreamBuffer *buf;
+
+  g_return_val_if_fail (stream != NULL, G_MININT64);
+
+  buf = stream->cur_buffer;
+  if (buf == NULL && stream->buffers)
+    buf = stream->buffers->data;
+  if (buf == NULL)
+    return G_MININT64;
+
+  if (GST_CLOCK_STIME_IS_VALID (buf->dts))
+    return buf->dts;
+
+  return buf->pts;
+}
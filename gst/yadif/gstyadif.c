@@ -72,10 +72,12 @@ static GstFlowReturn gst_yadif_transform (GstBaseTransform * trans,
 enum
 {
   PROP_0,
-  PROP_MODE
+  PROP_MODE,
+  PROP_N_THREADS
 };
 
 #define DEFAULT_MODE GST_DEINTERLACE_MODE_AUTO
+#define DEFAULT_N_THREADS 1
 
 /* pad templates */
 
@@ -160,11 +162,25 @@ gst_yadif_class_init (GstYadifClass * klass)
           DEFAULT_MODE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Number of threads",
+          "Number of threads to use for deinterlacing (0 = number of CPU cores)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
 }
 
+YadifFilterLineFunc yadif_get_filter_line (const gchar * name);
+
 static void
 gst_yadif_init (GstYadif * yadif)
 {
+  yadif->n_threads = DEFAULT_N_THREADS;
+  /* GST_YADIF_FILTER_LINE=avx2|sse2|vector|c forces a line filter, to
+   * compare them */
+  yadif->filter_line = yadif_get_filter_line (g_getenv
+      ("GST_YADIF_FILTER_LINE"));
+  yadif->stripe_pool = gst_video_stripe_pool_new ();
 }
 
 void
@@ -177,6 +193,11 @@ gst_yadif_set_property (GObject * object, guint property_id,
     case PROP_MODE:
       yadif->mode = g_value_get_enum (value);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (yadif);
+      yadif->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (yadif);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -193,6 +214,11 @@ gst_yadif_get_property (GObject * object, guint property_id,
     case PROP_MODE:
       g_value_set_enum (value, yadif->mode);
       break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (yadif);
+      g_value_set_uint (value, yadif->n_threads);
+      GST_OBJECT_UNLOCK (yadif);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -212,9 +238,11 @@ gst_yadif_dispose (GObject * object)
 void
 gst_yadif_finalize (GObject * object)
 {
-  /* GstYadif *yadif = GST_YADIF (object); */
+  GstYadif *yadif = GST_YADIF (object);
 
   /* clean up object here */
+  gst_video_stripe_pool_free (yadif->stripe_pool);
+  yadif->stripe_pool = NULL;
 
   G_OBJECT_CLASS (gst_yadif_parent_class)->finalize (object);
 }
@@ -291,7 +319,57 @@ gst_yadif_stop (GstBaseTransform * trans)
   return TRUE;
 }
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
+void yadif_filter_slice (GstYadif * yadif, int parity, int tff, int slice,
+    int n_slices);
+
+typedef struct
+{
+  GstYadif *yadif;
+  int parity, tff;
+  int slice, n_slices;
+} GstYadifSlice;
+
+static void
+gst_yadif_process_slice (gpointer data, gpointer user_data)
+{
+  GstYadifSlice *slice = data;
+
+  yadif_filter_slice (slice->yadif, slice->parity, slice->tff, slice->slice,
+      slice->n_slices);
+}
+
+/* Filters the first slice on the calling thread and all others on the
+ * worker pool, and waits until all of them are done */
+static void
+yadif_filter (GstYadif * yadif, int parity, int tff)
+{
+  GstYadifSlice *slices;
+  guint n_threads, n_slices, i;
+
+  GST_OBJECT_LOCK (yadif);
+  n_threads = yadif->n_threads;
+  GST_OBJECT_UNLOCK (yadif);
+
+  /* each slice needs at least a pair of lines of the smallest plane */
+  n_slices = gst_video_stripe_pool_prepare (yadif->stripe_pool, n_threads,
+      GST_VIDEO_INFO_HEIGHT (&yadif->video_info) / 4);
+  if (n_slices == 1) {
+    yadif_filter_slice (yadif, parity, tff, 0, 1);
+    return;
+  }
+
+  slices = g_newa (GstYadifSlice, n_slices);
+  for (i = 0; i < n_slices; i++) {
+    slices[i].yadif = yadif;
+    slices[i].parity = parity;
+    slices[i].tff = tff;
+    slices[i].slice = i;
+    slices[i].n_slices = n_slices;
+  }
+
+  gst_video_stripe_pool_run (yadif->stripe_pool, gst_yadif_process_slice,
+      NULL, slices, sizeof (GstYadifSlice), n_slices);
+}
 
 static GstFlowReturn
 gst_yadif_transform (GstBaseTransform * trans, GstBuffer * inbuf,
@@ -23,6 +23,7 @@
 
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
+#include <gst/video/gstvideostripepool.h>
 
 G_BEGIN_DECLS
 
@@ -35,6 +36,21 @@ G_BEGIN_DECLS
 typedef struct _GstYadif GstYadif;
 typedef struct _GstYadifClass GstYadifClass;
 
+typedef void (*YadifFilterLineFunc) (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+typedef struct {
+  const gchar *name;
+  YadifFilterLineFunc func;
+} YadifFilterLinePath;
+
+/* AVX2 line filter, selected at runtime */
+#if HAVE_CPU_X86_64 && (defined (__clang__) || \
+    (defined (__GNUC__) && __GNUC__ >= 5))
+#define HAVE_FILTER_LINE_AVX2 1
+#endif
+
 typedef enum {
   GST_DEINTERLACE_MODE_AUTO,
   GST_DEINTERLACE_MODE_INTERLACED,
@@ -46,13 +62,18 @@ struct _GstYadif
   GstBaseTransform base_yadif;
 
   GstDeinterlaceMode mode;
+  guint n_threads;
 
   GstVideoInfo video_info;
+  YadifFilterLineFunc filter_line;
 
   GstVideoFrame prev_frame;
   GstVideoFrame cur_frame;
   GstVideoFrame next_frame;
   GstVideoFrame dest_frame;
+
+  /* slice-parallel filtering */
+  GstVideoStripePool *stripe_pool;
 };
 
 struct _GstYadifClass
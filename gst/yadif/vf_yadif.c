@@ -115,49 +115,201 @@ filter_line_c_16bit (guint16 * dst,
 FILTER}
 #endif
 
-void yadif_filter (GstYadif * yadif, int parity, int tff);
+/* Portable vector version of filter_line_c for targets without the x86
+ * assembly, using compiler vector extensions (NEON, AltiVec, ...). It
+ * handles 8 pixels at a time in 16 bit lanes */
+#if !HAVE_CPU_X86_64 && (defined (__clang__) || \
+    (defined (__GNUC__) && __GNUC__ >= 9))
+#define HAVE_FILTER_LINE_VECTOR 1
+
+typedef gint16 YadifVec __attribute__ ((vector_size (16)));
+typedef guint8 YadifVec8 __attribute__ ((vector_size (8)));
+
+static inline YadifVec
+vec_load (const guint8 * p)
+{
+  YadifVec8 v;
+
+  memcpy (&v, p, sizeof (v));
+  return __builtin_convertvector (v, YadifVec);
+}
+
+static inline YadifVec
+vec_abs (YadifVec a)
+{
+  YadifVec s = a >> 15;
+
+  return (a ^ s) - s;
+}
+
+static inline YadifVec
+vec_max (YadifVec a, YadifVec b)
+{
+  YadifVec m = a > b;
+
+  return (a & m) | (b & ~m);
+}
+
+static inline YadifVec
+vec_min (YadifVec a, YadifVec b)
+{
+  YadifVec m = a < b;
+
+  return (a & m) | (b & ~m);
+}
+
+static void
+filter_line_vector (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+
+  /* the spatial check is only done by the C version */
+  if (mrefs > 0 && prefs > 0) {
+    filter_line_c (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
+    return;
+  }
+
+  for (x = 0; x + 8 <= w; x += 8) {
+    YadifVec c = vec_load (cur + x + mrefs);
+    YadifVec e = vec_load (cur + x + prefs);
+    YadifVec p2 = vec_load (prev2 + x);
+    YadifVec n2 = vec_load (next2 + x);
+    YadifVec d = (p2 + n2) >> 1;
+    YadifVec temporal_diff0 = vec_abs (p2 - n2);
+    YadifVec temporal_diff1 = (vec_abs (vec_load (prev + x + mrefs) - c) +
+        vec_abs (vec_load (prev + x + prefs) - e)) >> 1;
+    YadifVec temporal_diff2 = (vec_abs (vec_load (next + x + mrefs) - c) +
+        vec_abs (vec_load (next + x + prefs) - e)) >> 1;
+    YadifVec diff = vec_max (vec_max (temporal_diff0 >> 1, temporal_diff1),
+        temporal_diff2);
+    YadifVec spatial_pred = (c + e) >> 1;
+    YadifVec8 out;
+
+    if (mode < 2) {
+      YadifVec b = (vec_load (prev2 + x + 2 * mrefs) +
+          vec_load (next2 + x + 2 * mrefs)) >> 1;
+      YadifVec f = (vec_load (prev2 + x + 2 * prefs) +
+          vec_load (next2 + x + 2 * prefs)) >> 1;
+      YadifVec max = vec_max (vec_max (d - e, d - c), vec_min (b - c, f - e));
+      YadifVec min = vec_min (vec_min (d - e, d - c), vec_max (b - c, f - e));
+
+      diff = vec_max (vec_max (diff, min), -max);
+    }
+
+    spatial_pred = vec_min (vec_max (spatial_pred, d - diff), d + diff);
+
+    out = __builtin_convertvector (spatial_pred, YadifVec8);
+    memcpy (dst + x, &out, sizeof (out));
+  }
+
+  if (x < w)
+    filter_line_c (dst + x, prev + x, cur + x, next + x, w - x, prefs, mrefs,
+        parity, mode);
+}
+#endif
+
+void yadif_filter_slice (GstYadif * yadif, int parity, int tff, int slice,
+    int n_slices);
+const YadifFilterLinePath *yadif_get_filter_line_paths (void);
+YadifFilterLineFunc yadif_get_filter_line (const gchar * name);
 #ifdef HAVE_CPU_X86_64
 void filter_line_x86_64 (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
     int w, int prefs, int mrefs, int parity, int mode);
+#if HAVE_FILTER_LINE_AVX2
+void filter_line_x86_64_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+#endif
 #endif
 
+/* The line filters the CPU supports, fastest first and ending with the C
+ * version, terminated by an entry without a name */
+const YadifFilterLinePath *
+yadif_get_filter_line_paths (void)
+{
+  static YadifFilterLinePath paths[4];
+  static gsize paths_init = 0;
+
+  if (g_once_init_enter (&paths_init)) {
+    guint n = 0;
+
+#if HAVE_CPU_X86_64
+#if HAVE_FILTER_LINE_AVX2
+    if (__builtin_cpu_supports ("avx2")) {
+      paths[n].name = "avx2";
+      paths[n++].func = filter_line_x86_64_avx2;
+    }
+#endif
+    paths[n].name = "sse2";
+    paths[n++].func = filter_line_x86_64;
+#elif HAVE_FILTER_LINE_VECTOR
+    paths[n].name = "vector";
+    paths[n++].func = filter_line_vector;
+#endif
+    paths[n].name = "c";
+    paths[n++].func = filter_line_c;
+
+    g_once_init_leave (&paths_init, 1);
+  }
+
+  return paths;
+}
+
+/* The line filter called @name, or the fastest one if @name is NULL or
+ * not supported */
+YadifFilterLineFunc
+yadif_get_filter_line (const gchar * name)
+{
+  const YadifFilterLinePath *paths = yadif_get_filter_line_paths ();
+  guint i;
+
+  for (i = 0; name && paths[i].name; i++) {
+    if (g_str_equal (paths[i].name, name))
+      return paths[i].func;
+  }
+
+  return paths[0].func;
+}
+
+/* Filters rows [h * slice / n_slices, h * (slice + 1) / n_slices) of each
+ * plane. Rows only depend on the input frames, so slices can run in
+ * parallel */
 void
-yadif_filter (GstYadif * yadif, int parity, int tff)
+yadif_filter_slice (GstYadif * yadif, int parity, int tff, int slice,
+    int n_slices)
 {
   int y, i;
   const GstVideoInfo *vi = &yadif->video_info;
   const GstVideoFormatInfo *vfi = vi->finfo;
+  YadifFilterLineFunc filter_line = yadif->filter_line;
 
   for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (vfi); i++) {
     int w = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (vfi, i, vi->width);
     int h = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (vfi, i, vi->height);
     int refs = GST_VIDEO_INFO_COMP_STRIDE (vi, i);
     int df = GST_VIDEO_INFO_COMP_PSTRIDE (vi, i);
+    int y_start = h * slice / n_slices;
+    int y_end = h * (slice + 1) / n_slices;
     guint8 *prev_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->prev_frame, i);
     guint8 *cur_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->cur_frame, i);
     guint8 *next_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->next_frame, i);
     guint8 *dest_data = GST_VIDEO_FRAME_COMP_DATA (&yadif->dest_frame, i);
 
-    for (y = 0; y < h; y++) {
+    for (y = y_start; y < y_end; y++) {
       if ((y ^ parity) & 1) {
         guint8 *prev = prev_data + y * refs;
         guint8 *cur = cur_data + y * refs;
         guint8 *next = next_data + y * refs;
         guint8 *dst = dest_data + y * refs;
         int mode = ((y == 1) || (y + 2 == h)) ? 2 : yadif->mode;
-#if HAVE_CPU_X86_64
-        if (0) {
-          filter_line_c (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        } else {
-          filter_line_x86_64 (dst, prev, cur, next, w,
-              y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-        }
-#else
-        filter_line_c (dst, prev, cur, next, w,
+
+        filter_line (dst, prev, cur, next, w,
             y + 1 < h ? refs : -refs, y ? -refs : refs, parity ^ tff, mode);
-#endif
       } else {
         guint8 *dst = dest_data + y * refs;
         guint8 *cur = cur_data + y * refs;
@@ -21,6 +21,9 @@
 #include "config.h"
 
 #include <glib.h>
+#include <string.h>
+
+#include "gstyadif.h"
 
 #if HAVE_CPU_X86_64
 
@@ -87,6 +90,9 @@ filter_line_x86_64 (guint8 * dst,
     guint8 * prev, guint8 * cur, guint8 * next,
     int w, int prefs, int mrefs, int parity, int mode)
 {
+  DECLARE_ALIGNED (16, guint8, tail)[8];
+  int n = w & ~7;
+
 #if 0
 #if HAVE_MMXEXT_INLINE
   if (cpu_flags & AV_CPU_FLAG_MMXEXT)
@@ -101,7 +107,149 @@ filter_line_x86_64 (guint8 * dst,
     yadif->filter_line = yadif_filter_line_ssse3;
 #endif
 #endif
-  yadif_filter_line_sse2 (dst, prev, cur, next, w, prefs, mrefs, parity, mode);
+  if (n > 0)
+    yadif_filter_line_sse2 (dst, prev, cur, next, n, prefs, mrefs, parity,
+        mode);
+
+  /* The assembly always stores 8 pixels, don't let it write past the end
+   * of the line as the next one might be handled by another thread */
+  if (n < w) {
+    yadif_filter_line_sse2 (tail, prev + n, cur + n, next + n, 8, prefs,
+        mrefs, parity, mode);
+    memcpy (dst + n, tail, w - n);
+  }
+}
+
+#if HAVE_FILTER_LINE_AVX2
+#include <immintrin.h>
+
+#define LOAD(p) _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) (p)))
+#define ABS_DIFF(a,b) _mm256_abs_epi16 (_mm256_sub_epi16 (a, b))
+
+/* cur[mrefs-1+j] vs cur[prefs-1-j] and their two right neighbours */
+#define SCORE(j) \
+    _mm256_add_epi16 (_mm256_add_epi16 ( \
+            ABS_DIFF (LOAD (cur + mrefs - 1 + (j)), LOAD (cur + prefs - 1 - (j))), \
+            ABS_DIFF (LOAD (cur + mrefs + (j)), LOAD (cur + prefs - (j)))), \
+        ABS_DIFF (LOAD (cur + mrefs + 1 + (j)), LOAD (cur + prefs + 1 - (j))))
+
+#define PRED(j) \
+    _mm256_srli_epi16 (_mm256_add_epi16 (LOAD (cur + mrefs + (j)), \
+            LOAD (cur + prefs - (j))), 1)
+
+/* Same as the C FILTER: the second direction is only used if the first one
+ * was better than the vertical prediction, which is done by making its
+ * score too large otherwise */
+#define CHECK(j1,j2) \
+    { \
+      __m256i score = SCORE (j1); \
+      __m256i better = _mm256_cmpgt_epi16 (spatial_score, score); \
+      spatial_score = _mm256_min_epi16 (spatial_score, score); \
+      spatial_pred = _mm256_blendv_epi8 (spatial_pred, PRED (j1), better); \
+      score = _mm256_adds_epi16 (SCORE (j2), \
+          _mm256_slli_epi16 (_mm256_add_epi16 (better, one), 14)); \
+      better = _mm256_cmpgt_epi16 (spatial_score, score); \
+      spatial_score = _mm256_min_epi16 (spatial_score, score); \
+      spatial_pred = _mm256_blendv_epi8 (spatial_pred, PRED (j2), better); \
+    }
+
+static int __attribute__ ((target ("avx2")))
+yadif_filter_line_avx2 (guint8 * dst, guint8 * prev, guint8 * cur,
+    guint8 * next, int w, int prefs, int mrefs, int parity, int mode)
+{
+  guint8 *prev2 = parity ? prev : cur;
+  guint8 *next2 = parity ? cur : next;
+  const __m256i one = _mm256_set1_epi16 (1);
+  int x;
+
+  for (x = 0; x + 16 <= w; x += 16) {
+    __m256i c = LOAD (cur + mrefs);
+    __m256i e = LOAD (cur + prefs);
+    __m256i p2 = LOAD (prev2);
+    __m256i n2 = LOAD (next2);
+    __m256i d = _mm256_srai_epi16 (_mm256_add_epi16 (p2, n2), 1);
+    __m256i temporal_diff0 = ABS_DIFF (p2, n2);
+    __m256i temporal_diff1 =
+        _mm256_srli_epi16 (_mm256_add_epi16 (ABS_DIFF (LOAD (prev + mrefs), c),
+            ABS_DIFF (LOAD (prev + prefs), e)), 1);
+    __m256i temporal_diff2 =
+        _mm256_srli_epi16 (_mm256_add_epi16 (ABS_DIFF (LOAD (next + mrefs), c),
+            ABS_DIFF (LOAD (next + prefs), e)), 1);
+    __m256i diff =
+        _mm256_max_epi16 (_mm256_max_epi16 (_mm256_srli_epi16 (temporal_diff0,
+                1), temporal_diff1), temporal_diff2);
+    __m256i spatial_pred = _mm256_srli_epi16 (_mm256_add_epi16 (c, e), 1);
+    __m256i spatial_score =
+        _mm256_sub_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (ABS_DIFF (LOAD
+                    (cur + mrefs - 1), LOAD (cur + prefs - 1)), ABS_DIFF (c,
+                    e)), ABS_DIFF (LOAD (cur + mrefs + 1), LOAD (cur + prefs +
+                    1))), one);
+
+    CHECK (-1, -2);
+    CHECK (1, 2);
+
+    if (mode < 2) {
+      __m256i b =
+          _mm256_srli_epi16 (_mm256_add_epi16 (LOAD (prev2 + 2 * mrefs),
+              LOAD (next2 + 2 * mrefs)), 1);
+      __m256i f =
+          _mm256_srli_epi16 (_mm256_add_epi16 (LOAD (prev2 + 2 * prefs),
+              LOAD (next2 + 2 * prefs)), 1);
+      __m256i dc = _mm256_sub_epi16 (d, c);
+      __m256i de = _mm256_sub_epi16 (d, e);
+      __m256i bc = _mm256_sub_epi16 (b, c);
+      __m256i fe = _mm256_sub_epi16 (f, e);
+      __m256i max = _mm256_max_epi16 (_mm256_max_epi16 (de, dc),
+          _mm256_min_epi16 (bc, fe));
+      __m256i min = _mm256_min_epi16 (_mm256_min_epi16 (de, dc),
+          _mm256_max_epi16 (bc, fe));
+
+      diff = _mm256_max_epi16 (_mm256_max_epi16 (diff, min),
+          _mm256_sub_epi16 (_mm256_setzero_si256 (), max));
+    }
+
+    spatial_pred = _mm256_max_epi16 (spatial_pred, _mm256_sub_epi16 (d, diff));
+    spatial_pred = _mm256_min_epi16 (spatial_pred, _mm256_add_epi16 (d, diff));
+
+    _mm_storeu_si128 ((__m128i *) dst,
+        _mm_packus_epi16 (_mm256_castsi256_si128 (spatial_pred),
+            _mm256_extracti128_si256 (spatial_pred, 1)));
+
+    dst += 16;
+    prev += 16;
+    cur += 16;
+    next += 16;
+    prev2 += 16;
+    next2 += 16;
+  }
+
+  return x;
 }
 
+#undef LOAD
+#undef ABS_DIFF
+#undef SCORE
+#undef PRED
+#undef CHECK
+
+void filter_line_x86_64_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode);
+
+/* 16 pixels at a time with AVX2, the rest of the line with SSE2 */
+void
+filter_line_x86_64_avx2 (guint8 * dst,
+    guint8 * prev, guint8 * cur, guint8 * next,
+    int w, int prefs, int mrefs, int parity, int mode)
+{
+  int x;
+
+  x = yadif_filter_line_avx2 (dst, prev, cur, next, w, prefs, mrefs, parity,
+      mode);
+  if (x < w)
+    filter_line_x86_64 (dst + x, prev + x, cur + x, next + x, w - x, prefs,
+        mrefs, parity, mode);
+}
+#endif
+
 #endif
@@ -25,18 +25,65 @@
 #endif
 
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <limits.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #include <gst/base/gstbytewriter.h>
 #include <gst/gstprotection.h>
+#include <gst/allocators/allocators.h>
 #include "gstipcpipelinecomm.h"
 
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+#ifdef SYS_memfd_create
+#define HAVE_COMM_MEMFD 1
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS (1024 + 9)
+#endif
+#ifndef F_SEAL_SEAL
+#define F_SEAL_SEAL 0x0001
+#endif
+#ifndef F_SEAL_SHRINK
+#define F_SEAL_SHRINK 0x0002
+#endif
+#endif
+
 GST_DEBUG_CATEGORY_STATIC (gst_ipc_pipeline_comm_debug);
 #define GST_CAT_DEFAULT gst_ipc_pipeline_comm_debug
 
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
 
+/* Buffers smaller than this are not worth a shared memory slot */
+#define COMM_SHM_MIN_BUFFER_SIZE 4096
+/* memfd slots are grown in steps of this size */
+#define COMM_SHM_SIZE_ALIGN (64 * 1024)
+/* slot, kind, new fd flag, mapping size, offset, buffer size */
+#define COMM_SHM_DESCRIPTOR_SIZE (4 + 1 + 1 + 8 + 8 + 4)
+#define COMM_MAX_RECEIVED_FDS 8
+/* largest single read when the announced payload is bigger than that */
+#define COMM_MAX_READ_SIZE (1 << 24)
+/* read buffers per size, reads are allocated when all are in use */
+#define COMM_READ_POOL_MAX_BUFFERS 16
+
 GQuark QUARK_ID;
+static GQuark QUARK_SHM_RELEASE;
 
 typedef enum
 {
@@ -54,6 +101,38 @@ typedef enum
   COMM_REQUEST_TYPE_MESSAGE,
 } CommRequestType;
 
+typedef enum
+{
+  COMM_SHM_KIND_POOL,
+  COMM_SHM_KIND_FD,
+  COMM_SHM_KIND_DMABUF
+} CommShmKind;
+
+typedef struct
+{
+  guint32 slot;
+  guint8 kind;
+  int fd;
+  guint64 map_size;
+  guint64 offset;
+  guint32 size;
+} CommShmDescriptor;
+
+struct _GstIpcPipelineCommShmMapping
+{
+  gint refcount;
+  guint8 *data;
+  gsize size;
+};
+
+typedef struct
+{
+  GstIpcPipelineComm *comm;
+  GstElement *element;
+  guint32 slot;
+  GstIpcPipelineCommShmMapping *mapping;
+} CommShmRelease;
+
 typedef struct
 {
   guint32 id;
@@ -128,6 +207,14 @@ comm_request_free (CommRequest * req)
   g_free (req);
 }
 
+static void
+comm_read_pool_free (GstBufferPool * pool)
+{
+  /* buffers still used downstream are freed when they come back */
+  gst_buffer_pool_set_active (pool, FALSE);
+  gst_object_unref (pool);
+}
+
 static const gchar *
 comm_request_ret_get_name (CommRequestType type, guint32 ret)
 {
@@ -186,6 +273,10 @@ gst_ipc_pipeline_comm_data_type_get_name (GstIpcPipelineCommDataType type)
       return "MESSAGE";
     case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
       return "GERROR_MESSAGE";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER:
+      return "SHM_BUFFER";
+    case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_RELEASE:
+      return "SHM_RELEASE";
     default:
       return "UNKNOWN";
   }
@@ -212,31 +303,74 @@ gst_ipc_pipeline_comm_sync_fd (GstIpcPipelineComm * comm, guint32 id,
   return !comm_error;
 }
 
+/* Writes all the vectors to fdout, in as few syscalls as possible. If fd
+ * is valid, it is passed along with the first byte. iov is modified. */
 static gboolean
-write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
+write_iov_to_fd (GstIpcPipelineComm * comm, struct iovec *iov, int n_iov,
+    int fd)
 {
-  size_t offset;
-  gboolean ret = TRUE;
-
-  offset = 0;
-  GST_TRACE_OBJECT (comm->element, "Writing %zu bytes to fdout", size);
-  while (size) {
-    ssize_t written =
-        write (comm->fdout, (const unsigned char *) data + offset, size);
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } control;
+
+  GST_TRACE_OBJECT (comm->element, "Writing %d vectors to fdout", n_iov);
+  while (n_iov > 0) {
+    ssize_t written;
+
+    if (fd >= 0) {
+      struct msghdr msg = { 0, };
+      struct cmsghdr *cmsg;
+
+      GST_TRACE_OBJECT (comm->element, "Passing fd %d", fd);
+      msg.msg_iov = iov;
+      msg.msg_iovlen = MIN (n_iov, IOV_MAX);
+      memset (&control, 0, sizeof (control));
+      msg.msg_control = control.buf;
+      msg.msg_controllen = sizeof (control.buf);
+      cmsg = CMSG_FIRSTHDR (&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+      memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+      written = sendmsg (comm->fdout, &msg, 0);
+    } else {
+      written = writev (comm->fdout, iov, MIN (n_iov, IOV_MAX));
+    }
     if (written < 0) {
       if (errno == EAGAIN || errno == EINTR)
         continue;
       GST_ERROR_OBJECT (comm->element, "Failed to write to fd: %s",
           strerror (errno));
-      ret = FALSE;
-      goto done;
+      return FALSE;
+    }
+
+    /* the fd went along with the first byte */
+    fd = -1;
+
+    while (n_iov > 0 && (size_t) written >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --n_iov;
+    }
+    if (n_iov > 0) {
+      iov->iov_base = (guint8 *) iov->iov_base + written;
+      iov->iov_len -= written;
     }
-    size -= written;
-    offset += written;
   }
 
-done:
-  return ret;
+  return TRUE;
+}
+
+static gboolean
+write_to_fd_raw (GstIpcPipelineComm * comm, const void *data, size_t size)
+{
+  struct iovec iov;
+
+  iov.iov_base = (void *) data;
+  iov.iov_len = size;
+  return write_iov_to_fd (comm, &iov, 1, -1);
 }
 
 static gboolean
@@ -496,18 +630,235 @@ typedef struct
   guint64 flags;
 } CommBufferMetadata;
 
+static gboolean
+gst_ipc_pipeline_comm_can_pass_fds (GstIpcPipelineComm * comm)
+{
+  struct stat st;
+
+  if (comm->shm_checked_fd != comm->fdout) {
+    comm->shm_checked_fd = comm->fdout;
+    comm->shm_can_pass_fds = fstat (comm->fdout, &st) == 0
+        && S_ISSOCK (st.st_mode);
+    if (!comm->shm_can_pass_fds)
+      GST_WARNING_OBJECT (comm->element, "fdout %d is not a socket, buffers "
+          "will not go through shared memory", comm->fdout);
+  }
+  return comm->shm_can_pass_fds;
+}
+
+static void
+gst_ipc_pipeline_comm_free_shm_slot (GstIpcPipelineCommShmSlot * slot)
+{
+  if (slot->data)
+    munmap (slot->data, slot->size);
+  if (slot->fd >= 0)
+    close (slot->fd);
+  if (slot->held)
+    gst_buffer_unref (slot->held);
+  slot->fd = -1;
+  slot->size = 0;
+  slot->data = NULL;
+  slot->busy = FALSE;
+  slot->fd_sent = FALSE;
+  slot->held = NULL;
+}
+
+#ifdef HAVE_COMM_MEMFD
+static gboolean
+gst_ipc_pipeline_comm_ensure_shm_slot_size (GstIpcPipelineComm * comm,
+    GstIpcPipelineCommShmSlot * slot, gsize size)
+{
+  if (slot->fd >= 0 && slot->size >= size)
+    return TRUE;
+
+  size = GST_ROUND_UP_N (size, COMM_SHM_SIZE_ALIGN);
+
+  if (slot->fd < 0) {
+    slot->fd = syscall (SYS_memfd_create, "gst-ipc-pipeline",
+        MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (slot->fd < 0)
+      goto create_failed;
+  }
+  if (slot->data) {
+    munmap (slot->data, slot->size);
+    slot->data = NULL;
+  }
+  if (ftruncate (slot->fd, size) < 0)
+    goto resize_failed;
+  /* The peer gets the fd too, make sure it can't shrink the memory under
+   * our mapping, nor add seals preventing us from growing it. Slots only
+   * grow, and the seals stay in place for the next resizes */
+  if (slot->size == 0 &&
+      fcntl (slot->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL) < 0)
+    goto resize_failed;
+  slot->data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      slot->fd, 0);
+  if (slot->data == MAP_FAILED) {
+    slot->data = NULL;
+    goto resize_failed;
+  }
+  slot->size = size;
+  /* the peer has to map it again to see the new size */
+  slot->fd_sent = FALSE;
+
+  GST_DEBUG_OBJECT (comm->element, "Shared memory slot %d now %"
+      G_GSIZE_FORMAT " bytes", (gint) (slot - comm->shm_slots), size);
+  return TRUE;
+
+create_failed:
+  GST_WARNING_OBJECT (comm->element, "Failed to create memfd: %s",
+      strerror (errno));
+  return FALSE;
+
+resize_failed:
+  GST_WARNING_OBJECT (comm->element, "Failed to resize memfd: %s",
+      strerror (errno));
+  gst_ipc_pipeline_comm_free_shm_slot (slot);
+  return FALSE;
+}
+#endif
+
+/* Called with comm->mutex held. Picks a shared memory slot for the buffer
+ * data and fills desc, or returns FALSE if the data should go inline */
+static gboolean
+gst_ipc_pipeline_comm_get_shm_slot (GstIpcPipelineComm * comm,
+    GstBuffer * buffer, CommShmDescriptor * desc)
+{
+  GstIpcPipelineCommShmSlot *slot = NULL;
+  GstMemory *mem;
+  gsize size;
+  guint i;
+
+  if (!comm->shm)
+    return FALSE;
+
+  size = gst_buffer_get_size (buffer);
+  if (size < COMM_SHM_MIN_BUFFER_SIZE || size > G_MAXUINT32)
+    return FALSE;
+
+  if (!gst_ipc_pipeline_comm_can_pass_fds (comm))
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (gst_buffer_n_memory (buffer) == 1 && gst_is_fd_memory (mem)) {
+    /* Pass the fd of the buffer itself, and keep the buffer alive until
+     * the peer is done with it. Prefer slots without a memfd. */
+    for (i = 0; i < GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS; ++i) {
+      GstIpcPipelineCommShmSlot *s = &comm->shm_slots[i];
+
+      if (s->busy)
+        continue;
+      if (!slot || (slot->fd >= 0 && s->fd < 0))
+        slot = s;
+    }
+    if (!slot)
+      return FALSE;
+    gst_ipc_pipeline_comm_free_shm_slot (slot);
+
+    slot->busy = TRUE;
+    slot->held = gst_buffer_ref (buffer);
+    desc->kind =
+        gst_is_dmabuf_memory (mem) ? COMM_SHM_KIND_DMABUF : COMM_SHM_KIND_FD;
+    desc->fd = gst_fd_memory_get_fd (mem);
+    desc->map_size = mem->maxsize;
+    desc->offset = mem->offset;
+  } else {
+#ifdef HAVE_COMM_MEMFD
+    GstIpcPipelineCommShmSlot *grow = NULL, *empty = NULL;
+
+    /* a free memfd large enough, else one to grow, else a new one */
+    for (i = 0; i < GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS && !slot; ++i) {
+      GstIpcPipelineCommShmSlot *s = &comm->shm_slots[i];
+
+      if (s->busy)
+        continue;
+      if (s->fd < 0) {
+        if (!empty)
+          empty = s;
+      } else if (s->size >= size) {
+        slot = s;
+      } else if (!grow) {
+        grow = s;
+      }
+    }
+    if (!slot)
+      slot = grow ? grow : empty;
+    if (!slot)
+      return FALSE;
+    if (!gst_ipc_pipeline_comm_ensure_shm_slot_size (comm, slot, size))
+      return FALSE;
+
+    slot->busy = TRUE;
+    gst_buffer_extract (buffer, 0, slot->data, size);
+    desc->kind = COMM_SHM_KIND_POOL;
+    desc->fd = slot->fd_sent ? -1 : slot->fd;
+    desc->map_size = slot->size;
+    desc->offset = 0;
+#else
+    return FALSE;
+#endif
+  }
+
+  desc->slot = slot - comm->shm_slots;
+  desc->size = size;
+
+  GST_TRACE_OBJECT (comm->element, "Using shared memory slot %u, kind %u, "
+      "fd %d", desc->slot, desc->kind, desc->fd);
+  return TRUE;
+}
+
+/* Called with comm->mutex held */
+static void
+gst_ipc_pipeline_comm_release_shm_slot (GstIpcPipelineComm * comm,
+    guint32 n)
+{
+  GstIpcPipelineCommShmSlot *slot;
+
+  if (n >= GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS || !comm->shm_slots[n].busy) {
+    GST_WARNING_OBJECT (comm->element, "Release of unused shared memory "
+        "slot %u", n);
+    return;
+  }
+
+  GST_TRACE_OBJECT (comm->element, "Releasing shared memory slot %u", n);
+  slot = &comm->shm_slots[n];
+  slot->busy = FALSE;
+  if (slot->held) {
+    gst_buffer_unref (slot->held);
+    slot->held = NULL;
+  }
+}
+
+void
+gst_ipc_pipeline_comm_reset_shm (GstIpcPipelineComm * comm)
+{
+  guint i;
+
+  g_mutex_lock (&comm->mutex);
+  for (i = 0; i < GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS; ++i)
+    gst_ipc_pipeline_comm_free_shm_slot (&comm->shm_slots[i]);
+  comm->shm_checked_fd = -1;
+  g_mutex_unlock (&comm->mutex);
+}
+
 GstFlowReturn
 gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
     GstBuffer * buffer)
 {
-  const unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
-  GstMapInfo map;
+  unsigned char payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER;
   guint32 ret32 = GST_FLOW_OK;
   guint32 size, n;
   CommBufferMetadata meta;
   GstFlowReturn ret;
   MetaListRepresentation repr = { comm, 0, 4, NULL };   /* starts a 4 for n_meta */
-  GstByteWriter bw;
+  GstByteWriter bw, mbw;
+  CommShmDescriptor desc;
+  gboolean shm;
+  guint n_mem = 0, n_mapped = 0, n_iov = 0;
+  GstMapInfo *maps = NULL;
+  struct iovec *iov;
+  guint8 *header = NULL, *metas = NULL;
+  guint header_size, metas_size;
 
   g_mutex_lock (&comm->mutex);
   ++comm->send_id;
@@ -516,6 +867,7 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
       comm->send_id, buffer);
 
   gst_byte_writer_init (&bw);
+  gst_byte_writer_init (&mbw);
 
   meta.pts = GST_BUFFER_PTS (buffer);
   meta.dts = GST_BUFFER_DTS (buffer);
@@ -527,66 +879,107 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
   /* work out meta size */
   gst_buffer_foreach_meta (buffer, build_meta, &repr);
 
+  shm = gst_ipc_pipeline_comm_get_shm_slot (comm, buffer, &desc);
+  if (shm)
+    payload_type = GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER;
+
   if (!gst_byte_writer_put_uint8 (&bw, payload_type))
     goto write_failed;
   if (!gst_byte_writer_put_uint32_le (&bw, comm->send_id))
     goto write_failed;
-  size =
-      gst_buffer_get_size (buffer) + sizeof (guint32) +
-      sizeof (CommBufferMetadata) + repr.total_bytes;
+  if (shm) {
+    size = COMM_SHM_DESCRIPTOR_SIZE;
+  } else {
+    size = gst_buffer_get_size (buffer) + sizeof (guint32);
+  }
+  size += sizeof (CommBufferMetadata) + repr.total_bytes;
   if (!gst_byte_writer_put_uint32_le (&bw, size))
     goto write_failed;
   if (!gst_byte_writer_put_data (&bw, (const guint8 *) &meta, sizeof (meta)))
     goto write_failed;
-  size = gst_buffer_get_size (buffer);
-  if (!gst_byte_writer_put_uint32_le (&bw, size))
-    goto write_failed;
-  if (!write_byte_writer_to_fd (comm, &bw))
-    goto write_failed;
 
-  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
-    goto map_failed;
-  ret = write_to_fd_raw (comm, map.data, map.size);
-  gst_buffer_unmap (buffer, &map);
-  if (!ret)
-    goto write_failed;
+  if (shm) {
+    /* only a descriptor of the data goes through fdout */
+    if (!gst_byte_writer_put_uint32_le (&bw, desc.slot))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint8 (&bw, desc.kind))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint8 (&bw, desc.fd >= 0))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, desc.map_size))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint64_le (&bw, desc.offset))
+      goto write_failed;
+    if (!gst_byte_writer_put_uint32_le (&bw, desc.size))
+      goto write_failed;
+  } else {
+    size = gst_buffer_get_size (buffer);
+    if (!gst_byte_writer_put_uint32_le (&bw, size))
+      goto write_failed;
+    n_mem = gst_buffer_n_memory (buffer);
+  }
 
   /* meta */
-  gst_byte_writer_init (&bw);
-  if (!gst_byte_writer_put_uint32_le (&bw, repr.n_meta))
+  if (!gst_byte_writer_put_uint32_le (&mbw, repr.n_meta))
     goto write_failed;
   for (n = 0; n < repr.n_meta; ++n) {
     const MetaBuildInfo *info = repr.info + n;
     guint32 len;
     const char *s;
 
-    if (!gst_byte_writer_put_uint32_le (&bw, info->bytes))
+    if (!gst_byte_writer_put_uint32_le (&mbw, info->bytes))
       goto write_failed;
 
-    if (!gst_byte_writer_put_uint32_le (&bw, info->flags))
+    if (!gst_byte_writer_put_uint32_le (&mbw, info->flags))
       goto write_failed;
 
     s = g_type_name (info->api);
     len = strlen (s) + 1;
-    if (!gst_byte_writer_put_uint32_le (&bw, len))
+    if (!gst_byte_writer_put_uint32_le (&mbw, len))
       goto write_failed;
-    if (!gst_byte_writer_put_data (&bw, (const guint8 *) s, len))
+    if (!gst_byte_writer_put_data (&mbw, (const guint8 *) s, len))
       goto write_failed;
 
-    if (!gst_byte_writer_put_uint64_le (&bw, info->size))
+    if (!gst_byte_writer_put_uint64_le (&mbw, info->size))
       goto write_failed;
 
     s = info->str;
     len = s ? (strlen (s) + 1) : 0;
-    if (!gst_byte_writer_put_uint32_le (&bw, len))
+    if (!gst_byte_writer_put_uint32_le (&mbw, len))
       goto write_failed;
     if (len)
-      if (!gst_byte_writer_put_data (&bw, (const guint8 *) s, len))
+      if (!gst_byte_writer_put_data (&mbw, (const guint8 *) s, len))
         goto write_failed;
   }
 
-  if (!write_byte_writer_to_fd (comm, &bw))
+  /* header, each memory of the buffer and the metas all go in one
+   * vectored write, without merging the memories */
+  header_size = gst_byte_writer_get_size (&bw);
+  header = gst_byte_writer_reset_and_get_data (&bw);
+  metas_size = gst_byte_writer_get_size (&mbw);
+  metas = gst_byte_writer_reset_and_get_data (&mbw);
+  if (!header || !metas)
+    goto write_failed;
+
+  iov = g_newa (struct iovec, n_mem + 2);
+  maps = g_newa (GstMapInfo, n_mem);
+  iov[n_iov].iov_base = header;
+  iov[n_iov++].iov_len = header_size;
+  for (n_mapped = 0; n_mapped < n_mem; ++n_mapped) {
+    GstMemory *mem = gst_buffer_peek_memory (buffer, n_mapped);
+
+    if (!gst_memory_map (mem, &maps[n_mapped], GST_MAP_READ))
+      goto map_failed;
+    iov[n_iov].iov_base = maps[n_mapped].data;
+    iov[n_iov++].iov_len = maps[n_mapped].size;
+  }
+  iov[n_iov].iov_base = metas;
+  iov[n_iov++].iov_len = metas_size;
+
+  if (!write_iov_to_fd (comm, iov, n_iov, shm ? desc.fd : -1))
     goto write_failed;
+  if (shm && desc.kind == COMM_SHM_KIND_POOL)
+    comm->shm_slots[desc.slot].fd_sent = TRUE;
 
   if (!gst_ipc_pipeline_comm_sync_fd (comm, comm->send_id, NULL, &ret32,
           ACK_TYPE_BLOCKING, COMM_REQUEST_TYPE_BUFFER))
@@ -595,7 +988,12 @@ gst_ipc_pipeline_comm_write_buffer_to_fd (GstIpcPipelineComm * comm,
 
 done:
   g_mutex_unlock (&comm->mutex);
+  for (n = 0; n < n_mapped; ++n)
+    gst_memory_unmap (gst_buffer_peek_memory (buffer, n), &maps[n]);
   gst_byte_writer_reset (&bw);
+  gst_byte_writer_reset (&mbw);
+  g_free (header);
+  g_free (metas);
   for (n = 0; n < repr.n_meta; ++n)
     g_free (repr.info[n].str);
   g_free (repr.info);
@@ -604,6 +1002,8 @@ done:
 write_failed:
   GST_ELEMENT_ERROR (comm->element, RESOURCE, WRITE, (NULL),
       ("Failed to write to socket"));
+  if (shm)
+    gst_ipc_pipeline_comm_release_shm_slot (comm, desc.slot);
   ret = GST_FLOW_COMM_ERROR;
   goto done;
 
@@ -620,37 +1020,265 @@ map_failed:
   goto done;
 }
 
+static GstIpcPipelineCommShmMapping *
+comm_shm_mapping_new (int fd, gsize size)
+{
+  GstIpcPipelineCommShmMapping *mapping;
+  guint8 *data;
+
+  data = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    return NULL;
+
+  mapping = g_slice_new (GstIpcPipelineCommShmMapping);
+  mapping->refcount = 1;
+  mapping->data = data;
+  mapping->size = size;
+  return mapping;
+}
+
+static GstIpcPipelineCommShmMapping *
+comm_shm_mapping_ref (GstIpcPipelineCommShmMapping * mapping)
+{
+  g_atomic_int_inc (&mapping->refcount);
+  return mapping;
+}
+
+static void
+comm_shm_mapping_unref (GstIpcPipelineCommShmMapping * mapping)
+{
+  if (g_atomic_int_dec_and_test (&mapping->refcount)) {
+    munmap (mapping->data, mapping->size);
+    g_slice_free (GstIpcPipelineCommShmMapping, mapping);
+  }
+}
+
+static void
+gst_ipc_pipeline_comm_write_shm_release_to_fd (GstIpcPipelineComm * comm,
+    guint32 slot)
+{
+  const unsigned char payload_type =
+      GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_RELEASE;
+  GstByteWriter bw;
+
+  g_mutex_lock (&comm->mutex);
+
+  /* the peer is gone, and its slots along with it */
+  if (comm->fdout < 0)
+    goto done;
+
+  GST_TRACE_OBJECT (comm->element, "Writing release of shared memory slot %u",
+      slot);
+  gst_byte_writer_init (&bw);
+  if (!gst_byte_writer_put_uint8 (&bw, payload_type))
+    goto write_failed;
+  if (!gst_byte_writer_put_uint32_le (&bw, 0))
+    goto write_failed;
+  if (!gst_byte_writer_put_uint32_le (&bw, sizeof (slot)))
+    goto write_failed;
+  if (!gst_byte_writer_put_uint32_le (&bw, slot))
+    goto write_failed;
+
+  if (!write_byte_writer_to_fd (comm, &bw))
+    goto write_failed;
+
+  gst_byte_writer_reset (&bw);
+
+done:
+  g_mutex_unlock (&comm->mutex);
+  return;
+
+write_failed:
+  gst_byte_writer_reset (&bw);
+  GST_WARNING_OBJECT (comm->element,
+      "Failed to release shared memory slot %u", slot);
+  goto done;
+}
+
+static CommShmRelease *
+comm_shm_release_new (GstIpcPipelineComm * comm, guint32 slot,
+    GstIpcPipelineCommShmMapping * mapping)
+{
+  CommShmRelease *release;
+
+  release = g_slice_new (CommShmRelease);
+  release->comm = comm;
+  release->element = gst_object_ref (comm->element);
+  release->slot = slot;
+  release->mapping = mapping ? comm_shm_mapping_ref (mapping) : NULL;
+  return release;
+}
+
+/* called when the memory of a shared memory buffer is freed */
+static void
+comm_shm_release_free (gpointer data)
+{
+  CommShmRelease *release = data;
+
+  gst_ipc_pipeline_comm_write_shm_release_to_fd (release->comm, release->slot);
+  if (release->mapping)
+    comm_shm_mapping_unref (release->mapping);
+  gst_object_unref (release->element);
+  g_slice_free (CommShmRelease, release);
+}
+
+/* Reads a shared memory descriptor and wraps the memory it points to */
+static GstMemory *
+gst_ipc_pipeline_comm_read_shm_memory (GstIpcPipelineComm * comm,
+    const guint8 * payload, guint32 * buffer_data_size)
+{
+  GstIpcPipelineCommShmMapping *mapping;
+  CommShmDescriptor desc;
+  GstMemory *mem = NULL;
+  guint8 new_fd;
+  int fd = -1;
+
+  memcpy (&desc.slot, payload, sizeof (desc.slot));
+  payload += sizeof (desc.slot);
+  desc.kind = *payload++;
+  new_fd = *payload++;
+  memcpy (&desc.map_size, payload, sizeof (desc.map_size));
+  payload += sizeof (desc.map_size);
+  memcpy (&desc.offset, payload, sizeof (desc.offset));
+  payload += sizeof (desc.offset);
+  memcpy (&desc.size, payload, sizeof (desc.size));
+  *buffer_data_size = desc.size;
+
+  if (new_fd) {
+    if (g_queue_is_empty (&comm->shm_received_fds)) {
+      GST_ERROR_OBJECT (comm->element, "No fd received for shared memory "
+          "slot %u", desc.slot);
+      return NULL;
+    }
+    fd = GPOINTER_TO_INT (g_queue_pop_head (&comm->shm_received_fds));
+  }
+
+  /* offset comes from the peer, don't let it wrap around */
+  if (desc.slot >= GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS
+      || desc.offset > desc.map_size
+      || desc.size > desc.map_size - desc.offset)
+    goto invalid;
+
+  /* mapping past the end of the file would fault when reading */
+  if (fd >= 0) {
+    off_t fd_size = lseek (fd, 0, SEEK_END);
+
+    if (fd_size < 0 || (guint64) fd_size < desc.map_size)
+      goto invalid;
+  }
+
+  switch (desc.kind) {
+    case COMM_SHM_KIND_POOL:
+      if (fd >= 0) {
+        mapping = comm_shm_mapping_new (fd, desc.map_size);
+        if (!mapping) {
+          GST_ERROR_OBJECT (comm->element, "Failed to map shared memory: %s",
+              strerror (errno));
+          goto failed;
+        }
+        close (fd);
+        fd = -1;
+        if (comm->shm_maps[desc.slot])
+          comm_shm_mapping_unref (comm->shm_maps[desc.slot]);
+        comm->shm_maps[desc.slot] = mapping;
+      }
+      mapping = comm->shm_maps[desc.slot];
+      if (!mapping || desc.offset > mapping->size
+          || desc.size > mapping->size - desc.offset)
+        goto invalid;
+      mem = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, mapping->data,
+          mapping->size, desc.offset, desc.size,
+          comm_shm_release_new (comm, desc.slot, mapping),
+          comm_shm_release_free);
+      break;
+    case COMM_SHM_KIND_FD:
+    case COMM_SHM_KIND_DMABUF:
+      if (fd < 0)
+        goto invalid;
+      if (desc.kind == COMM_SHM_KIND_DMABUF) {
+        if (!comm->dmabuf_allocator)
+          comm->dmabuf_allocator = gst_dmabuf_allocator_new ();
+        mem = gst_dmabuf_allocator_alloc (comm->dmabuf_allocator, fd,
+            desc.map_size);
+      } else {
+        if (!comm->fd_allocator)
+          comm->fd_allocator = gst_fd_allocator_new ();
+        mem = gst_fd_allocator_alloc (comm->fd_allocator, fd, desc.map_size,
+            GST_FD_MEMORY_FLAG_NONE);
+      }
+      if (!mem)
+        goto failed;
+      /* the memory owns the fd now */
+      fd = -1;
+      /* this is the sender's own buffer, which it may still be using */
+      GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+      gst_memory_resize (mem, desc.offset, desc.size);
+      gst_mini_object_set_qdata (GST_MINI_OBJECT (mem), QUARK_SHM_RELEASE,
+          comm_shm_release_new (comm, desc.slot, NULL), comm_shm_release_free);
+      break;
+    default:
+      goto invalid;
+  }
+
+  GST_TRACE_OBJECT (comm->element, "Got %u bytes from shared memory slot %u, "
+      "kind %u", desc.size, desc.slot, desc.kind);
+  return mem;
+
+invalid:
+  GST_ERROR_OBJECT (comm->element, "Invalid shared memory descriptor: slot "
+      "%u, kind %u, offset %" G_GUINT64_FORMAT ", size %u", desc.slot,
+      desc.kind, desc.offset, desc.size);
+failed:
+  if (fd >= 0)
+    close (fd);
+  return NULL;
+}
+
 static GstBuffer *
-gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size)
+gst_ipc_pipeline_comm_read_buffer (GstIpcPipelineComm * comm, guint32 size,
+    gboolean shm)
 {
   GstBuffer *buffer;
+  GstMemory *mem = NULL;
   CommBufferMetadata meta;
   guint32 n_meta, n;
   const guint8 *payload = NULL;
   guint32 mapped_size, buffer_data_size;
 
+  mapped_size = sizeof (CommBufferMetadata) +
+      (shm ? COMM_SHM_DESCRIPTOR_SIZE : sizeof (buffer_data_size));
+
   /* this should not be called if we don't have enough yet */
   g_return_val_if_fail (gst_adapter_available (comm->adapter) >= size, NULL);
-  g_return_val_if_fail (size >= sizeof (CommBufferMetadata), NULL);
+  g_return_val_if_fail (size >= mapped_size, NULL);
 
-  mapped_size = sizeof (CommBufferMetadata) + sizeof (buffer_data_size);
   payload = gst_adapter_map (comm->adapter, mapped_size);
   if (!payload)
     return NULL;
   memcpy (&meta, payload, sizeof (CommBufferMetadata));
   payload += sizeof (CommBufferMetadata);
-  memcpy (&buffer_data_size, payload, sizeof (buffer_data_size));
+  if (shm) {
+    mem = gst_ipc_pipeline_comm_read_shm_memory (comm, payload,
+        &buffer_data_size);
+  } else {
+    memcpy (&buffer_data_size, payload, sizeof (buffer_data_size));
+  }
   size -= mapped_size;
   gst_adapter_unmap (comm->adapter);
   gst_adapter_flush (comm->adapter, mapped_size);
 
-  if (buffer_data_size == 0) {
+  if (shm) {
+    if (!mem)
+      return NULL;
+    buffer = gst_buffer_new ();
+    gst_buffer_append_memory (buffer, mem);
+  } else if (buffer_data_size == 0) {
     buffer = gst_buffer_new ();
   } else {
     buffer = gst_adapter_get_buffer (comm->adapter, buffer_data_size);
     gst_adapter_flush (comm->adapter, buffer_data_size);
+    size -= buffer_data_size;
   }
-  size -= buffer_data_size;
 
   GST_BUFFER_PTS (buffer) = meta.pts;
   GST_BUFFER_DTS (buffer) = meta.dts;
@@ -1597,6 +2225,8 @@ done:
 void
 gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
 {
+  guint i;
+
   g_mutex_init (&comm->mutex);
   comm->element = element;
   comm->fdin = comm->fdout = -1;
@@ -1605,14 +2235,38 @@ gst_ipc_pipeline_comm_init (GstIpcPipelineComm * comm, GstElement * element)
       g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
       (GDestroyNotify) comm_request_free);
   comm->adapter = gst_adapter_new ();
+  comm->read_pools =
+      g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) comm_read_pool_free);
   comm->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&comm->pollFDin);
+
+  comm->shm_checked_fd = -1;
+  for (i = 0; i < GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS; ++i)
+    comm->shm_slots[i].fd = -1;
+  comm->plain_fdin = -1;
+  g_queue_init (&comm->shm_received_fds);
 }
 
 void
 gst_ipc_pipeline_comm_clear (GstIpcPipelineComm * comm)
 {
+  guint i;
+
+  for (i = 0; i < GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS; ++i) {
+    gst_ipc_pipeline_comm_free_shm_slot (&comm->shm_slots[i]);
+    if (comm->shm_maps[i])
+      comm_shm_mapping_unref (comm->shm_maps[i]);
+  }
+  while (!g_queue_is_empty (&comm->shm_received_fds))
+    close (GPOINTER_TO_INT (g_queue_pop_head (&comm->shm_received_fds)));
+  if (comm->fd_allocator)
+    gst_object_unref (comm->fd_allocator);
+  if (comm->dmabuf_allocator)
+    gst_object_unref (comm->dmabuf_allocator);
+
   g_hash_table_destroy (comm->waiting_ids);
+  g_hash_table_destroy (comm->read_pools);
   gst_object_unref (comm->adapter);
   gst_poll_free (comm->poll);
   g_mutex_clear (&comm->mutex);
@@ -1699,11 +2353,131 @@ gst_ipc_pipeline_comm_reply_request (GstIpcPipelineComm * comm, guint32 id,
   return TRUE;
 }
 
+/* Reads from fd, queueing any fd passed along with the data */
+static ssize_t
+read_from_fd (GstIpcPipelineComm * comm, int fd, void *data, size_t size)
+{
+  struct msghdr msg = { 0, };
+  struct iovec iov;
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int) * COMM_MAX_RECEIVED_FDS)];
+  } control;
+  struct cmsghdr *cmsg;
+  ssize_t sz;
+  int flags = 0;
+
+  if (fd == comm->plain_fdin)
+    return read (fd, data, size);
+
+  iov.iov_base = data;
+  iov.iov_len = size;
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+#ifdef MSG_CMSG_CLOEXEC
+  flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+  sz = recvmsg (fd, &msg, flags);
+  if (sz < 0 && errno == ENOTSOCK) {
+    /* a pipe, no fds can come through it */
+    comm->plain_fdin = fd;
+    return read (fd, data, size);
+  }
+  if (sz <= 0)
+    return sz;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    guint n, n_fds;
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+    n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+    for (n = 0; n < n_fds; ++n) {
+      int rfd;
+
+      memcpy (&rfd, CMSG_DATA (cmsg) + n * sizeof (int), sizeof (int));
+      GST_TRACE_OBJECT (comm->element, "Received fd %d", rfd);
+      g_queue_push_tail (&comm->shm_received_fds, GINT_TO_POINTER (rfd));
+    }
+  }
+  if (msg.msg_flags & MSG_CTRUNC)
+    GST_WARNING_OBJECT (comm->element, "Some received fds were dropped");
+
+  return sz;
+}
+
+typedef struct
+{
+  GstBuffer *buffer;
+  GstMapInfo map;
+} CommReadBuffer;
+
+static void
+comm_read_buffer_free (CommReadBuffer * read)
+{
+  gst_buffer_unmap (read->buffer, &read->map);
+  gst_buffer_unref (read->buffer);
+  g_slice_free (CommReadBuffer, read);
+}
+
+/* Returns a buffer of at least @size bytes to read into. Inline buffer data
+ * is handed downstream as sub-buffers of what was read here
+ * (gst_adapter_get_buffer), so the pooled buffer is not read into directly:
+ * the returned buffer wraps its memory and keeps it out of the pool until
+ * the last sub-buffer is gone. Sizes are rounded up to a power of two so
+ * that only a few pools are used */
+static GstBuffer *
+gst_ipc_pipeline_comm_get_read_buffer (GstIpcPipelineComm * comm, gsize size)
+{
+  GstBufferPoolAcquireParams params = { 0, };
+  GstBufferPool *pool;
+  GstBuffer *pooled = NULL;
+  CommReadBuffer *read;
+
+  size = MIN ((gsize) 1 << g_bit_storage (size - 1), COMM_MAX_READ_SIZE);
+
+  pool = g_hash_table_lookup (comm->read_pools, GSIZE_TO_POINTER (size));
+  if (!pool) {
+    GstStructure *config;
+
+    pool = gst_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, NULL, size, 0,
+        COMM_READ_POOL_MAX_BUFFERS);
+    if (!gst_buffer_pool_set_config (pool, config)
+        || !gst_buffer_pool_set_active (pool, TRUE)) {
+      GST_WARNING_OBJECT (comm->element, "Failed to set up read pool");
+      gst_object_unref (pool);
+      return gst_buffer_new_allocate (NULL, size, NULL);
+    }
+    g_hash_table_insert (comm->read_pools, GSIZE_TO_POINTER (size), pool);
+  }
+
+  /* all of them are still used downstream, don't wait for one */
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+  if (gst_buffer_pool_acquire_buffer (pool, &pooled, &params) != GST_FLOW_OK)
+    return gst_buffer_new_allocate (NULL, size, NULL);
+
+  read = g_slice_new (CommReadBuffer);
+  read->buffer = pooled;
+  if (!gst_buffer_map (pooled, &read->map, GST_MAP_WRITE)) {
+    g_slice_free (CommReadBuffer, read);
+    gst_buffer_unref (pooled);
+    return gst_buffer_new_allocate (NULL, size, NULL);
+  }
+
+  return gst_buffer_new_wrapped_full (0, read->map.data, read->map.size, 0,
+      read->map.size, read, (GDestroyNotify) comm_read_buffer_free);
+}
+
 static gint
 update_adapter (GstIpcPipelineComm * comm)
 {
-  GstMemory *mem = NULL;
-  GstBuffer *buf;
+  GstBuffer *buf = NULL;
   GstMapInfo map;
   ssize_t sz;
   gint ret = 0;
@@ -1741,12 +2515,27 @@ again:
   /* read from fdin if possible and push data to our adapter */
   if (comm->pollFDin.fd >= 0
       && gst_poll_fd_can_read (comm->poll, &comm->pollFDin)) {
-    if (!mem)
-      mem = gst_allocator_alloc (NULL, comm->read_chunk_size, NULL);
+    gsize size = comm->read_chunk_size;
+
+    /* read the rest of the payload being received in one go */
+    if (comm->state != GST_IPC_PIPELINE_COMM_STATE_TYPE) {
+      gsize available = gst_adapter_available (comm->adapter);
 
-    gst_memory_map (mem, &map, GST_MAP_WRITE);
-    sz = read (comm->pollFDin.fd, map.data, map.size);
-    gst_memory_unmap (mem, &map);
+      if (comm->payload_length > available)
+        size = CLAMP (comm->payload_length - available, size,
+            COMM_MAX_READ_SIZE);
+    }
+
+    if (buf && gst_buffer_get_size (buf) < size) {
+      gst_buffer_unref (buf);
+      buf = NULL;
+    }
+    if (!buf)
+      buf = gst_ipc_pipeline_comm_get_read_buffer (comm, size);
+
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    sz = read_from_fd (comm, comm->pollFDin.fd, map.data, map.size);
+    gst_buffer_unmap (buf, &map);
 
     if (sz <= 0) {
       if (errno == EAGAIN)
@@ -1755,17 +2544,15 @@ again:
       if (errno != EINTR)
         ret = 1;
     } else {
-      gst_memory_resize (mem, 0, sz);
-      buf = gst_buffer_new ();
-      gst_buffer_append_memory (buf, mem);
-      mem = NULL;
+      gst_buffer_resize (buf, 0, sz);
       GST_TRACE_OBJECT (comm->element, "Read %u bytes from fd", (unsigned) sz);
       gst_adapter_push (comm->adapter, buf);
+      buf = NULL;
     }
   }
 
-  if (mem)
-    gst_memory_unref (mem);
+  if (buf)
+    gst_buffer_unref (buf);
 
   return ret;
 }
@@ -1775,28 +2562,26 @@ read_many (GstIpcPipelineComm * comm)
 {
   gboolean ret = TRUE;
   gsize available;
-  const guint8 *payload;
 
   while (1)
     switch (comm->state) {
       case GST_IPC_PIPELINE_COMM_STATE_TYPE:
       {
+        guint8 header[1 + sizeof (guint32) * 2];
         guint8 type;
-        guint32 mapped_size;
 
         available = gst_adapter_available (comm->adapter);
-        mapped_size = 1 + sizeof (gint32) * 2;
-        if (available < mapped_size)
+        if (available < sizeof (header))
           goto done;
 
-        payload = gst_adapter_map (comm->adapter, mapped_size);
-        type = *payload++;
+        /* copy rather than map, the header often spans two reads */
+        gst_adapter_copy (comm->adapter, header, 0, sizeof (header));
+        gst_adapter_flush (comm->adapter, sizeof (header));
+        type = header[0];
         g_mutex_lock (&comm->mutex);
-        memcpy (&comm->id, payload, sizeof (guint32));
-        memcpy (&comm->payload_length, payload + 4, sizeof (guint32));
+        memcpy (&comm->id, header + 1, sizeof (guint32));
+        memcpy (&comm->payload_length, header + 5, sizeof (guint32));
         g_mutex_unlock (&comm->mutex);
-        gst_adapter_unmap (comm->adapter);
-        gst_adapter_flush (comm->adapter, mapped_size);
         GST_TRACE_OBJECT (comm->element, "Got id %u, type %d, payload %u",
             comm->id, type, comm->payload_length);
         switch (type) {
@@ -1810,6 +2595,8 @@ read_many (GstIpcPipelineComm * comm)
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE:
           case GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER:
+          case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_RELEASE:
             GST_TRACE_OBJECT (comm->element, "switching to state %s",
                 gst_ipc_pipeline_comm_data_type_get_name (type));
             comm->state = type;
@@ -1821,7 +2608,6 @@ read_many (GstIpcPipelineComm * comm)
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_ACK:
       {
-        const guint8 *rets;
         guint32 ret32;
 
         available = gst_adapter_available (comm->adapter);
@@ -1831,9 +2617,7 @@ read_many (GstIpcPipelineComm * comm)
         if (available < sizeof (guint32))
           goto ack_failed;
 
-        rets = gst_adapter_map (comm->adapter, sizeof (guint32));
-        memcpy (&ret32, rets, sizeof (ret32));
-        gst_adapter_unmap (comm->adapter);
+        gst_adapter_copy (comm->adapter, &ret32, 0, sizeof (ret32));
         gst_adapter_flush (comm->adapter, sizeof (guint32));
         GST_TRACE_OBJECT (comm->element, "Got ACK %s for id %u",
             gst_flow_get_name (ret32), comm->id);
@@ -1874,6 +2658,7 @@ read_many (GstIpcPipelineComm * comm)
         break;
       }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_BUFFER:
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER:
       {
         GstBuffer *buf;
 
@@ -1881,7 +2666,8 @@ read_many (GstIpcPipelineComm * comm)
         if (available < comm->payload_length)
           goto done;
 
-        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length);
+        buf = gst_ipc_pipeline_comm_read_buffer (comm, comm->payload_length,
+            comm->state == GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER);
         if (!buf)
           goto buffer_failed;
 
@@ -1905,6 +2691,28 @@ read_many (GstIpcPipelineComm * comm)
         comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
         break;
       }
+      case GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_RELEASE:
+      {
+        guint32 slot;
+
+        available = gst_adapter_available (comm->adapter);
+        if (available < comm->payload_length)
+          goto done;
+
+        if (comm->payload_length < sizeof (guint32))
+          goto release_failed;
+
+        gst_adapter_copy (comm->adapter, &slot, 0, sizeof (slot));
+        gst_adapter_flush (comm->adapter, comm->payload_length);
+
+        g_mutex_lock (&comm->mutex);
+        gst_ipc_pipeline_comm_release_shm_slot (comm, slot);
+        g_mutex_unlock (&comm->mutex);
+
+        GST_TRACE_OBJECT (comm->element, "switching to state TYPE");
+        comm->state = GST_IPC_PIPELINE_COMM_STATE_TYPE;
+        break;
+      }
       case GST_IPC_PIPELINE_COMM_DATA_TYPE_EVENT:
       {
         GstEvent *event;
@@ -2109,6 +2917,13 @@ buffer_failed:
     ret = FALSE;
     goto done;
   }
+release_failed:
+  {
+    GST_ELEMENT_ERROR (comm->element, STREAM, DECODE, (NULL),
+        ("could not read shared memory release from fd"));
+    ret = FALSE;
+    goto done;
+  }
 event_failed:
   {
     GST_ELEMENT_ERROR (comm->element, STREAM, DECODE, (NULL),
@@ -2317,6 +3132,7 @@ gst_ipc_pipeline_comm_plugin_init (void)
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_comm_debug, "ipcpipelinecomm", 0,
         "ipc pipeline comm");
     QUARK_ID = g_quark_from_static_string ("ipcpipeline-id");
+    QUARK_SHM_RELEASE = g_quark_from_static_string ("ipcpipeline-shm-release");
     REGISTER_SERIALIZATION_NO_COMPARE (gst_event_get_type (), event);
     g_once_init_leave (&once, (gsize) 1);
   }
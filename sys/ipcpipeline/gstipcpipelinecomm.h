@@ -51,8 +51,27 @@ typedef enum {
   GST_IPC_PIPELINE_COMM_DATA_TYPE_STATE_LOST,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_MESSAGE,
   GST_IPC_PIPELINE_COMM_DATA_TYPE_GERROR_MESSAGE,
+  /* shared memory data plane */
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_BUFFER,
+  GST_IPC_PIPELINE_COMM_DATA_TYPE_SHM_RELEASE,
 } GstIpcPipelineCommDataType;
 
+#define GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS 16
+
+/* A shared memory slot on the sending side: either a memfd the buffer
+ * data is copied into, or (fd == -1) a buffer whose own fd was passed */
+typedef struct
+{
+  int fd;
+  gsize size;
+  guint8 *data;
+  gboolean busy;
+  gboolean fd_sent;
+  GstBuffer *held;
+} GstIpcPipelineCommShmSlot;
+
+typedef struct _GstIpcPipelineCommShmMapping GstIpcPipelineCommShmMapping;
+
 typedef struct
 {
   GstElement *element;
@@ -75,6 +94,21 @@ typedef struct
 
   guint read_chunk_size;
   GstClockTime ack_time;
+  /* GstBufferPool of read buffers, by size */
+  GHashTable *read_pools;
+
+  /* shared memory data plane, sending side */
+  gboolean shm;
+  int shm_checked_fd;
+  gboolean shm_can_pass_fds;
+  GstIpcPipelineCommShmSlot shm_slots[GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS];
+
+  /* shared memory data plane, receiving side */
+  int plain_fdin;
+  GQueue shm_received_fds;
+  GstIpcPipelineCommShmMapping *shm_maps[GST_IPC_PIPELINE_COMM_SHM_MAX_SLOTS];
+  GstAllocator *fd_allocator;
+  GstAllocator *dmabuf_allocator;
 
   void (*on_buffer) (guint32, GstBuffer *, gpointer);
   void (*on_event) (guint32, GstEvent *, gboolean, gpointer);
@@ -92,6 +126,7 @@ void gst_ipc_pipeline_comm_init (GstIpcPipelineComm *comm, GstElement *e);
 void gst_ipc_pipeline_comm_clear (GstIpcPipelineComm *comm);
 void gst_ipc_pipeline_comm_cancel (GstIpcPipelineComm * comm,
     gboolean flushing);
+void gst_ipc_pipeline_comm_reset_shm (GstIpcPipelineComm * comm);
 
 void gst_ipc_pipeline_comm_write_flow_ack_to_fd (GstIpcPipelineComm * comm,
     guint32 id, GstFlowReturn ret);
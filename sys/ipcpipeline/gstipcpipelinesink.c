@@ -56,6 +56,8 @@
  * custom protocol. Each buffer, event, query, message or state change is
  * serialized in a "packet" and sent over the socket. The sender then
  * performs a blocking wait for a reply, if a return code is needed.
+ * Each packet is written with a single system call; packets are not
+ * coalesced, so small buffers still cost one write and one read each.
  *
  * All objects that contan a GstStructure (messages, queries, events) are
  * serialized by serializing the GstStructure to a string
@@ -66,7 +68,12 @@
  * GError are serialized differently).
  *
  * Buffers are transported by writing their content directly on the socket.
- * More efficient ways for memory sharing could be implemented in the future.
+ * If #GstIpcPipelineSink:shared-memory is enabled and the socket is a unix
+ * domain socket, the contents of large buffers are instead copied into
+ * memfds shared with the slave, or, for buffers backed by a single fd
+ * (#GstFdMemory, dmabuf), the fd itself is passed. Only a small descriptor
+ * then goes over the socket, and the slave releases the memory when it is
+ * done with it.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -98,11 +105,13 @@ enum
   PROP_FDOUT,
   PROP_READ_CHUNK_SIZE,
   PROP_ACK_TIME,
+  PROP_SHARED_MEMORY,
 };
 
 
 #define DEFAULT_READ_CHUNK_SIZE 4096
 #define DEFAULT_ACK_TIME (10 * G_TIME_SPAN_SECOND)
+#define DEFAULT_SHARED_MEMORY FALSE
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_ipc_pipeline_sink_debug, "ipcpipelinesink", 0, "ipcpipelinesink element");
@@ -174,6 +183,10 @@ gst_ipc_pipeline_sink_class_init (GstIpcPipelineSinkClass * klass)
           "Maximum time to wait for a response to a message",
           0, G_MAXUINT64, DEFAULT_ACK_TIME,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_SHARED_MEMORY,
+      g_param_spec_boolean ("shared-memory", "Shared memory",
+          "Pass buffer contents through shared memory instead of the socket",
+          DEFAULT_SHARED_MEMORY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gst_ipc_pipeline_sink_signals[SIGNAL_DISCONNECT] =
       g_signal_new ("disconnect",
@@ -210,6 +223,7 @@ gst_ipc_pipeline_sink_init (GstIpcPipelineSink * sink)
   gst_ipc_pipeline_comm_init (&sink->comm, GST_ELEMENT (sink));
   sink->comm.read_chunk_size = DEFAULT_READ_CHUNK_SIZE;
   sink->comm.ack_time = DEFAULT_ACK_TIME;
+  sink->comm.shm = DEFAULT_SHARED_MEMORY;
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   sink->threads = g_thread_pool_new (pusher, sink, -1, FALSE, NULL);
@@ -271,6 +285,9 @@ gst_ipc_pipeline_sink_set_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       sink->comm.ack_time = g_value_get_uint64 (value);
       break;
+    case PROP_SHARED_MEMORY:
+      sink->comm.shm = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -296,6 +313,9 @@ gst_ipc_pipeline_sink_get_property (GObject * object, guint prop_id,
     case PROP_ACK_TIME:
       g_value_set_uint64 (value, sink->comm.ack_time);
       break;
+    case PROP_SHARED_MEMORY:
+      g_value_set_boolean (value, sink->comm.shm);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -577,6 +597,7 @@ gst_ipc_pipeline_sink_disconnect (GstIpcPipelineSink * sink)
   sink->comm.fdin = -1;
   sink->comm.fdout = -1;
   gst_ipc_pipeline_comm_cancel (&sink->comm, FALSE);
+  gst_ipc_pipeline_comm_reset_shm (&sink->comm);
   gst_ipc_pipeline_sink_start_reader_thread (sink);
 }
 
@@ -39,6 +39,7 @@
 #include "gstshmsink.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
 
@@ -58,7 +59,9 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_RING_SIZE,
+  PROP_FD_PASSING
 };
 
 struct GstShmClient
@@ -69,6 +72,8 @@ struct GstShmClient
 
 #define DEFAULT_SIZE ( 64 * 1024 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_RING_SIZE (0)
+#define DEFAULT_FD_PASSING (FALSE)
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -353,6 +358,8 @@ gst_shm_sink_init (GstShmSink * self)
   self->size = DEFAULT_SIZE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->ring_size = DEFAULT_RING_SIZE;
+  self->fd_passing = DEFAULT_FD_PASSING;
 
   gst_allocation_params_init (&self->params);
 }
@@ -415,6 +422,42 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           -1, G_MAXINT64, -1,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstShmSink:ring-size:
+   *
+   * Number of buffer descriptors in a ring shared with the clients, rounded
+   * up to a power of two. Buffers are then handed to up to 32 clients
+   * without going through the control socket, which is only used to wake
+   * up sleeping clients. 0 sends every buffer over the control socket.
+   * This may be modified during the NULL->READY transition.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size",
+          "Size of the descriptor ring",
+          "Number of buffers that can be handed to the clients through a "
+          "shared ring, 0 to use the control socket only",
+          0, 65536, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstShmSink:fd-passing:
+   *
+   * Pass buffers made of a single file descriptor backed memory (memfd,
+   * dmabuf, ...) to the clients as file descriptors over the control socket
+   * instead of copying them into the shared memory area. All the clients
+   * must support it. Ignored if #GstShmSink:ring-size is set.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_FD_PASSING,
+      g_param_spec_boolean ("fd-passing",
+          "Pass file descriptors",
+          "Send buffers backed by a file descriptor to the clients without "
+          "copying them", DEFAULT_FD_PASSING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -503,6 +546,16 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (&self->cond);
       break;
+    case PROP_RING_SIZE:
+      GST_OBJECT_LOCK (object);
+      self->ring_size = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
+    case PROP_FD_PASSING:
+      GST_OBJECT_LOCK (object);
+      self->fd_passing = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -532,6 +585,12 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_int64 (value, self->buffer_time);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
+    case PROP_FD_PASSING:
+      g_value_set_boolean (value, self->fd_passing);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -567,6 +626,15 @@ gst_shm_sink_start (GstBaseSink * bsink)
     return FALSE;
   }
 
+  if (self->ring_size > 0 &&
+      sp_writer_enable_ring (self->pipe, self->ring_size) < 0) {
+    sp_writer_close (self->pipe, NULL, NULL);
+    self->pipe = NULL;
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE,
+        ("Could not create the descriptor ring."), (NULL));
+    return FALSE;
+  }
+
   sp_set_data (self->pipe, self);
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
@@ -638,6 +706,35 @@ gst_shm_sink_stop (GstBaseSink * bsink)
   return TRUE;
 }
 
+static void
+free_buffer_locked (GstBuffer * buffer, void *data)
+{
+  GSList **list = data;
+
+  g_assert (buffer != NULL);
+
+  *list = g_slist_prepend (*list, buffer);
+}
+
+/* Frees the buffers that all the ring clients are done with, dropping the
+ * object lock while unreffing them. If @wait is set and there are none,
+ * the poll thread will be woken up by the next one released */
+static gboolean
+gst_shm_sink_reclaim_locked (GstShmSink * self, gboolean wait)
+{
+  GSList *list = NULL;
+
+  if (sp_writer_ring_reclaim (self->pipe, wait,
+          (sp_buffer_free_callback) free_buffer_locked, &list) <= 0)
+    return FALSE;
+
+  GST_OBJECT_UNLOCK (self);
+  g_slist_free_full (list, (GDestroyNotify) gst_buffer_unref);
+  GST_OBJECT_LOCK (self);
+
+  return TRUE;
+}
+
 static gboolean
 gst_shm_sink_can_render (GstShmSink * self, GstClockTime time)
 {
@@ -681,7 +778,11 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     }
   }
 
+  gst_shm_sink_reclaim_locked (self, FALSE);
+
   while (!gst_shm_sink_can_render (self, GST_BUFFER_TIMESTAMP (buf))) {
+    if (gst_shm_sink_reclaim_locked (self, TRUE))
+      continue;
     g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
     if (self->unlock) {
       GST_OBJECT_UNLOCK (self);
@@ -694,6 +795,32 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   }
 
 
+  if (self->fd_passing && self->ring_size == 0 &&
+      gst_buffer_n_memory (buf) == 1 &&
+      gst_is_fd_memory (gst_buffer_peek_memory (buf, 0))) {
+    memory = gst_buffer_peek_memory (buf, 0);
+
+    GST_LOG_OBJECT (self, "Passing the file descriptor of buffer %p", buf);
+    sendbuf = gst_buffer_ref (buf);
+    rv = sp_writer_send_fd_buf (self->pipe, gst_fd_memory_get_fd (memory),
+        memory->offset, memory->size, sendbuf);
+    GST_OBJECT_UNLOCK (self);
+
+    if (rv == -1) {
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          (NULL), ("Failed to send file descriptor over SHM"));
+      gst_buffer_unref (sendbuf);
+      return GST_FLOW_ERROR;
+    }
+
+    if (rv == 0) {
+      GST_DEBUG_OBJECT (self, "No clients connected, unreffing buffer");
+      gst_buffer_unref (sendbuf);
+    }
+
+    return ret;
+  }
+
   if (gst_buffer_n_memory (buf) > 1) {
     GST_LOG_OBJECT (self, "Buffer %p has %d GstMemory, we only support a single"
         " one, need to do a memcpy", buf, gst_buffer_n_memory (buf));
@@ -721,6 +848,8 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
     while ((memory =
             gst_shm_sink_allocator_alloc_locked (self->allocator,
                 gst_buffer_get_size (buf), &self->params)) == NULL) {
+      if (gst_shm_sink_reclaim_locked (self, TRUE))
+        continue;
       g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
       if (self->unlock) {
         GST_OBJECT_UNLOCK (self);
@@ -781,7 +910,25 @@ gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
    * We know it's not mapped for writing anywhere as we just mapped it for
    * reading
    */
-  rv = sp_writer_send_buf (self->pipe, (char *) map.data, map.size, sendbuf);
+  while ((rv = sp_writer_send_buf (self->pipe, (char *) map.data, map.size,
+              sendbuf)) == -2) {
+    if (gst_shm_sink_reclaim_locked (self, TRUE))
+      continue;
+    GST_LOG_OBJECT (self, "Descriptor ring is full, waiting for the clients");
+    g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+    if (self->unlock) {
+      GST_OBJECT_UNLOCK (self);
+      ret = gst_base_sink_wait_preroll (bsink);
+      if (ret == GST_FLOW_OK) {
+        GST_OBJECT_LOCK (self);
+      } else {
+        gst_buffer_unmap (sendbuf, &map);
+        gst_buffer_unref (sendbuf);
+        return ret;
+      }
+    }
+  }
+
   if (rv == -1) {
     GST_ELEMENT_ERROR (self, STREAM, FAILED,
         (NULL), ("Failed to send data over SHM"));
@@ -805,16 +952,6 @@ error:
   return GST_FLOW_ERROR;
 }
 
-static void
-free_buffer_locked (GstBuffer * buffer, void *data)
-{
-  GSList **list = data;
-
-  g_assert (buffer != NULL);
-
-  *list = g_slist_prepend (*list, buffer);
-}
-
 static gpointer
 pollthread_func (gpointer data)
 {
@@ -939,6 +1076,10 @@ pollthread_func (gpointer data)
       goto again;
     }
 
+    GST_OBJECT_LOCK (self);
+    gst_shm_sink_reclaim_locked (self, FALSE);
+    GST_OBJECT_UNLOCK (self);
+
     g_cond_broadcast (&self->cond);
   }
 
@@ -954,8 +1095,11 @@ gst_shm_sink_event (GstBaseSink * bsink, GstEvent * event)
     case GST_EVENT_EOS:
       GST_OBJECT_LOCK (self);
       while (self->wait_for_connection && sp_writer_pending_writes (self->pipe)
-          && !self->unlock)
+          && !self->unlock) {
+        if (gst_shm_sink_reclaim_locked (self, TRUE))
+          continue;
         g_cond_wait (&self->cond, GST_OBJECT_GET_LOCK (self));
+      }
       GST_OBJECT_UNLOCK (self);
       break;
     default:
@@ -52,6 +52,8 @@ struct _GstShmSink
 
   guint perms;
   guint size;
+  guint ring_size;
+  gboolean fd_passing;
 
   GList *clients;
 
@@ -41,8 +41,10 @@
 #include "gstshmsrc.h"
 
 #include <gst/gst.h>
+#include <gst/allocators/allocators.h>
 
 #include <string.h>
+#include <unistd.h>
 
 /* signals */
 enum
@@ -63,6 +65,8 @@ struct GstShmBuffer
 {
   char *buf;
   GstShmPipe *pipe;
+  /* For buffers passed as a file descriptor */
+  int fd_id;
 };
 
 
@@ -155,6 +159,7 @@ gst_shm_src_init (GstShmSrc * self)
 {
   self->poll = gst_poll_new (TRUE);
   gst_poll_fd_init (&self->pollfd);
+  self->fd_allocator = gst_fd_allocator_new ();
 }
 
 static void
@@ -164,6 +169,7 @@ gst_shm_src_finalize (GObject * object)
 
   gst_poll_free (self->poll);
   g_free (self->socket_path);
+  gst_object_unref (self->fd_allocator);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -318,6 +324,74 @@ free_buffer (gpointer data)
   g_slice_free (struct GstShmBuffer, gsb);
 }
 
+static void
+free_fd_buffer (gpointer data)
+{
+  struct GstShmBuffer *gsb = data;
+  g_return_if_fail (gsb->pipe != NULL);
+  g_return_if_fail (gsb->pipe->src != NULL);
+
+  GST_LOG ("Freeing fd buffer %d", gsb->fd_id);
+
+  GST_OBJECT_LOCK (gsb->pipe->src);
+  sp_client_recv_finish_fd (gsb->pipe->pipe, gsb->fd_id);
+  GST_OBJECT_UNLOCK (gsb->pipe->src);
+
+  gst_shm_pipe_dec (gsb->pipe);
+
+  g_slice_free (struct GstShmBuffer, gsb);
+}
+
+static GQuark
+gst_shm_src_buffer_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("GstShmSrcBuffer");
+
+  return quark;
+}
+
+/* Wraps a buffer passed as a file descriptor, which it takes ownership of */
+static GstBuffer *
+gst_shm_src_wrap_fd (GstShmSrc * self, int fd, gulong offset, gsize size,
+    int fd_id)
+{
+  struct GstShmBuffer *gsb;
+  GstMemory *mem;
+  GstBuffer *buffer;
+  off_t maxsize;
+
+  gsb = g_slice_new0 (struct GstShmBuffer);
+  gsb->fd_id = fd_id;
+  gsb->pipe = self->pipe;
+  gst_shm_pipe_inc (self->pipe);
+
+  maxsize = lseek (fd, 0, SEEK_END);
+  if (maxsize < 0 || offset + size > (gsize) maxsize) {
+    GST_WARNING_OBJECT (self, "File descriptor of size %" G_GINT64_FORMAT
+        " can't hold %" G_GSIZE_FORMAT " bytes at offset %lu",
+        (gint64) maxsize, size, offset);
+    close (fd);
+    free_fd_buffer (gsb);
+    return NULL;
+  }
+
+  mem = gst_fd_allocator_alloc (self->fd_allocator, fd, maxsize,
+      GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize (mem, offset, size);
+  GST_MINI_OBJECT_FLAG_SET (mem, GST_MEMORY_FLAG_READONLY);
+  /* Released when the memory is freed, which closes the fd */
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem),
+      gst_shm_src_buffer_quark (), gsb, free_fd_buffer);
+
+  buffer = gst_buffer_new ();
+  gst_buffer_append_memory (buffer, mem);
+
+  return buffer;
+}
+
 static GstFlowReturn
 gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
@@ -325,8 +399,23 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   gchar *buf = NULL;
   int rv = 0;
   struct GstShmBuffer *gsb;
+  int fd = -1;
+  gulong fd_offset = 0;
+  int fd_id = 0;
 
   do {
+    /* Buffers published in the ring don't make the socket readable */
+    GST_OBJECT_LOCK (self);
+    rv = sp_client_try_recv (self->pipe->pipe, &buf);
+    GST_OBJECT_UNLOCK (self);
+    if (rv < 0) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+          ("Error reading from the descriptor ring: %d", rv));
+      return GST_FLOW_ERROR;
+    }
+    if (buf)
+      break;
+
     if (gst_poll_wait (self->poll, GST_CLOCK_TIME_NONE) < 0) {
       if (errno == EBUSY)
         return GST_FLOW_FLUSHING;
@@ -354,7 +443,8 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
       buf = NULL;
       GST_LOG_OBJECT (self, "Reading from pipe");
       GST_OBJECT_LOCK (self);
-      rv = sp_client_recv (self->pipe->pipe, &buf);
+      rv = sp_client_recv_fd (self->pipe->pipe, &buf, &fd, &fd_offset,
+          &fd_id);
       GST_OBJECT_UNLOCK (self);
       if (rv < 0) {
         GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
@@ -362,7 +452,20 @@ gst_shm_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
         return GST_FLOW_ERROR;
       }
     }
-  } while (buf == NULL);
+  } while (buf == NULL && fd < 0);
+
+  if (fd >= 0) {
+    GST_LOG_OBJECT (self, "Got file descriptor %d of size %d", fd, rv);
+
+    *outbuf = gst_shm_src_wrap_fd (self, fd, fd_offset, rv, fd_id);
+    if (*outbuf == NULL) {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, ("Failed to read from shmsrc"),
+          ("Invalid file descriptor received"));
+      return GST_FLOW_ERROR;
+    }
+
+    return GST_FLOW_OK;
+  }
 
   GST_LOG_OBJECT (self, "Got buffer %p of size %d", buf, rv);
 
@@ -56,6 +56,8 @@ struct _GstShmSrc
 
   GstFlowReturn flow_return;
   gboolean unlocked;
+
+  GstAllocator *fd_allocator;
 };
 
 struct _GstShmSrcClass
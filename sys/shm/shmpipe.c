@@ -67,9 +67,43 @@
  * type 4: ack buffer
  * offset
  *
- * Type 4 goes from the client to the server
+ * type 5: new ring area
+ * Area length
+ * Size of path (followed by path)
+ * Index of the client's cursor in the ring
+ *
+ * type 6: ring wakeup
+ * No payload
+ *
+ * type 7: ring buffer released
+ * No payload
+ *
+ * type 8: fd buffer (the area id is the buffer id)
+ * offset
+ * bufsize
+ * The file descriptor is passed as SCM_RIGHTS ancillary data
+ *
+ * type 9: ack fd buffer (the area id is the buffer id)
+ * No payload
+ *
+ * Types 4, 7 and 9 go from the client to the server
  * The rest are from the server to the client
- * The client should never write in the SHM
+ * The client should never write in the SHM, except in the ring area
+ */
+
+/*
+ * The ring area starts with a ShmRingHeader, followed by n_slots
+ * descriptors. The writer publishes a buffer by filling the descriptor
+ * at write_index, setting its holders to the mask of the ring clients,
+ * then incrementing write_index. Each client consumes the descriptors
+ * from its own cursor and clears its bit in holders when done with the
+ * buffer, the writer frees it once holders is 0.
+ *
+ * Before waiting on the socket, a client sets its sleeping flag and
+ * checks write_index again; the writer only sends a wakeup command to
+ * the clients whose flag it clears. In the other direction, the writer
+ * sets writer_waiting when it is out of space, and the client clearing
+ * the last bit of a descriptor then sends a released command.
  */
 
 
@@ -80,10 +114,28 @@ enum
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_RING = 5,
+  COMMAND_RING_WAKEUP = 6,
+  COMMAND_RING_RELEASED = 7,
+  COMMAND_NEW_FD_BUFFER = 8,
+  COMMAND_ACK_FD_BUFFER = 9
 };
 
+#ifdef MSG_CMSG_CLOEXEC
+#define RECV_FD_FLAGS MSG_CMSG_CLOEXEC
+#else
+#define RECV_FD_FLAGS 0
+#endif
+
+#define SHM_RING_MAX_CLIENTS 32
+
 typedef struct _ShmArea ShmArea;
+typedef struct _ShmRing ShmRing;
+typedef struct _ShmRingHeader ShmRingHeader;
+typedef struct _ShmRingCursor ShmRingCursor;
+typedef struct _ShmRingDesc ShmRingDesc;
+typedef struct _ShmRingHeld ShmRingHeld;
 
 struct _ShmArea
 {
@@ -104,10 +156,68 @@ struct _ShmArea
   ShmArea *next;
 };
 
+/* Those live in the ring area, shared with other processes */
+struct _ShmRingCursor
+{
+  uint32_t read_index;
+  uint32_t sleeping;
+};
+
+struct _ShmRingDesc
+{
+  uint32_t area_id;
+  uint32_t holders;
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct _ShmRingHeader
+{
+  uint32_t n_slots;
+  uint32_t write_index;
+  uint32_t writer_waiting;
+  uint32_t padding;
+
+  ShmRingCursor cursors[SHM_RING_MAX_CLIENTS];
+  ShmRingDesc slots[0];
+};
+
+struct _ShmRing
+{
+  int is_writer;
+
+  int shm_fd;
+
+  ShmRingHeader *header;
+  size_t len;
+
+  char *name;
+
+  /* The header is writable by the clients, so the writer keeps its own
+   * copy of those and only ever writes them to the header. The client
+   * only reads n_slots once, when checking the size of the ring */
+  uint32_t n_slots;
+  uint32_t write_index;
+
+  /* Writer only: the buffer published in each slot */
+  ShmBuffer **buffers;
+};
+
+/* Client only: a buffer received from the ring and not released yet */
+struct _ShmRingHeld
+{
+  char *buf;
+  ShmArea *area;
+  uint32_t slot;
+
+  ShmRingHeld *next;
+};
+
 struct _ShmBuffer
 {
   int use_count;
 
+  /* NULL for a buffer passed as a file descriptor, whose offset is the id */
   ShmArea *shm_area;
   unsigned long offset;
   size_t size;
@@ -118,6 +228,9 @@ struct _ShmBuffer
 
   void *tag;
 
+  /* Slot in the ring or -1 if it was only sent over the sockets */
+  int ring_slot;
+
   int num_clients;
   /* This must ALWAYS stay last in the struct */
   int clients[0];
@@ -134,6 +247,7 @@ struct _ShmPipe
   ShmArea *shm_area;
 
   int next_area_id;
+  int next_fd_buffer_id;
 
   ShmBuffer *buffers;
 
@@ -141,11 +255,18 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  ShmRing *ring;
+  /* Writer: mask of the clients using the ring, client: own cursor */
+  uint32_t ring_clients;
+  int ring_index;
+  ShmRingHeld *ring_held;
 };
 
 struct _ShmClient
 {
   int fd;
+  int ring_index;
 
   ShmClient *next;
 };
@@ -179,6 +300,13 @@ struct CommandBuffer
     {
       unsigned long offset;
     } ack_buffer;
+    struct
+    {
+      size_t size;
+      unsigned int path_size;
+      unsigned int index;
+      /* Followed by path */
+    } new_ring;
   } payload;
 };
 
@@ -187,6 +315,9 @@ static void sp_close_shm (ShmArea * area);
 static int sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf,
     ShmBuffer * prev_buf, ShmClient * client, void **tag);
 static void sp_shm_area_dec (ShmPipe * self, ShmArea * area);
+static void sp_close_ring (ShmRing * ring);
+static int sp_ring_reclaim_unused (ShmPipe * self,
+    sp_buffer_free_callback callback, void *user_data);
 
 
 
@@ -365,6 +496,91 @@ sp_close_shm (ShmArea * area)
   spalloc_free (ShmArea, area);
 }
 
+/* Clients need to write in the ring, so they get write access wherever
+ * they have read access */
+#define RING_PERMS(perms) \
+  ((perms) | (((perms) & (S_IRUSR | S_IRGRP | S_IROTH)) >> 1))
+
+#define RETURN_ERROR(format, ...)  do {                   \
+  fprintf (stderr, format, __VA_ARGS__);                  \
+  sp_close_ring (ring);                                   \
+  return NULL;                                            \
+  } while (0)
+
+/**
+ * sp_open_ring:
+ * @path: Path of the ring area for a reader,
+ *  NULL if this is a writer (then it will allocate its own path)
+ *
+ * Opens a ShmRing, which is writable by the readers too
+ */
+
+static ShmRing *
+sp_open_ring (const char *path, mode_t perms, size_t size)
+{
+  ShmRing *ring = spalloc_new (ShmRing);
+  char tmppath[32];
+  int i = 0;
+
+  memset (ring, 0, sizeof (ShmRing));
+
+  ring->header = MAP_FAILED;
+  ring->len = size;
+  ring->is_writer = (path == NULL);
+  ring->shm_fd = -1;
+
+  if (path) {
+    ring->shm_fd = shm_open (path, O_RDWR, 0);
+  } else {
+    do {
+      snprintf (tmppath, sizeof (tmppath), "/shmring.%5d.%5d", getpid (), i++);
+      ring->shm_fd = shm_open (tmppath, O_RDWR | O_CREAT | O_EXCL,
+          RING_PERMS (perms));
+    } while (ring->shm_fd < 0 && errno == EEXIST);
+  }
+
+  if (ring->shm_fd < 0)
+    RETURN_ERROR ("shm_open failed on %s (%d): %s\n",
+        path ? path : tmppath, errno, strerror (errno));
+
+  ring->name = strdup (path ? path : tmppath);
+
+  if (!path && ftruncate (ring->shm_fd, size))
+    RETURN_ERROR ("Could not resize ring area, ftruncate failed (%d): %s\n",
+        errno, strerror (errno));
+
+  ring->header = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      ring->shm_fd, 0);
+
+  if (ring->header == MAP_FAILED)
+    RETURN_ERROR ("mmap failed (%d): %s\n", errno, strerror (errno));
+
+  return ring;
+}
+
+#undef RETURN_ERROR
+
+static void
+sp_close_ring (ShmRing * ring)
+{
+  if (ring->buffers)
+    spalloc_free1 (sizeof (ShmBuffer *) * ring->n_slots, ring->buffers);
+
+  if (ring->header != MAP_FAILED)
+    munmap (ring->header, ring->len);
+
+  if (ring->shm_fd >= 0)
+    close (ring->shm_fd);
+
+  if (ring->name) {
+    if (ring->is_writer)
+      shm_unlink (ring->name);
+    free (ring->name);
+  }
+
+  spalloc_free (ShmRing, ring);
+}
+
 static void
 sp_shm_area_inc (ShmArea * area)
 {
@@ -423,6 +639,16 @@ sp_dec (ShmPipe * self)
   if (self->use_count > 0)
     return;
 
+  while (self->ring_held) {
+    ShmRingHeld *held = self->ring_held;
+
+    self->ring_held = held->next;
+    spalloc_free (ShmRingHeld, held);
+  }
+
+  if (self->ring)
+    sp_close_ring (self->ring);
+
   while (self->shm_area)
     sp_shm_area_dec (self, self->shm_area);
 
@@ -466,6 +692,9 @@ sp_writer_setperms_shm (ShmPipe * self, mode_t perms)
   for (area = self->shm_area; area; area = area->next)
     ret |= fchmod (area->shm_fd, perms);
 
+  if (self->ring)
+    ret |= fchmod (self->ring->shm_fd, RING_PERMS (perms));
+
   ret |= chmod (self->socket_path, perms);
 
   return ret;
@@ -485,6 +714,43 @@ send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
   return 1;
 }
 
+static int
+send_command_with_fd (int fd, struct CommandBuffer *cb,
+    unsigned short int type, int area_id, int passed_fd)
+{
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int))];
+  } control;
+
+  cb->type = type;
+  cb->area_id = area_id;
+
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+
+  memset (&control, 0, sizeof (control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+  memcpy (CMSG_DATA (cmsg), &passed_fd, sizeof (int));
+
+  if (sendmsg (fd, &msg, MSG_NOSIGNAL) != sizeof (struct CommandBuffer))
+    return 0;
+
+  return 1;
+}
+
 int
 sp_writer_resize (ShmPipe * self, size_t size)
 {
@@ -573,7 +839,33 @@ sp_writer_free_block (ShmBlock * block)
   spalloc_free (ShmBlock, block);
 }
 
-/* Returns the number of client this has successfully been sent to */
+int
+sp_writer_enable_ring (ShmPipe * self, unsigned int n_slots)
+{
+  unsigned int slots = 1;
+
+  if (self->ring || self->clients || n_slots == 0 || n_slots > (1U << 16))
+    return -1;
+
+  /* Indexes wrap around at 2^32, so the number of slots must divide it */
+  while (slots < n_slots)
+    slots <<= 1;
+
+  self->ring = sp_open_ring (NULL, self->perms,
+      sizeof (ShmRingHeader) + sizeof (ShmRingDesc) * slots);
+  if (!self->ring)
+    return -1;
+
+  self->ring->n_slots = slots;
+  self->ring->header->n_slots = slots;
+  self->ring->buffers = spalloc_alloc (sizeof (ShmBuffer *) * slots);
+  memset (self->ring->buffers, 0, sizeof (ShmBuffer *) * slots);
+
+  return 0;
+}
+
+/* Returns the number of client this has successfully been sent to,
+ * or -2 if the ring is full */
 
 int
 sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
@@ -584,8 +876,11 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   ShmBuffer *sb;
   ShmClient *client = NULL;
   ShmAllocBlock *ablock = NULL;
+  ShmRingHeader *header = NULL;
+  uint32_t slot = 0;
   int i = 0;
   int c = 0;
+  int ring_c = 0;
 
   if (self->num_clients == 0)
     return 0;
@@ -603,6 +898,15 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   if (!ablock)
     return -1;
 
+  if (self->ring_clients) {
+    header = self->ring->header;
+    slot = self->ring->write_index & (self->ring->n_slots - 1);
+
+    /* The oldest published buffer is still in use */
+    if (self->ring->buffers[slot])
+      return -2;
+  }
+
   sb = spalloc_alloc (sizeof (ShmBuffer) + sizeof (int) * self->num_clients);
   memset (sb, 0, sizeof (ShmBuffer));
   memset (sb->clients, -1, sizeof (int) * self->num_clients);
@@ -612,9 +916,14 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   sb->num_clients = self->num_clients;
   sb->ablock = ablock;
   sb->tag = tag;
+  sb->ring_slot = -1;
 
   for (client = self->clients; client; client = client->next) {
     struct CommandBuffer cb = { 0 };
+
+    if (client->ring_index >= 0)
+      continue;
+
     cb.payload.buffer.offset = offset;
     cb.payload.buffer.size = bsize;
     if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
@@ -623,7 +932,34 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
     c++;
   }
 
-  if (c == 0) {
+  if (header) {
+    ShmRingDesc *desc = &header->slots[slot];
+
+    desc->area_id = area->id;
+    desc->offset = offset;
+    desc->size = size;
+    __atomic_store_n (&desc->holders, self->ring_clients, __ATOMIC_RELAXED);
+    self->ring->write_index++;
+    __atomic_store_n (&header->write_index, self->ring->write_index,
+        __ATOMIC_SEQ_CST);
+
+    sb->ring_slot = slot;
+    self->ring->buffers[slot] = sb;
+
+    for (client = self->clients; client; client = client->next) {
+      struct CommandBuffer cb = { 0 };
+
+      if (client->ring_index < 0)
+        continue;
+
+      ring_c++;
+      if (__atomic_exchange_n (&header->cursors[client->ring_index].sleeping,
+              0, __ATOMIC_SEQ_CST))
+        send_command (client->fd, &cb, COMMAND_RING_WAKEUP, 0);
+    }
+  }
+
+  if (c + ring_c == 0) {
     spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * sb->num_clients, sb);
     return 0;
   }
@@ -636,6 +972,120 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void *tag)
   sb->next = self->buffers;
   self->buffers = sb;
 
+  return c + ring_c;
+}
+
+/* Like recv_command(), @passed_fd is set to the file descriptor passed with
+ * the command, or -1 */
+static int
+recv_command_with_fd (int fd, struct CommandBuffer *cb, int *passed_fd)
+{
+  struct msghdr msg = { 0 };
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union
+  {
+    struct cmsghdr hdr;
+    char buf[CMSG_SPACE (sizeof (int) * 4)];
+  } control;
+  int retval;
+
+  *passed_fd = -1;
+
+  iov.iov_base = cb;
+  iov.iov_len = sizeof (struct CommandBuffer);
+
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+
+  retval = recvmsg (fd, &msg, MSG_DONTWAIT | RECV_FD_FLAGS);
+  if (retval < 0)
+    return 0;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+    int fds[4];
+    int i, n_fds;
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+      continue;
+
+    n_fds = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+    memcpy (fds, CMSG_DATA (cmsg), sizeof (int) * n_fds);
+
+    /* Only one is ever sent, don't leak any other */
+    for (i = 0; i < n_fds; i++) {
+      if (*passed_fd < 0)
+        *passed_fd = fds[i];
+      else
+        close (fds[i]);
+    }
+  }
+
+  if (retval != sizeof (struct CommandBuffer)) {
+    if (*passed_fd >= 0)
+      close (*passed_fd);
+    *passed_fd = -1;
+    return 0;
+  }
+
+  return 1;
+}
+
+/* Sends a buffer from a file descriptor, which must be mappable by the
+ * clients, instead of from the shm area. Not supported with a ring.
+ * Returns the number of client this has successfully been sent to */
+
+int
+sp_writer_send_fd_buf (ShmPipe * self, int fd, unsigned long offset,
+    size_t size, void *tag)
+{
+  ShmBuffer *sb;
+  ShmClient *client = NULL;
+  int i = 0;
+  int c = 0;
+  int id;
+
+  if (self->ring)
+    return -1;
+
+  if (self->num_clients == 0)
+    return 0;
+
+  id = self->next_fd_buffer_id;
+  self->next_fd_buffer_id = (self->next_fd_buffer_id + 1) & INT_MAX;
+
+  sb = spalloc_alloc (sizeof (ShmBuffer) + sizeof (int) * self->num_clients);
+  memset (sb, 0, sizeof (ShmBuffer));
+  memset (sb->clients, -1, sizeof (int) * self->num_clients);
+  sb->offset = id;
+  sb->size = size;
+  sb->num_clients = self->num_clients;
+  sb->tag = tag;
+  sb->ring_slot = -1;
+
+  for (client = self->clients; client; client = client->next) {
+    struct CommandBuffer cb = { 0 };
+    cb.payload.buffer.offset = offset;
+    cb.payload.buffer.size = size;
+    if (!send_command_with_fd (client->fd, &cb, COMMAND_NEW_FD_BUFFER, id,
+            fd))
+      continue;
+    sb->clients[i++] = client->fd;
+    c++;
+  }
+
+  if (c == 0) {
+    spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * sb->num_clients, sb);
+    return 0;
+  }
+
+  sb->use_count = c;
+
+  sb->next = self->buffers;
+  self->buffers = sb;
+
   return c;
 }
 
@@ -654,16 +1104,48 @@ recv_command (int fd, struct CommandBuffer *cb)
 
 long int
 sp_client_recv (ShmPipe * self, char **buf)
+{
+  return sp_client_recv_fd (self, buf, NULL, NULL, NULL);
+}
+
+/* Like sp_client_recv(), but buffers passed as file descriptors are
+ * returned in @fd, which the caller then owns, with *@buf set to NULL.
+ * They are released with sp_client_recv_finish_fd() and @fd_id.
+ * If @fd is NULL, they are released and ignored. */
+
+long int
+sp_client_recv_fd (ShmPipe * self, char **buf, int *fd,
+    unsigned long *fd_offset, int *fd_id)
 {
   char *area_name = NULL;
   ShmArea *newarea;
   ShmArea *area;
   struct CommandBuffer cb;
+  int passed_fd;
   int retval;
 
-  if (!recv_command (self->main_socket, &cb))
+  if (!recv_command_with_fd (self->main_socket, &cb, &passed_fd))
     return -1;
 
+  if (cb.type == COMMAND_NEW_FD_BUFFER) {
+    if (passed_fd < 0)
+      return -6;
+
+    if (!fd) {
+      close (passed_fd);
+      sp_client_recv_finish_fd (self, cb.area_id);
+      return 0;
+    }
+
+    *buf = NULL;
+    *fd = passed_fd;
+    *fd_offset = cb.payload.buffer.offset;
+    *fd_id = cb.area_id;
+    return cb.payload.buffer.size;
+  } else if (passed_fd >= 0) {
+    close (passed_fd);
+  }
+
   switch (cb.type) {
     case COMMAND_NEW_SHM_AREA:
       assert (cb.payload.new_shm_area.path_size > 0);
@@ -709,6 +1191,41 @@ sp_client_recv (ShmPipe * self, char **buf)
       }
       return -23;
 
+    case COMMAND_NEW_RING:
+      assert (cb.payload.new_ring.path_size > 0);
+
+      if (self->ring || cb.payload.new_ring.index >= SHM_RING_MAX_CLIENTS ||
+          cb.payload.new_ring.size < sizeof (ShmRingHeader))
+        return -5;
+
+      area_name = malloc (cb.payload.new_ring.path_size + 1);
+      retval = recv (self->main_socket, area_name,
+          cb.payload.new_ring.path_size, 0);
+      if (retval != cb.payload.new_ring.path_size) {
+        free (area_name);
+        return -3;
+      }
+      /* Ensure area_name is NULL terminated */
+      area_name[retval] = 0;
+
+      self->ring = sp_open_ring (area_name, 0, cb.payload.new_ring.size);
+      free (area_name);
+      if (!self->ring)
+        return -4;
+
+      self->ring->n_slots = self->ring->header->n_slots;
+      if (self->ring->n_slots == 0 ||
+          (self->ring->n_slots & (self->ring->n_slots - 1)) ||
+          sizeof (ShmRingHeader) + sizeof (ShmRingDesc) *
+          (size_t) self->ring->n_slots > self->ring->len)
+        return -5;
+
+      self->ring_index = cb.payload.new_ring.index;
+      break;
+
+    case COMMAND_RING_WAKEUP:
+      break;
+
     default:
       return -99;
   }
@@ -716,6 +1233,76 @@ sp_client_recv (ShmPipe * self, char **buf)
   return 0;
 }
 
+/* Returns the size of the next buffer in the ring, if there is one,
+ * otherwise 0 and the caller must wait for the socket to be readable */
+
+long int
+sp_client_try_recv (ShmPipe * self, char **buf)
+{
+  ShmRingHeader *header;
+  ShmRingCursor *cursor;
+  ShmRingDesc *desc;
+  ShmRingHeld *held;
+  ShmArea *area;
+  uint32_t read_index;
+  uint32_t slot;
+  uint32_t area_id;
+  uint64_t offset, size;
+
+  if (!self->ring)
+    return 0;
+
+  header = self->ring->header;
+  cursor = &header->cursors[self->ring_index];
+  read_index = cursor->read_index;
+
+  if (read_index == __atomic_load_n (&header->write_index, __ATOMIC_ACQUIRE)) {
+    /* Ask for a wakeup, then check again in case the writer published a
+     * buffer without seeing the flag */
+    __atomic_store_n (&cursor->sleeping, 1, __ATOMIC_SEQ_CST);
+    if (read_index == __atomic_load_n (&header->write_index,
+            __ATOMIC_SEQ_CST))
+      return 0;
+    __atomic_store_n (&cursor->sleeping, 0, __ATOMIC_RELAXED);
+  }
+
+  slot = read_index & (self->ring->n_slots - 1);
+  desc = &header->slots[slot];
+
+  /* The header is writable by every client, so read the descriptor exactly
+   * once and only ever use that copy */
+  area_id = __atomic_load_n (&desc->area_id, __ATOMIC_ACQUIRE);
+  offset = __atomic_load_n (&desc->offset, __ATOMIC_ACQUIRE);
+  size = __atomic_load_n (&desc->size, __ATOMIC_ACQUIRE);
+
+  for (area = self->shm_area; area; area = area->next) {
+    if (area->id == area_id)
+      break;
+  }
+
+  /* The new area is announced on the socket, which is readable already */
+  if (!area)
+    return 0;
+
+  if (offset > area->shm_area_len || size > area->shm_area_len - offset ||
+      size > INT_MAX)
+    return -23;
+
+  *buf = area->shm_area_buf + offset;
+  sp_shm_area_inc (area);
+
+  held = spalloc_new (ShmRingHeld);
+  held->buf = *buf;
+  held->area = area;
+  held->slot = slot;
+  held->next = self->ring_held;
+  self->ring_held = held;
+
+  __atomic_store_n (&cursor->read_index, read_index + 1, __ATOMIC_RELEASE);
+
+  return size;
+}
+
 int
 sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
 {
@@ -729,7 +1316,7 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
     case COMMAND_ACK_BUFFER:
 
       for (buf = self->buffers; buf; buf = buf->next) {
-        if (buf->shm_area->id == cb.area_id &&
+        if (buf->shm_area && buf->shm_area->id == cb.area_id &&
             buf->offset == cb.payload.ack_buffer.offset) {
           return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
         }
@@ -737,6 +1324,18 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
       }
 
       return -2;
+    case COMMAND_ACK_FD_BUFFER:
+
+      for (buf = self->buffers; buf; buf = buf->next) {
+        if (!buf->shm_area && buf->offset == (unsigned long) cb.area_id)
+          return sp_shmbuf_dec (self, buf, prev_buf, client, tag);
+        prev_buf = buf;
+      }
+
+      return -2;
+    case COMMAND_RING_RELEASED:
+      /* The buffers are freed by sp_writer_ring_reclaim() */
+      return 1;
     default:
       return -99;
   }
@@ -744,12 +1343,46 @@ sp_writer_recv (ShmPipe * self, ShmClient * client, void **tag)
   return 0;
 }
 
+/* Called by the client that cleared the last bit of a ring descriptor */
+static int
+sp_client_ring_release (ShmPipe * self, ShmRingHeld * held)
+{
+  ShmRingHeader *header = self->ring->header;
+  struct CommandBuffer cb = { 0 };
+  uint32_t holders;
+
+  sp_shm_area_dec (self, held->area);
+
+  holders = __atomic_and_fetch (&header->slots[held->slot].holders,
+      ~(1U << self->ring_index), __ATOMIC_SEQ_CST);
+  spalloc_free (ShmRingHeld, held);
+
+  if (holders != 0 ||
+      !__atomic_exchange_n (&header->writer_waiting, 0, __ATOMIC_SEQ_CST))
+    return 1;
+
+  return send_command (self->main_socket, &cb, COMMAND_RING_RELEASED, 0);
+}
+
 int
 sp_client_recv_finish (ShmPipe * self, char *buf)
 {
   ShmArea *shm_area = NULL;
   unsigned long offset;
   struct CommandBuffer cb = { 0 };
+  ShmRingHeld *held, *prev_held = NULL;
+
+  for (held = self->ring_held; held; held = held->next) {
+    if (held->buf == buf) {
+      if (prev_held)
+        prev_held->next = held->next;
+      else
+        self->ring_held = held->next;
+
+      return sp_client_ring_release (self, held);
+    }
+    prev_held = held;
+  }
 
   for (shm_area = self->shm_area; shm_area; shm_area = shm_area->next) {
     if (buf >= shm_area->shm_area_buf &&
@@ -768,6 +1401,14 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
       self->shm_area->id);
 }
 
+int
+sp_client_recv_finish_fd (ShmPipe * self, int fd_id)
+{
+  struct CommandBuffer cb = { 0 };
+
+  return send_command (self->main_socket, &cb, COMMAND_ACK_FD_BUFFER, fd_id);
+}
+
 ShmPipe *
 sp_client_open (const char *path)
 {
@@ -812,6 +1453,7 @@ sp_writer_accept_client (ShmPipe * self)
   int fd;
   struct CommandBuffer cb = { 0 };
   int pathlen = strlen (self->shm_area->shm_area_name) + 1;
+  int ring_index = -1;
 
 
   fd = accept (self->main_socket, NULL, NULL);
@@ -834,8 +1476,43 @@ sp_writer_accept_client (ShmPipe * self)
     goto error;
   }
 
+  /* Clients past the size of the mask keep using the socket */
+  if (self->ring) {
+    for (ring_index = 0; ring_index < SHM_RING_MAX_CLIENTS; ring_index++) {
+      if (!(self->ring_clients & (1U << ring_index)))
+        break;
+    }
+    if (ring_index == SHM_RING_MAX_CLIENTS)
+      ring_index = -1;
+  }
+
+  if (ring_index >= 0) {
+    ShmRingHeader *header = self->ring->header;
+
+    header->cursors[ring_index].read_index = self->ring->write_index;
+    header->cursors[ring_index].sleeping = 0;
+
+    pathlen = strlen (self->ring->name) + 1;
+    memset (&cb, 0, sizeof (cb));
+    cb.payload.new_ring.size = self->ring->len;
+    cb.payload.new_ring.path_size = pathlen;
+    cb.payload.new_ring.index = ring_index;
+    if (!send_command (fd, &cb, COMMAND_NEW_RING, 0)) {
+      fprintf (stderr, "Sending new ring failed: %s", strerror (errno));
+      goto error;
+    }
+
+    if (send (fd, self->ring->name, pathlen, MSG_NOSIGNAL) != pathlen) {
+      fprintf (stderr, "Sending new ring path failed: %s", strerror (errno));
+      goto error;
+    }
+
+    self->ring_clients |= 1U << ring_index;
+  }
+
   client = spalloc_new (ShmClient);
   client->fd = fd;
+  client->ring_index = ring_index;
 
   /* Prepend ot linked list */
   client->next = self->clients;
@@ -850,6 +1527,35 @@ error:
   return NULL;
 }
 
+static int
+sp_shmbuf_in_ring (ShmPipe * self, ShmBuffer * buf)
+{
+  if (buf->ring_slot < 0)
+    return 0;
+
+  return __atomic_load_n (&self->ring->header->slots[buf->ring_slot].holders,
+      __ATOMIC_SEQ_CST) != 0;
+}
+
+static void
+sp_shmbuf_free (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf)
+{
+  /* Remove from linked list */
+  if (prev_buf)
+    prev_buf->next = buf->next;
+  else
+    self->buffers = buf->next;
+
+  if (buf->ring_slot >= 0)
+    self->ring->buffers[buf->ring_slot] = NULL;
+
+  if (buf->shm_area) {
+    shm_alloc_space_block_dec (buf->ablock);
+    sp_shm_area_dec (self, buf->shm_area);
+  }
+  spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * buf->num_clients, buf);
+}
+
 static int
 sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
     ShmClient * client, void **tag)
@@ -874,23 +1580,63 @@ sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf, ShmBuffer * prev_buf,
 
   buf->use_count--;
 
-  if (buf->use_count == 0) {
-    /* Remove from linked list */
-    if (prev_buf)
-      prev_buf->next = buf->next;
-    else
-      self->buffers = buf->next;
-
+  if (buf->use_count == 0 && !sp_shmbuf_in_ring (self, buf)) {
     if (tag)
       *tag = buf->tag;
-    shm_alloc_space_block_dec (buf->ablock);
-    sp_shm_area_dec (self, buf->shm_area);
-    spalloc_free1 (sizeof (ShmBuffer) + sizeof (int) * buf->num_clients, buf);
+    sp_shmbuf_free (self, buf, prev_buf);
     return 0;
   }
   return 1;
 }
 
+static int
+sp_ring_reclaim_unused (ShmPipe * self, sp_buffer_free_callback callback,
+    void *user_data)
+{
+  ShmBuffer *buf, *prev_buf = NULL, *next;
+  int freed = 0;
+
+  for (buf = self->buffers; buf; buf = next) {
+    next = buf->next;
+
+    if (buf->ring_slot >= 0 && buf->use_count == 0 &&
+        !sp_shmbuf_in_ring (self, buf)) {
+      void *tag = buf->tag;
+
+      sp_shmbuf_free (self, buf, prev_buf);
+      if (callback)
+        callback (tag, user_data);
+      freed++;
+    } else {
+      prev_buf = buf;
+    }
+  }
+
+  return freed;
+}
+
+/* Returns the number of buffers freed */
+
+int
+sp_writer_ring_reclaim (ShmPipe * self, int wait,
+    sp_buffer_free_callback callback, void *user_data)
+{
+  int freed;
+
+  if (!self->ring)
+    return 0;
+
+  freed = sp_ring_reclaim_unused (self, callback, user_data);
+  if (freed > 0 || !wait)
+    return freed;
+
+  /* Ask the clients to tell us when they release a buffer, then check
+   * again in case the last one did so without seeing the flag */
+  __atomic_store_n (&self->ring->header->writer_waiting, 1, __ATOMIC_SEQ_CST);
+
+  return sp_ring_reclaim_unused (self, callback, user_data);
+}
+
 void
 sp_writer_close_client (ShmPipe * self, ShmClient * client,
     sp_buffer_free_callback callback, void *user_data)
@@ -901,6 +1647,20 @@ sp_writer_close_client (ShmPipe * self, ShmClient * client,
   shutdown (client->fd, SHUT_RDWR);
   close (client->fd);
 
+  if (client->ring_index >= 0) {
+    ShmRingHeader *header = self->ring->header;
+    uint32_t bit = 1U << client->ring_index;
+
+    self->ring_clients &= ~bit;
+    for (buffer = self->buffers; buffer; buffer = buffer->next) {
+      if (buffer->ring_slot >= 0)
+        __atomic_and_fetch (&header->slots[buffer->ring_slot].holders, ~bit,
+            __ATOMIC_SEQ_CST);
+    }
+
+    sp_ring_reclaim_unused (self, callback, user_data);
+  }
+
 again:
   for (buffer = self->buffers; buffer; buffer = buffer->next) {
     int i;
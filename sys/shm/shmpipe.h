@@ -56,6 +56,22 @@
  * buffers are no longer valid. If was valid buffer was received, the
  * client must release it with sp_client_recv_finish() when it is done
  * reading from it.
+ *
+ * Optionally, the writer can call sp_writer_enable_ring() before any
+ * client connects. Buffers are then published to the clients through a
+ * ring of descriptors in a second shm area instead of the socket, and
+ * released by clearing the client's bit in the descriptor. The socket
+ * is then only used to wake up clients or the writer that are waiting.
+ * In this mode, sp_writer_send_buf() returns -2 if the ring is full,
+ * and the writer must call sp_writer_ring_reclaim() to free the buffers
+ * the clients are done with: if it returns 0 when called with @wait set,
+ * the writer must wait for events on the client fds and try again. The
+ * clients must call sp_client_try_recv() before waiting on the socket.
+ *
+ * Without a ring, the writer can also send buffers from any file
+ * descriptor with sp_writer_send_fd_buf(). It is passed to the clients
+ * over the socket, which receive it with sp_client_recv_fd() and
+ * release it with sp_client_recv_finish_fd().
  */
 
 
@@ -97,6 +113,8 @@ int sp_writer_get_client_fd (ShmClient * client);
 ShmBlock *sp_writer_alloc_block (ShmPipe * self, size_t size);
 void sp_writer_free_block (ShmBlock *block);
 int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, void * tag);
+int sp_writer_send_fd_buf (ShmPipe * self, int fd, unsigned long offset,
+    size_t size, void * tag);
 char *sp_writer_block_get_buf (ShmBlock *block);
 ShmPipe *sp_writer_block_get_pipe (ShmBlock *block);
 size_t sp_writer_get_max_buf_size (ShmPipe * self);
@@ -108,13 +126,21 @@ int sp_writer_recv (ShmPipe * self, ShmClient * client, void ** tag);
 
 int sp_writer_pending_writes (ShmPipe * self);
 
+int sp_writer_enable_ring (ShmPipe * self, unsigned int n_slots);
+int sp_writer_ring_reclaim (ShmPipe * self, int wait,
+    sp_buffer_free_callback callback, void * user_data);
+
 ShmBuffer *sp_writer_get_pending_buffers (ShmPipe * self);
 ShmBuffer *sp_writer_get_next_buffer (ShmBuffer * buffer);
 void *sp_writer_buf_get_tag (ShmBuffer * buffer);
 
 ShmPipe *sp_client_open (const char *path);
 long int sp_client_recv (ShmPipe * self, char **buf);
+long int sp_client_try_recv (ShmPipe * self, char **buf);
+long int sp_client_recv_fd (ShmPipe * self, char **buf, int *fd,
+    unsigned long *fd_offset, int *fd_id);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
+int sp_client_recv_finish_fd (ShmPipe * self, int fd_id);
 void sp_client_close (ShmPipe * self);
 
 #ifdef __cplusplus
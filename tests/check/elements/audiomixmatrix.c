@@ -0,0 +1,217 @@
+/* GStreamer
+ *
+ * unit test for the audiomixmatrix kernels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "gstaudiomixmatrix.c"
+
+#define MAX_CHANNELS 8
+#define N_SAMPLES 256
+#define N_RUNS 100
+
+static const GstAudioFormat formats[] = {
+  GST_AUDIO_FORMAT_F32,
+  GST_AUDIO_FORMAT_F64,
+  GST_AUDIO_FORMAT_S16,
+  GST_AUDIO_FORMAT_S32,
+};
+
+static GstCaps *
+create_caps (GstAudioFormat format, guint channels)
+{
+  GstAudioInfo info;
+
+  gst_audio_info_init (&info);
+  gst_audio_info_set_format (&info, format, 48000, channels, NULL);
+
+  return gst_audio_info_to_caps (&info);
+}
+
+static GstBuffer *
+create_input (GstAudioFormat format, guint channels)
+{
+  guint i, n = N_SAMPLES * channels;
+  GstBuffer *buffer;
+  GstMapInfo map;
+
+  buffer = gst_buffer_new_allocate (NULL,
+      n * GST_AUDIO_FORMAT_INFO_WIDTH (gst_audio_format_get_info (format)) / 8,
+      NULL);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  for (i = 0; i < n; i++) {
+    switch (format) {
+      case GST_AUDIO_FORMAT_F32:
+        ((gfloat *) map.data)[i] = g_random_double_range (-1.0, 1.0);
+        break;
+      case GST_AUDIO_FORMAT_F64:
+        ((gdouble *) map.data)[i] = g_random_double_range (-1.0, 1.0);
+        break;
+      case GST_AUDIO_FORMAT_S16:
+        ((gint16 *) map.data)[i] = g_random_int_range (G_MININT16,
+            G_MAXINT16 + 1);
+        break;
+      case GST_AUDIO_FORMAT_S32:
+        ((gint32 *) map.data)[i] = (gint32) g_random_int ();
+        break;
+      default:
+        g_assert_not_reached ();
+        break;
+    }
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  return buffer;
+}
+
+/* Mostly zeros, as in routing matrices */
+static void
+fill_sparse_matrix (gdouble * matrix, guint in_channels, guint out_channels)
+{
+  guint i;
+
+  for (i = 0; i < in_channels * out_channels; i++) {
+    if (g_random_int_range (0, 4) == 0)
+      matrix[i] = g_random_double_range (-1.0, 1.0);
+    else
+      matrix[i] = 0.0;
+  }
+}
+
+/* Each output channel is one of the input channels, or silence */
+static void
+fill_copy_matrix (gdouble * matrix, guint in_channels, guint out_channels)
+{
+  guint out;
+
+  memset (matrix, 0, sizeof (gdouble) * in_channels * out_channels);
+  for (out = 0; out < out_channels; out++) {
+    gint in = g_random_int_range (-1, in_channels);
+
+    if (in >= 0)
+      matrix[out * in_channels + in] = 1.0;
+  }
+}
+
+/* Mixes random input with a random matrix, using the kernel picked for the
+ * matrix and then the dense one, and checks that both give the same
+ * samples. Returns the kernel that was picked */
+static GstAudioMixMatrixKernel
+compare_with_dense (GstAudioFormat format, gboolean copy)
+{
+  GstAudioMixMatrix *self;
+  GstAudioMixMatrixKernel kernel;
+  GstBuffer *inbuf, *outbuf, *dense_outbuf;
+  GstCaps *incaps, *outcaps;
+  GstMapInfo map;
+  guint in_channels = g_random_int_range (1, MAX_CHANNELS + 1);
+  guint out_channels = g_random_int_range (1, MAX_CHANNELS + 1);
+  gsize out_size;
+
+  self = g_object_new (GST_TYPE_AUDIO_MIX_MATRIX, "in-channels", in_channels,
+      "out-channels", out_channels, NULL);
+  gst_element_set_state (GST_ELEMENT (self), GST_STATE_PAUSED);
+
+  self->matrix = g_new (gdouble, in_channels * out_channels);
+  if (copy)
+    fill_copy_matrix (self->matrix, in_channels, out_channels);
+  else
+    fill_sparse_matrix (self->matrix, in_channels, out_channels);
+
+  incaps = create_caps (format, in_channels);
+  outcaps = create_caps (format, out_channels);
+  fail_unless (gst_audio_mix_matrix_set_caps (GST_BASE_TRANSFORM (self),
+          incaps, outcaps));
+  gst_caps_unref (incaps);
+  gst_caps_unref (outcaps);
+  kernel = self->kernel;
+
+  inbuf = create_input (format, in_channels);
+  out_size = gst_buffer_get_size (inbuf) / in_channels * out_channels;
+  outbuf = gst_buffer_new_allocate (NULL, out_size, NULL);
+  dense_outbuf = gst_buffer_new_allocate (NULL, out_size, NULL);
+
+  fail_unless_equals_int (gst_audio_mix_matrix_transform (GST_BASE_TRANSFORM
+          (self), inbuf, outbuf), GST_FLOW_OK);
+  self->kernel = GST_AUDIO_MIX_MATRIX_KERNEL_DENSE;
+  fail_unless_equals_int (gst_audio_mix_matrix_transform (GST_BASE_TRANSFORM
+          (self), inbuf, dense_outbuf), GST_FLOW_OK);
+
+  gst_buffer_map (dense_outbuf, &map, GST_MAP_READ);
+  fail_unless (gst_buffer_memcmp (outbuf, 0, map.data, map.size) == 0,
+      "kernel %d differs from the dense one for %s, %u to %u channels",
+      kernel, gst_audio_format_to_string (format), in_channels, out_channels);
+  gst_buffer_unmap (dense_outbuf, &map);
+
+  gst_buffer_unref (inbuf);
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (dense_outbuf);
+  gst_element_set_state (GST_ELEMENT (self), GST_STATE_NULL);
+  gst_object_unref (self);
+
+  return kernel;
+}
+
+GST_START_TEST (test_sparse_kernel)
+{
+  guint f, run, n_sparse;
+
+  g_random_set_seed (1);
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    n_sparse = 0;
+    for (run = 0; run < N_RUNS; run++) {
+      if (compare_with_dense (formats[f], FALSE) ==
+          GST_AUDIO_MIX_MATRIX_KERNEL_SPARSE)
+        n_sparse++;
+    }
+    fail_unless (n_sparse > 0);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_copy_kernel)
+{
+  guint f, run;
+
+  g_random_set_seed (2);
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    for (run = 0; run < N_RUNS; run++) {
+      fail_unless_equals_int (compare_with_dense (formats[f], TRUE),
+          GST_AUDIO_MIX_MATRIX_KERNEL_COPY);
+    }
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+audiomixmatrix_suite (void)
+{
+  Suite *s = suite_create ("audiomixmatrix");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_sparse_kernel);
+  tcase_add_test (tc_chain, test_copy_kernel);
+
+  return s;
+}
+
+GST_CHECK_MAIN (audiomixmatrix);
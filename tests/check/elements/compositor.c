@@ -30,6 +30,7 @@
 #endif
 
 #include <unistd.h>
+#include <string.h>
 
 #include <gst/check/gstcheck.h>
 #include <gst/check/gstconsistencychecker.h>
@@ -2075,6 +2076,250 @@ GST_START_TEST (test_start_time_first_live_drop_3_unlinked_1)
 
 GST_END_TEST;
 
+static GstBuffer *
+_pull_first_buffer (const gchar * desc)
+{
+  GstElement *pipeline, *appsink;
+  GstSample *sample = NULL;
+  GstBuffer *buffer;
+  GstStateChangeReturn state_res;
+
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+
+  appsink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  state_res = gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (appsink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+  buffer = gst_buffer_ref (gst_sample_get_buffer (sample));
+  gst_sample_unref (sample);
+
+  state_res = gst_element_set_state (pipeline, GST_STATE_NULL);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+  gst_object_unref (appsink);
+  gst_object_unref (pipeline);
+
+  return buffer;
+}
+
+static GstBuffer *
+_run_n_threads_pipeline (const gchar * format, guint n_threads)
+{
+  GstBuffer *buffer;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=comp n-threads=%u "
+      "sink_1::xpos=37 sink_1::ypos=51 sink_1::alpha=0.6 "
+      "sink_2::xpos=-20 sink_2::ypos=150 "
+      "sink_3::xpos=200 sink_3::ypos=-13 sink_3::width=160 ! "
+      "appsink name=sink "
+      "videotestsrc num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=%s,width=320,height=240 ! comp.sink_0 "
+      "videotestsrc num-buffers=1 pattern=smpte ! "
+      "video/x-raw,format=%s,width=100,height=78 ! comp.sink_1 "
+      "videotestsrc num-buffers=1 pattern=circular ! "
+      "video/x-raw,format=%s,width=120,height=130 ! comp.sink_2 "
+      "videotestsrc num-buffers=1 pattern=zone-plate ! "
+      "video/x-raw,format=%s,width=80,height=60 ! comp.sink_3",
+      n_threads, format, format, format, format);
+  buffer = _pull_first_buffer (desc);
+  g_free (desc);
+
+  return buffer;
+}
+
+/* Test that blending in stripes on multiple threads gives the exact same
+ * output as blending on a single thread */
+GST_START_TEST (test_n_threads)
+{
+  static const gchar *formats[] = { "AYUV", "BGRA", "I420", "NV12", "YUY2",
+    "Y444", "RGB"
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstBuffer *single, *multi;
+    GstMapInfo single_map, multi_map;
+
+    GST_INFO ("testing format %s", formats[i]);
+
+    single = _run_n_threads_pipeline (formats[i], 1);
+    multi = _run_n_threads_pipeline (formats[i], 4);
+
+    fail_unless (gst_buffer_map (single, &single_map, GST_MAP_READ));
+    fail_unless (gst_buffer_map (multi, &multi_map, GST_MAP_READ));
+    fail_unless_equals_int (single_map.size, multi_map.size);
+    fail_unless (memcmp (single_map.data, multi_map.data,
+            single_map.size) == 0);
+    gst_buffer_unmap (single, &single_map);
+    gst_buffer_unmap (multi, &multi_map);
+
+    gst_buffer_unref (single);
+    gst_buffer_unref (multi);
+  }
+}
+
+GST_END_TEST;
+
+static guint8
+_get_luma (GstBuffer * buffer, gint width, gint height, gint x, gint y)
+{
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  guint8 luma;
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, width, height);
+  fail_unless (gst_video_frame_map (&frame, &info, buffer, GST_MAP_READ));
+  luma = GST_VIDEO_FRAME_COMP_DATA (&frame, 0)[y *
+      GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0) + x];
+  gst_video_frame_unmap (&frame);
+
+  return luma;
+}
+
+static guint8
+_get_pattern_luma (const gchar * pattern)
+{
+  GstBuffer *buffer;
+  gchar *desc;
+  guint8 luma;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=1 pattern=%s ! "
+      "video/x-raw,format=I420,width=32,height=32 ! appsink name=sink",
+      pattern);
+  buffer = _pull_first_buffer (desc);
+  g_free (desc);
+
+  luma = _get_luma (buffer, 32, 32, 0, 0);
+  gst_buffer_unref (buffer);
+
+  return luma;
+}
+
+/* Test that partially occluded opaque pads and the background are only
+ * drawn where they are visible, without leaving anything undrawn */
+GST_START_TEST (test_partially_occluded)
+{
+  guint8 red, blue, green;
+  GstBuffer *buffer;
+  guint n_threads;
+
+  red = _get_pattern_luma ("red");
+  blue = _get_pattern_luma ("blue");
+  green = _get_pattern_luma ("green");
+
+  for (n_threads = 1; n_threads <= 4; n_threads += 3) {
+    gchar *desc;
+
+    desc = g_strdup_printf ("compositor name=comp background=black "
+        "n-threads=%u sink_1::xpos=110 sink_1::ypos=30 "
+        "sink_2::xpos=270 sink_2::ypos=190 ! "
+        "video/x-raw,format=I420,width=320,height=240 ! appsink name=sink "
+        "videotestsrc num-buffers=1 pattern=red ! "
+        "video/x-raw,format=I420,width=200,height=200 ! comp.sink_0 "
+        "videotestsrc num-buffers=1 pattern=blue ! "
+        "video/x-raw,format=I420,width=200,height=200 ! comp.sink_1 "
+        "videotestsrc num-buffers=1 pattern=green ! "
+        "video/x-raw,format=I420,width=50,height=50 ! comp.sink_2", n_threads);
+    buffer = _pull_first_buffer (desc);
+    g_free (desc);
+
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 10, 10), red);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 108, 199), red);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 110, 30), blue);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 150, 100), blue);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 269, 229), blue);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 270, 190), green);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 319, 239), green);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 315, 10), 16);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 50, 220), 16);
+    fail_unless_equals_int (_get_luma (buffer, 320, 240, 105, 235), 16);
+
+    gst_buffer_unref (buffer);
+  }
+}
+
+GST_END_TEST;
+
+static GstPadProbeReturn
+_store_first_buffer_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstBuffer **buffer = user_data;
+
+  if (*buffer == NULL)
+    *buffer = gst_buffer_ref (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Returns whether the first output buffer shares its memory with the first
+ * buffer of the topmost pad */
+static gboolean
+_top_pad_forwarded (const gchar * pad_props)
+{
+  GstElement *pipeline, *appsink, *top;
+  GstBuffer *in_buffer = NULL, *out_buffer;
+  GstSample *sample = NULL;
+  GstStateChangeReturn state_res;
+  GstPad *srcpad;
+  gboolean forwarded;
+  gchar *desc;
+
+  desc = g_strdup_printf ("compositor name=comp %s ! "
+      "video/x-raw,format=I420,width=320,height=240 ! appsink name=sink "
+      "videotestsrc num-buffers=1 pattern=red ! "
+      "video/x-raw,format=I420,width=320,height=240 ! comp.sink_0 "
+      "videotestsrc name=top num-buffers=1 pattern=ball ! "
+      "video/x-raw,format=I420,width=320,height=240 ! comp.sink_1", pad_props);
+  pipeline = gst_parse_launch (desc, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (desc);
+
+  top = gst_bin_get_by_name (GST_BIN (pipeline), "top");
+  srcpad = gst_element_get_static_pad (top, "src");
+  gst_pad_add_probe (srcpad, GST_PAD_PROBE_TYPE_BUFFER,
+      _store_first_buffer_probe, &in_buffer, NULL);
+  gst_object_unref (srcpad);
+  gst_object_unref (top);
+
+  appsink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  state_res = gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+
+  g_signal_emit_by_name (appsink, "pull-sample", &sample);
+  fail_unless (sample != NULL);
+  out_buffer = gst_sample_get_buffer (sample);
+  fail_unless (in_buffer != NULL);
+
+  forwarded = gst_buffer_peek_memory (out_buffer, 0) ==
+      gst_buffer_peek_memory (in_buffer, 0);
+
+  gst_sample_unref (sample);
+  state_res = gst_element_set_state (pipeline, GST_STATE_NULL);
+  ck_assert_int_ne (state_res, GST_STATE_CHANGE_FAILURE);
+  gst_buffer_unref (in_buffer);
+  gst_object_unref (appsink);
+  gst_object_unref (pipeline);
+
+  return forwarded;
+}
+
+/* Test that a topmost pad hiding everything else is forwarded without
+ * copying it, and only then */
+GST_START_TEST (test_passthrough_full_frame)
+{
+  fail_unless (_top_pad_forwarded (""));
+  fail_if (_top_pad_forwarded ("sink_1::alpha=0.5"));
+  fail_if (_top_pad_forwarded ("sink_1::xpos=1"));
+  fail_if (_top_pad_forwarded ("sink_1::width=160"));
+  fail_if (_top_pad_forwarded ("sink_0::crossfade-ratio=0.5"));
+}
+
+GST_END_TEST;
+
 static Suite *
 compositor_suite (void)
 {
@@ -2102,6 +2347,9 @@ compositor_suite (void)
   tcase_add_test (tc_chain, test_ignore_eos);
   tcase_add_test (tc_chain, test_pad_z_order);
   tcase_add_test (tc_chain, test_pad_numbering);
+  tcase_add_test (tc_chain, test_n_threads);
+  tcase_add_test (tc_chain, test_partially_occluded);
+  tcase_add_test (tc_chain, test_passthrough_full_frame);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_0);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_3);
   tcase_add_test (tc_chain, test_start_time_zero_live_drop_3_unlinked_1);
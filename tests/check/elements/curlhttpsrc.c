@@ -0,0 +1,127 @@
+/*
+ * Unittest for curlhttpsrc
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gio/gio.h>
+
+#define SEGMENT_SIZE 4096
+
+static gint n_connections;
+
+/* Minimal keep-alive HTTP/1.1 server answering every GET with a segment */
+static gboolean
+run_server (GThreadedSocketService * service, GSocketConnection * connection,
+    GObject * source_object, gpointer user_data)
+{
+  GInputStream *in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  GOutputStream *out =
+      g_io_stream_get_output_stream (G_IO_STREAM (connection));
+  GDataInputStream *data = g_data_input_stream_new (in);
+  guint8 body[SEGMENT_SIZE] = { 0, };
+  gchar *line;
+
+  g_atomic_int_inc (&n_connections);
+
+  g_data_input_stream_set_newline_type (data, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+  while ((line = g_data_input_stream_read_line (data, NULL, NULL, NULL))) {
+    gboolean end_of_request = (line[0] == '\0');
+
+    g_free (line);
+    if (end_of_request) {
+      gchar *headers = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+          "Content-Type: application/octet-stream\r\n"
+          "Content-Length: %d\r\n\r\n", SEGMENT_SIZE);
+
+      if (!g_output_stream_write_all (out, headers, strlen (headers), NULL,
+              NULL, NULL) || !g_output_stream_write_all (out, body,
+              sizeof (body), NULL, NULL, NULL)) {
+        g_free (headers);
+        break;
+      }
+      g_free (headers);
+    }
+  }
+
+  g_object_unref (data);
+  return TRUE;
+}
+
+GST_START_TEST (test_connection_reuse)
+{
+  GSocketService *service;
+  GstElement *pipeline, *src, *sink;
+  GstBus *bus;
+  guint16 port;
+  guint new_connections, reused_connections;
+  gint i;
+
+  g_atomic_int_set (&n_connections, 0);
+  service = g_threaded_socket_service_new (4);
+  port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service),
+      NULL, NULL);
+  fail_unless (port != 0);
+  g_signal_connect (service, "run", G_CALLBACK (run_server), NULL);
+  g_socket_service_start (service);
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("curlhttpsrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (src != NULL && sink != NULL);
+  g_object_set (src, "proxy", NULL, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  fail_unless (gst_element_link (src, sink));
+  bus = gst_element_get_bus (pipeline);
+
+  /* Download three segments from the same server in a row, like an adaptive
+   * demuxer reusing its source element */
+  for (i = 0; i < 3; i++) {
+    gchar *uri =
+        g_strdup_printf ("http://127.0.0.1:%u/segment%d.ts", port, i);
+    GstMessage *msg;
+
+    g_object_set (src, "location", uri, NULL);
+    g_free (uri);
+
+    fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+        GST_STATE_CHANGE_FAILURE);
+    msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    fail_unless (msg != NULL);
+    fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+    gst_message_unref (msg);
+    fail_unless (gst_element_set_state (pipeline, GST_STATE_READY) ==
+        GST_STATE_CHANGE_SUCCESS);
+  }
+
+  g_object_get (src, "new-connections", &new_connections,
+      "reused-connections", &reused_connections, NULL);
+  fail_unless_equals_int (new_connections, 1);
+  fail_unless_equals_int (reused_connections, 2);
+  fail_unless_equals_int (g_atomic_int_get (&n_connections), 1);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  g_socket_service_stop (service);
+  g_socket_listener_close (G_SOCKET_LISTENER (service));
+  g_object_unref (service);
+}
+
+GST_END_TEST;
+
+static Suite *
+curlhttpsrc_suite (void)
+{
+  Suite *s = suite_create ("curlhttpsrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 20);
+  tcase_add_test (tc_chain, test_connection_reuse);
+
+  return s;
+}
+
+GST_CHECK_MAIN (curlhttpsrc);
@@ -556,6 +556,115 @@ GST_START_TEST (test_crc)
 
 GST_END_TEST;
 
+GST_START_TEST (test_crc_slicing)
+{
+  guint8 data[1031];
+  GstBuffer *buffer;
+  guint i, length;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = g_random_int () & 0xff;
+
+  /* compare with a byte at a time CRC over all alignments and lengths */
+  for (length = 0; length < 64; length++) {
+    for (i = 0; i < 8; i++) {
+      guint16 crc_register = CRC_INIT;
+      const guint8 *p = data + i;
+      guint n;
+
+      for (n = 0; n < length; n++)
+        crc_register = (guint16) ((crc_register << 8) ^
+            gst_dp_crc_table[((crc_register >> 8) & 0x00ff) ^ *p++]);
+      if (length)
+        crc_register ^= 0xffff;
+      else
+        crc_register = 0;
+
+      fail_unless_equals_int (gst_dp_crc (data + i, length), crc_register);
+    }
+  }
+
+  /* a CRC over a buffer of several memories is the CRC of their data */
+  buffer = gst_buffer_new ();
+  for (i = 0; i < sizeof (data); i += 100)
+    gst_buffer_append_memory (buffer,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, data,
+            sizeof (data), i, MIN (100, sizeof (data) - i), NULL, NULL));
+  fail_unless_equals_int (gst_dp_crc_from_buffer (buffer),
+      gst_dp_crc (data, sizeof (data)));
+  gst_buffer_unref (buffer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_many_memories)
+{
+  GstCaps *caps;
+  GstElement *gdppay;
+  GstBuffer *inbuffer, *outbuffer;
+  guint8 data[1024];
+  GstMapInfo map;
+  guint i, n_mem;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i & 0xff;
+
+  gdppay = setup_gdppay ();
+  g_object_set (gdppay, "crc-payload", TRUE, NULL);
+
+  fail_unless (gst_element_set_state (gdppay,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, gdppay, caps, GST_FORMAT_TIME);
+
+  /* a first buffer gets the streamheader sent */
+  inbuffer = gst_buffer_new_and_alloc (4);
+  gst_buffer_memset (inbuffer, 0, 0, 4);
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 4);
+
+  /* a buffer with as many memories as possible can't take the header too,
+   * so it is pushed after it without merging the memories */
+  n_mem = gst_buffer_get_max_memory ();
+  inbuffer = gst_buffer_new ();
+  for (i = 0; i < n_mem; i++)
+    gst_buffer_append_memory (inbuffer,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, data,
+            sizeof (data), i * 64, 64, NULL, NULL));
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 6);
+
+  outbuffer = g_list_nth_data (buffers, 4);
+  fail_unless_equals_int (gst_buffer_get_size (outbuffer),
+      GST_DP_HEADER_LENGTH);
+  fail_if (GST_BUFFER_FLAG_IS_SET (outbuffer, GST_BUFFER_FLAG_DELTA_UNIT));
+  gst_buffer_map (outbuffer, &map, GST_MAP_READ);
+  fail_unless_equals_int (GST_DP_HEADER_PAYLOAD_LENGTH (map.data),
+      n_mem * 64);
+  fail_unless_equals_int (GST_DP_HEADER_CRC_PAYLOAD (map.data),
+      gst_dp_crc (data, n_mem * 64));
+  gst_buffer_unmap (outbuffer, &map);
+
+  outbuffer = g_list_nth_data (buffers, 5);
+  fail_unless_equals_int (gst_buffer_n_memory (outbuffer), n_mem);
+  fail_unless_equals_int (gst_buffer_get_size (outbuffer), n_mem * 64);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (outbuffer, GST_BUFFER_FLAG_DELTA_UNIT));
+
+  fail_unless (gst_element_set_state (gdppay,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  gst_caps_unref (caps);
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  ASSERT_OBJECT_REFCOUNT (gdppay, "gdppay", 1);
+  cleanup_gdppay (gdppay);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 gdppay_suite (void)
@@ -569,6 +678,8 @@ gdppay_suite (void)
   tcase_add_test (tc_chain, test_first_no_new_segment);
   tcase_add_test (tc_chain, test_streamheader);
   tcase_add_test (tc_chain, test_crc);
+  tcase_add_test (tc_chain, test_crc_slicing);
+  tcase_add_test (tc_chain, test_many_memories);
 
   return s;
 }
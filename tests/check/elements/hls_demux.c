@@ -724,6 +724,136 @@ GST_START_TEST (testFragmentDownloadError)
 
 GST_END_TEST;
 
+/* Tracks the requests of testPrefetch, which come from several threads */
+typedef struct _GstHlsDemuxTestPrefetchContext
+{
+  GstHlsDemuxTestCase *test_case;
+  GMutex lock;
+  GCond cond;
+  GHashTable *request_counts;
+  gboolean prefetched_during_first;
+  gboolean first_done;
+} GstHlsDemuxTestPrefetchContext;
+
+static gboolean
+gst_hlsdemux_test_prefetch_src_start (GstTestHTTPSrc * src,
+    const gchar * uri, GstTestHTTPSrcInput * input_data, gpointer user_data)
+{
+  GstHlsDemuxTestPrefetchContext *context = user_data;
+  guint count;
+  gboolean ret;
+
+  g_mutex_lock (&context->lock);
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (context->request_counts,
+          uri));
+  g_hash_table_insert (context->request_counts, g_strdup (uri),
+      GUINT_TO_POINTER (count + 1));
+  if (g_str_has_suffix (uri, "/002.ts") && !context->first_done)
+    context->prefetched_during_first = TRUE;
+  g_cond_broadcast (&context->cond);
+  ret = gst_hlsdemux_test_src_start (src, uri, input_data, context->test_case);
+  g_mutex_unlock (&context->lock);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_hlsdemux_test_prefetch_src_create (GstTestHTTPSrc * src,
+    guint64 offset, guint length, GstBuffer ** retbuf, gpointer context,
+    gpointer user_data)
+{
+  GstHlsDemuxTestPrefetchContext *prefetch_context = user_data;
+  GstHlsDemuxTestInputData *input = (GstHlsDemuxTestInputData *) context;
+  GstFlowReturn ret;
+
+  ret = gst_hlsdemux_test_src_create (src, offset, length, retbuf, context,
+      prefetch_context->test_case);
+
+  /* Keep the first fragment downloading until the next one was requested
+   * ahead, so that it can only have been prefetched */
+  if (g_str_has_suffix (input->uri, "/001.ts") &&
+      offset + length >= input->size) {
+    gint64 end_time = g_get_monotonic_time () + 5 * G_TIME_SPAN_SECOND;
+
+    g_mutex_lock (&prefetch_context->lock);
+    while (!prefetch_context->prefetched_during_first &&
+        g_cond_wait_until (&prefetch_context->cond, &prefetch_context->lock,
+            end_time));
+    prefetch_context->first_done = TRUE;
+    g_mutex_unlock (&prefetch_context->lock);
+  }
+
+  return ret;
+}
+
+static void
+testPrefetchPreTestCallback (GstAdaptiveDemuxTestEngine * engine,
+    gpointer user_data)
+{
+  g_object_set (engine->demux, "prefetch-fragments", 2, NULL);
+}
+
+/*
+ * Test that fragments requested ahead are used instead of being downloaded
+ * again
+ *
+ */
+GST_START_TEST (testPrefetch)
+{
+  const guint segment_size = 30 * TS_PACKET_LEN;
+  const gchar *manifest =
+      "#EXTM3U \n"
+      "#EXT-X-TARGETDURATION:1\n"
+      "#EXTINF:1,Test\n" "001.ts\n"
+      "#EXTINF:1,Test\n" "002.ts\n"
+      "#EXTINF:1,Test\n" "003.ts\n"
+      "#EXTINF:1,Test\n" "004.ts\n" "#EXT-X-ENDLIST\n";
+  GstHlsDemuxTestInputData inputTestData[] = {
+    {"http://unit.test/media.m3u8", (guint8 *) manifest, 0},
+    {"http://unit.test/001.ts", NULL, segment_size},
+    {"http://unit.test/002.ts", NULL, segment_size},
+    {"http://unit.test/003.ts", NULL, segment_size},
+    {"http://unit.test/004.ts", NULL, segment_size},
+    {NULL, NULL, 0},
+  };
+  GstAdaptiveDemuxTestExpectedOutput outputTestData[] = {
+    {"src_0", 4 * segment_size, NULL},
+    {NULL, 0, NULL}
+  };
+  GstHlsDemuxTestPrefetchContext context = { 0 };
+  guint i;
+  TESTCASE_INIT_BOILERPLATE (segment_size);
+
+  context.test_case = &hlsTestCase;
+  g_mutex_init (&context.lock);
+  g_cond_init (&context.cond);
+  context.request_counts = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
+
+  http_src_callbacks.src_start = gst_hlsdemux_test_prefetch_src_start;
+  http_src_callbacks.src_create = gst_hlsdemux_test_prefetch_src_create;
+  engine_callbacks.pre_test = testPrefetchPreTestCallback;
+  engine_callbacks.appsink_eos =
+      gst_adaptive_demux_test_check_size_of_received_data;
+
+  gst_test_http_src_install_callbacks (&http_src_callbacks, &context);
+  gst_adaptive_demux_test_run (DEMUX_ELEMENT_NAME,
+      inputTestData[0].uri, &engine_callbacks, engineTestData);
+
+  fail_unless (context.prefetched_during_first);
+  for (i = 1; inputTestData[i].uri; ++i) {
+    fail_unless_equals_int (GPOINTER_TO_UINT (g_hash_table_lookup
+            (context.request_counts, inputTestData[i].uri)), 1);
+  }
+
+  g_hash_table_unref (context.request_counts);
+  g_cond_clear (&context.cond);
+  g_mutex_clear (&context.lock);
+  TESTCASE_UNREF_BOILERPLATE;
+}
+
+GST_END_TEST;
+
 static Suite *
 hls_demux_suite (void)
 {
@@ -743,6 +873,7 @@ hls_demux_suite (void)
   tcase_add_test (tc_basicTest, testSeekSnapAfterPosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapBeforePosition);
   tcase_add_test (tc_basicTest, testReverseSeekSnapAfterPosition);
+  tcase_add_test (tc_basicTest, testPrefetch);
 
   tcase_add_unchecked_fixture (tc_basicTest, gst_adaptive_demux_test_setup,
       gst_adaptive_demux_test_teardown);
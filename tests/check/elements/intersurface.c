@@ -0,0 +1,215 @@
+/* GStreamer
+ *
+ * unit test for the queues of the inter elements surfaces
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "gstintersurface.c"
+
+#define N_BUFFERS 5
+
+static void
+create_buffers (GstBuffer ** buffers)
+{
+  guint i;
+
+  for (i = 0; i < N_BUFFERS; i++)
+    buffers[i] = gst_buffer_new ();
+}
+
+static void
+free_buffers (GstBuffer ** buffers)
+{
+  guint i;
+
+  for (i = 0; i < N_BUFFERS; i++) {
+    ASSERT_MINI_OBJECT_REFCOUNT (buffers[i], "buffer", 1);
+    gst_buffer_unref (buffers[i]);
+  }
+}
+
+/* Checks that the next buffer read from @queue is @expected */
+static void
+check_read (GstInterQueue * queue, guint64 * read_count, GstBuffer * expected)
+{
+  GstBuffer *buffer = gst_inter_queue_read (queue, read_count);
+
+  fail_unless (buffer == expected);
+  if (buffer)
+    gst_buffer_unref (buffer);
+}
+
+GST_START_TEST (test_queue_readers)
+{
+  GstInterQueue queue = { NULL, };
+  GstBuffer *buffers[N_BUFFERS];
+  guint64 read_a = 0, read_b = 0;
+
+  create_buffers (buffers);
+  gst_inter_queue_set_size (&queue, 3);
+
+  gst_inter_queue_push (&queue, buffers[0]);
+  gst_inter_queue_push (&queue, buffers[1]);
+  /* shared by reference */
+  ASSERT_MINI_OBJECT_REFCOUNT (buffers[0], "buffer", 2);
+
+  check_read (&queue, &read_a, buffers[0]);
+  check_read (&queue, &read_a, buffers[1]);
+  check_read (&queue, &read_a, NULL);
+  fail_unless_equals_uint64 (read_a, 2);
+
+  gst_inter_queue_push (&queue, buffers[2]);
+  check_read (&queue, &read_a, buffers[2]);
+
+  /* each reader gets all the buffers, whatever the others read */
+  check_read (&queue, &read_b, buffers[0]);
+  check_read (&queue, &read_b, buffers[1]);
+  check_read (&queue, &read_b, buffers[2]);
+  check_read (&queue, &read_b, NULL);
+
+  gst_inter_queue_clear (&queue);
+  g_free (queue.buffers);
+  free_buffers (buffers);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queue_overrun)
+{
+  GstInterQueue queue = { NULL, };
+  GstBuffer *buffers[N_BUFFERS];
+  guint64 read_count = 0;
+  guint i;
+
+  create_buffers (buffers);
+  gst_inter_queue_set_size (&queue, 2);
+
+  for (i = 0; i < N_BUFFERS; i++)
+    gst_inter_queue_push (&queue, buffers[i]);
+  fail_unless_equals_uint64 (queue.write_count, N_BUFFERS);
+  /* only the last two are kept */
+  ASSERT_MINI_OBJECT_REFCOUNT (buffers[0], "buffer", 1);
+  ASSERT_MINI_OBJECT_REFCOUNT (buffers[N_BUFFERS - 1], "buffer", 2);
+
+  /* a late reader skips the overwritten buffers */
+  check_read (&queue, &read_count, buffers[N_BUFFERS - 2]);
+  check_read (&queue, &read_count, buffers[N_BUFFERS - 1]);
+  check_read (&queue, &read_count, NULL);
+  fail_unless_equals_uint64 (read_count, N_BUFFERS);
+
+  gst_inter_queue_clear (&queue);
+  g_free (queue.buffers);
+  free_buffers (buffers);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_queue_clear)
+{
+  GstInterQueue queue = { NULL, };
+  GstBuffer *buffers[N_BUFFERS];
+  guint64 read_count = 0;
+
+  create_buffers (buffers);
+  gst_inter_queue_set_size (&queue, 3);
+
+  gst_inter_queue_push (&queue, buffers[0]);
+  gst_inter_queue_push (&queue, buffers[1]);
+
+  /* the same size keeps the buffers */
+  gst_inter_queue_set_size (&queue, 3);
+  ASSERT_MINI_OBJECT_REFCOUNT (buffers[0], "buffer", 2);
+
+  /* cleared buffers are skipped, the readers keep their position */
+  gst_inter_queue_clear (&queue);
+  ASSERT_MINI_OBJECT_REFCOUNT (buffers[0], "buffer", 1);
+  check_read (&queue, &read_count, NULL);
+  fail_unless_equals_uint64 (read_count, 2);
+
+  gst_inter_queue_push (&queue, buffers[2]);
+  check_read (&queue, &read_count, buffers[2]);
+
+  /* so does resizing */
+  gst_inter_queue_push (&queue, buffers[3]);
+  gst_inter_queue_set_size (&queue, 5);
+  ASSERT_MINI_OBJECT_REFCOUNT (buffers[3], "buffer", 1);
+  gst_inter_queue_push (&queue, buffers[4]);
+  check_read (&queue, &read_count, buffers[4]);
+  check_read (&queue, &read_count, NULL);
+
+  gst_inter_queue_clear (&queue);
+  g_free (queue.buffers);
+  free_buffers (buffers);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_audio_queue_size)
+{
+  /* a period more than the buffer time, in chunks of at least a period */
+  fail_unless_equals_int (gst_inter_surface_get_audio_queue_size
+      (DEFAULT_AUDIO_BUFFER_TIME, DEFAULT_AUDIO_PERIOD_TIME), 41);
+  fail_unless_equals_int (gst_inter_surface_get_audio_queue_size
+      (100 * GST_MSECOND, 30 * GST_MSECOND), 5);
+  fail_unless_equals_int (gst_inter_surface_get_audio_queue_size
+      (GST_SECOND, 0), 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_surface_shared)
+{
+  GstInterSurface *a, *b, *c;
+
+  a = gst_inter_surface_get ("a");
+  b = gst_inter_surface_get ("a");
+  c = gst_inter_surface_get ("c");
+
+  fail_unless (a == b);
+  fail_unless (a != c);
+  fail_unless_equals_int (a->ref_count, 2);
+  fail_unless_equals_int (a->video_queue.size, DEFAULT_VIDEO_QUEUE_SIZE);
+  fail_unless_equals_int (a->audio_queue.size,
+      gst_inter_surface_get_audio_queue_size (DEFAULT_AUDIO_BUFFER_TIME,
+          DEFAULT_AUDIO_PERIOD_TIME));
+
+  gst_inter_surface_unref (a);
+  gst_inter_surface_unref (b);
+  gst_inter_surface_unref (c);
+}
+
+GST_END_TEST;
+
+static Suite *
+intersurface_suite (void)
+{
+  Suite *s = suite_create ("intersurface");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_queue_readers);
+  tcase_add_test (tc_chain, test_queue_overrun);
+  tcase_add_test (tc_chain, test_queue_clear);
+  tcase_add_test (tc_chain, test_audio_queue_size);
+  tcase_add_test (tc_chain, test_surface_shared);
+
+  return s;
+}
+
+GST_CHECK_MAIN (intersurface);
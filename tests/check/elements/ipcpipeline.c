@@ -0,0 +1,190 @@
+/* GStreamer
+ *
+ * unit test for the ipcpipelinesink/ipcpipelinesrc data path
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <gst/check/gstcheck.h>
+
+/* more than the number of shared memory slots, so that all of them need
+ * to be released and reused for the shared memory test to pass */
+#define N_BUFFERS 64
+
+/* Both ends run in this process, connected by a socketpair, which is enough
+ * to exercise the data plane. Buffers received by the slave are checked in
+ * the fakesink handoff: data copied inline through the socket is writable,
+ * data coming from shared memory is read-only. */
+
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  gint size;
+  gint received;
+  gint n_shm;
+  gboolean bad_data;
+} TestData;
+
+static void
+handoff_cb (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    TestData * data)
+{
+  GstMapInfo map;
+  gboolean readonly, bad = FALSE;
+  gsize i;
+
+  readonly = gst_buffer_n_memory (buf) == 1
+      && GST_MEMORY_IS_READONLY (gst_buffer_peek_memory (buf, 0));
+
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  if (map.size != data->size)
+    bad = TRUE;
+  /* fakesrc filltype=pattern writes 0x00 to 0xff repeatedly */
+  for (i = 0; i < map.size && !bad; ++i)
+    bad = map.data[i] != (i & 0xff);
+  gst_buffer_unmap (buf, &map);
+
+  g_mutex_lock (&data->lock);
+  data->received++;
+  if (readonly)
+    data->n_shm++;
+  if (bad)
+    data->bad_data = TRUE;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+run_pipelines (gint size, gboolean shared_memory, TestData * data)
+{
+  GstElement *master, *slave;
+  GstElement *src, *ipcpipelinesink, *ipcpipelinesrc, *sink;
+  gint64 end_time;
+  int sockets[2];
+
+  fail_unless (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+  fail_unless (fcntl (sockets[0], F_SETFL, O_NONBLOCK) == 0);
+  fail_unless (fcntl (sockets[1], F_SETFL, O_NONBLOCK) == 0);
+
+  g_mutex_init (&data->lock);
+  g_cond_init (&data->cond);
+  data->size = size;
+  data->received = 0;
+  data->n_shm = 0;
+  data->bad_data = FALSE;
+
+  slave = gst_element_factory_make ("ipcslavepipeline", NULL);
+  fail_unless (slave != NULL);
+  ipcpipelinesrc = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (ipcpipelinesrc, "fdin", sockets[1], "fdout", sockets[1],
+      NULL);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE,
+      "enable-last-sample", FALSE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), data);
+  gst_bin_add_many (GST_BIN (slave), ipcpipelinesrc, sink, NULL);
+  fail_unless (gst_element_link (ipcpipelinesrc, sink));
+
+  master = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("fakesrc", NULL);
+  gst_util_set_object_arg (G_OBJECT (src), "sizetype", "fixed");
+  gst_util_set_object_arg (G_OBJECT (src), "filltype", "pattern");
+  g_object_set (src, "sizemax", size, "num-buffers", N_BUFFERS, NULL);
+  ipcpipelinesink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  g_object_set (ipcpipelinesink, "fdin", sockets[0], "fdout", sockets[0],
+      "shared-memory", shared_memory, NULL);
+  gst_bin_add_many (GST_BIN (master), src, ipcpipelinesink, NULL);
+  fail_unless (gst_element_link (src, ipcpipelinesink));
+
+  fail_if (gst_element_set_state (master, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&data->lock);
+  while (data->received < N_BUFFERS)
+    if (!g_cond_wait_until (&data->cond, &data->lock, end_time))
+      break;
+  g_mutex_unlock (&data->lock);
+
+  g_signal_emit_by_name (ipcpipelinesink, "disconnect", NULL);
+  g_signal_emit_by_name (ipcpipelinesrc, "disconnect", NULL);
+  gst_element_set_state (master, GST_STATE_NULL);
+  gst_element_set_state (slave, GST_STATE_NULL);
+  gst_object_unref (master);
+  gst_object_unref (slave);
+
+  close (sockets[0]);
+  close (sockets[1]);
+  g_cond_clear (&data->cond);
+  g_mutex_clear (&data->lock);
+
+  fail_unless_equals_int (data->received, N_BUFFERS);
+  fail_if (data->bad_data);
+}
+
+GST_START_TEST (test_inline_buffers)
+{
+  TestData data;
+
+  run_pipelines (64 * 1024, FALSE, &data);
+  fail_unless_equals_int (data.n_shm, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_small_buffers_stay_inline)
+{
+  TestData data;
+
+  /* below the shared memory threshold */
+  run_pipelines (256, TRUE, &data);
+  fail_unless_equals_int (data.n_shm, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_buffers)
+{
+  TestData data;
+
+  /* fakesink drops every buffer after the handoff, which releases its slot:
+   * if slots leaked, buffers past the slot count would fall back inline */
+  run_pipelines (64 * 1024, TRUE, &data);
+  fail_unless_equals_int (data.n_shm, N_BUFFERS);
+}
+
+GST_END_TEST;
+
+static Suite *
+ipcpipeline_suite (void)
+{
+  Suite *s = suite_create ("ipcpipeline");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_inline_buffers);
+  tcase_add_test (tc, test_small_buffers_stay_inline);
+  tcase_add_test (tc, test_shm_buffers);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ipcpipeline);
@@ -803,6 +803,343 @@ GST_START_TEST (test_keyframe_flag_propagation)
 
 GST_END_TEST;
 
+GST_START_TEST (test_m2ts_output)
+{
+  GstElement *mux;
+  gchar *padname;
+  GstCaps *caps;
+  GstClockTime ts = 0;
+  guint32 prev_arrival = 0;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "m2ts-mode", TRUE, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 50; i++) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (4000);
+
+    gst_buffer_memset (inbuffer, 0, 0, 4000);
+    GST_BUFFER_PTS (inbuffer) = ts;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+    ts += 40 * GST_MSECOND;
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless (buffers != NULL);
+
+  /* every buffer is 32 packets of 192 bytes, whose 4 byte prefix carries a
+   * growing arrival timestamp */
+  while (buffers != NULL) {
+    GstBuffer *outbuffer = buffers->data;
+    GstMapInfo map;
+    gsize offset;
+
+    buffers = g_list_remove (buffers, outbuffer);
+
+    gst_buffer_map (outbuffer, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, 32 * 192);
+    for (offset = 0; offset < map.size; offset += 192) {
+      guint32 arrival = GST_READ_UINT32_BE (map.data + offset) & 0x3FFFFFFF;
+
+      fail_unless (map.data[offset + 4] == 0x47);
+      fail_unless (arrival >= prev_arrival);
+      prev_arrival = arrival;
+    }
+    gst_buffer_unmap (outbuffer, &map);
+    gst_buffer_unref (outbuffer);
+  }
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_constant_bitrate)
+{
+  GstElement *mux;
+  gchar *padname;
+  GstCaps *caps;
+  GstClockTime ts = 0;
+  const guint64 bitrate = 2000000;
+  const guint pcr_interval = 3600;
+  guint64 n_bytes = 0, last_pcr_bytes = 0;
+  gint64 pcr_base = -1, last_pcr = -1;
+  guint n_pcrs = 0, n_null = 0;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", bitrate, "pcr-interval", pcr_interval,
+      "alignment", 7, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* 20 seconds of 800 kbit/s */
+  for (i = 0; i < 500; i++) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (4000);
+
+    gst_buffer_memset (inbuffer, 0, 0, 4000);
+    GST_BUFFER_PTS (inbuffer) = ts;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+    ts += 40 * GST_MSECOND;
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless (buffers != NULL);
+
+  while (buffers != NULL) {
+    GstBuffer *outbuffer = buffers->data;
+    GstMapInfo map;
+    gsize offset;
+
+    buffers = g_list_remove (buffers, outbuffer);
+
+    gst_buffer_map (outbuffer, &map, GST_MAP_READ);
+    fail_unless (map.size % 188 == 0);
+    for (offset = 0; offset < map.size; offset += 188, n_bytes += 188) {
+      const guint8 *data = map.data + offset;
+      guint pid = ((data[1] & 0x1f) << 8) | data[2];
+      gint64 pcr;
+
+      fail_unless (data[0] == 0x47);
+      if (pid == 0x1fff)
+        n_null++;
+
+      /* adaptation field with the PCR flag */
+      if (!(data[3] & 0x20) || data[4] == 0 || !(data[5] & 0x10))
+        continue;
+
+      pcr = (((guint64) data[6] << 25) | (data[7] << 17) | (data[8] << 9) |
+          (data[9] << 1) | (data[10] >> 7)) * 300 +
+          (((data[10] & 1) << 8) | data[11]);
+
+      /* every PCR is exactly the time byte 10 of its packet, holding the
+       * last bit of the PCR base, is sent at the bitrate */
+      if (pcr_base == -1)
+        pcr_base = pcr - gst_util_uint64_scale ((n_bytes + 10) * 8, 27000000,
+            bitrate);
+      fail_unless (ABS (pcr - pcr_base - (gint64) gst_util_uint64_scale
+              ((n_bytes + 10) * 8, 27000000, bitrate)) <= 1,
+          "PCR %" G_GINT64_FORMAT " off at byte %" G_GUINT64_FORMAT, pcr,
+          n_bytes);
+
+      /* and they are never further apart than the interval, give or take
+       * the PAT and PMT packets written in front of the PCR packet */
+      if (last_pcr != -1) {
+        fail_unless (pcr > last_pcr);
+        fail_unless (pcr - last_pcr <= pcr_interval * 300 +
+            gst_util_uint64_scale (4 * 188 * 8, 27000000, bitrate) + 1);
+      }
+      last_pcr = pcr;
+      last_pcr_bytes = n_bytes;
+      n_pcrs++;
+    }
+    gst_buffer_unmap (outbuffer, &map);
+    gst_buffer_unref (outbuffer);
+  }
+
+  /* the stream was padded up to the bitrate, and the PCRs cover it all */
+  fail_unless (n_null > 0);
+  fail_unless (n_pcrs >= 19 * 25);
+  fail_unless (gst_util_uint64_scale (last_pcr_bytes * 8, GST_SECOND,
+          bitrate) >= 19 * GST_SECOND);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_constant_bitrate_m2ts)
+{
+  GstElement *mux;
+  gchar *padname;
+  GstCaps *caps;
+  GstClockTime ts = 0;
+  const guint64 bitrate = 2000000;
+  guint n_pcrs = 0;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", bitrate, "m2ts-mode", TRUE, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  for (i = 0; i < 50; i++) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (4000);
+
+    gst_buffer_memset (inbuffer, 0, 0, 4000);
+    GST_BUFFER_PTS (inbuffer) = ts;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+    ts += 40 * GST_MSECOND;
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless (buffers != NULL);
+
+  /* the arrival timestamp is the time the packet starts, and the PCR is the
+   * time its byte 10 arrives, 10 bytes later at the bitrate */
+  while (buffers != NULL) {
+    GstBuffer *outbuffer = buffers->data;
+    GstMapInfo map;
+    gsize offset;
+
+    buffers = g_list_remove (buffers, outbuffer);
+
+    gst_buffer_map (outbuffer, &map, GST_MAP_READ);
+    fail_unless (map.size % 192 == 0);
+    for (offset = 0; offset < map.size; offset += 192) {
+      const guint8 *data = map.data + offset + 4;
+      guint32 arrival = GST_READ_UINT32_BE (map.data + offset) & 0x3FFFFFFF;
+      gint64 pcr, delay;
+
+      fail_unless (data[0] == 0x47);
+      if (!(data[3] & 0x20) || data[4] == 0 || !(data[5] & 0x10))
+        continue;
+
+      pcr = (((guint64) data[6] << 25) | (data[7] << 17) | (data[8] << 9) |
+          (data[9] << 1) | (data[10] >> 7)) * 300 +
+          (((data[10] & 1) << 8) | data[11]);
+
+      delay = (pcr - arrival) & 0x3FFFFFFF;
+      fail_unless (ABS (delay - (gint64) gst_util_uint64_scale (10 * 8,
+                  27000000, bitrate)) <= 1,
+          "PCR %" G_GINT64_FORMAT " is %" G_GINT64_FORMAT " after arrival",
+          pcr, delay);
+      n_pcrs++;
+    }
+    gst_buffer_unmap (outbuffer, &map);
+    gst_buffer_unref (outbuffer);
+  }
+
+  fail_unless (n_pcrs > 0);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bitrate_change)
+{
+  GstElement *mux;
+  gchar *padname;
+  GstCaps *caps;
+  GstClockTime ts = 0;
+  const guint64 bitrate1 = 2000000, bitrate2 = 4000000;
+  const guint pcr_interval = 3600;
+  guint64 n_bytes = 0, last_pcr_bytes = 0;
+  gint64 last_pcr = -1;
+  gboolean switched = FALSE;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  g_object_set (mux, "bitrate", bitrate1, "pcr-interval", pcr_interval,
+      "alignment", 7, NULL);
+
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  gst_check_setup_events (mysrcpad, mux, caps, GST_FORMAT_TIME);
+  gst_caps_unref (caps);
+
+  /* 5 seconds at each bitrate */
+  for (i = 0; i < 250; i++) {
+    GstBuffer *inbuffer = gst_buffer_new_and_alloc (4000);
+
+    if (i == 125)
+      g_object_set (mux, "bitrate", bitrate2, NULL);
+
+    gst_buffer_memset (inbuffer, 0, 0, 4000);
+    GST_BUFFER_PTS (inbuffer) = ts;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+    ts += 40 * GST_MSECOND;
+  }
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless (buffers != NULL);
+
+  while (buffers != NULL) {
+    GstBuffer *outbuffer = buffers->data;
+    GstMapInfo map;
+    gsize offset;
+
+    buffers = g_list_remove (buffers, outbuffer);
+
+    gst_buffer_map (outbuffer, &map, GST_MAP_READ);
+    for (offset = 0; offset < map.size; offset += 188, n_bytes += 188) {
+      const guint8 *data = map.data + offset;
+      gint64 pcr, at_bitrate1, at_bitrate2;
+
+      if (!(data[3] & 0x20) || data[4] == 0 || !(data[5] & 0x10))
+        continue;
+
+      pcr = (((guint64) data[6] << 25) | (data[7] << 17) | (data[8] << 9) |
+          (data[9] << 1) | (data[10] >> 7)) * 300 +
+          (((data[10] & 1) << 8) | data[11]);
+
+      if (last_pcr == -1) {
+        last_pcr = pcr;
+        last_pcr_bytes = n_bytes;
+        continue;
+      }
+
+      /* the PCRs go on from where they were, at the old rate up to the
+       * change and at the new one after it, with the pair around the change
+       * in between */
+      at_bitrate1 = gst_util_uint64_scale ((n_bytes - last_pcr_bytes) * 8,
+          27000000, bitrate1);
+      at_bitrate2 = gst_util_uint64_scale ((n_bytes - last_pcr_bytes) * 8,
+          27000000, bitrate2);
+      fail_unless (pcr - last_pcr >= at_bitrate2 - 1 &&
+          pcr - last_pcr <= at_bitrate1 + 1,
+          "PCR %" G_GINT64_FORMAT " off at byte %" G_GUINT64_FORMAT, pcr,
+          n_bytes);
+      if (switched)
+        fail_unless (ABS (pcr - last_pcr - at_bitrate2) <= 1);
+      else if (ABS (pcr - last_pcr - at_bitrate1) > 1)
+        switched = TRUE;
+
+      fail_unless (pcr - last_pcr <= pcr_interval * 300 +
+          gst_util_uint64_scale (4 * 188 * 8, 27000000, bitrate1) + 1);
+
+      last_pcr = pcr;
+      last_pcr_bytes = n_bytes;
+    }
+    gst_buffer_unmap (outbuffer, &map);
+    gst_buffer_unref (outbuffer);
+  }
+
+  fail_unless (switched);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -819,6 +1156,10 @@ mpegtsmux_suite (void)
   tcase_add_test (tc_chain, test_multiple_state_change);
   tcase_add_test (tc_chain, test_align);
   tcase_add_test (tc_chain, test_keyframe_flag_propagation);
+  tcase_add_test (tc_chain, test_m2ts_output);
+  tcase_add_test (tc_chain, test_constant_bitrate);
+  tcase_add_test (tc_chain, test_constant_bitrate_m2ts);
+  tcase_add_test (tc_chain, test_bitrate_change);
 
   return s;
 }
@@ -26,6 +26,11 @@
 
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/allocators/allocators.h>
+#include <glib/gstdio.h>
+
+#include <string.h>
+#include <unistd.h>
 
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
@@ -42,7 +47,7 @@ GstElement *src, *sink;
 GstPad *sinkpad, *srcpad;
 
 static void
-setup_shm (void)
+setup_shm_full (guint ring_size, gboolean fd_passing)
 {
   gchar *socket_path = NULL;
 
@@ -52,7 +57,8 @@ setup_shm (void)
   srcpad = gst_check_setup_src_pad (sink, &src_template);
   sinkpad = gst_check_setup_sink_pad (src, &sink_template);
 
-  g_object_set (sink, "socket-path", "shm-unit-test", NULL);
+  g_object_set (sink, "socket-path", "shm-unit-test", "ring-size", ring_size,
+      "fd-passing", fd_passing, NULL);
 
   fail_unless (gst_element_set_state (sink, GST_STATE_PLAYING) ==
       GST_STATE_CHANGE_ASYNC);
@@ -69,6 +75,24 @@ setup_shm (void)
       GST_STATE_CHANGE_SUCCESS);
 }
 
+static void
+setup_shm (void)
+{
+  setup_shm_full (0, FALSE);
+}
+
+static void
+setup_shm_ring (void)
+{
+  setup_shm_full (4, FALSE);
+}
+
+static void
+setup_shm_fd_passing (void)
+{
+  setup_shm_full (0, TRUE);
+}
+
 static void
 teardown_shm (void)
 {
@@ -169,6 +193,95 @@ GST_START_TEST (test_shm_alloc)
 
 GST_END_TEST;
 
+/* Push more buffers than the ring holds, each one being released by the
+ * receiving side before the next, so that the slots have to be reused */
+GST_START_TEST (test_shm_ring_reuse)
+{
+  GstSegment segment;
+  guint i;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  for (i = 0; i < 20; i++) {
+    GstBuffer *buf;
+    guint8 value = i;
+
+    buf = gst_buffer_new_allocate (NULL, 1000, NULL);
+    gst_buffer_memset (buf, 0, value, 1000);
+    fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+    g_mutex_lock (&check_mutex);
+    while (buffers == NULL)
+      g_cond_wait (&check_cond, &check_mutex);
+    g_mutex_unlock (&check_mutex);
+    fail_unless (g_list_length (buffers) == 1);
+
+    buf = buffers->data;
+    fail_unless (gst_buffer_get_size (buf) == 1000);
+    fail_unless (gst_buffer_memcmp (buf, 999, &value, 1) == 0);
+
+    gst_check_drop_buffers ();
+  }
+
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_shm_fd_passing)
+{
+  GstAllocator *alloc;
+  GstSegment segment;
+  GstMemory *mem;
+  GstBuffer *buf;
+  gchar *filename;
+  guint8 data[1000];
+  guint8 value = 42;
+  gint fd;
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_segment_init (&segment, GST_FORMAT_BYTES);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  fd = g_file_open_tmp ("shm-test-XXXXXX", &filename, NULL);
+  fail_unless (fd >= 0);
+  g_unlink (filename);
+  g_free (filename);
+
+  /* The buffer starts in the middle of the file */
+  memset (data, 0, sizeof (data));
+  fail_unless (write (fd, data, sizeof (data)) == sizeof (data));
+  data[999] = value;
+  fail_unless (write (fd, data, sizeof (data)) == sizeof (data));
+
+  alloc = gst_fd_allocator_new ();
+  mem = gst_fd_allocator_alloc (alloc, fd, 2000, GST_FD_MEMORY_FLAG_NONE);
+  gst_memory_resize (mem, 1000, 1000);
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf, mem);
+  gst_object_unref (alloc);
+
+  fail_unless (gst_pad_push (srcpad, buf) == GST_FLOW_OK);
+
+  g_mutex_lock (&check_mutex);
+  while (buffers == NULL)
+    g_cond_wait (&check_cond, &check_mutex);
+  g_mutex_unlock (&check_mutex);
+  fail_unless (g_list_length (buffers) == 1);
+
+  buf = buffers->data;
+  fail_unless (gst_buffer_get_size (buf) == 1000);
+  fail_unless (gst_is_fd_memory (gst_buffer_peek_memory (buf, 0)));
+  fail_unless (gst_buffer_memcmp (buf, 999, &value, 1) == 0);
+
+  gst_check_drop_buffers ();
+  teardown_shm ();
+}
+
+GST_END_TEST;
+
 static Suite *
 shm_suite (void)
 {
@@ -181,6 +294,19 @@ shm_suite (void)
   tcase_add_test (tc, test_shm_alloc);
   suite_add_tcase (s, tc);
 
+  tc = tcase_create ("shm-ring");
+  tcase_add_checked_fixture (tc, setup_shm_ring, NULL);
+  tcase_add_test (tc, test_shm_sysmem_alloc);
+  tcase_add_test (tc, test_shm_alloc);
+  tcase_add_test (tc, test_shm_ring_reuse);
+  suite_add_tcase (s, tc);
+
+  tc = tcase_create ("shm-fd-passing");
+  tcase_add_checked_fixture (tc, setup_shm_fd_passing, NULL);
+  tcase_add_test (tc, test_shm_sysmem_alloc);
+  tcase_add_test (tc, test_shm_fd_passing);
+  suite_add_tcase (s, tc);
+
   return s;
 }
 
@@ -207,6 +207,167 @@ GST_START_TEST (test_roc)
 
 GST_END_TEST;
 
+#define TEST_KEY "012345678901234567890123456789"
+#define TEST_PAYLOAD_SIZE 160
+#define TEST_PACKET_SIZE (12 + TEST_PAYLOAD_SIZE)
+/* aes-128-icm / hmac-sha1-80 authentication tag */
+#define TEST_TAG_SIZE 10
+
+static GstBuffer *
+create_rtp_buffer (guint16 seqnum, gsize tailroom)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  buf = gst_buffer_new_allocate (NULL, TEST_PACKET_SIZE + tailroom, NULL);
+  gst_buffer_set_size (buf, TEST_PACKET_SIZE);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  memset (map.data, 0, map.size);
+  map.data[0] = 0x80;
+  map.data[1] = 8;
+  GST_WRITE_UINT16_BE (map.data + 2, seqnum);
+  GST_WRITE_UINT32_BE (map.data + 8, 1356955624);
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+GST_START_TEST (test_protect_in_place_and_list)
+{
+  GstElement *srtpenc;
+  GstPad *sinkpad;
+  GstHarness *h;
+  GstBuffer *buf, *key;
+  GstBufferList *list;
+  GstMemory *mem;
+  guint i;
+
+  srtpenc = gst_element_factory_make ("srtpenc", NULL);
+  key = gst_buffer_new_wrapped (g_strdup (TEST_KEY), strlen (TEST_KEY));
+  g_object_set (srtpenc, "key", key, NULL);
+  gst_buffer_unref (key);
+  sinkpad = gst_element_get_request_pad (srtpenc, "rtp_sink_0");
+  fail_unless (sinkpad != NULL);
+
+  h = gst_harness_new_with_element (srtpenc, "rtp_sink_0", "rtp_src_0");
+  gst_harness_set_src_caps_str (h, "application/x-rtp, payload=(int)8, "
+      "ssrc=(uint)1356955624");
+
+  /* A buffer with room for the trailer is protected without copying */
+  buf = create_rtp_buffer (0, 64);
+  mem = gst_buffer_peek_memory (buf, 0);
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      TEST_PACKET_SIZE + TEST_TAG_SIZE);
+  fail_unless (gst_buffer_peek_memory (buf, 0) == mem);
+  gst_buffer_unref (buf);
+
+  /* One without is copied, as are the ones of a list still in use */
+  buf = create_rtp_buffer (1, 0);
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  buf = gst_harness_pull (h);
+  fail_unless_equals_int (gst_buffer_get_size (buf),
+      TEST_PACKET_SIZE + TEST_TAG_SIZE);
+  gst_buffer_unref (buf);
+
+  list = gst_buffer_list_new ();
+  for (i = 2; i < 10; i++)
+    gst_buffer_list_add (list, create_rtp_buffer (i, i % 2 ? 64 : 0));
+  gst_buffer_list_ref (list);
+  fail_unless_equals_int (gst_pad_push_list (h->srcpad, list), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 10);
+  for (i = 2; i < 10; i++) {
+    GstMapInfo map;
+
+    buf = gst_harness_pull (h);
+    fail_unless_equals_int (gst_buffer_get_size (buf),
+        TEST_PACKET_SIZE + TEST_TAG_SIZE);
+    fail_unless_equals_int (gst_buffer_get_size (gst_buffer_list_get (list,
+                i - 2)), TEST_PACKET_SIZE);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (GST_READ_UINT16_BE (map.data + 2), i);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+  gst_buffer_list_unref (list);
+
+  gst_harness_teardown (h);
+  gst_element_release_request_pad (srtpenc, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srtpenc);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_decode_list)
+{
+  GstElement *srtpenc;
+  GstPad *sinkpad;
+  GstHarness *enc_h, *dec_h;
+  GstBuffer *buf, *key;
+  GstBufferList *list;
+  GstCaps *caps;
+  guint i;
+
+  srtpenc = gst_element_factory_make ("srtpenc", NULL);
+  key = gst_buffer_new_wrapped (g_strdup (TEST_KEY), strlen (TEST_KEY));
+  g_object_set (srtpenc, "key", key, NULL);
+  sinkpad = gst_element_get_request_pad (srtpenc, "rtp_sink_0");
+  fail_unless (sinkpad != NULL);
+
+  enc_h = gst_harness_new_with_element (srtpenc, "rtp_sink_0", "rtp_src_0");
+  gst_harness_set_src_caps_str (enc_h, "application/x-rtp, payload=(int)8, "
+      "ssrc=(uint)1356955624");
+
+  dec_h = gst_harness_new_with_padnames ("srtpdec", "rtp_sink", "rtp_src");
+  caps = gst_caps_new_simple ("application/x-srtp",
+      "payload", G_TYPE_INT, 8, "ssrc", G_TYPE_UINT, 1356955624,
+      "srtp-key", GST_TYPE_BUFFER, key,
+      "srtp-cipher", G_TYPE_STRING, "aes-128-icm",
+      "srtp-auth", G_TYPE_STRING, "hmac-sha1-80",
+      "srtcp-cipher", G_TYPE_STRING, "aes-128-icm",
+      "srtcp-auth", G_TYPE_STRING, "hmac-sha1-80", NULL);
+  gst_harness_set_src_caps (dec_h, caps);
+  gst_buffer_unref (key);
+
+  list = gst_buffer_list_new ();
+  for (i = 0; i < 10; i++) {
+    fail_unless_equals_int (gst_harness_push (enc_h,
+            create_rtp_buffer (i, 0)), GST_FLOW_OK);
+    gst_buffer_list_add (list, gst_harness_pull (enc_h));
+  }
+
+  /* A corrupted packet is dropped without affecting the rest of the list */
+  buf = gst_buffer_list_get_writable (list, 5);
+  gst_buffer_memset (buf, 20, 0xff, 4);
+
+  fail_unless_equals_int (gst_pad_push_list (dec_h->srcpad, list),
+      GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_received (dec_h), 9);
+  for (i = 0; i < 10; i++) {
+    GstMapInfo map;
+
+    if (i == 5)
+      continue;
+
+    buf = gst_harness_pull (dec_h);
+    fail_unless_equals_int (gst_buffer_get_size (buf), TEST_PACKET_SIZE);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (GST_READ_UINT16_BE (map.data + 2), i);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (enc_h);
+  gst_harness_teardown (dec_h);
+  gst_element_release_request_pad (srtpenc, sinkpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srtpenc);
+}
+
+GST_END_TEST;
+
 static Suite *
 srtp_suite (void)
 {
@@ -218,6 +379,8 @@ srtp_suite (void)
   tcase_add_test (tc_chain, test_create_and_unref);
   tcase_add_test (tc_chain, test_play);
   tcase_add_test (tc_chain, test_roc);
+  tcase_add_test (tc_chain, test_protect_in_place_and_list);
+  tcase_add_test (tc_chain, test_decode_list);
 
   return s;
 }
@@ -0,0 +1,370 @@
+/* GStreamer
+ *
+ * unit test for tsdemux trick modes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include <gst/check/gstcheck.h>
+
+/* The test stream: a single H.264 stream of 10 seconds at 25 fps, with an
+ * IDR picture every 10 frames. It only needs to look like H.264 to the
+ * keyframe detection of tsdemux, the NAL units hold filler bytes. */
+#define N_FRAMES 250
+#define FRAME_RATE 25
+#define GOP_SIZE 10
+#define KEY_FRAME_SIZE 4000
+#define DELTA_FRAME_SIZE 1000
+
+#define PMT_PID 0x1000
+#define VIDEO_PID 0x100
+
+#define FRAME_PTS(n) (90000 + (n) * 90000 / FRAME_RATE)
+
+typedef struct
+{
+  GMutex lock;
+  gdouble rate;
+  guint64 bytes_pulled;
+  guint n_buffers;
+  guint n_delta;
+  GstClockTime first_pts;
+  GstClockTime last_pts;
+  GstClockTime min_pts_delta;
+  gboolean misordered;
+} TrickModeData;
+
+static guint32
+crc32_mpeg (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+/* Appends a packet carrying as much of @data as fits, returns how much */
+static guint
+write_ts_packet (GByteArray * ts, guint16 pid, gboolean pusi, guint8 * cc,
+    guint64 pcr, gboolean rai, const guint8 * data, guint len)
+{
+  guint8 pkt[188];
+  gboolean has_af = pcr != -1 || rai;
+  guint af_len = has_af ? 1 + (pcr != -1 ? 6 : 0) : 0;
+  guint room, n, i;
+
+  room = 184 - (has_af ? 1 + af_len : 0);
+  n = MIN (len, room);
+  if (n < room) {
+    /* stuff the adaptation field up to the end of the packet */
+    has_af = TRUE;
+    af_len = 184 - n - 1;
+  }
+
+  pkt[0] = 0x47;
+  pkt[1] = (pusi ? 0x40 : 0x00) | (pid >> 8);
+  pkt[2] = pid & 0xff;
+  pkt[3] = (has_af ? 0x30 : 0x10) | (*cc & 0x0f);
+  *cc = (*cc + 1) & 0x0f;
+  i = 4;
+
+  if (has_af) {
+    guint end = i + 1 + af_len;
+
+    pkt[i++] = af_len;
+    if (af_len > 0) {
+      pkt[i++] = (pcr != -1 ? 0x10 : 0x00) | (rai ? 0x40 : 0x00);
+      if (pcr != -1) {
+        pkt[i++] = pcr >> 25;
+        pkt[i++] = pcr >> 17;
+        pkt[i++] = pcr >> 9;
+        pkt[i++] = pcr >> 1;
+        pkt[i++] = ((pcr & 1) << 7) | 0x7e;
+        pkt[i++] = 0x00;
+      }
+      memset (pkt + i, 0xff, end - i);
+      i = end;
+    }
+  }
+
+  memcpy (pkt + i, data, n);
+  g_byte_array_append (ts, pkt, sizeof (pkt));
+
+  return n;
+}
+
+static void
+write_section (GByteArray * ts, guint16 pid, guint8 * cc,
+    const guint8 * section, guint len)
+{
+  guint8 buf[184];
+  guint32 crc;
+
+  /* pointer field, section, CRC */
+  buf[0] = 0;
+  memcpy (buf + 1, section, len);
+  crc = crc32_mpeg (section, len);
+  GST_WRITE_UINT32_BE (buf + 1 + len, crc);
+  write_ts_packet (ts, pid, TRUE, cc, -1, FALSE, buf, len + 5);
+}
+
+static GByteArray *
+create_test_stream (void)
+{
+  static const guint8 pat[] = {
+    0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff
+  };
+  static const guint8 pmt[] = {
+    0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00,
+    0x1b, 0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00
+  };
+  GByteArray *ts = g_byte_array_new ();
+  guint8 pat_cc = 0, pmt_cc = 0, video_cc = 0;
+  guint8 pes[14 + KEY_FRAME_SIZE];
+  guint f;
+
+  for (f = 0; f < N_FRAMES; f++) {
+    gboolean key = f % GOP_SIZE == 0;
+    guint64 pts = FRAME_PTS (f);
+    guint size = key ? KEY_FRAME_SIZE : DELTA_FRAME_SIZE;
+    guint len = 14 + size, pos = 0;
+
+    if (key) {
+      write_section (ts, 0, &pat_cc, pat, sizeof (pat));
+      write_section (ts, PMT_PID, &pmt_cc, pmt, sizeof (pmt));
+    }
+
+    /* PES header with a PTS, unbounded length */
+    pes[0] = 0x00;
+    pes[1] = 0x00;
+    pes[2] = 0x01;
+    pes[3] = 0xe0;
+    pes[4] = 0x00;
+    pes[5] = 0x00;
+    pes[6] = 0x84;
+    pes[7] = 0x80;
+    pes[8] = 0x05;
+    pes[9] = 0x21 | ((pts >> 29) & 0x0e);
+    pes[10] = pts >> 22;
+    pes[11] = 0x01 | ((pts >> 14) & 0xfe);
+    pes[12] = pts >> 7;
+    pes[13] = 0x01 | ((pts << 1) & 0xfe);
+    /* an IDR or a non-IDR slice NAL unit */
+    memset (pes + 14, 0x80, size);
+    pes[14] = 0x00;
+    pes[15] = 0x00;
+    pes[16] = 0x01;
+    pes[17] = key ? 0x65 : 0x41;
+
+    pos += write_ts_packet (ts, VIDEO_PID, TRUE, &video_cc, pts - 9000, key,
+        pes, len);
+    while (pos < len)
+      pos += write_ts_packet (ts, VIDEO_PID, FALSE, &video_cc, -1, FALSE,
+          pes + pos, len - pos);
+  }
+
+  return ts;
+}
+
+static GstPadProbeReturn
+pull_probe (GstPad * pad, GstPadProbeInfo * info, TrickModeData * data)
+{
+  g_mutex_lock (&data->lock);
+  data->bytes_pulled += gst_buffer_get_size (GST_PAD_PROBE_INFO_BUFFER (info));
+  g_mutex_unlock (&data->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+handoff_cb (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    TrickModeData * data)
+{
+  GstClockTime pts = GST_BUFFER_PTS (buf);
+  guint8 nal[4];
+
+  fail_unless_equals_int (gst_buffer_extract (buf, 0, nal, 4), 4);
+
+  g_mutex_lock (&data->lock);
+  data->n_buffers++;
+  if ((nal[3] & 0x1f) != 5)
+    data->n_delta++;
+  if (GST_CLOCK_TIME_IS_VALID (data->last_pts)) {
+    if (data->rate > 0.0 ? pts <= data->last_pts : pts >= data->last_pts)
+      data->misordered = TRUE;
+    else
+      data->min_pts_delta = MIN (data->min_pts_delta,
+          ABS (GST_CLOCK_DIFF (data->last_pts, pts)));
+  } else {
+    data->first_pts = pts;
+  }
+  data->last_pts = pts;
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, GstElement * sink)
+{
+  GstPad *sinkpad = gst_element_get_static_pad (sink, "sink");
+
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+}
+
+/* Plays the test stream from a file in trick mode, with tsdemux pulling */
+static void
+run_trick_mode (gdouble rate, TrickModeData * data, guint64 * file_size)
+{
+  GstElement *pipeline, *src, *demux, *sink;
+  GstMessage *msg;
+  GByteArray *ts;
+  GstPad *pad;
+  GError *err = NULL;
+  gchar *location;
+  gint fd;
+
+  ts = create_test_stream ();
+  *file_size = ts->len;
+  fd = g_file_open_tmp ("tsdemux-XXXXXX.ts", &location, &err);
+  fail_unless (fd >= 0);
+  close (fd);
+  fail_unless (g_file_set_contents (location, (const gchar *) ts->data,
+          ts->len, NULL));
+  g_byte_array_unref (ts);
+
+  g_mutex_init (&data->lock);
+  data->rate = rate;
+  data->bytes_pulled = 0;
+  data->n_buffers = 0;
+  data->n_delta = 0;
+  data->first_pts = GST_CLOCK_TIME_NONE;
+  data->last_pts = GST_CLOCK_TIME_NONE;
+  data->min_pts_delta = GST_CLOCK_TIME_NONE;
+  data->misordered = FALSE;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("filesrc", NULL);
+  demux = gst_element_factory_make ("tsdemux", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (src, "location", location, NULL);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, sink, NULL);
+  fail_unless (gst_element_link (src, demux));
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), sink);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_ASYNC);
+  fail_unless_equals_int (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE), GST_STATE_CHANGE_SUCCESS);
+
+  /* only count what is read in trick mode, not the initial scan */
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), data);
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_PULL | GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) pull_probe, data, NULL);
+  gst_object_unref (pad);
+
+  fail_unless (gst_element_seek (pipeline, rate, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_TRICKMODE |
+          GST_SEEK_FLAG_TRICKMODE_KEY_UNITS, GST_SEEK_TYPE_SET, 0,
+          GST_SEEK_TYPE_NONE, -1));
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      10 * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_mutex_clear (&data->lock);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_START_TEST (test_key_unit_trick_mode)
+{
+  TrickModeData data;
+  guint64 file_size;
+
+  /* a keyframe every 2 seconds at most, out of one every 400 ms */
+  run_trick_mode (20.0, &data, &file_size);
+
+  fail_unless_equals_int (data.n_delta, 0);
+  fail_if (data.misordered);
+  fail_unless (data.n_buffers >= 3 && data.n_buffers <= 5,
+      "got %u keyframes", data.n_buffers);
+  fail_unless (data.last_pts > data.first_pts);
+  fail_unless (data.min_pts_delta >= 2 * GST_SECOND);
+
+  /* the data between the keyframes was skipped */
+  fail_unless (data.bytes_pulled < file_size * 3 / 4,
+      "read %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " bytes",
+      data.bytes_pulled, file_size);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_reverse_playback)
+{
+  TrickModeData data;
+  guint64 file_size;
+
+  /* the interval is one GOP, so every keyframe is the last one at or
+   * before the target and they all come out, from the last to the first */
+  run_trick_mode (-4.0, &data, &file_size);
+
+  fail_unless_equals_int (data.n_delta, 0);
+  fail_if (data.misordered);
+  fail_unless_equals_int (data.n_buffers, N_FRAMES / GOP_SIZE);
+  fail_unless (data.last_pts < data.first_pts);
+  fail_unless_equals_uint64 (data.min_pts_delta,
+      GOP_SIZE * GST_SECOND / FRAME_RATE);
+  fail_unless_equals_uint64 (data.first_pts - data.last_pts,
+      (N_FRAMES / GOP_SIZE - 1) * GOP_SIZE * GST_SECOND / FRAME_RATE);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_key_unit_trick_mode);
+  tcase_add_test (tc_chain, test_reverse_playback);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux);
@@ -0,0 +1,245 @@
+/* GStreamer
+ *
+ * unit test for the tsdemux keyframe index
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include <gst/check/gstcheck.h>
+
+#undef GST_CAT_DEFAULT
+#include "tsdemuxindex.h"
+#include "tsdemuxindex.c"
+
+#define STREAM_SIZE 1000000
+
+static const guint8 stream_head[] = { 0x47, 0x40, 0x00, 0x10 };
+static const guint8 stream_tail[] = { 0x47, 0x01, 0x00, 0x1f };
+
+static void
+set_stream (TSDemuxIndex * index, guint64 size)
+{
+  ts_demux_index_set_stream_size (index, size);
+  ts_demux_index_set_stream_fingerprint (index, stream_head,
+      sizeof (stream_head), stream_tail, sizeof (stream_tail));
+}
+
+static TSDemuxIndex *
+create_index (void)
+{
+  TSDemuxIndex *index = ts_demux_index_new ();
+  guint i;
+
+  /* a keyframe every second, 10000 bytes apart */
+  for (i = 0; i < 10; i++)
+    ts_demux_index_add_entry (index, i * 10000, i * GST_SECOND);
+  set_stream (index, STREAM_SIZE);
+
+  return index;
+}
+
+static gchar *
+create_temp_file (void)
+{
+  GError *err = NULL;
+  gchar *location;
+  gint fd;
+
+  fd = g_file_open_tmp ("tsdemuxindex-XXXXXX", &location, &err);
+  fail_unless (fd >= 0, "Failed to create temp file: %s",
+      err ? err->message : "");
+  close (fd);
+
+  return location;
+}
+
+GST_START_TEST (test_lookup)
+{
+  TSDemuxIndex *index = create_index ();
+  TSDemuxIndexEntry entry;
+
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 10);
+  fail_unless (ts_demux_index_is_dirty (index));
+
+  fail_unless (ts_demux_index_lookup (index, 0, &entry));
+  fail_unless_equals_uint64 (entry.offset, 0);
+  fail_unless_equals_uint64 (entry.ts, 0);
+
+  fail_unless (ts_demux_index_lookup (index, 3 * GST_SECOND, &entry));
+  fail_unless_equals_uint64 (entry.offset, 30000);
+  fail_unless_equals_uint64 (entry.ts, 3 * GST_SECOND);
+
+  fail_unless (ts_demux_index_lookup (index, 4500 * GST_MSECOND, &entry));
+  fail_unless_equals_uint64 (entry.offset, 40000);
+  fail_unless_equals_uint64 (entry.ts, 4 * GST_SECOND);
+
+  /* the keyframe after the last one is unknown */
+  fail_if (ts_demux_index_lookup (index, 9 * GST_SECOND, &entry));
+  fail_if (ts_demux_index_lookup (index, 20 * GST_SECOND, &entry));
+
+  /* a gap larger than TS_DEMUX_INDEX_MAX_GAP wasn't indexed */
+  ts_demux_index_add_entry (index, 200000, 9 * GST_SECOND +
+      TS_DEMUX_INDEX_MAX_GAP + 1);
+  fail_unless (ts_demux_index_lookup (index, 8 * GST_SECOND, &entry));
+  fail_if (ts_demux_index_lookup (index, 10 * GST_SECOND, &entry));
+
+  ts_demux_index_free (index);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_out_of_order)
+{
+  TSDemuxIndex *index = ts_demux_index_new ();
+  TSDemuxIndexEntry entry;
+
+  ts_demux_index_add_entry (index, 10000, 1 * GST_SECOND);
+  ts_demux_index_add_entry (index, 30000, 3 * GST_SECOND);
+
+  /* earlier than the previous keyframe, or later than the next one */
+  ts_demux_index_add_entry (index, 40000, 2 * GST_SECOND);
+  ts_demux_index_add_entry (index, 20000, 4 * GST_SECOND);
+  ts_demux_index_add_entry (index, 5000, 1 * GST_SECOND);
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 2);
+
+  /* an offset that is already known */
+  ts_demux_index_add_entry (index, 30000, 2500 * GST_MSECOND);
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 2);
+
+  /* in between the two, as after a seek */
+  ts_demux_index_add_entry (index, 20000, 2 * GST_SECOND);
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 3);
+  fail_unless (ts_demux_index_lookup (index, 2500 * GST_MSECOND, &entry));
+  fail_unless_equals_uint64 (entry.offset, 20000);
+
+  ts_demux_index_free (index);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_save_load)
+{
+  TSDemuxIndex *index = create_index ();
+  TSDemuxIndexEntry entry;
+  GError *err = NULL;
+  gchar *location;
+
+  location = create_temp_file ();
+
+  fail_unless (ts_demux_index_save (index, location, &err));
+  fail_if (ts_demux_index_is_dirty (index));
+  ts_demux_index_free (index);
+
+  index = ts_demux_index_new ();
+  set_stream (index, STREAM_SIZE);
+  fail_unless (ts_demux_index_load (index, location, &err));
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 10);
+  fail_if (ts_demux_index_is_dirty (index));
+  fail_unless (ts_demux_index_lookup (index, 7200 * GST_MSECOND, &entry));
+  fail_unless_equals_uint64 (entry.offset, 70000);
+  fail_unless_equals_uint64 (entry.ts, 7 * GST_SECOND);
+
+  /* loading merges, entries already known don't make it dirty */
+  fail_unless (ts_demux_index_load (index, location, &err));
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 10);
+  fail_if (ts_demux_index_is_dirty (index));
+  ts_demux_index_free (index);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_load_other_stream)
+{
+  TSDemuxIndex *index = create_index ();
+  GError *err = NULL;
+  gchar *location;
+
+  location = create_temp_file ();
+  fail_unless (ts_demux_index_save (index, location, &err));
+  ts_demux_index_free (index);
+
+  /* the stream was replaced by one of another size */
+  index = ts_demux_index_new ();
+  set_stream (index, STREAM_SIZE + 188);
+  fail_if (ts_demux_index_load (index, location, &err));
+  fail_unless (err != NULL);
+  g_clear_error (&err);
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 0);
+
+  /* the stream was replaced by another one of the same size */
+  ts_demux_index_set_stream_size (index, STREAM_SIZE);
+  ts_demux_index_set_stream_fingerprint (index, stream_head,
+      sizeof (stream_head), stream_head, sizeof (stream_head));
+  fail_if (ts_demux_index_load (index, location, &err));
+  fail_unless (err != NULL);
+  g_clear_error (&err);
+  fail_unless_equals_int (ts_demux_index_get_n_entries (index), 0);
+
+  /* nor is anything loaded or saved if the size is unknown */
+  ts_demux_index_set_stream_size (index, 0);
+  fail_if (ts_demux_index_load (index, location, &err));
+  g_clear_error (&err);
+  fail_if (ts_demux_index_save (index, location, &err));
+  g_clear_error (&err);
+  ts_demux_index_free (index);
+
+  /* or the fingerprint */
+  index = ts_demux_index_new ();
+  ts_demux_index_set_stream_size (index, STREAM_SIZE);
+  fail_if (ts_demux_index_load (index, location, &err));
+  g_clear_error (&err);
+  fail_if (ts_demux_index_save (index, location, &err));
+  g_clear_error (&err);
+  ts_demux_index_free (index);
+
+  /* not an index at all */
+  fail_unless (g_file_set_contents (location, "TSDI", 4, NULL));
+  index = ts_demux_index_new ();
+  set_stream (index, STREAM_SIZE);
+  fail_if (ts_demux_index_load (index, location, &err));
+  g_clear_error (&err);
+  ts_demux_index_free (index);
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemuxindex_suite (void)
+{
+  Suite *s = suite_create ("tsdemuxindex");
+  TCase *tc_chain = tcase_create ("general");
+
+  init_ts_demux_index ();
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_lookup);
+  tcase_add_test (tc_chain, test_out_of_order);
+  tcase_add_test (tc_chain, test_save_load);
+  tcase_add_test (tc_chain, test_load_other_stream);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemuxindex);
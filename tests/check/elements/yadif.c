@@ -0,0 +1,201 @@
+/* GStreamer
+ *
+ * unit test for the yadif line filters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "vf_yadif.c"
+/* the assembly has its own CHECK */
+#undef CHECK
+#include "yadif.c"
+
+#define MAX_WIDTH 100
+/* room for reading a few pixels around the lines */
+#define STRIDE (MAX_WIDTH + 64)
+#define N_LINES 7
+#define N_RUNS 50
+
+typedef struct
+{
+  guint8 prev[N_LINES * STRIDE];
+  guint8 cur[N_LINES * STRIDE];
+  guint8 next[N_LINES * STRIDE];
+} Frames;
+
+static void
+fill_random (guint8 * data, gsize size, gboolean smooth)
+{
+  gsize i;
+
+  /* smooth data makes the spatial and temporal predictions matter,
+   * noise makes the clipping matter */
+  for (i = 0; i < size; i++) {
+    if (smooth && i > 0)
+      data[i] = CLAMP ((gint) data[i - 1] + g_random_int_range (-8, 9), 0,
+          255);
+    else
+      data[i] = g_random_int_range (0, 256);
+  }
+}
+
+/* Runs @a and @b on the middle line of random frames, for all widths,
+ * modes and parities, with the references the slice filtering uses for
+ * the first, the last and the other lines. Only the references for which
+ * @check_refs is TRUE are checked */
+static void
+compare_filter_lines (const gchar * name, YadifFilterLineFunc a,
+    YadifFilterLineFunc b, const gboolean check_refs[3])
+{
+  const gint refs[3][2] = {
+    /* prefs, mrefs */
+    {STRIDE, -STRIDE},
+    {STRIDE, STRIDE},
+    {-STRIDE, -STRIDE},
+  };
+  Frames *frames = g_new (Frames, 1);
+  guint8 dst_a[STRIDE], dst_b[STRIDE];
+  gint run, w, r, mode, parity;
+
+  for (run = 0; run < N_RUNS; run++) {
+    gboolean smooth = run % 2 == 0;
+
+    fill_random (frames->prev, sizeof (frames->prev), smooth);
+    fill_random (frames->cur, sizeof (frames->cur), smooth);
+    fill_random (frames->next, sizeof (frames->next), smooth);
+
+    for (w = 1; w <= MAX_WIDTH; w++) {
+      for (r = 0; r < 3; r++) {
+        if (!check_refs[r])
+          continue;
+
+        for (mode = 0; mode < 3; mode++) {
+          for (parity = 0; parity < 2; parity++) {
+            gsize offs = (N_LINES / 2) * STRIDE + 16;
+
+            memset (dst_a, 0xaa, sizeof (dst_a));
+            memset (dst_b, 0xaa, sizeof (dst_b));
+            a (dst_a + 16, frames->prev + offs, frames->cur + offs,
+                frames->next + offs, w, refs[r][0], refs[r][1], parity, mode);
+            b (dst_b + 16, frames->prev + offs, frames->cur + offs,
+                frames->next + offs, w, refs[r][0], refs[r][1], parity, mode);
+
+            /* same pixels, and nothing written around the line */
+            fail_unless (memcmp (dst_a, dst_b, sizeof (dst_a)) == 0,
+                "%s differs for width %d, refs %d, mode %d, parity %d", name,
+                w, r, mode, parity);
+          }
+        }
+      }
+    }
+  }
+
+  g_free (frames);
+}
+
+GST_START_TEST (test_filter_line_paths)
+{
+  const YadifFilterLinePath *paths = yadif_get_filter_line_paths ();
+  gboolean have_c = FALSE;
+  guint i;
+
+  for (i = 0; paths[i].name; i++) {
+    GST_INFO ("line filter %s", paths[i].name);
+    if (paths[i].func == filter_line_c)
+      have_c = TRUE;
+  }
+  fail_unless (have_c);
+  fail_unless (yadif_get_filter_line (NULL) == paths[0].func);
+  fail_unless (yadif_get_filter_line ("c") == filter_line_c);
+  fail_unless (yadif_get_filter_line ("none") == paths[0].func);
+}
+
+GST_END_TEST;
+
+#if HAVE_FILTER_LINE_VECTOR
+GST_START_TEST (test_filter_line_vector)
+{
+  const gboolean all_refs[3] = { TRUE, TRUE, TRUE };
+
+  g_random_set_seed (1);
+  compare_filter_lines ("vector", filter_line_vector, filter_line_c,
+      all_refs);
+}
+
+GST_END_TEST;
+#endif
+
+#if HAVE_CPU_X86_64
+/* The x86 assembly always does the spatial check, which the C version only
+ * does when both references point down, so that is where they can be
+ * compared */
+GST_START_TEST (test_filter_line_sse2)
+{
+  const gboolean all_refs[3] = { FALSE, TRUE, FALSE };
+
+  g_random_set_seed (2);
+  compare_filter_lines ("sse2", filter_line_x86_64, filter_line_c, all_refs);
+}
+
+GST_END_TEST;
+
+#if HAVE_FILTER_LINE_AVX2
+/* AVX2 does what the SSE2 assembly does, on all lines */
+GST_START_TEST (test_filter_line_avx2)
+{
+  const gboolean all_refs[3] = { TRUE, TRUE, TRUE };
+  const gboolean c_refs[3] = { FALSE, TRUE, FALSE };
+
+  if (!__builtin_cpu_supports ("avx2")) {
+    GST_INFO ("no AVX2, skipping");
+    return;
+  }
+
+  g_random_set_seed (3);
+  compare_filter_lines ("avx2", filter_line_x86_64_avx2, filter_line_c,
+      c_refs);
+  compare_filter_lines ("avx2", filter_line_x86_64_avx2, filter_line_x86_64,
+      all_refs);
+}
+
+GST_END_TEST;
+#endif
+#endif
+
+static Suite *
+yadif_suite (void)
+{
+  Suite *s = suite_create ("yadif");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_filter_line_paths);
+#if HAVE_FILTER_LINE_VECTOR
+  tcase_add_test (tc_chain, test_filter_line_vector);
+#endif
+#if HAVE_CPU_X86_64
+  tcase_add_test (tc_chain, test_filter_line_sse2);
+#if HAVE_FILTER_LINE_AVX2
+  tcase_add_test (tc_chain, test_filter_line_avx2);
+#endif
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (yadif);
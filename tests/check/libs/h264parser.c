@@ -211,6 +211,41 @@ GST_START_TEST (test_h264_parse_slice_eoseq_slice)
 
 GST_END_TEST;
 
+GST_START_TEST (test_h264_parse_start_code_boundaries)
+{
+  /* AU delimiter, then a start code that is not followed by any byte */
+  static const guint8 aud_truncated[] = {
+    0x00, 0x00, 0x01, 0x09, 0x10, 0x01, 0x00, 0x00, 0x01
+  };
+  static const guint8 aud_aud[] = {
+    0x00, 0x00, 0x01, 0x09, 0x10, 0x01, 0x00, 0x00, 0x01, 0x09, 0x10
+  };
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264NalParser *const parser = gst_h264_nal_parser_new ();
+
+  res = gst_h264_parser_identify_nalu (parser, aud_truncated, 0,
+      sizeof (aud_truncated), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_NO_NAL_END);
+
+  res = gst_h264_parser_identify_nalu (parser, aud_aud, 0,
+      sizeof (aud_aud), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_AU_DELIMITER);
+  assert_equals_int (nalu.offset, 3);
+  assert_equals_int (nalu.size, 3);
+
+  res = gst_h264_parser_identify_nalu (parser, aud_aud,
+      nalu.offset + nalu.size, sizeof (aud_aud), &nalu);
+  assert_equals_int (res, GST_H264_PARSER_NO_NAL_END);
+  assert_equals_int (nalu.type, GST_H264_NAL_AU_DELIMITER);
+  assert_equals_int (nalu.offset, 9);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -221,6 +256,7 @@ h264parser_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
   tcase_add_test (tc_chain, test_h264_parse_slice_eoseq_slice);
+  tcase_add_test (tc_chain, test_h264_parse_start_code_boundaries);
 
   return s;
 }
@@ -0,0 +1,188 @@
+/* GStreamer
+ *
+ * prefetch-bench.c: benchmark program for the fragment prefetching of the
+ * adaptive demuxers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program downloads an HLS, DASH or Smooth Streaming presentation as
+ * fast as possible, without decoding it, once without prefetching and once
+ * with the demuxer's "prefetch-fragments" property set, and prints the time
+ * it took and the resulting throughput, eg:
+ *
+ *   prefetch-bench --prefetch 3 --seconds 60 http://example.com/master.m3u8
+ *
+ * The difference grows with the round-trip time to the server. For live
+ * presentations, --seconds must be given since they never end.
+ */
+
+#include <gst/gst.h>
+
+static gint n_prefetch = 3;
+static gint max_seconds = 0;
+static gint connection_speed = 0;
+
+typedef struct
+{
+  GstElement *pipeline;
+  guint prefetch;
+  /* written from the streaming threads of all the sinks */
+  GMutex lock;
+  guint64 bytes;
+} RunData;
+
+static void
+sink_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    RunData * data)
+{
+  g_mutex_lock (&data->lock);
+  data->bytes += gst_buffer_get_size (buf);
+  g_mutex_unlock (&data->lock);
+}
+
+static void
+pad_added (GstElement * uridecodebin, GstPad * pad, RunData * data)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, "signal-handoffs", TRUE,
+      NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (sink_handoff), data);
+  gst_bin_add (GST_BIN (data->pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+/* The adaptive demuxers are the only elements with this property */
+static void
+element_added (GstBin * bin, GstBin * sub_bin, GstElement * element,
+    RunData * data)
+{
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+          "prefetch-fragments"))
+    g_object_set (element, "prefetch-fragments", data->prefetch, NULL);
+}
+
+static gdouble
+run (const gchar * uri, guint prefetch, guint64 * bytes)
+{
+  RunData data = { NULL, prefetch, };
+  GstElement *uridecodebin;
+  GstCaps *caps;
+  GstMessage *msg;
+  GError *err = NULL;
+  gint64 start;
+  gdouble elapsed = -1;
+
+  g_mutex_init (&data.lock);
+  data.pipeline = gst_pipeline_new (NULL);
+  uridecodebin = gst_element_factory_make ("uridecodebin", NULL);
+
+  /* stop at the output of the demuxers, only the download is measured */
+  caps = gst_caps_from_string ("video/mpegts; video/quicktime; video/webm; "
+      "audio/webm; audio/mpeg; application/x-id3; application/x-subtitle-vtt; "
+      "application/ttml+xml");
+  g_object_set (uridecodebin, "uri", uri, "caps", caps, NULL);
+  if (connection_speed > 0)
+    g_object_set (uridecodebin, "connection-speed",
+        (guint64) connection_speed, NULL);
+  gst_caps_unref (caps);
+
+  g_signal_connect (uridecodebin, "pad-added", G_CALLBACK (pad_added), &data);
+  g_signal_connect (data.pipeline, "deep-element-added",
+      G_CALLBACK (element_added), &data);
+  gst_bin_add (GST_BIN (data.pipeline), uridecodebin);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (data.pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (data.pipeline),
+      max_seconds > 0 ? max_seconds * GST_SECOND : GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (msg == NULL || GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  if (msg)
+    gst_message_unref (msg);
+
+  gst_element_set_state (data.pipeline, GST_STATE_NULL);
+  gst_object_unref (data.pipeline);
+
+  *bytes = data.bytes;
+  g_mutex_clear (&data.lock);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"prefetch", 'p', 0, G_OPTION_ARG_INT, &n_prefetch,
+        "Number of fragments to prefetch in the second run", NULL},
+    {"seconds", 's', 0, G_OPTION_ARG_INT, &max_seconds,
+        "Stop each run after this many seconds (0 = at the end)", NULL},
+    {"connection-speed", 'c', 0, G_OPTION_ARG_INT, &connection_speed,
+        "Connection speed in kbit/s, to pin the variant (0 = automatic)",
+          NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("URI");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s [--prefetch N] URI\n", argv[0]);
+    return 1;
+  }
+
+  for (i = 0; i < 2; i++) {
+    guint prefetch = i == 0 ? 0 : n_prefetch;
+    guint64 bytes;
+    gdouble elapsed;
+
+    elapsed = run (argv[1], prefetch, &bytes);
+    if (elapsed <= 0)
+      return 1;
+
+    g_print ("prefetch-fragments=%u: %" G_GUINT64_FORMAT " bytes in %.2f s, "
+        "%.2f Mbit/s\n", prefetch, bytes, elapsed,
+        bytes * 8 / elapsed / 1000000);
+  }
+
+  return 0;
+}
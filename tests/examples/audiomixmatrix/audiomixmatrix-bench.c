@@ -0,0 +1,198 @@
+/* GStreamer
+ *
+ * audiomixmatrix-bench.c: benchmark program for the audiomixmatrix element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program mixes N channels into N channels with an identity, a
+ * permutation, a sparse (two inputs per output) and a dense matrix, for
+ * 2 to 64 channels, and prints the throughput in millions of frames per
+ * second for each combination, eg:
+ *
+ *   audiomixmatrix-bench --buffers 2000 --format S16LE
+ */
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#define SAMPLES_PER_BUFFER 1024
+
+static gint n_buffers = 2000;
+static gchar *format = NULL;
+
+typedef enum
+{
+  MATRIX_IDENTITY,
+  MATRIX_PERMUTATION,
+  MATRIX_SPARSE,
+  MATRIX_DENSE
+} MatrixType;
+
+static const gchar *matrix_names[] = {
+  "identity", "permutation", "sparse", "dense"
+};
+
+static gdouble
+coefficient (MatrixType type, guint channels, guint out, guint in)
+{
+  switch (type) {
+    case MATRIX_IDENTITY:
+      return out == in ? 1.0 : 0.0;
+    case MATRIX_PERMUTATION:
+      return (out + 1) % channels == in ? 1.0 : 0.0;
+    case MATRIX_SPARSE:
+      return (out == in || (out + 1) % channels == in) ? 0.5 : 0.0;
+    case MATRIX_DENSE:
+    default:
+      return 1.0 / channels;
+  }
+}
+
+static void
+set_matrix (GstElement * mix, MatrixType type, guint channels)
+{
+  GValue matrix = G_VALUE_INIT;
+  guint out, in;
+
+  g_value_init (&matrix, GST_TYPE_ARRAY);
+  for (out = 0; out < channels; out++) {
+    GValue row = G_VALUE_INIT;
+
+    g_value_init (&row, GST_TYPE_ARRAY);
+    for (in = 0; in < channels; in++) {
+      GValue v = G_VALUE_INIT;
+
+      g_value_init (&v, G_TYPE_DOUBLE);
+      g_value_set_double (&v, coefficient (type, channels, out, in));
+      gst_value_array_append_and_take_value (&row, &v);
+    }
+    gst_value_array_append_and_take_value (&matrix, &row);
+  }
+
+  g_object_set (mix, "in-channels", channels, "out-channels", channels,
+      "channel-mask", G_GUINT64_CONSTANT (0), NULL);
+  g_object_set_property (G_OBJECT (mix), "matrix", &matrix);
+  g_value_unset (&matrix);
+}
+
+static gdouble
+run (const gchar * fmt, MatrixType type, guint channels)
+{
+  GstElement *pipeline, *mix;
+  GstAudioFormatInfo *finfo;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *desc;
+  gint64 start;
+  gdouble elapsed = -1;
+
+  finfo = (GstAudioFormatInfo *)
+      gst_audio_format_get_info (gst_audio_format_from_string (fmt));
+
+  /* fakesrc only zeroes the memory, so that the source costs next to
+   * nothing compared to the mixing */
+  desc = g_strdup_printf ("fakesrc sizetype=fixed filltype=zero sizemax=%u "
+      "num-buffers=%d ! audio/x-raw,format=%s,rate=48000,channels=%u,"
+      "channel-mask=(bitmask)0,layout=interleaved ! audiomixmatrix name=mix "
+      "! fakesink sync=false", SAMPLES_PER_BUFFER * channels *
+      GST_AUDIO_FORMAT_INFO_WIDTH (finfo) / 8, n_buffers, fmt, channels);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  mix = gst_bin_get_by_name (GST_BIN (pipeline), "mix");
+  set_matrix (mix, type, channels);
+  gst_object_unref (mix);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"buffers", 'n', 0, G_OPTION_ARG_INT, &n_buffers,
+        "Number of buffers of " G_STRINGIFY (SAMPLES_PER_BUFFER)
+          " frames to mix", NULL},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Sample format to test (default: F32LE, S16LE and S32LE)", NULL},
+    {NULL}
+  };
+  static const gchar *formats[] = { "F32LE", "S16LE", "S32LE" };
+  static const guint channels[] = { 2, 8, 16, 32, 64 };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint f, c, t;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  for (f = 0; f < G_N_ELEMENTS (formats); f++) {
+    if (format && g_strcmp0 (format, formats[f]) != 0)
+      continue;
+
+    g_print ("%s, Mframes/s:\n%8s", formats[f], "channels");
+    for (t = 0; t < G_N_ELEMENTS (matrix_names); t++)
+      g_print (" %12s", matrix_names[t]);
+    g_print ("\n");
+
+    for (c = 0; c < G_N_ELEMENTS (channels); c++) {
+      g_print ("%8u", channels[c]);
+      for (t = 0; t < G_N_ELEMENTS (matrix_names); t++) {
+        gdouble elapsed = run (formats[f], t, channels[c]);
+
+        if (elapsed <= 0)
+          return 1;
+        g_print (" %12.1f", n_buffers * SAMPLES_PER_BUFFER / elapsed / 1e6);
+      }
+      g_print ("\n");
+    }
+  }
+
+  g_free (format);
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+/* GStreamer
+ *
+ * nal-bench.c: benchmark program for the H.264/H.265 NAL unit splitting
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program splits a byte-stream H.264 or H.265 elementary stream into
+ * NAL units with gst_h26x_parser_identify_nalu() a number of times, and
+ * prints how fast that went, next to a plain start code scan with
+ * gst_byte_reader_masked_scan_uint32() for reference, eg:
+ *
+ *   nal-bench --iterations 20 video.h264
+ *   nal-bench --h265 video.hevc
+ *
+ * Files ending in .h265 or .hevc are taken to be H.265.
+ */
+
+#include <gst/gst.h>
+#include <gst/base/gstbytereader.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+static gint n_iterations = 10;
+static gboolean h265 = FALSE;
+
+static guint
+identify_h264 (GstH264NalParser * parser, const guint8 * data, gsize size)
+{
+  GstH264NalUnit nalu;
+  GstH264ParserResult res;
+  guint offset = 0, n_nals = 0;
+
+  do {
+    res = gst_h264_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res == GST_H264_PARSER_OK || res == GST_H264_PARSER_NO_NAL_END) {
+      n_nals++;
+      offset = nalu.offset + nalu.size;
+    }
+  } while (res == GST_H264_PARSER_OK);
+
+  return n_nals;
+}
+
+static guint
+identify_h265 (GstH265Parser * parser, const guint8 * data, gsize size)
+{
+  GstH265NalUnit nalu;
+  GstH265ParserResult res;
+  guint offset = 0, n_nals = 0;
+
+  do {
+    res = gst_h265_parser_identify_nalu (parser, data, offset, size, &nalu);
+    if (res == GST_H265_PARSER_OK || res == GST_H265_PARSER_NO_NAL_END) {
+      n_nals++;
+      offset = nalu.offset + nalu.size;
+    }
+  } while (res == GST_H265_PARSER_OK);
+
+  return n_nals;
+}
+
+static guint
+scan (const guint8 * data, gsize size)
+{
+  GstByteReader br;
+  guint offset = 0, n_start_codes = 0;
+  gint pos;
+
+  gst_byte_reader_init (&br, data, size);
+  while (offset < size - 4) {
+    pos = gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
+        offset, size - offset);
+    if (pos < 0)
+      break;
+    n_start_codes++;
+    offset = pos + 3;
+  }
+
+  return n_start_codes;
+}
+
+static void
+report (const gchar * what, guint n, gsize size, gint64 elapsed)
+{
+  gdouble secs = elapsed / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("%-30s %8u NALs %10.1f MB/s %12.0f NALs/s\n", what, n,
+      (gdouble) size * n_iterations / secs / (1024 * 1024),
+      (gdouble) n * n_iterations / secs);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+        "Number of times to go through the file", NULL},
+    {"h265", 0, 0, G_OPTION_ARG_NONE, &h265,
+        "The file is H.265", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  gchar *contents;
+  gsize size;
+  guint n = 0;
+  gint64 start;
+  gint i;
+
+  ctx = g_option_context_new ("FILE");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc != 2) {
+    g_printerr ("Usage: %s [--h265] FILE\n", argv[0]);
+    return 1;
+  }
+
+  if (!g_file_get_contents (argv[1], &contents, &size, &err)) {
+    g_printerr ("Failed to read %s: %s\n", argv[1], err->message);
+    g_clear_error (&err);
+    return 1;
+  }
+  if (size < 4) {
+    g_printerr ("%s is too short\n", argv[1]);
+    g_free (contents);
+    return 1;
+  }
+
+  if (g_str_has_suffix (argv[1], ".h265") || g_str_has_suffix (argv[1],
+          ".hevc"))
+    h265 = TRUE;
+
+  if (h265) {
+    GstH265Parser *parser = gst_h265_parser_new ();
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < n_iterations; i++)
+      n = identify_h265 (parser, (const guint8 *) contents, size);
+    report ("gst_h265_parser_identify_nalu", n, size,
+        g_get_monotonic_time () - start);
+    gst_h265_parser_free (parser);
+  } else {
+    GstH264NalParser *parser = gst_h264_nal_parser_new ();
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < n_iterations; i++)
+      n = identify_h264 (parser, (const guint8 *) contents, size);
+    report ("gst_h264_parser_identify_nalu", n, size,
+        g_get_monotonic_time () - start);
+    gst_h264_nal_parser_free (parser);
+  }
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < n_iterations; i++)
+    n = scan ((const guint8 *) contents, size);
+  report ("masked_scan_uint32", n, size, g_get_monotonic_time () - start);
+
+  g_free (contents);
+
+  return 0;
+}
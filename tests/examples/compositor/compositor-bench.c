@@ -0,0 +1,140 @@
+/* GStreamer
+ *
+ * compositor-bench.c: benchmark program for the compositor element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program composes 4, 9 and 16 translucent inputs laid out in a grid,
+ * once with a single thread and once with --threads threads, and prints
+ * how many output frames per second were produced, eg:
+ *
+ *   compositor-bench --frames 300 --width 1920 --height 1080 --threads 4
+ */
+
+#include <gst/gst.h>
+
+static gint n_frames = 300;
+static gint width = 1920;
+static gint height = 1080;
+static gint n_threads = 0;
+
+static gdouble
+run (guint grid, guint threads)
+{
+  GString *desc = g_string_new (NULL);
+  GstElement *pipeline;
+  GstMessage *msg;
+  GError *err = NULL;
+  gint64 start;
+  gdouble elapsed = -1;
+  guint i;
+
+  g_string_append_printf (desc, "compositor name=c n-threads=%u "
+      "background=black", threads);
+
+  /* translucent inputs, so that they are blended and not copied */
+  for (i = 0; i < grid * grid; i++)
+    g_string_append_printf (desc, " sink_%u::xpos=%d sink_%u::ypos=%d "
+        "sink_%u::alpha=0.8", i, (i % grid) * (width / grid), i,
+        (i / grid) * (height / grid), i);
+
+  g_string_append_printf (desc, " ! video/x-raw,format=AYUV,width=%d,"
+      "height=%d ! fakesink sync=false", width, height);
+
+  for (i = 0; i < grid * grid; i++)
+    g_string_append_printf (desc, " videotestsrc num-buffers=%d ! "
+        "video/x-raw,format=AYUV,width=%d,height=%d,framerate=30/1 ! c.",
+        n_frames, width / grid, height / grid);
+
+  pipeline = gst_parse_launch (desc->str, &err);
+  g_string_free (desc, TRUE);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  /* prerolling includes the setup of the sources, leave it out */
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+        "Number of frames to compose", NULL},
+    {"width", 0, 0, G_OPTION_ARG_INT, &width, "Output width", NULL},
+    {"height", 0, 0, G_OPTION_ARG_INT, &height, "Output height", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+        "Number of threads to compare with (0 = number of processors)", NULL},
+    {NULL}
+  };
+  static const guint grids[] = { 2, 3, 4 };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_threads <= 0)
+    n_threads = g_get_num_processors ();
+
+  for (i = 0; i < G_N_ELEMENTS (grids); i++) {
+    gdouble single, multi;
+
+    single = run (grids[i], 1);
+    multi = run (grids[i], n_threads);
+    if (single <= 0 || multi <= 0)
+      return 1;
+
+    g_print ("%2u pads: 1 thread %.1f fps, %d threads %.1f fps (%.2fx)\n",
+        grids[i] * grids[i], n_frames / single, n_threads, n_frames / multi,
+        single / multi);
+  }
+
+  return 0;
+}
@@ -0,0 +1,225 @@
+/* GStreamer
+ *
+ * curlhttpsrc-bench.c: benchmark program for curlhttpsrc over loopback
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program runs a minimal HTTP server on the loopback interface and
+ * downloads a number of segments from it with curlhttpsrc into a fakesink,
+ * then prints the throughput and the peak resident set size of the
+ * process, eg:
+ *
+ *   curlhttpsrc-bench --size 256 --segments 4
+ *   curlhttpsrc-bench --size 64 --consumer-delay 1000
+ *   curlhttpsrc-bench --size 256 -e souphttpsrc
+ *
+ * With --consumer-delay, the sink sleeps for each buffer, so the network is
+ * faster than the pipeline and the memory use shows how much data the
+ * source holds back.
+ */
+
+#include <string.h>
+#include <sys/resource.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#define WRITE_SIZE (64 * 1024)
+
+static gint size_mb = 256;
+static gint n_segments = 1;
+static gint consumer_delay = 0;
+static gchar *element = NULL;
+
+/* Minimal keep-alive HTTP/1.1 server answering every GET with a segment of
+ * size_mb MB */
+static gboolean
+run_server (GThreadedSocketService * service, GSocketConnection * connection,
+    GObject * source_object, gpointer user_data)
+{
+  GInputStream *in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  GOutputStream *out =
+      g_io_stream_get_output_stream (G_IO_STREAM (connection));
+  GDataInputStream *data = g_data_input_stream_new (in);
+  guint8 *body = g_malloc0 (WRITE_SIZE);
+  guint64 segment_size = (guint64) size_mb * 1024 * 1024;
+  gchar *line;
+
+  g_data_input_stream_set_newline_type (data, G_DATA_STREAM_NEWLINE_TYPE_ANY);
+  while ((line = g_data_input_stream_read_line (data, NULL, NULL, NULL))) {
+    gboolean end_of_request = (line[0] == '\0');
+    gchar *headers;
+    guint64 written = 0;
+
+    g_free (line);
+    if (!end_of_request)
+      continue;
+
+    headers = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/octet-stream\r\n"
+        "Content-Length: %" G_GUINT64_FORMAT "\r\n\r\n", segment_size);
+    if (!g_output_stream_write_all (out, headers, strlen (headers), NULL,
+            NULL, NULL)) {
+      g_free (headers);
+      break;
+    }
+    g_free (headers);
+
+    while (written < segment_size) {
+      gsize len = MIN (WRITE_SIZE, segment_size - written);
+
+      if (!g_output_stream_write_all (out, body, len, NULL, NULL, NULL))
+        break;
+      written += len;
+    }
+    if (written < segment_size)
+      break;
+  }
+
+  g_free (body);
+  g_object_unref (data);
+  return TRUE;
+}
+
+static void
+sink_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  g_usleep (consumer_delay);
+}
+
+static glong
+get_peak_rss (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  /* in kilobytes on Linux */
+  return usage.ru_maxrss;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"size", 's', 0, G_OPTION_ARG_INT, &size_mb,
+        "Size of each segment in MB", NULL},
+    {"segments", 'n', 0, G_OPTION_ARG_INT, &n_segments,
+        "Number of segments to download in a row", NULL},
+    {"consumer-delay", 'd', 0, G_OPTION_ARG_INT, &consumer_delay,
+        "Time in microseconds the sink spends on each buffer", NULL},
+    {"element", 'e', 0, G_OPTION_ARG_STRING, &element,
+        "HTTP source to use (default: curlhttpsrc)", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GSocketService *service;
+  GstElement *pipeline, *src, *sink;
+  GstBus *bus;
+  guint16 port;
+  glong rss_before;
+  gint64 start;
+  gdouble elapsed;
+  gint i;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (size_mb <= 0 || n_segments <= 0 || consumer_delay < 0) {
+    g_printerr ("Invalid parameters\n");
+    return 1;
+  }
+
+  service = g_threaded_socket_service_new (4);
+  port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service),
+      NULL, &err);
+  if (port == 0) {
+    g_printerr ("Failed to listen: %s\n", err->message);
+    g_clear_error (&err);
+    return 1;
+  }
+  g_signal_connect (service, "run", G_CALLBACK (run_server), NULL);
+  g_socket_service_start (service);
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make (element ? element : "curlhttpsrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!src || !sink) {
+    g_printerr ("Missing elements\n");
+    return 1;
+  }
+  g_object_set (src, "proxy", NULL, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  if (consumer_delay > 0) {
+    g_object_set (sink, "signal-handoffs", TRUE, NULL);
+    g_signal_connect (sink, "handoff", G_CALLBACK (sink_handoff), NULL);
+  }
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  gst_element_link (src, sink);
+  bus = gst_element_get_bus (pipeline);
+
+  rss_before = get_peak_rss ();
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_segments; i++) {
+    gchar *uri = g_strdup_printf ("http://127.0.0.1:%u/segment%d", port, i);
+    GstMessage *msg;
+
+    g_object_set (src, "location", uri, NULL);
+    g_free (uri);
+
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+      gst_message_parse_error (msg, &err, NULL);
+      g_printerr ("ERROR: %s\n", err->message);
+      g_clear_error (&err);
+      gst_message_unref (msg);
+      return 1;
+    }
+    gst_message_unref (msg);
+    gst_element_set_state (pipeline, GST_STATE_READY);
+  }
+
+  elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+  g_print ("%d x %d MB in %.3f s: %.1f MB/s, %.1f Mbit/s, peak RSS %ld kB "
+      "(%ld kB before the downloads)\n", n_segments, size_mb, elapsed,
+      n_segments * size_mb / elapsed, n_segments * size_mb * 8.388608 /
+      elapsed, get_peak_rss (), rss_before);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (pipeline);
+
+  g_socket_service_stop (service);
+  g_socket_listener_close (G_SOCKET_LISTENER (service));
+  g_object_unref (service);
+  g_free (element);
+
+  return 0;
+}
@@ -0,0 +1,131 @@
+/* GStreamer
+ *
+ * gaussianblur-bench.c: benchmark program for the gaussianblur element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program blurs frames with gaussianblur for a range of sigma values,
+ * once on a single thread and once on --threads threads, and prints how
+ * many frames per second were blurred, eg:
+ *
+ *   gaussianblur-bench --frames 100 --width 1920 --height 1080 --threads 4
+ *
+ * Negative sigma values sharpen, 0 copies the frame.
+ */
+
+#include <gst/gst.h>
+
+static gint n_frames = 100;
+static gint width = 1920;
+static gint height = 1080;
+static gint n_threads = 0;
+
+static gdouble
+run (gdouble sigma, guint threads)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *desc;
+  gchar sigma_str[G_ASCII_DTOSTR_BUF_SIZE];
+  gint64 start;
+  gdouble elapsed = -1;
+
+  /* a solid colour costs next to nothing to generate, and the blur doesn't
+   * depend on the content */
+  desc = g_strdup_printf ("videotestsrc pattern=solid-color num-buffers=%d ! "
+      "video/x-raw,format=AYUV,width=%d,height=%d,framerate=30/1 ! "
+      "gaussianblur sigma=%s n-threads=%u ! fakesink sync=false", n_frames,
+      width, height, g_ascii_dtostr (sigma_str, sizeof (sigma_str), sigma),
+      threads);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+        "Number of frames to blur", NULL},
+    {"width", 0, 0, G_OPTION_ARG_INT, &width, "Frame width", NULL},
+    {"height", 0, 0, G_OPTION_ARG_INT, &height, "Frame height", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+        "Number of threads to compare with (0 = number of processors)", NULL},
+    {NULL}
+  };
+  static const gdouble sigmas[] = { -2.0, 0.0, 0.5, 1.2, 2.0, 5.0, 10.0, 20.0 };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_threads <= 0)
+    n_threads = g_get_num_processors ();
+
+  for (i = 0; i < G_N_ELEMENTS (sigmas); i++) {
+    gdouble single, multi;
+
+    single = run (sigmas[i], 1);
+    multi = run (sigmas[i], n_threads);
+    if (single <= 0 || multi <= 0)
+      return 1;
+
+    g_print ("sigma %5.1f: 1 thread %.1f fps, %d threads %.1f fps (%.2fx)\n",
+        sigmas[i], n_frames / single, n_threads, n_frames / multi,
+        single / multi);
+  }
+
+  return 0;
+}
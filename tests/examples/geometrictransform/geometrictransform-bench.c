@@ -0,0 +1,146 @@
+/* GStreamer
+ *
+ * geometrictransform-bench.c: benchmark program for the geometrictransform
+ * elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program runs frames through geometrictransform elements with
+ * nearest neighbour mapping on one thread, and with nearest neighbour and
+ * bilinear mapping on --threads threads, and prints how many frames per
+ * second each did, eg:
+ *
+ *   geometrictransform-bench --frames 300 --threads 4 fisheye rotate diffuse
+ *
+ * Without element names, all the elements of the plugin are run.
+ */
+
+#include <gst/gst.h>
+
+static gint n_frames = 300;
+static gint width = 1920;
+static gint height = 1080;
+static gint n_threads = 0;
+static gchar *format = NULL;
+
+static gdouble
+run (const gchar * element, guint threads, const gchar * interpolation)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *desc;
+  gint64 start;
+  gdouble elapsed = -1;
+
+  /* a solid colour costs next to nothing to generate */
+  desc = g_strdup_printf ("videotestsrc pattern=solid-color num-buffers=%d ! "
+      "video/x-raw,format=%s,width=%d,height=%d,framerate=60/1 ! "
+      "%s n-threads=%u interpolation=%s ! fakesink sync=false", n_frames,
+      format ? format : "BGRx", width, height, element, threads,
+      interpolation);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  /* the map is generated on the first frame, leave it out */
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+        "Number of frames to transform", NULL},
+    {"width", 0, 0, G_OPTION_ARG_INT, &width, "Frame width", NULL},
+    {"height", 0, 0, G_OPTION_ARG_INT, &height, "Frame height", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+        "Number of threads to compare with (0 = number of processors)", NULL},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Video format (default: BGRx)", NULL},
+    {NULL}
+  };
+  static const gchar *all_elements[] = {
+    "bulge", "circle", "diffuse", "fisheye", "kaleidoscope", "marble",
+    "mirror", "perspective", "pinch", "rotate", "sphere", "square",
+    "stretch", "tunnel", "twirl", "waterripple", NULL
+  };
+  const gchar *const *elements = all_elements;
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("[ELEMENT...]");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc > 1)
+    elements = (const gchar * const *) argv + 1;
+  if (n_threads <= 0)
+    n_threads = g_get_num_processors ();
+
+  g_print ("%-14s %12s %12s %12s\n", "fps", "1 thread", "threads",
+      "bilinear");
+  for (i = 0; elements[i]; i++) {
+    gdouble single, multi, bilinear;
+
+    single = run (elements[i], 1, "nearest");
+    multi = run (elements[i], n_threads, "nearest");
+    bilinear = run (elements[i], n_threads, "bilinear");
+    if (single <= 0 || multi <= 0 || bilinear <= 0)
+      return 1;
+
+    g_print ("%-14s %12.1f %12.1f %12.1f\n", elements[i], n_frames / single,
+        n_frames / multi, n_frames / bilinear);
+  }
+
+  g_free (format);
+
+  return 0;
+}
@@ -0,0 +1,188 @@
+/* GStreamer
+ *
+ * benchmark program for the ipcpipelinesrc/ipcpipelinesink elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program pushes a number of fixed size buffers from fakesrc to a
+ * fakesink running in a different process and prints how many buffers
+ * per second went through, eg:
+ *
+ *   ipc-bench --buffers 100000 --size 64
+ *   ipc-bench --buffers 1000 --size 8294400 --shared-memory
+ */
+
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <gst/gst.h>
+
+static GMainLoop *loop = NULL;
+static gint n_buffers = 10000;
+static gint buffer_size = 64;
+static gboolean shared_memory = FALSE;
+static gint64 start_time;
+
+static gboolean
+master_bus_msg (GstBus * bus, GstMessage * msg, gpointer data)
+{
+  GstPipeline *pipeline = data;
+
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GError *err;
+      gchar *dbg;
+
+      gst_message_parse_error (msg, &err, &dbg);
+      g_printerr ("ERROR: %s\n", err->message);
+      if (dbg != NULL)
+        g_printerr ("ERROR debug information: %s\n", dbg);
+      g_error_free (err);
+      g_free (dbg);
+
+      g_main_loop_quit (loop);
+      break;
+    }
+    case GST_MESSAGE_EOS:{
+      gdouble elapsed =
+          (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC;
+
+      g_print ("%d buffers of %d bytes in %.3f s: %.0f buffers/s, "
+          "%.1f MB/s\n", n_buffers, buffer_size, elapsed,
+          n_buffers / elapsed, n_buffers * (gdouble) buffer_size / elapsed /
+          (1024 * 1024));
+      gst_element_set_state (GST_ELEMENT (pipeline), GST_STATE_NULL);
+      g_main_loop_quit (loop);
+      break;
+    }
+    default:
+      break;
+  }
+  return TRUE;
+}
+
+static void
+start_source (int fdin, int fdout)
+{
+  GstElement *pipeline;
+  GstElement *source, *ipcpipelinesink;
+
+  pipeline = gst_pipeline_new (NULL);
+  gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), master_bus_msg, pipeline);
+
+  source = gst_element_factory_make ("fakesrc", NULL);
+  gst_util_set_object_arg (G_OBJECT (source), "sizetype", "fixed");
+  g_object_set (source, "sizemax", buffer_size, "num-buffers", n_buffers,
+      NULL);
+
+  ipcpipelinesink = gst_element_factory_make ("ipcpipelinesink", NULL);
+  g_object_set (ipcpipelinesink, "fdin", fdin, "fdout", fdout,
+      "shared-memory", shared_memory, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), source, ipcpipelinesink, NULL);
+  gst_element_link (source, ipcpipelinesink);
+
+  start_time = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+}
+
+static void
+start_sink (int fdin, int fdout)
+{
+  GstElement *pipeline;
+  GstElement *ipcpipelinesrc, *sink;
+
+  pipeline = gst_element_factory_make ("ipcslavepipeline", NULL);
+  ipcpipelinesrc = gst_element_factory_make ("ipcpipelinesrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+  g_object_set (ipcpipelinesrc, "fdin", fdin, "fdout", fdout, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), ipcpipelinesrc, sink, NULL);
+  gst_element_link (ipcpipelinesrc, sink);
+}
+
+static void
+run (pid_t pid)
+{
+  loop = g_main_loop_new (NULL, FALSE);
+  g_main_loop_run (loop);
+  if (pid > 0)
+    kill (pid, SIGTERM);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"buffers", 'n', 0, G_OPTION_ARG_INT, &n_buffers,
+        "Number of buffers to send", NULL},
+    {"size", 's', 0, G_OPTION_ARG_INT, &buffer_size,
+        "Size of the buffers in bytes", NULL},
+    {"shared-memory", 'm', 0, G_OPTION_ARG_NONE, &shared_memory,
+        "Send buffers through shared memory", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  int sockets[2];
+  pid_t pid;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    fprintf (stderr, "Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sockets)) {
+    fprintf (stderr, "Error creating sockets: %s\n", strerror (errno));
+    return 1;
+  }
+  if (fcntl (sockets[0], F_SETFL, O_NONBLOCK) < 0 ||
+      fcntl (sockets[1], F_SETFL, O_NONBLOCK) < 0) {
+    fprintf (stderr, "Error setting O_NONBLOCK on sockets: %s\n",
+        strerror (errno));
+    return 1;
+  }
+
+  pid = fork ();
+  if (pid < 0) {
+    fprintf (stderr, "Error forking: %s\n", strerror (errno));
+    return 1;
+  } else if (pid > 0) {
+    gst_init (&argc, &argv);
+    start_source (sockets[0], sockets[0]);
+  } else {
+    gst_init (&argc, &argv);
+    start_sink (sockets[1], sockets[1]);
+  }
+
+  run (pid);
+
+  return 0;
+}
@@ -0,0 +1,327 @@
+/* GStreamer
+ *
+ * tsdemux-bench.c: benchmark program for tsdemux on synthetic multiplexes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program generates a transport stream in memory and times how long
+ * a demuxer takes to go through it. The multiplex holds one program with a
+ * single video stream, and packets on a number of other PIDs which are in
+ * no program, the way a full satellite or cable multiplex looks to a
+ * demuxer only interested in one service, eg:
+ *
+ *   tsdemux-bench --seconds 2 --bitrate 1000 --other-pids 40
+ *   tsdemux-bench --seconds 2 --bitrate 1000 --other-pids 40 -e tsparse
+ *
+ * With --pes-packets, video PES packets can be made as large as the frames
+ * of a high bitrate stream, eg. about 1 MB for 4K video at 200 Mbit/s:
+ *
+ *   tsdemux-bench --seconds 5 --bitrate 200 --other-pids 0 --pes-packets 5500
+ *
+ * The whole multiplex is kept in memory, 125 MB per second at 1 Gbit/s.
+ *
+ * tsparse looks at every packet, which gives a point of comparison for the
+ * PID filtering done by tsdemux.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/gst.h>
+
+#define PACKET_SIZE 188
+#define PMT_PID 0x1000
+#define VIDEO_PID 0x100
+#define FIRST_OTHER_PID 0x200
+
+/* PAT and PMT are repeated every 100 ms, PCRs sent every 40 ms */
+#define PSI_INTERVAL (GST_SECOND / 10)
+#define PCR_INTERVAL (GST_SECOND / 25)
+
+/* Size of the buffers pushed into the demuxer */
+#define CHUNK_PACKETS 1024
+
+static gint seconds = 2;
+static gint bitrate = 1000;
+static gint other_pids = 40;
+static gint pes_packets = 100;
+static gchar *element = NULL;
+
+typedef struct
+{
+  guint8 *data;
+  guint64 n_packets;
+  guint64 n;
+  guint8 cc[0x2000];
+} TsWriter;
+
+static guint32
+crc32_mpeg (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+/* Writes the next packet. The payload is padded with 0xff, a PCR (in 90 kHz
+ * units) is put in the adaptation field if not -1 */
+static void
+write_packet (TsWriter * w, guint16 pid, gboolean pusi, gint64 pcr,
+    const guint8 * payload, guint len)
+{
+  guint8 *pkt = w->data + w->n * PACKET_SIZE;
+  guint i = 4;
+
+  pkt[0] = 0x47;
+  pkt[1] = (pusi ? 0x40 : 0x00) | (pid >> 8);
+  pkt[2] = pid & 0xff;
+  pkt[3] = (pcr != -1 ? 0x30 : 0x10) | (w->cc[pid]++ & 0x0f);
+
+  if (pcr != -1) {
+    pkt[i++] = 7;
+    pkt[i++] = 0x10;
+    pkt[i++] = pcr >> 25;
+    pkt[i++] = pcr >> 17;
+    pkt[i++] = pcr >> 9;
+    pkt[i++] = pcr >> 1;
+    pkt[i++] = ((pcr & 1) << 7) | 0x7e;
+    pkt[i++] = 0x00;
+  }
+
+  len = MIN (len, PACKET_SIZE - i);
+  memcpy (pkt + i, payload, len);
+  memset (pkt + i + len, 0xff, PACKET_SIZE - i - len);
+  w->n++;
+}
+
+static void
+write_section (TsWriter * w, guint16 pid, const guint8 * section, guint len)
+{
+  guint8 buf[PACKET_SIZE];
+
+  buf[0] = 0;
+  memcpy (buf + 1, section, len);
+  GST_WRITE_UINT32_BE (buf + 1 + len, crc32_mpeg (section, len));
+  write_packet (w, pid, TRUE, -1, buf, len + 5);
+}
+
+static void
+write_pes_header (guint8 * pes, guint64 pts)
+{
+  pes[0] = 0x00;
+  pes[1] = 0x00;
+  pes[2] = 0x01;
+  pes[3] = 0xe0;
+  pes[4] = 0x00;
+  pes[5] = 0x00;
+  pes[6] = 0x84;
+  pes[7] = 0x80;
+  pes[8] = 0x05;
+  pes[9] = 0x21 | ((pts >> 29) & 0x0e);
+  pes[10] = pts >> 22;
+  pes[11] = 0x01 | ((pts >> 14) & 0xfe);
+  pes[12] = pts >> 7;
+  pes[13] = 0x01 | ((pts << 1) & 0xfe);
+  /* an IDR slice, then filler */
+  pes[14] = 0x00;
+  pes[15] = 0x00;
+  pes[16] = 0x01;
+  pes[17] = 0x65;
+  memset (pes + 18, 0x80, PACKET_SIZE - 18);
+}
+
+static GstBuffer *
+create_multiplex (void)
+{
+  static const guint8 pat[] = {
+    0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff
+  };
+  static const guint8 pmt[] = {
+    0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00,
+    0x1b, 0xe0 | (VIDEO_PID >> 8), VIDEO_PID & 0xff, 0xf0, 0x00
+  };
+  guint8 payload[PACKET_SIZE];
+  GstClockTime next_psi = 0, next_pcr = 0;
+  guint video_packets = 0;
+  TsWriter w = { NULL, };
+
+  w.n_packets = (guint64) seconds * bitrate * 1000000 / 8 / PACKET_SIZE;
+  w.data = g_malloc (w.n_packets * PACKET_SIZE);
+  memset (payload, 0x80, sizeof (payload));
+
+  while (w.n < w.n_packets) {
+    GstClockTime ts = gst_util_uint64_scale (w.n * PACKET_SIZE * 8,
+        GST_SECOND, bitrate * G_GUINT64_CONSTANT (1000000));
+    guint64 ts_90k = gst_util_uint64_scale (ts, 9, GST_MSECOND / 10);
+    guint stream = w.n % (other_pids + 1);
+
+    if (ts >= next_psi && w.n + 2 <= w.n_packets) {
+      write_section (&w, 0, pat, sizeof (pat));
+      write_section (&w, PMT_PID, pmt, sizeof (pmt));
+      next_psi += PSI_INTERVAL;
+    } else if (stream == 0) {
+      gint64 pcr = -1;
+
+      if (ts >= next_pcr) {
+        pcr = ts_90k;
+        next_pcr += PCR_INTERVAL;
+      }
+      if (video_packets % pes_packets == 0) {
+        guint8 pes[PACKET_SIZE];
+
+        /* decoded 100 ms after it arrives */
+        write_pes_header (pes, ts_90k + 9000);
+        write_packet (&w, VIDEO_PID, TRUE, pcr, pes, sizeof (pes));
+      } else {
+        write_packet (&w, VIDEO_PID, FALSE, pcr, payload, sizeof (payload));
+      }
+      video_packets++;
+    } else {
+      write_packet (&w, FIRST_OTHER_PID + stream - 1, FALSE, -1, payload,
+          sizeof (payload));
+    }
+  }
+
+  return gst_buffer_new_wrapped (w.data, w.n_packets * PACKET_SIZE);
+}
+
+static void
+pad_added_cb (GstElement * demux, GstPad * pad, GstElement * pipeline)
+{
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *sinkpad;
+
+  g_object_set (sink, "sync", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  gst_object_unref (sinkpad);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"seconds", 's', 0, G_OPTION_ARG_INT, &seconds,
+        "Duration of the multiplex", NULL},
+    {"bitrate", 'b', 0, G_OPTION_ARG_INT, &bitrate,
+        "Bitrate of the multiplex in Mbit/s", NULL},
+    {"other-pids", 'p', 0, G_OPTION_ARG_INT, &other_pids,
+        "Number of PIDs not belonging to the program", NULL},
+    {"pes-packets", 'P', 0, G_OPTION_ARG_INT, &pes_packets,
+        "Number of TS packets per video PES", NULL},
+    {"element", 'e', 0, G_OPTION_ARG_STRING, &element,
+        "Demuxer to use (default: tsdemux)", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstElement *pipeline, *src, *demux;
+  GstBuffer *mux;
+  GstCaps *caps;
+  GstMessage *msg;
+  gsize mux_size;
+  guint64 n_packets;
+  gint64 start;
+  gdouble elapsed;
+  guint64 i;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (seconds <= 0 || bitrate <= 0 || other_pids < 0 || pes_packets <= 0) {
+    g_printerr ("Invalid multiplex parameters\n");
+    return 1;
+  }
+
+  mux = create_multiplex ();
+  mux_size = gst_buffer_get_size (mux);
+  n_packets = mux_size / PACKET_SIZE;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("appsrc", NULL);
+  demux = gst_element_factory_make (element ? element : "tsdemux", NULL);
+  if (!src || !demux) {
+    g_printerr ("Missing elements\n");
+    return 1;
+  }
+  caps = gst_caps_new_simple ("video/mpegts", "systemstream", G_TYPE_BOOLEAN,
+      TRUE, "packetsize", G_TYPE_INT, PACKET_SIZE, NULL);
+  g_object_set (src, "caps", caps, "max-bytes", (guint64) 0, NULL);
+  gst_caps_unref (caps);
+  gst_bin_add_many (GST_BIN (pipeline), src, demux, NULL);
+  gst_element_link (src, demux);
+  g_signal_connect (demux, "pad-added", G_CALLBACK (pad_added_cb), pipeline);
+
+  /* everything is queued up front, only the demuxing is timed */
+  for (i = 0; i < n_packets; i += CHUNK_PACKETS) {
+    GstBuffer *buf = gst_buffer_copy_region (mux, GST_BUFFER_COPY_MEMORY,
+        i * PACKET_SIZE, MIN (CHUNK_PACKETS, n_packets - i) * PACKET_SIZE);
+    GstFlowReturn ret;
+
+    g_signal_emit_by_name (src, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", NULL);
+  gst_buffer_unref (mux);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  } else {
+    g_print ("%" G_GUINT64_FORMAT " packets (%.1f MB) in %.3f s: "
+        "%.0f packets/s, %.1f MB/s, %.1f Mbit/s\n", n_packets,
+        mux_size / (1024.0 * 1024.0), elapsed, n_packets / elapsed,
+        mux_size / elapsed / (1024 * 1024), mux_size * 8 / elapsed / 1000000);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_free (element);
+
+  return 0;
+}
@@ -0,0 +1,190 @@
+/* GStreamer
+ *
+ * tsmux-bench.c: benchmark program for mpegtsmux across bitrates
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program muxes a synthetic H.264 stream of 25 frames per second, with
+ * a keyframe every second, at a number of bitrates and prints how fast
+ * mpegtsmux produced the transport stream, eg:
+ *
+ *   tsmux-bench --seconds 10 --alignment 7
+ *
+ * The frames only hold an access unit delimiter and a slice NAL header
+ * followed by filler, mpegtsmux doesn't look any further.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/gst.h>
+
+#define PACKET_SIZE 188
+#define FPS 25
+
+static gint seconds = 10;
+static gint alignment = -1;
+
+static GstBuffer *
+create_frame (gsize size, gboolean keyframe)
+{
+  static const guint8 aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+  guint8 *data = g_malloc (size);
+
+  memcpy (data, aud, sizeof (aud));
+  data[6] = 0x00;
+  data[7] = 0x00;
+  data[8] = 0x01;
+  data[9] = keyframe ? 0x65 : 0x41;
+  memset (data + 10, 0x80, size - 10);
+
+  return gst_buffer_new_wrapped (data, size);
+}
+
+static void
+sink_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    guint64 * bytes)
+{
+  *bytes += gst_buffer_get_size (buf);
+}
+
+static gdouble
+run (guint mbps, guint64 * bytes)
+{
+  GstElement *pipeline, *src, *mux, *sink;
+  GstBuffer *keyframe, *delta;
+  GstCaps *caps;
+  GstMessage *msg;
+  GError *err = NULL;
+  gsize frame_size = (gsize) mbps * 1000000 / 8 / FPS;
+  gint64 start;
+  gdouble elapsed = -1;
+  guint i;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("appsrc", NULL);
+  mux = gst_element_factory_make ("mpegtsmux", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  if (!src || !mux || !sink) {
+    g_printerr ("Missing elements\n");
+    return -1;
+  }
+
+  caps = gst_caps_new_simple ("video/x-h264", "stream-format", G_TYPE_STRING,
+      "byte-stream", "alignment", G_TYPE_STRING, "au", "width", G_TYPE_INT,
+      1920, "height", G_TYPE_INT, 1080, "framerate", GST_TYPE_FRACTION, FPS, 1,
+      NULL);
+  g_object_set (src, "caps", caps, "format", GST_FORMAT_TIME, "max-bytes",
+      (guint64) 0, NULL);
+  gst_caps_unref (caps);
+  g_object_set (mux, "alignment", alignment, NULL);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  *bytes = 0;
+  g_signal_connect (sink, "handoff", G_CALLBACK (sink_handoff), bytes);
+  gst_bin_add_many (GST_BIN (pipeline), src, mux, sink, NULL);
+  gst_element_link_many (src, mux, sink, NULL);
+
+  /* everything is queued up front, only the muxing is timed. The frames
+   * share the memory of two buffers. */
+  keyframe = create_frame (frame_size, TRUE);
+  delta = create_frame (frame_size, FALSE);
+  for (i = 0; i < seconds * FPS; i++) {
+    GstBuffer *buf = gst_buffer_copy (i % FPS == 0 ? keyframe : delta);
+    GstFlowReturn ret;
+
+    GST_BUFFER_PTS (buf) = GST_BUFFER_DTS (buf) =
+        gst_util_uint64_scale_int (i, GST_SECOND, FPS);
+    GST_BUFFER_DURATION (buf) = GST_SECOND / FPS;
+    if (i % FPS != 0)
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+    g_signal_emit_by_name (src, "push-buffer", buf, &ret);
+    gst_buffer_unref (buf);
+  }
+  g_signal_emit_by_name (src, "end-of-stream", NULL);
+  gst_buffer_unref (keyframe);
+  gst_buffer_unref (delta);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"seconds", 's', 0, G_OPTION_ARG_INT, &seconds,
+        "Duration of the stream", NULL},
+    {"alignment", 'a', 0, G_OPTION_ARG_INT, &alignment,
+        "mpegtsmux alignment (-1 = none, 7 = 7 packets as for UDP)", NULL},
+    {NULL}
+  };
+  static const guint bitrates[] = { 2, 8, 20, 80, 200 };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (seconds <= 0) {
+    g_printerr ("Invalid duration\n");
+    return 1;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (bitrates); i++) {
+    guint64 bytes;
+    gdouble elapsed;
+
+    elapsed = run (bitrates[i], &bytes);
+    if (elapsed <= 0)
+      return 1;
+
+    g_print ("%3u Mbit/s: %" G_GUINT64_FORMAT " packets in %.3f s, "
+        "%.0f packets/s, %.1f Mbit/s (%.0fx realtime)\n", bitrates[i],
+        bytes / PACKET_SIZE, elapsed, bytes / PACKET_SIZE / elapsed,
+        bytes * 8 / elapsed / 1000000, seconds / elapsed);
+  }
+
+  return 0;
+}
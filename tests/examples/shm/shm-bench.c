@@ -0,0 +1,219 @@
+/* GStreamer
+ *
+ * shm-bench.c: benchmark program for the shmsink/shmsrc elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program pushes buffers from fakesrc into shmsink and receives them
+ * with shmsrc in a child process. Each buffer carries the time it was
+ * produced at, and the child prints the throughput and the mean and
+ * maximum latency of the handoff, eg:
+ *
+ *   shm-bench --buffers 100000 --size 1024
+ *   shm-bench --buffers 100000 --size 1024 --ring-size 64
+ *
+ * With --ring-size 0 every buffer goes over the control socket, otherwise
+ * through the shared descriptor ring.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <gst/gst.h>
+
+static gint n_buffers = 100000;
+static gint buffer_size = 1024;
+static gint ring_size = 0;
+static gchar *socket_path = NULL;
+
+typedef struct
+{
+  GMainLoop *loop;
+  gint received;
+  gint64 start;
+  gint64 total_latency;
+  gint64 max_latency;
+} SinkData;
+
+static void
+src_handoff (GstElement * fakesrc, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  gst_buffer_fill (buf, 0, &now, sizeof (now));
+}
+
+static void
+sink_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    SinkData * data)
+{
+  gint64 now = g_get_monotonic_time (), then;
+
+  gst_buffer_extract (buf, 0, &then, sizeof (then));
+  if (data->received++ == 0)
+    data->start = now;
+  data->total_latency += now - then;
+  data->max_latency = MAX (data->max_latency, now - then);
+
+  if (data->received == n_buffers)
+    g_main_loop_quit (data->loop);
+}
+
+static gboolean
+bus_msg (GstBus * bus, GstMessage * msg, gpointer user_data)
+{
+  GMainLoop *loop = user_data;
+
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GError *err;
+
+      gst_message_parse_error (msg, &err, NULL);
+      g_printerr ("ERROR: %s\n", err->message);
+      g_error_free (err);
+      g_main_loop_quit (loop);
+      break;
+    }
+    case GST_MESSAGE_EOS:
+      g_main_loop_quit (loop);
+      break;
+    default:
+      break;
+  }
+  return TRUE;
+}
+
+static void
+run_source (void)
+{
+  GMainLoop *loop = g_main_loop_new (NULL, FALSE);
+  GstElement *pipeline, *src, *sink;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("fakesrc", NULL);
+  sink = gst_element_factory_make ("shmsink", NULL);
+  gst_util_set_object_arg (G_OBJECT (src), "sizetype", "fixed");
+  g_object_set (src, "sizemax", buffer_size, "num-buffers", n_buffers,
+      "signal-handoffs", TRUE, NULL);
+  g_signal_connect (src, "handoff", G_CALLBACK (src_handoff), NULL);
+  g_object_set (sink, "socket-path", socket_path, "ring-size", ring_size,
+      "wait-for-connection", TRUE, "sync", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  gst_element_link (src, sink);
+
+  gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), bus_msg, loop);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (loop);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (loop);
+}
+
+static void
+run_sink (void)
+{
+  SinkData data = { g_main_loop_new (NULL, FALSE), 0, };
+  GstElement *pipeline, *src, *sink;
+  gdouble elapsed;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("shmsrc", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (src, "socket-path", socket_path, NULL);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (sink_handoff), &data);
+  gst_bin_add_many (GST_BIN (pipeline), src, sink, NULL);
+  gst_element_link (src, sink);
+
+  gst_bus_add_watch (GST_ELEMENT_BUS (pipeline), bus_msg, data.loop);
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (data.loop);
+
+  elapsed = (g_get_monotonic_time () - data.start) / (gdouble) G_USEC_PER_SEC;
+  if (data.received > 0)
+    g_print ("%d buffers of %d bytes in %.3f s: %.0f buffers/s, "
+        "latency mean %.1f us, max %" G_GINT64_FORMAT " us\n", data.received,
+        buffer_size, elapsed, data.received / elapsed,
+        data.total_latency / (gdouble) data.received, data.max_latency);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (data.loop);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"buffers", 'n', 0, G_OPTION_ARG_INT, &n_buffers,
+        "Number of buffers to send", NULL},
+    {"size", 's', 0, G_OPTION_ARG_INT, &buffer_size,
+        "Size of the buffers in bytes", NULL},
+    {"ring-size", 'r', 0, G_OPTION_ARG_INT, &ring_size,
+        "Size of the descriptor ring, 0 to use the control socket", NULL},
+    {"socket-path", 'p', 0, G_OPTION_ARG_STRING, &socket_path,
+        "Path of the control socket", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  pid_t pid;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    fprintf (stderr, "Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (buffer_size < sizeof (gint64)) {
+    fprintf (stderr, "Buffers must be at least %u bytes\n",
+        (guint) sizeof (gint64));
+    return 1;
+  }
+  if (socket_path == NULL)
+    socket_path = g_strdup_printf ("/tmp/shm-bench-%d", (int) getpid ());
+
+  pid = fork ();
+  if (pid < 0) {
+    fprintf (stderr, "Error forking: %s\n", strerror (errno));
+    return 1;
+  } else if (pid > 0) {
+    gst_init (&argc, &argv);
+    run_source ();
+    waitpid (pid, NULL, 0);
+  } else {
+    gst_init (&argc, &argv);
+    /* let shmsink create the socket */
+    while (!g_file_test (socket_path, G_FILE_TEST_EXISTS))
+      g_usleep (10000);
+    run_sink ();
+  }
+
+  g_free (socket_path);
+
+  return 0;
+}
@@ -0,0 +1,215 @@
+/* GStreamer
+ *
+ * srtpenc-bench.c: benchmark program for the srtpenc element
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program protects RTP packets with srtpenc and prints how many
+ * packets per second it went through. The packets are pushed as single
+ * buffers and as buffer lists, and either each in its own writable memory
+ * with room for the SRTP trailer, so that they are protected in place, or
+ * all sharing the memory of their payload, so that they are copied, eg:
+ *
+ *   srtpenc-bench --packets 200000 --size 1200 --list-size 32
+ */
+
+#include <string.h>
+#include <gst/gst.h>
+
+#define RTP_HEADER_SIZE 12
+#define SSRC 0x12345678
+
+/* room for the SRTP trailer, more than srtpenc asks for with any version of
+ * libsrtp */
+#define TRAILER_ROOM 256
+
+static gint n_packets = 100000;
+static gint packet_size = 1200;
+static gint list_size = 32;
+
+static void
+write_rtp_header (guint8 * data, guint seq)
+{
+  data[0] = 0x80;
+  data[1] = 96;
+  GST_WRITE_UINT16_BE (data + 2, seq);
+  GST_WRITE_UINT32_BE (data + 4, seq * 3000);
+  GST_WRITE_UINT32_BE (data + 8, SSRC);
+}
+
+/* A packet in its own memory, with tailroom for the trailer */
+static GstBuffer *
+create_writable_packet (guint seq)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, packet_size + TRAILER_ROOM,
+      NULL);
+  GstMapInfo map;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  write_rtp_header (map.data, seq);
+  memset (map.data + RTP_HEADER_SIZE, 0xaa, packet_size - RTP_HEADER_SIZE);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_set_size (buf, packet_size);
+
+  return buf;
+}
+
+/* A packet made of a header and a payload shared by all packets */
+static GstBuffer *
+create_shared_packet (guint seq, GstMemory * payload)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, RTP_HEADER_SIZE, NULL);
+  GstMapInfo map;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  write_rtp_header (map.data, seq);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_append_memory (buf, gst_memory_ref (payload));
+
+  return buf;
+}
+
+static gdouble
+run (gboolean in_place, gboolean lists)
+{
+  GstElement *pipeline, *src;
+  GstBufferList *list = NULL;
+  GstMemory *payload = NULL;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *desc;
+  gint64 start;
+  gdouble elapsed = -1;
+  gint i;
+
+  desc = g_strdup_printf ("appsrc name=src max-bytes=0 caps=\"application/"
+      "x-rtp,media=video,clock-rate=90000,encoding-name=H264,payload=96,"
+      "ssrc=(uint)%u\" ! srtpenc key=0123456789012345678901234567890123456789"
+      "01234567890123456789 ! fakesink sync=false", SSRC);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+
+  if (!in_place) {
+    GstMapInfo map;
+
+    payload = gst_allocator_alloc (NULL, packet_size - RTP_HEADER_SIZE, NULL);
+    gst_memory_map (payload, &map, GST_MAP_WRITE);
+    memset (map.data, 0xaa, map.size);
+    gst_memory_unmap (payload, &map);
+  }
+
+  /* everything is queued up front, only the protection is timed */
+  for (i = 0; i < n_packets; i++) {
+    GstBuffer *buf = in_place ? create_writable_packet (i) :
+        create_shared_packet (i, payload);
+    GstFlowReturn ret;
+
+    if (!lists) {
+      g_signal_emit_by_name (src, "push-buffer", buf, &ret);
+      gst_buffer_unref (buf);
+      continue;
+    }
+
+    if (!list)
+      list = gst_buffer_list_new_sized (list_size);
+    gst_buffer_list_add (list, buf);
+    if (gst_buffer_list_length (list) == list_size || i == n_packets - 1) {
+      g_signal_emit_by_name (src, "push-buffer-list", list, &ret);
+      gst_buffer_list_unref (list);
+      list = NULL;
+    }
+  }
+  g_signal_emit_by_name (src, "end-of-stream", NULL);
+  gst_object_unref (src);
+  if (payload)
+    gst_memory_unref (payload);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"packets", 'n', 0, G_OPTION_ARG_INT, &n_packets,
+        "Number of packets to protect", NULL},
+    {"size", 's', 0, G_OPTION_ARG_INT, &packet_size,
+        "Size of the RTP packets in bytes", NULL},
+    {"list-size", 'l', 0, G_OPTION_ARG_INT, &list_size,
+        "Number of packets per buffer list", NULL},
+    {NULL}
+  };
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (n_packets <= 0 || packet_size <= RTP_HEADER_SIZE || list_size <= 0) {
+    g_printerr ("Invalid parameters\n");
+    return 1;
+  }
+
+  for (i = 0; i < 4; i++) {
+    gboolean in_place = (i & 1) == 0;
+    gboolean lists = (i & 2) != 0;
+    gdouble elapsed;
+
+    elapsed = run (in_place, lists);
+    if (elapsed <= 0)
+      return 1;
+
+    g_print ("%-8s %-14s %.0f packets/s, %.1f Mbit/s\n",
+        in_place ? "in place" : "copied", lists ? "buffer lists" :
+        "single buffers", n_packets / elapsed,
+        (gdouble) n_packets * packet_size * 8 / elapsed / 1000000);
+  }
+
+  return 0;
+}
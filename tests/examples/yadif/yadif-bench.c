@@ -0,0 +1,147 @@
+/* GStreamer
+ *
+ * yadif-bench.c: benchmark program for the yadif line filters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * This program deinterlaces frames with yadif using each of the given line
+ * filters, on one thread and on --threads threads, and prints how many
+ * frames per second each did, eg:
+ *
+ *   yadif-bench --frames 300 --threads 4 c sse2 avx2
+ *
+ * The line filter is picked with the GST_YADIF_FILTER_LINE environment
+ * variable, names the CPU does not support run the fastest one instead.
+ * Without names, the C filter is compared with the default one.
+ */
+
+#include <gst/gst.h>
+
+static gint n_frames = 300;
+static gint width = 1920;
+static gint height = 1080;
+static gint n_threads = 0;
+static gchar *format = NULL;
+
+static gdouble
+run (const gchar * filter_line, guint threads)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GError *err = NULL;
+  gchar *desc;
+  gint64 start;
+  gdouble elapsed = -1;
+
+  if (filter_line)
+    g_setenv ("GST_YADIF_FILTER_LINE", filter_line, TRUE);
+  else
+    g_unsetenv ("GST_YADIF_FILTER_LINE");
+
+  /* yadif filters every frame whatever the interlace mode. The ball moves,
+   * so there is motion to detect, and costs next to nothing to draw */
+  desc = g_strdup_printf ("videotestsrc pattern=ball num-buffers=%d ! "
+      "video/x-raw,format=%s,width=%d,height=%d,framerate=30/1 ! "
+      "yadif n-threads=%u ! fakesink sync=false", n_frames,
+      format ? format : "I420", width, height, threads);
+  pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (!pipeline) {
+    g_printerr ("Failed to create pipeline: %s\n", err->message);
+    g_clear_error (&err);
+    return -1;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS) {
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+  } else {
+    gst_message_parse_error (msg, &err, NULL);
+    g_printerr ("ERROR: %s\n", err->message);
+    g_clear_error (&err);
+  }
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  return elapsed;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionEntry options[] = {
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+        "Number of frames to deinterlace", NULL},
+    {"width", 0, 0, G_OPTION_ARG_INT, &width, "Frame width", NULL},
+    {"height", 0, 0, G_OPTION_ARG_INT, &height, "Frame height", NULL},
+    {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+        "Number of threads to compare with (0 = number of processors)", NULL},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Video format (default: I420)", NULL},
+    {NULL}
+  };
+  static const gchar *default_filters[] = { "c", NULL, };
+  const gchar *const *filters = default_filters;
+  guint n_filters = G_N_ELEMENTS (default_filters);
+  GOptionContext *ctx;
+  GError *err = NULL;
+  guint i;
+
+  ctx = g_option_context_new ("[FILTER...]");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("Error initializing: %s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (argc > 1) {
+    filters = (const gchar * const *) argv + 1;
+    n_filters = argc - 1;
+  }
+  if (n_threads <= 0)
+    n_threads = g_get_num_processors ();
+
+  g_print ("%-14s %12s %12s\n", "fps", "1 thread", "threads");
+  for (i = 0; i < n_filters; i++) {
+    gdouble single, multi;
+
+    single = run (filters[i], 1);
+    multi = run (filters[i], n_threads);
+    if (single <= 0 || multi <= 0)
+      return 1;
+
+    g_print ("%-14s %12.1f %12.1f\n", filters[i] ? filters[i] : "default",
+        n_frames / single, n_frames / multi);
+  }
+
+  g_free (format);
+
+  return 0;
+}